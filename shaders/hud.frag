@@ -0,0 +1,22 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec2 fragUv;
+layout(location = 1) in vec4 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+layout(push_constant) uniform Push {
+    vec2 scale;
+    vec2 translate;
+    uint textureIndex;
+} push;
+
+// The bindless table, see VhlBindlessTable. The HUD binds it as its only set.
+layout(set = 0, binding = 1) uniform sampler2D textures[];
+
+void main()
+{
+    // shapes sample the atlas' white texel
+    outColor = fragColor * texture(textures[push.textureIndex], fragUv);
+}
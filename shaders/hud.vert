@@ -0,0 +1,24 @@
+#version 450
+
+// HudSystem's vertex, written by nuklear
+layout(location = 0) in vec2 position;  // pixels, origin at the top left
+layout(location = 1) in vec2 uv;
+layout(location = 2) in uint color;  // RGBA8 in sRGB, R in the low byte
+
+layout(location = 0) out vec2 fragUv;
+layout(location = 1) out vec4 fragColor;
+
+layout(push_constant) uniform Push {
+    vec2 scale;
+    vec2 translate;
+    uint textureIndex;
+} push;
+
+void main()
+{
+    fragUv = uv;
+    fragColor = unpackUnorm4x8(color);
+    // the swap chain image is sRGB, so blending happens on linear values
+    fragColor.rgb = pow(fragColor.rgb, vec3(2.2));
+    gl_Position = vec4(position * push.scale + push.translate, 0.0, 1.0);
+}
@@ -1,11 +1,20 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec3 fragPosWorld;
 layout(location = 2) in vec3 fragNormalWorld;
+layout(location = 3) in vec2 fragUv;
+layout(location = 4) flat in uint fragTextureIndex;
 
 layout(location = 0) out vec4 outColor;
 
+// Specialized per pipeline variant by SimpleRenderSystem. The UBO block keeps the
+// layout of the default size, so MAX_LIGHTS may only be specialized downwards.
+layout(constant_id = 0) const int MAX_LIGHTS = 10;
+layout(constant_id = 1) const bool SPECULAR_ENABLED = true;
+layout(constant_id = 2) const float SPECULAR_EXPONENT = 256.0;
+
 struct PointLight {
     vec4 position; // ignore w
     vec4 color; // w is intensity
@@ -16,15 +25,12 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 viewMatrix;
     mat4 inverseViewMatrix;
     vec4 ambientLightColor; // w is intensity
-    PointLight pointLight[10];
+    PointLight pointLight[MAX_LIGHTS];
     int numLights;
 } ubo;
 
-layout(push_constant) uniform Push {
-    mat4 modelMatrix;
-    mat4 normalMatrix;
-} push;
-
+// The bindless table, see VhlBindlessTable
+layout(set = 1, binding = 1) uniform sampler2D textures[];
 
 void main()
 {
@@ -35,8 +41,11 @@ void main()
     vec3 cameraWorld = ubo.inverseViewMatrix[3].xyz;
     vec3 viewDirection = normalize(cameraWorld - fragPosWorld);
 
-    for (int i = 0; i < ubo.numLights; i++) 
+    // constant trip count so the driver can unroll, numLights only ends it early
+    for (int i = 0; i < MAX_LIGHTS; i++) 
     {
+        if (i >= ubo.numLights) break;
+
         PointLight light = ubo.pointLight[i];
         vec3 directionToLight = light.position.xyz - fragPosWorld;
         float attenuation = 1.0 / dot(directionToLight, directionToLight);
@@ -48,12 +57,16 @@ void main()
         diffuseLight += intensity * cosAngleIncidence;
 
         // specular lighting
-        vec3 halfAngle = normalize(viewDirection + directionToLight);
-        float blinnTerm = dot(surfaceNormal, halfAngle);
-        blinnTerm = clamp(blinnTerm, 0, 1);
-        blinnTerm = pow(blinnTerm, 256.0);
-        specularLight += blinnTerm * intensity;
+        if (SPECULAR_ENABLED)
+        {
+            vec3 halfAngle = normalize(viewDirection + directionToLight);
+            float blinnTerm = dot(surfaceNormal, halfAngle);
+            blinnTerm = clamp(blinnTerm, 0, 1);
+            blinnTerm = pow(blinnTerm, SPECULAR_EXPONENT);
+            specularLight += blinnTerm * intensity;
+        }
     }
 
-    outColor = vec4((diffuseLight + specularLight) * fragColor, 1.0);
+    vec3 albedo = fragColor * texture(textures[nonuniformEXT(fragTextureIndex)], fragUv).rgb;
+    outColor = vec4((diffuseLight + specularLight) * albedo, 1.0);
 }
\ No newline at end of file
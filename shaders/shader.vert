@@ -8,6 +8,12 @@ layout(location = 3) in vec2 uv;
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragPosWorld;
 layout(location = 2) out vec3 fragNormalWorld;
+layout(location = 3) out vec2 fragUv;
+layout(location = 4) flat out uint fragTextureIndex;
+
+// Specialized per pipeline variant by SimpleRenderSystem. The UBO block keeps the
+// layout of the default size, so MAX_LIGHTS may only be specialized downwards.
+layout(constant_id = 0) const int MAX_LIGHTS = 10;
 
 struct PointLight {
     vec4 position; // ignore w
@@ -19,23 +25,34 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 viewMatrix;
     mat4 inverseViewMatrix;
     vec4 ambientLightColor; // w is intensity
-    PointLight pointLight[10];
+    PointLight pointLight[MAX_LIGHTS];
     int numLights;
 } ubo;
 
-layout(push_constant) uniform Push {
-    mat4 modelMatrix;
-    mat4 normalMatrix;
-} push;
+// Written once per frame by SimpleRenderSystem and indexed by the draw's firstInstance, so
+// indirect draws need no per-draw push constants. modelMatrix holds the three rows of the affine
+// model transform, normalMatrix the three (padded) columns of the normal matrix.
+struct ObjectData {
+    mat3x4 modelMatrix;
+    mat3x4 normalMatrix;
+    uint textureIndex; // slot in the bindless texture array
+};
+
+layout(set = 2, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} objectBuffer;
 
 void main() 
 {
-    vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+    ObjectData object = objectBuffer.objects[gl_InstanceIndex];
+    vec4 positionWorld = vec4(vec4(position, 1.0) * object.modelMatrix, 1.0);
 
     gl_Position = ubo.projectionMatrix * ubo.viewMatrix * positionWorld; 
 
-    fragNormalWorld = normalize(mat3(push.normalMatrix) * normal);
+    fragNormalWorld = normalize(mat3(object.normalMatrix) * normal);
     fragPosWorld = positionWorld.xyz;
     fragColor = color;
+    fragUv = uv;
+    fragTextureIndex = object.textureIndex;
 
 }
\ No newline at end of file
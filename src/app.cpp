@@ -2,27 +2,39 @@
 
 #include "keyboard_movement_controller.hpp"
 #include "vhl_buffer.hpp"
+#include "vhl_profiler.hpp"
+#include "vhl_render_graph_check.hpp"
+#include "vhl_shader_watcher.hpp"
 #include "systems/simple_renderer_system.hpp"
 #include "systems/point_light_system.hpp"
+#include "systems/hud_system.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <stdexcept>
 #include <chrono>
+#include <cstring>
 #include <array>
+#include <filesystem>
+#include <iostream>
 
 namespace vhl 
 {
-    HuiApp::HuiApp() 
+    HuiApp::HuiApp(const HuiAppOptions& options) : m_Options(options)
     {
-        m_GlobalPool = VhlDescriptorPool::Builder(m_VhlDevice)
-            .setMaxSets(VhlSwapChain::MAX_FRAMES_IN_FLIGHT)
-            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VhlSwapChain::MAX_FRAMES_IN_FLIGHT)
-            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VhlSwapChain::MAX_FRAMES_IN_FLIGHT)
-            .build();
+        VHL_PROFILE_THREAD("main");
+        // the HUD lists the zones of the last frame, so it needs them recorded too
+        VhlProfiler::setEnabled(!m_Options.tracePath.empty() || m_Options.hud);
+
+        // long lived sets, grows as systems add their own
+        m_GlobalAllocator = std::make_unique<VhlDescriptorAllocator>(m_VhlDevice, VhlSwapChain::MAX_FRAMES_IN_FLIGHT);
+        m_GlobalSetCache = std::make_unique<VhlDescriptorSetCache>(m_VhlDevice, *m_GlobalAllocator);
+        // sampled by objects without a texture of their own
+        m_DefaultTexture = VhlTexture::createSolidColor(m_VhlDevice, m_BindlessTable, 0xffffffff);
         loadGameObjects();
     }
       
@@ -30,41 +42,76 @@ namespace vhl
 
     void HuiApp::run() 
     {
-        std::vector<std::unique_ptr<VhlBuffer>> uboBuffers(VhlSwapChain::MAX_FRAMES_IN_FLIGHT);
-        for (int i = 0; i < uboBuffers.size(); i++)
+        auto& uniformRing = m_VhlRenderer.getUniformRing();
+        auto& renderStats = m_VhlRenderer.getRenderStats();
+        renderStats.setPipelineStatisticsEnabled(m_Options.pipelineStatistics);
+        std::unique_ptr<VhlRenderStatsLogger> statsLogger{};
+        if (!m_Options.statsPath.empty())
         {
-            uboBuffers[i] = std::make_unique<VhlBuffer>(
-                m_VhlDevice,
-                sizeof(GlobalUBO),
-                1,
-                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-            uboBuffers[i]->map();
+            statsLogger = std::make_unique<VhlRenderStatsLogger>(m_Options.statsPath);
         }
-
-        auto globalSetLayout = VhlDescriptorSetLayout::Builder(m_VhlDevice)
-            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-            .build();
-
-        std::vector<VkDescriptorSet> globalDescriptorSets(VhlSwapChain::MAX_FRAMES_IN_FLIGHT);
-        for (int i = 0; i < globalDescriptorSets.size(); i++)
+        std::unique_ptr<VhlRenderGraphCheck> graphCheck{};
+        if (m_Options.renderGraphCheck)
         {
-            auto bufferInfo = uboBuffers[i]->descriptorInfo();
-            VhlDescriptorWriter(*globalSetLayout, *m_GlobalPool)
-                .writeBuffer(0, &bufferInfo)
-                .build(globalDescriptorSets[i]);
+            graphCheck = std::make_unique<VhlRenderGraphCheck>(m_VhlDevice);
         }
 
+        // the GlobalUBO lives in the uniform ring, frames select their block with a dynamic offset
+        auto globalSetLayout = VhlDescriptorSetLayout::Builder(m_VhlDevice)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL_GRAPHICS)
+            .build(m_PipelineManager.getLayoutCache().getDescriptorLayoutCache());
+
+        VkDescriptorSet globalDescriptorSet;
+        auto bufferInfo = uniformRing.descriptorInfo(sizeof(GlobalUBO));
+        VhlDescriptorWriter(*globalSetLayout, *m_GlobalSetCache)
+            .writeBuffer(0, &bufferInfo)
+            .build(globalDescriptorSet);
+
+        // specialize the light loop for the lights this scene actually has
+        LightingVariant lightingVariant{};
+        lightingVariant.maxLights = std::max(1, static_cast<int>(std::count_if(
+            m_GameObjects.begin(), m_GameObjects.end(),
+            [](const auto& kv) { return kv.second.pointLight != nullptr; })));
+
+        // both pipelines compile in parallel on the manager's workers
         SimpleRenderSystem simpleRenderSystem(
             m_VhlDevice, 
+            m_PipelineManager,
             m_VhlRenderer.getSwapChainRenderPass(), 
-            globalSetLayout->getDescriptorSetLayout());
+            globalSetLayout->getDescriptorSetLayout(),
+            m_BindlessTable,
+            *m_DefaultTexture,
+            lightingVariant);
 
         PointLightSystem pointLightSystem(
             m_VhlDevice, 
+            m_PipelineManager,
             m_VhlRenderer.getSwapChainRenderPass(), 
             globalSetLayout->getDescriptorSetLayout());
 
+        HudSystem hudSystem(
+            m_VhlDevice,
+            m_PipelineManager,
+            m_VhlRenderer.getSwapChainRenderPass(),
+            m_BindlessTable);
+        bool hudVisible = m_Options.hud;
+        bool hudKeyDown = false;
+
+        // edited shaders are recompiled in the background and swapped in between frames. Only in
+        // interactive runs: repeatable and headless ones must render the shaders they started with
+        std::unique_ptr<VhlShaderWatcher> shaderWatcher;
+        if (!m_VhlWindow.isHeadless() && m_Options.fixedTimestep <= 0.f)
+        {
+            try
+            {
+                shaderWatcher = std::make_unique<VhlShaderWatcher>("shaders");
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "shader hot reload disabled: " << e.what() << std::endl;
+            }
+        }
+
         VhlCamera camera{};
         //camera.setViewDirection(glm::vec3(0.f), glm::vec3(0.5f, 0.f, 1.f));
         //camera.setViewTarget(glm::vec3(-2.f, -2.f, 2.f), glm::vec3(0.f, 0.f, 2.5f));
@@ -72,18 +119,101 @@ namespace vhl
         auto viewerObject = VhlGameObject::createGameObject();
         viewerObject.transform.translation.z = -2.5f;
         KeyboardMovementController cameraController{};
+        VhlCameraPath cameraPath = makeCameraPath();
+        VhlCameraPath recordedPath{};
+        bool recording = cameraPath.empty() && !m_Options.recordCameraPath.empty();
+
+        if (m_Options.fixedTimestep > 0.f)
+        {
+            // start from a fully loaded scene so every run renders the same frames
+            m_PipelineManager.waitIdle();
+            m_ModelLoader.waitIdle();
+            m_AssetManager.update();
+            m_TextureLoader.waitIdle();
+        }
 
         auto currentTime = std::chrono::high_resolution_clock::now();
+        float elapsedTime = 0.f;
+        uint32_t frameNumber = 0;
+        bool traceKeyDown = false;
 
-        while (!m_VhlWindow.shouldClose())
+        while (!m_VhlWindow.shouldClose() && (m_Options.frameCount == 0 || frameNumber < m_Options.frameCount))
         {
-            glfwPollEvents();
+            VHL_PROFILE_SCOPE("frame");
+            auto frameStart = std::chrono::high_resolution_clock::now();
+            uint64_t zonesBegin = VhlProfiler::now();
+            {
+                VHL_PROFILE_SCOPE("poll events");
+                m_VhlWindow.pollEvents();
+            }
+
+            // F12 dumps the zones recorded so far without ending the run
+            if (!m_VhlWindow.isHeadless() && !m_Options.tracePath.empty())
+            {
+                bool keyDown = glfwGetKey(m_VhlWindow.getGLFWwindow(), TRACE_KEY) == GLFW_PRESS;
+                if (keyDown && !traceKeyDown)
+                {
+                    VhlProfiler::writeChromeTrace(m_Options.tracePath);
+                    std::cout << "wrote trace to " << m_Options.tracePath << std::endl;
+                }
+                traceKeyDown = keyDown;
+            }
+            // F3 shows or hides the HUD
+            if (!m_VhlWindow.isHeadless())
+            {
+                bool keyDown = glfwGetKey(m_VhlWindow.getGLFWwindow(), HUD_KEY) == GLFW_PRESS;
+                if (keyDown && !hudKeyDown)
+                {
+                    hudVisible = !hudVisible;
+                    VhlProfiler::setEnabled(!m_Options.tracePath.empty() || hudVisible);
+                }
+                hudKeyDown = keyDown;
+            }
+
+            {
+                VHL_PROFILE_SCOPE("update assets");
+                if (shaderWatcher)
+                {
+                    auto recompiledShaders = shaderWatcher->takeRecompiled();
+                    if (!recompiledShaders.empty())
+                    {
+                        m_PipelineManager.reloadShaders(recompiledShaders);
+                    }
+                }
+                m_PipelineManager.applyReloads();
+                // meshes freed MAX_FRAMES_IN_FLIGHT frames ago become reusable before uploads reserve
+                m_GeometryPool.update();
+                m_ModelLoader.update();
+                m_AssetManager.update();
+                m_TextureLoader.update();
+                // the streamer fits its budget to the heaps' usage
+                m_VhlDevice.updateMemoryBudget();
+                // acts on the screen sizes the previous frame's culling requested
+                m_TextureStreamer.update();
+            }
 
             auto newTime = std::chrono::high_resolution_clock::now();
             float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
             currentTime = newTime;
+            if (m_Options.fixedTimestep > 0.f)
+            {
+                frameTime = m_Options.fixedTimestep;
+            }
+            elapsedTime += frameTime;
 
-            cameraController.moveInPlaneXZ(m_VhlWindow.getGLFWwindow(), frameTime, viewerObject);
+            if (!cameraPath.empty())
+            {
+                cameraPath.evaluate(elapsedTime, viewerObject.transform);
+            }
+            else if (!m_VhlWindow.isHeadless())
+            {
+                cameraController.moveInPlaneXZ(m_VhlWindow.getGLFWwindow(), frameTime, viewerObject);
+            }
+            if (recording && (recordedPath.empty() ||
+                elapsedTime >= recordedPath.getDuration() + CAMERA_RECORD_INTERVAL))
+            {
+                recordedPath.addKeyframe({elapsedTime, viewerObject.transform.translation, viewerObject.transform.rotation});
+            }
             camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
 
             float aspect = m_VhlRenderer.getAspectRatio();
@@ -94,35 +224,189 @@ namespace vhl
             if (auto commandBuffer = m_VhlRenderer.beginFrame())
             {
                 int frameIndex = m_VhlRenderer.getFrameIndex();
-                FrameInfo frameInfo{frameIndex, frameTime, commandBuffer, camera, globalDescriptorSets[frameIndex], m_GameObjects};
+                auto globalUbo = uniformRing.allocate(sizeof(GlobalUBO));
+                FrameInfo frameInfo{
+                    frameIndex,
+                    frameTime,
+                    commandBuffer,
+                    camera,
+                    globalDescriptorSet,
+                    globalUbo.offset,
+                    m_GameObjects,
+                    m_VhlRenderer.getFrameDescriptorAllocator(),
+                    uniformRing,
+                    m_RenderQueue,
+                    m_VhlRenderer.getSwapChainExtent(),
+                    m_VhlRenderer.getGpuProfiler(),
+                    renderStats};
+                // staging copies submitted by this iteration's asset updates
+                frameInfo.renderStats.getCounters().bytesUploaded += m_ModelLoader.getUploadedBytes() +
+                    m_TextureLoader.getUploadedBytes() + m_TextureStreamer.getUploadedBytes();
                 // update
                 GlobalUBO ubo{};
                 ubo.projection = camera.getProjection();
                 ubo.view = camera.getView();
                 ubo.inverseView = camera.getInverseView();
                 pointLightSystem.update(frameInfo, ubo);
-                uboBuffers[frameIndex]->writeToBuffer(&ubo);
-                uboBuffers[frameIndex]->flush();
-
-                // render
-                m_VhlRenderer.beginSwapChainRenderPass(commandBuffer);
-
-                // order here matters
-                simpleRenderSystem.renderGameObjects(frameInfo);
-                pointLightSystem.render(frameInfo);
-
-                m_VhlRenderer.endSwapChainRenderPass(commandBuffer);
+                std::memcpy(globalUbo.mapped, &ubo, sizeof(GlobalUBO));
+
+                if (graphCheck) graphCheck->addPasses(m_VhlRenderer.getRenderGraph());
+
+                // render, recorded when the frame's render graph executes in endFrame()
+                m_VhlRenderer.addSwapChainPass([&](VkCommandBuffer commandBuffer)
+                {
+                    // order here matters
+                    simpleRenderSystem.renderGameObjects(frameInfo);
+                    {
+                        // the simple render system's draws are recorded here
+                        VhlGpuScope scope{frameInfo.gpuProfiler, commandBuffer, "render queue"};
+                        m_RenderQueue.flush(commandBuffer, uniformRing);
+
+                        const auto& queueStats = m_RenderQueue.getStats();
+                        auto& counters = frameInfo.renderStats.getCounters();
+                        counters.drawCalls += queueStats.drawCalls;
+                        counters.instances += queueStats.draws;
+                        counters.triangles += queueStats.triangles;
+                        counters.pipelineBinds += queueStats.pipelineBinds;
+                        counters.descriptorSetBinds += queueStats.descriptorSetBinds;
+                        // a vertex and an index buffer per geometry pool switch
+                        counters.bufferBinds += 2 * queueStats.vertexBufferBinds;
+                    }
+                    pointLightSystem.render(frameInfo);
+                    if (hudVisible)
+                    {
+                        auto assetStats = m_AssetManager.getStats();
+                        auto streamingStats = m_TextureStreamer.getStats();
+                        auto geometryStats = m_GeometryPool.getStats();
+                        VkDeviceSize vertexSize = sizeof(VhlModel::Vertex);
+                        VkDeviceSize indexSize = sizeof(uint32_t);
+                        hudSystem.render(frameInfo, {
+                            {"uniform ring peak", uniformRing.getPeakBytesUsed(), uniformRing.getBytesPerFrame()},
+                            {"model cache", assetStats.residentBytes, assetStats.budgetBytes},
+                            {"streamed textures", streamingStats.residentBytes, streamingStats.effectiveBudgetBytes},
+                            {"geometry pool",
+                                geometryStats.verticesUsed * vertexSize + geometryStats.indicesUsed * indexSize,
+                                geometryStats.vertexCapacity * vertexSize + geometryStats.indexCapacity * indexSize}});
+                    }
+                });
                 m_VhlRenderer.endFrame();
+
+                float cpuFrameTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                    std::chrono::high_resolution_clock::now() - frameStart).count();
+                if (statsLogger)
+                {
+                    statsLogger->log(renderStats, cpuFrameTime, m_VhlRenderer.getLastGpuFrameTime());
+                }
+                if (m_Options.onFrame)
+                {
+                    HuiFrameSample sample{};
+                    sample.frameNumber = frameNumber;
+                    sample.cpuFrameTime = cpuFrameTime;
+                    sample.gpuFrameTime = m_VhlRenderer.getLastGpuFrameTime();
+                    sample.counters = renderStats.getLastCounters();
+                    m_Options.onFrame(sample);
+                }
+                // zones of this iteration so far, the frame zone itself ends after it
+                hudSystem.addFrame(cpuFrameTime, m_VhlRenderer.getLastGpuFrameTime(), zonesBegin, VhlProfiler::now());
+                frameNumber++;
             }
         }
 
         vkDeviceWaitIdle(m_VhlDevice.device());
+
+        if (!m_Options.tracePath.empty())
+        {
+            VhlProfiler::writeChromeTrace(m_Options.tracePath);
+            std::cout << "wrote trace to " << m_Options.tracePath << std::endl;
+        }
+
+        if (recording && recordedPath.getKeyframes().size() >= 2)
+        {
+            recordedPath.saveToFile(m_Options.recordCameraPath);
+            std::cout << "saved " << recordedPath.getKeyframes().size() << " camera keyframes to "
+                      << m_Options.recordCameraPath << std::endl;
+        }
+
+        if (m_VhlWindow.isHeadless() && !m_Options.screenshotPath.empty() && frameNumber > 0)
+        {
+            m_VhlRenderer.saveLastFrame(m_Options.screenshotPath);
+            std::cout << "saved frame " << frameNumber << " to " << m_Options.screenshotPath << std::endl;
+        }
+
+        for (const auto& timing : m_VhlRenderer.getGpuProfiler().getTimings())
+        {
+            std::cout << "gpu " << std::string(2 * timing.depth, ' ') << timing.name << ": " << timing.averageTime
+                      << " ms average, " << timing.lastTime << " ms last" << std::endl;
+        }
+        auto pipelineStats = m_PipelineManager.getStats();
+        std::cout << "pipelines: " << pipelineStats.uniquePipelines << " unique, "
+                  << pipelineStats.cacheHits << " cache hits" << std::endl;
+        std::cout << "uniform ring: " << uniformRing.getPeakBytesUsed() << " of "
+                  << uniformRing.getBytesPerFrame() << " bytes per frame at peak" << std::endl;
+        auto queueStats = m_RenderQueue.getStats();
+        std::cout << "render queue: " << queueStats.draws << " draws in " << queueStats.drawCalls << " draw calls, "
+                  << queueStats.pipelineBinds << " pipeline binds, "
+                  << queueStats.descriptorSetBinds << " descriptor set binds, " << queueStats.vertexBufferBinds
+                  << " vertex buffer binds, " << queueStats.keyOverflows << " sort key overflows in the last frame"
+                  << std::endl;
+        const auto& graphStats = m_VhlRenderer.getRenderGraph().getStats();
+        std::cout << "render graph: " << graphStats.passes << " passes, " << graphStats.culledPasses << " culled, "
+                  << graphStats.barriers << " barriers (" << graphStats.imageBarriers << " image, "
+                  << graphStats.bufferBarriers << " buffer), " << graphStats.transientImages << " transient images in "
+                  << graphStats.allocatedBytes << " of " << graphStats.transientBytes << " bytes in the last frame"
+                  << std::endl;
+        if (graphCheck && frameNumber > 0)
+        {
+            graphCheck->verify(graphStats);
+            std::cout << "render graph check passed" << std::endl;
+        }
+        const auto& counters = renderStats.getLastCounters();
+        std::cout << "last frame: " << counters.drawCalls << " draw calls, " << counters.instances << " instances, "
+                  << counters.triangles << " triangles, " << counters.pipelineBinds << " pipeline binds, "
+                  << counters.descriptorSetBinds << " descriptor set binds, " << counters.pushConstantUpdates
+                  << " push constant updates, " << counters.bufferBinds << " buffer binds, "
+                  << counters.bytesUploaded << " bytes uploaded" << std::endl;
+        if (renderStats.hasPipelineStatistics())
+        {
+            const auto& statistics = renderStats.getPipelineStatistics();
+            std::cout << "pipeline statistics of frame " << statistics.frameNumber << ": "
+                      << statistics.inputPrimitives << " input primitives, " << statistics.vertexInvocations
+                      << " vertex invocations, " << statistics.clippingPrimitives << " primitives after clipping, "
+                      << statistics.fragmentInvocations << " fragment invocations" << std::endl;
+        }
+        else if (m_Options.pipelineStatistics && !renderStats.isPipelineStatisticsSupported())
+        {
+            std::cout << "pipeline statistics: not supported by the device" << std::endl;
+        }
+        auto assetStats = m_AssetManager.getStats();
+        std::cout << "assets: " << assetStats.residentModels << " models, " << assetStats.residentBytes << " of "
+                  << assetStats.budgetBytes << " bytes resident, " << static_cast<int>(assetStats.hitRate() * 100.f)
+                  << "% hit rate (" << assetStats.hits << " hits, " << assetStats.misses << " misses)" << std::endl;
+        auto geometryStats = m_GeometryPool.getStats();
+        std::cout << "geometry pool: " << geometryStats.meshes << " meshes, " << geometryStats.verticesUsed << "/"
+                  << geometryStats.vertexCapacity << " vertices, " << geometryStats.indicesUsed << "/"
+                  << geometryStats.indexCapacity << " indices" << std::endl;
+        auto streamingStats = m_TextureStreamer.getStats();
+        std::cout << "texture streaming: " << streamingStats.texturesAtWantedLevel << "/" << streamingStats.textures
+                  << " textures at their wanted level, " << streamingStats.residentLevels << "/"
+                  << streamingStats.totalLevels << " levels and " << streamingStats.residentBytes << " of "
+                  << streamingStats.budgetBytes << " bytes resident, " << streamingStats.evictions << " evictions"
+                  << std::endl;
+        m_VhlDevice.updateMemoryBudget();
+        const auto& memoryBudget = m_VhlDevice.getMemoryBudget();
+        for (uint32_t heap = 0; heap < memoryBudget.size(); heap++)
+        {
+            const auto& budget = memoryBudget[heap];
+            std::cout << "memory heap " << heap << (budget.deviceLocal ? " (device local): " : ": ") << budget.usage
+                      << " of " << budget.budget << " bytes budget used, " << budget.allocated << " allocated by the engine"
+                      << (m_VhlDevice.memoryBudgetSupported ? "" : " (budget estimated)") << std::endl;
+        }
     }
 
     void HuiApp::loadGameObjects()
     {
         /*
-        float aspectRatio = (float)HuiApp::WIDTH / HuiApp::HEIGHT;
+        float aspectRatio = (float)m_Options.width / m_Options.height;
         std::vector<VhlModel::Vertex> vertices {
             {{ 0.0f, -1.1546f, 0.f }, { 1.0f, 0.0f, 0.0f }},
             {{-1.0f,  0.5773f, 0.f }, { 0.0f, 1.0f, 0.0f }},
@@ -142,32 +426,90 @@ namespace vhl
         m_GameObjects.push_back(std::move(triangle));
         */
 
-        std::shared_ptr<VhlModel> vhlModel = VhlModel::createModelFromFile(m_VhlDevice, "models/flat_vase.obj");
+        if (m_Options.scene == "vases")
+        {
+            loadVases();
+        }
+        else if (m_Options.scene == "vase_grid")
+        {
+            loadVaseGrid();
+        }
+        else
+        {
+            throw std::runtime_error("unknown scene: " + m_Options.scene);
+        }
+    }
 
+    void HuiApp::loadVases()
+    {
+        // models arrive over the next frames, objects render once theirs is uploaded
         auto flatVase = VhlGameObject::createGameObject();
-        flatVase.model = vhlModel;
         flatVase.transform.translation = { -0.5f, .5f, 0.f };
         flatVase.transform.scale = glm::vec3{ 3.0f, 1.5f, 3.0f };
+        loadModelAsync(flatVase.getId(), "models/flat_vase.obj");
         
         m_GameObjects.emplace(flatVase.getId(), std::move(flatVase));
 
-        vhlModel = VhlModel::createModelFromFile(m_VhlDevice, "models/smooth_vase.obj");
         auto smoothVase = VhlGameObject::createGameObject();
-        smoothVase.model = vhlModel;
         smoothVase.transform.translation = { 0.5f, .5f, 0.f };
         smoothVase.transform.scale = glm::vec3{ 3.0f, 1.5f, 3.0f };
+        loadModelAsync(smoothVase.getId(), "models/smooth_vase.obj");
        
         m_GameObjects.emplace(smoothVase.getId(), std::move(smoothVase));
 
 
-        vhlModel = VhlModel::createModelFromFile(m_VhlDevice, "models/quad.obj");
         auto floor = VhlGameObject::createGameObject();
-        floor.model = vhlModel;
         floor.transform.translation = { 0.f, 0.5f, 0.f };
         floor.transform.scale = glm::vec3{ 3.0f, 1.0f, 3.0f };
+        loadModelAsync(floor.getId(), "models/quad.obj");
+        // cooked with tools/texture_cooker, else the source image is decoded and its mips generated
+        // on the gpu. The floor stays untextured without either.
+        if (std::filesystem::exists("textures/floor.vtex"))
+        {
+            floor.streamedTexture = m_TextureStreamer.open("textures/floor.vtex");
+        }
+        else if (std::filesystem::exists("textures/floor.png"))
+        {
+            loadTextureAsync(floor.getId(), "textures/floor.png");
+        }
         
         m_GameObjects.emplace(floor.getId(), std::move(floor));
 
+        addLightRing({0.f, 0.f, 0.f}, 1.f);
+    }
+
+    // draw call heavy: every vase is its own object, the two models are shared through the asset manager
+    void HuiApp::loadVaseGrid()
+    {
+        constexpr int GRID_SIZE = 32;
+        constexpr float SPACING = 0.75f;
+
+        for (int z = 0; z < GRID_SIZE; z++)
+        {
+            for (int x = 0; x < GRID_SIZE; x++)
+            {
+                auto vase = VhlGameObject::createGameObject();
+                vase.transform.translation = {
+                    (x - 0.5f * (GRID_SIZE - 1)) * SPACING, .5f, (z - 0.5f * (GRID_SIZE - 1)) * SPACING };
+                vase.transform.scale = glm::vec3{ 2.0f, 1.0f, 2.0f };
+                vase.transform.rotation.y = 0.1f * (x * GRID_SIZE + z);
+                loadModelAsync(vase.getId(), (x + z) % 2 == 0 ? "models/flat_vase.obj" : "models/smooth_vase.obj");
+
+                m_GameObjects.emplace(vase.getId(), std::move(vase));
+            }
+        }
+
+        auto floor = VhlGameObject::createGameObject();
+        floor.transform.translation = { 0.f, 0.5f, 0.f };
+        floor.transform.scale = glm::vec3{ 0.5f * GRID_SIZE * SPACING + 1.f, 1.0f, 0.5f * GRID_SIZE * SPACING + 1.f };
+        loadModelAsync(floor.getId(), "models/quad.obj");
+        m_GameObjects.emplace(floor.getId(), std::move(floor));
+
+        addLightRing({0.f, 0.f, 0.f}, 0.25f * GRID_SIZE * SPACING);
+    }
+
+    void HuiApp::addLightRing(glm::vec3 center, float radius)
+    {
         std::vector<glm::vec3> lightColors
         {
             {1.f, .1f, .1f},
@@ -186,12 +528,55 @@ namespace vhl
                 glm::mat4(1.f), 
                 i * glm::two_pi<float>() / lightColors.size(),
                 {0.f, -1.f, 0.f});
-            pointLight.transform.translation = glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
+            pointLight.transform.translation = center + glm::vec3(rotateLight * glm::vec4(-radius, -1.f, -radius, 1.f));
             m_GameObjects.emplace(pointLight.getId(), std::move(pointLight));
         }
 
     }
 
+    VhlCameraPath HuiApp::makeCameraPath() const
+    {
+        if (m_Options.cameraPath.empty())
+        {
+            return {};
+        }
+        if (m_Options.cameraPath == "orbit")
+        {
+            // scripted 20 second loop framing the whole scene, y points down
+            if (m_Options.scene == "vase_grid")
+            {
+                return VhlCameraPath::orbit({0.f, 0.5f, 0.f}, 14.f, -5.f, 20.f);
+            }
+            return VhlCameraPath::orbit({0.f, 0.f, 0.f}, 2.5f, -1.f, 20.f);
+        }
+        return VhlCameraPath::loadFromFile(m_Options.cameraPath);
+    }
+
+    void HuiApp::loadModelAsync(VhlGameObject::id_t objectId, const std::string& filepath)
+    {
+        // runs from m_ModelLoader.update() in the frame loop, the object may be gone by then
+        m_AssetManager.loadModel(filepath, [this, objectId](std::shared_ptr<VhlModel> model)
+        {
+            auto it = m_GameObjects.find(objectId);
+            if (it != m_GameObjects.end())
+            {
+                it->second.model = std::move(model);
+            }
+        });
+    }
+
+    void HuiApp::loadTextureAsync(VhlGameObject::id_t objectId, const std::string& filepath)
+    {
+        m_TextureLoader.load(filepath, [this, objectId](std::shared_ptr<VhlTexture> texture)
+        {
+            auto it = m_GameObjects.find(objectId);
+            if (it != m_GameObjects.end())
+            {
+                it->second.texture = std::move(texture);
+            }
+        });
+    }
+
     void HuiApp::createFractal(std::vector<VhlModel::Vertex>& vertices, int level, glm::vec3 top, glm::vec3 left, glm::vec3 right)
     {
         if (level <= 0)
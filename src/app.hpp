@@ -1,25 +1,80 @@
 #pragma once
 
+#include "vhl_asset_manager.hpp"
+#include "vhl_bindless_table.hpp"
 #include "vhl_camera.hpp"
+#include "vhl_camera_path.hpp"
 #include "vhl_device.hpp"
 #include "vhl_game_object.hpp"
+#include "vhl_geometry_pool.hpp"
+#include "vhl_model_loader.hpp"
+#include "vhl_pipeline_manager.hpp"
+#include "vhl_render_queue.hpp"
+#include "vhl_render_stats.hpp"
 #include "vhl_renderer.hpp"
+#include "vhl_texture.hpp"
+#include "vhl_texture_loader.hpp"
+#include "vhl_texture_streamer.hpp"
 #include "vhl_window.hpp"
 #include "vhl_descriptors.hpp"
 
 // std
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace vhl 
 {
+	// Measurements of one rendered frame
+	struct HuiFrameSample
+	{
+		uint32_t frameNumber = 0;
+		float cpuFrameTime = 0.f;  // ms of wall time for the whole loop iteration
+		float gpuFrameTime = -1.f;  // ms, reported MAX_FRAMES_IN_FLIGHT frames late, negative if unknown
+		VhlRenderStats::Counters counters{};
+	};
+
+	struct HuiAppOptions
+	{
+		int width = 1920;
+		int height = 1080;
+		// render offscreen without a window or surface, e.g. on lavapipe in CI
+		bool headless = false;
+		uint32_t frameCount = 0;  // stop after this many frames, 0 runs until the window closes
+		std::string screenshotPath{};  // headless only, the last frame is written here as a PPM
+
+		std::string scene = "vases";  // see HuiApp::SCENES
+		// "orbit" or a file saved by recordCameraPath, replaces keyboard control when set
+		std::string cameraPath{};
+		std::string recordCameraPath{};  // keyboard driven runs save their camera flight here
+		// > 0 advances the simulation by this many seconds each frame instead of the wall clock and
+		// waits for the scene's assets and pipelines before the first frame, so runs repeat exactly
+		float fixedTimestep = 0.f;
+		std::function<void(const HuiFrameSample&)> onFrame{};
+		// records CPU zones and writes them here as a Chrome trace on exit or when TRACE_KEY is pressed
+		std::string tracePath{};
+		// one row of VhlRenderStats counters per frame, off when empty
+		std::string statsPath{};
+		// measure the swap chain pass with a pipeline statistics query when the device supports it
+		bool pipelineStatistics = false;
+		// start with the performance HUD shown, HUD_KEY toggles it in windowed runs
+		bool hud = false;
+		// add offscreen passes that exercise culling and transient aliasing, verified on exit
+		bool renderGraphCheck = false;
+	};
+
 	class HuiApp
 	{
 	public:
-		static constexpr int WIDTH = 1920;
-		static constexpr int HEIGHT = 1080;
+		static constexpr const char* SCENES[] = { "vases", "vase_grid" };
+		// seconds between keyframes of a recorded camera path
+		static constexpr float CAMERA_RECORD_INTERVAL = 0.25f;
+		static constexpr int TRACE_KEY = GLFW_KEY_F12;
+		static constexpr int HUD_KEY = GLFW_KEY_F3;
 
-		HuiApp();
+		HuiApp(const HuiAppOptions& options = HuiAppOptions{});
 		~HuiApp();
 
 		HuiApp(const HuiApp&) = delete;
@@ -29,14 +84,33 @@ namespace vhl
 
 		void run();
 
+		const char* getDeviceName() const { return m_VhlDevice.properties.deviceName; }
+
 	private:
 		void loadGameObjects();
+		void loadVases();
+		void loadVaseGrid();
+		void addLightRing(glm::vec3 center, float radius);
+		VhlCameraPath makeCameraPath() const;
+		void loadModelAsync(VhlGameObject::id_t objectId, const std::string& filepath);
+		void loadTextureAsync(VhlGameObject::id_t objectId, const std::string& filepath);
 
-		VhlWindow m_VhlWindow{ WIDTH, HEIGHT, "Hello Huiyu" };
+		HuiAppOptions m_Options;
+		VhlWindow m_VhlWindow{ m_Options.width, m_Options.height, "Hello Huiyu", m_Options.headless };
 		VhlDevice m_VhlDevice{ m_VhlWindow };
 		VhlRenderer m_VhlRenderer{ m_VhlWindow, m_VhlDevice };
+		VhlPipelineManager m_PipelineManager{ m_VhlDevice };
+		VhlBindlessTable m_BindlessTable{ m_VhlDevice };
+		VhlRenderQueue m_RenderQueue{ m_VhlDevice };
+		VhlGeometryPool m_GeometryPool{ m_VhlDevice, sizeof(VhlModel::Vertex), 1 << 18, 1 << 20 };
+		VhlModelLoader m_ModelLoader{ m_GeometryPool };
+		VhlAssetManager m_AssetManager{ m_ModelLoader, 64 * 1024 * 1024 };
+		VhlTextureLoader m_TextureLoader{ m_VhlDevice, m_BindlessTable };
+		VhlTextureStreamer m_TextureStreamer{ m_VhlDevice, m_BindlessTable, 256 * 1024 * 1024, 8 * 1024 * 1024 };
+		std::unique_ptr<VhlTexture> m_DefaultTexture{};
 
-		std::unique_ptr<VhlDescriptorPool> m_GlobalPool{};
+		std::unique_ptr<VhlDescriptorAllocator> m_GlobalAllocator{};
+		std::unique_ptr<VhlDescriptorSetCache> m_GlobalSetCache{};
 		VhlGameObject::Map m_GameObjects;
 	};
 }
\ No newline at end of file
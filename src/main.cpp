@@ -2,22 +2,110 @@
 
 // std
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
-int main() 
+namespace
 {
-    vhl::HuiApp app;
+    // vhuiluna [--headless] [--frames N] [--screenshot out.ppm] [--width W] [--height H] [--scene name]
+    //          [--camera-path orbit|file] [--record-camera-path file] [--fixed-timestep seconds]
+    //          [--trace file.json] [--stats file.csv] [--pipeline-statistics] [--hud]
+    //          [--graph-check]
+    vhl::HuiAppOptions parseOptions(int argc, char** argv)
+    {
+        vhl::HuiAppOptions options{};
+        for (int i = 1; i < argc; i++)
+        {
+            bool hasValue = i + 1 < argc;
+            if (std::strcmp(argv[i], "--headless") == 0)
+            {
+                options.headless = true;
+            }
+            else if (std::strcmp(argv[i], "--frames") == 0 && hasValue)
+            {
+                options.frameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (std::strcmp(argv[i], "--screenshot") == 0 && hasValue)
+            {
+                options.screenshotPath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--width") == 0 && hasValue)
+            {
+                options.width = std::stoi(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--height") == 0 && hasValue)
+            {
+                options.height = std::stoi(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--scene") == 0 && hasValue)
+            {
+                options.scene = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--camera-path") == 0 && hasValue)
+            {
+                options.cameraPath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--record-camera-path") == 0 && hasValue)
+            {
+                options.recordCameraPath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--fixed-timestep") == 0 && hasValue)
+            {
+                options.fixedTimestep = std::stof(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--trace") == 0 && hasValue)
+            {
+                options.tracePath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--stats") == 0 && hasValue)
+            {
+                options.statsPath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--pipeline-statistics") == 0)
+            {
+                options.pipelineStatistics = true;
+            }
+            else if (std::strcmp(argv[i], "--hud") == 0)
+            {
+                options.hud = true;
+            }
+            else if (std::strcmp(argv[i], "--graph-check") == 0)
+            {
+                options.renderGraphCheck = true;
+            }
+            else
+            {
+                throw std::runtime_error(std::string("unknown argument ") + argv[i]);
+            }
+        }
+
+        // nothing closes a headless run, never let it spin forever
+        if (options.headless && options.frameCount == 0)
+        {
+            options.frameCount = 300;
+        }
+        if (options.width <= 0 || options.height <= 0)
+        {
+            throw std::runtime_error("width and height must be positive");
+        }
+        return options;
+    }
+}
 
-    try 
+int main(int argc, char** argv)
+{
+    try
     {
+        vhl::HuiApp app{parseOptions(argc, argv)};
         app.run();
     }
-    catch (const std::exception& e) 
+    catch (const std::exception& e)
     {
         std::cerr << e.what() << std::endl;
         return EXIT_FAILURE;
     }
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
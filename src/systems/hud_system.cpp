@@ -0,0 +1,420 @@
+#include "hud_system.hpp"
+
+#include "vhl_gpu_profiler.hpp"
+#include "vhl_profiler.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// libs, configured by vhl_nuklear.hpp through hud_system.hpp
+#define NK_IMPLEMENTATION
+#include <nuklear.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace vhl
+{
+    struct HudPushConstants
+    {
+        glm::vec2 scale{};
+        glm::vec2 translate{};
+        uint32_t textureIndex;
+    };
+
+    // set 0 of hud.frag
+    static constexpr uint32_t BINDLESS_SET = 0;
+
+    static constexpr float ROW_HEIGHT = 14.f;
+    static constexpr float GRAPH_HEIGHT = 80.f;
+    static constexpr float WINDOW_WIDTH = 380.f;
+    static constexpr uint32_t MAX_ZONE_DEPTH = 2;
+
+    static const nk_color CPU_COLOR = nk_rgb(90, 200, 120);
+    static const nk_color GPU_COLOR = nk_rgb(230, 160, 60);
+    static const nk_color HEADER_COLOR = nk_rgb(140, 180, 255);
+    static const nk_color WARNING_COLOR = nk_rgb(255, 90, 70);
+
+    static double toMegabytes(VkDeviceSize bytes) { return bytes / (1024.0 * 1024.0); }
+
+    HudSystem::HudSystem(
+        VhlDevice& device,
+        VhlPipelineManager& pipelineManager,
+        VkRenderPass renderPass,
+        VhlBindlessTable& bindlessTable)
+        : m_VhlDevice(device), m_PipelineManager(pipelineManager), m_BindlessTable(bindlessTable)
+    {
+        createFontAtlas();
+        createPipelineLayout();
+        createPipeline(renderPass);
+
+        nk_buffer_init_default(&m_Commands);
+        nk_buffer_init_default(&m_Vertices);
+        nk_buffer_init_default(&m_Indices);
+
+        m_Context.style.window.fixed_background = nk_style_item_color(nk_rgba(16, 16, 16, 200));
+        m_Context.style.window.padding = nk_vec2(6.f, 4.f);
+        m_Context.style.window.spacing = nk_vec2(4.f, 1.f);
+    }
+
+    HudSystem::~HudSystem()
+    {
+        // the worker may still be building against our layout
+        m_VhlPipeline->wait();
+
+        nk_buffer_free(&m_Commands);
+        nk_buffer_free(&m_Vertices);
+        nk_buffer_free(&m_Indices);
+        nk_free(&m_Context);
+        nk_font_atlas_clear(&m_FontAtlas);
+    }
+
+    void HudSystem::createFontAtlas()
+    {
+        nk_font_atlas_init_default(&m_FontAtlas);
+        nk_font_atlas_begin(&m_FontAtlas);
+        nk_font* font = nk_font_atlas_add_default(&m_FontAtlas, FONT_HEIGHT, nullptr);
+
+        int width = 0;
+        int height = 0;
+        const void* pixels = nk_font_atlas_bake(&m_FontAtlas, &width, &height, NK_FONT_ATLAS_RGBA32);
+        if (pixels == nullptr)
+        {
+            throw std::runtime_error("failed to bake HUD font atlas!");
+        }
+
+        // glyph coverage is in alpha, so the atlas must not be sRGB decoded
+        m_FontTexture = VhlTexture::createFromPixels(
+            m_VhlDevice,
+            m_BindlessTable,
+            static_cast<uint32_t>(width),
+            static_cast<uint32_t>(height),
+            pixels,
+            VK_FORMAT_R8G8B8A8_UNORM);
+
+        nk_font_atlas_end(&m_FontAtlas, nk_handle_id(static_cast<int>(m_FontTexture->getBindlessIndex())), &m_NullTexture);
+        nk_font_atlas_cleanup(&m_FontAtlas);
+
+        if (!nk_init_default(&m_Context, &font->handle))
+        {
+            throw std::runtime_error("failed to create HUD context!");
+        }
+    }
+
+    void HudSystem::createPipelineLayout()
+    {
+        m_Reflection = VhlPipeline::reflect("shaders/hud.vert.spv", "shaders/hud.frag.spv");
+        if (m_Reflection.pushConstantRange.size != sizeof(HudPushConstants))
+        {
+            throw std::runtime_error("failed to create HUD pipeline layout: HudPushConstants is out of sync with the shader push constant block!");
+        }
+
+        m_PipelineLayout = m_PipelineManager.getLayoutCache().getPipelineLayout(
+            m_Reflection, {m_BindlessTable.getDescriptorSetLayout()});
+    }
+
+    void HudSystem::createPipeline(VkRenderPass renderPass)
+    {
+        auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+        VhlPipeline::defaultPipelineConfigInfo(*pipelineConfig);
+        VhlPipeline::enableAlphaBlending(*pipelineConfig);
+        // drawn over the scene
+        pipelineConfig->depthStencilInfo.depthTestEnable = VK_FALSE;
+        pipelineConfig->depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+        pipelineConfig->bindingDescriptions = {{0, sizeof(HudVertex), VK_VERTEX_INPUT_RATE_VERTEX}};
+        pipelineConfig->attributeDescriptions = {
+            {0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(HudVertex, position)},
+            {1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(HudVertex, uv)},
+            {2, 0, VK_FORMAT_R32_UINT, offsetof(HudVertex, color)},
+        };
+        VhlPipeline::applyVertexInputs(m_Reflection, *pipelineConfig);
+        pipelineConfig->renderPass = renderPass;
+        pipelineConfig->pipelineLayout = m_PipelineLayout;
+        m_VhlPipeline = m_PipelineManager.createPipeline(
+            "shaders/hud.vert.spv",
+            "shaders/hud.frag.spv",
+            std::move(pipelineConfig));
+    }
+
+    void HudSystem::addFrame(float cpuFrameTime, float gpuFrameTime, uint64_t zonesBegin, uint64_t zonesEnd)
+    {
+        m_CpuFrameTimes[m_HistoryNext] = cpuFrameTime;
+        m_GpuFrameTimes[m_HistoryNext] = gpuFrameTime;
+        m_HistoryNext = (m_HistoryNext + 1) % FRAME_HISTORY;
+        m_HistoryCount = std::min(m_HistoryCount + 1, FRAME_HISTORY);
+        m_ZonesBegin = zonesBegin;
+        m_ZonesEnd = zonesEnd;
+    }
+
+    void HudSystem::render(FrameInfo& frameInfo, const std::vector<MemoryUsage>& memoryUsage)
+    {
+        VHL_PROFILE_SCOPE("HudSystem::render");
+        VhlGpuScope gpuScope{frameInfo.gpuProfiler, frameInfo.commandBuffer, "hud"};
+
+        // display only, an empty input frame keeps nuklear's state machine going
+        nk_input_begin(&m_Context);
+        nk_input_end(&m_Context);
+
+        buildLayout(frameInfo, memoryUsage);
+        recordDraws(frameInfo);
+        nk_clear(&m_Context);
+    }
+
+    void HudSystem::buildLayout(FrameInfo& frameInfo, const std::vector<MemoryUsage>& memoryUsage)
+    {
+        nk_context* ctx = &m_Context;
+        char text[128];
+        auto header = [ctx](const char* title)
+        {
+            nk_layout_row_dynamic(ctx, ROW_HEIGHT + 4.f, 1);
+            nk_label_colored(ctx, title, NK_TEXT_LEFT, HEADER_COLOR);
+            nk_layout_row_dynamic(ctx, ROW_HEIGHT, 2);
+        };
+        auto row = [ctx](const char* name, const char* value)
+        {
+            nk_label(ctx, name, NK_TEXT_LEFT);
+            nk_label(ctx, value, NK_TEXT_RIGHT);
+        };
+
+        float height = std::max(static_cast<float>(frameInfo.extent.height) - 20.f, 100.f);
+        if (!nk_begin(ctx, "performance", nk_rect(10.f, 10.f, WINDOW_WIDTH, height),
+                NK_WINDOW_BORDER | NK_WINDOW_TITLE | NK_WINDOW_NO_SCROLLBAR | NK_WINDOW_NO_INPUT))
+        {
+            nk_end(ctx);
+            return;
+        }
+
+        // oldest first
+        float cpuSum = 0.f;
+        float gpuSum = 0.f;
+        uint32_t gpuCount = 0;
+        float graphMax = 1000.f / 60.f;
+        for (uint32_t i = 0; i < m_HistoryCount; i++)
+        {
+            cpuSum += m_CpuFrameTimes[i];
+            graphMax = std::max(graphMax, m_CpuFrameTimes[i]);
+            if (m_GpuFrameTimes[i] < 0.f) continue;
+            gpuSum += m_GpuFrameTimes[i];
+            gpuCount++;
+            graphMax = std::max(graphMax, m_GpuFrameTimes[i]);
+        }
+
+        header("frame");
+        float cpuAverage = m_HistoryCount > 0 ? cpuSum / m_HistoryCount : 0.f;
+        std::snprintf(text, sizeof(text), "%.2f ms (%.0f fps)", cpuAverage, cpuAverage > 0.f ? 1000.f / cpuAverage : 0.f);
+        nk_label_colored(ctx, "cpu", NK_TEXT_LEFT, CPU_COLOR);
+        nk_label(ctx, text, NK_TEXT_RIGHT);
+        if (gpuCount > 0)
+        {
+            std::snprintf(text, sizeof(text), "%.2f ms", gpuSum / gpuCount);
+        }
+        else
+        {
+            std::snprintf(text, sizeof(text), "n/a");
+        }
+        nk_label_colored(ctx, "gpu", NK_TEXT_LEFT, GPU_COLOR);
+        nk_label(ctx, text, NK_TEXT_RIGHT);
+
+        if (m_HistoryCount > 0)
+        {
+            nk_layout_row_dynamic(ctx, GRAPH_HEIGHT, 1);
+            int count = static_cast<int>(m_HistoryCount);
+            if (nk_chart_begin_colored(ctx, NK_CHART_LINES, CPU_COLOR, CPU_COLOR, count, 0.f, graphMax))
+            {
+                nk_chart_add_slot_colored(ctx, NK_CHART_LINES, GPU_COLOR, GPU_COLOR, count, 0.f, graphMax);
+                uint32_t first = (m_HistoryNext + FRAME_HISTORY - m_HistoryCount) % FRAME_HISTORY;
+                for (uint32_t i = 0; i < m_HistoryCount; i++)
+                {
+                    uint32_t index = (first + i) % FRAME_HISTORY;
+                    nk_chart_push_slot(ctx, m_CpuFrameTimes[index], 0);
+                    nk_chart_push_slot(ctx, std::max(m_GpuFrameTimes[index], 0.f), 1);
+                }
+                nk_chart_end(ctx);
+            }
+            std::snprintf(text, sizeof(text), "graph: last %u frames, up to %.1f ms", m_HistoryCount, graphMax);
+            nk_layout_row_dynamic(ctx, ROW_HEIGHT, 1);
+            nk_label(ctx, text, NK_TEXT_LEFT);
+        }
+
+        header("cpu zones, previous frame");
+        if (VhlProfiler::isEnabled())
+        {
+            for (const auto& zone : VhlProfiler::getThreadZones(m_ZonesBegin, m_ZonesEnd))
+            {
+                if (zone.depth > MAX_ZONE_DEPTH) continue;
+                std::string name = std::string(2 * zone.depth, ' ') + zone.name;
+                if (zone.count > 1) name += " x" + std::to_string(zone.count);
+                std::snprintf(text, sizeof(text), "%.3f ms", zone.duration * 1e-6);
+                row(name.c_str(), text);
+            }
+        }
+        else
+        {
+            row("profiler disabled", "");
+        }
+
+        header("gpu scopes");
+        auto timings = frameInfo.gpuProfiler.getTimings();
+        if (timings.empty())
+        {
+            row(frameInfo.gpuProfiler.isSupported() ? "no results yet" : "timestamps not supported", "");
+        }
+        for (const auto& timing : timings)
+        {
+            std::string name = std::string(2 * timing.depth, ' ') + timing.name;
+            std::snprintf(text, sizeof(text), "%.3f ms", timing.averageTime);
+            row(name.c_str(), text);
+        }
+
+        header("draws, previous frame");
+        const auto& counters = frameInfo.renderStats.getLastCounters();
+        auto countRow = [&](const char* name, unsigned long long value)
+        {
+            std::snprintf(text, sizeof(text), "%llu", value);
+            row(name, text);
+        };
+        countRow("draw calls", counters.drawCalls);
+        countRow("instances", counters.instances);
+        countRow("triangles", counters.triangles);
+        countRow("pipeline binds", counters.pipelineBinds);
+        countRow("descriptor set binds", counters.descriptorSetBinds);
+        countRow("push constant updates", counters.pushConstantUpdates);
+        countRow("buffer binds", counters.bufferBinds);
+        std::snprintf(text, sizeof(text), "%.1f KB", counters.bytesUploaded / 1024.0);
+        row("bytes uploaded", text);
+        if (frameInfo.renderStats.hasPipelineStatistics())
+        {
+            const auto& statistics = frameInfo.renderStats.getPipelineStatistics();
+            countRow("vertex invocations", statistics.vertexInvocations);
+            countRow("fragment invocations", statistics.fragmentInvocations);
+        }
+
+        header("memory");
+        const auto& memoryBudget = m_VhlDevice.getMemoryBudget();
+        for (uint32_t heap = 0; heap < memoryBudget.size(); heap++)
+        {
+            const auto& budget = memoryBudget[heap];
+            std::snprintf(text, sizeof(text), "heap %u%s", heap, budget.deviceLocal ? " (device local)" : "");
+            std::string name = text;
+            std::snprintf(text, sizeof(text), "%.0f / %.0f MB", toMegabytes(budget.usage), toMegabytes(budget.budget));
+            // past the threshold the streaming systems start evicting
+            bool pressure = budget.usage > budget.budget * static_cast<double>(VhlDevice::MEMORY_WARNING_THRESHOLD);
+            nk_label(ctx, name.c_str(), NK_TEXT_LEFT);
+            nk_label_colored(ctx, text, NK_TEXT_RIGHT, pressure ? WARNING_COLOR : ctx->style.text.color);
+        }
+        for (const auto& usage : memoryUsage)
+        {
+            std::snprintf(text, sizeof(text), "%.1f / %.1f MB", toMegabytes(usage.usedBytes), toMegabytes(usage.capacityBytes));
+            row(usage.name, text);
+        }
+
+        nk_end(ctx);
+    }
+
+    void HudSystem::recordDraws(FrameInfo& frameInfo)
+    {
+        static const nk_draw_vertex_layout_element VERTEX_LAYOUT[] = {
+            {NK_VERTEX_POSITION, NK_FORMAT_FLOAT, offsetof(HudVertex, position)},
+            {NK_VERTEX_TEXCOORD, NK_FORMAT_FLOAT, offsetof(HudVertex, uv)},
+            {NK_VERTEX_COLOR, NK_FORMAT_R8G8B8A8, offsetof(HudVertex, color)},
+            {NK_VERTEX_LAYOUT_END}};
+
+        // anti-aliasing would roughly triple the vertex count of thin lines and text for little gain
+        nk_convert_config config{};
+        config.vertex_layout = VERTEX_LAYOUT;
+        config.vertex_size = sizeof(HudVertex);
+        config.vertex_alignment = alignof(HudVertex);
+        config.null = m_NullTexture;
+        config.circle_segment_count = 12;
+        config.arc_segment_count = 12;
+        config.curve_segment_count = 12;
+        config.global_alpha = 1.f;
+        config.line_AA = NK_ANTI_ALIASING_OFF;
+        config.shape_AA = NK_ANTI_ALIASING_OFF;
+
+        nk_buffer_clear(&m_Commands);
+        nk_buffer_clear(&m_Vertices);
+        nk_buffer_clear(&m_Indices);
+        if (nk_convert(&m_Context, &m_Commands, &m_Vertices, &m_Indices, &config) != NK_CONVERT_SUCCESS) return;
+
+        VkDeviceSize vertexBytes = nk_buffer_total(&m_Vertices);
+        VkDeviceSize indexBytes = nk_buffer_total(&m_Indices);
+        if (vertexBytes == 0 || indexBytes == 0) return;
+
+        // nothing to draw with until the worker has finished compiling
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+        if (!m_VhlPipeline->bind(commandBuffer)) return;
+        auto& counters = frameInfo.renderStats.getCounters();
+        counters.pipelineBinds++;
+
+        auto vertexBlock = frameInfo.uniformRing.allocate(vertexBytes);
+        std::memcpy(vertexBlock.mapped, nk_buffer_memory_const(&m_Vertices), vertexBytes);
+        auto indexBlock = frameInfo.uniformRing.allocate(indexBytes);
+        std::memcpy(indexBlock.mapped, nk_buffer_memory_const(&m_Indices), indexBytes);
+
+        VkBuffer ringBuffer = frameInfo.uniformRing.getBuffer();
+        VkDeviceSize vertexOffset = vertexBlock.offset;
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &ringBuffer, &vertexOffset);
+        vkCmdBindIndexBuffer(commandBuffer, ringBuffer, indexBlock.offset,
+            sizeof(nk_draw_index) == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+        counters.bufferBinds += 2;
+        m_BindlessTable.bind(commandBuffer, m_PipelineLayout, BINDLESS_SET);
+        counters.descriptorSetBinds++;
+
+        float width = static_cast<float>(frameInfo.extent.width);
+        float height = static_cast<float>(frameInfo.extent.height);
+        HudPushConstants push{};
+        push.scale = {2.f / width, 2.f / height};
+        push.translate = {-1.f, -1.f};
+        push.textureIndex = VhlBindlessTable::INVALID_INDEX;
+
+        const nk_draw_command* command;
+        uint32_t firstIndex = 0;
+        nk_draw_foreach(command, &m_Context, &m_Commands)
+        {
+            if (command->elem_count == 0) continue;
+
+            float x0 = std::max(command->clip_rect.x, 0.f);
+            float y0 = std::max(command->clip_rect.y, 0.f);
+            float x1 = std::min(command->clip_rect.x + command->clip_rect.w, width);
+            float y1 = std::min(command->clip_rect.y + command->clip_rect.h, height);
+            if (x1 > x0 && y1 > y0)
+            {
+                uint32_t textureIndex = static_cast<uint32_t>(command->texture.id);
+                if (textureIndex != push.textureIndex)
+                {
+                    push.textureIndex = textureIndex;
+                    vkCmdPushConstants(
+                        commandBuffer,
+                        m_PipelineLayout,
+                        m_Reflection.pushConstantRange.stageFlags,
+                        0,
+                        m_Reflection.pushConstantRange.size,
+                        &push);
+                    counters.pushConstantUpdates++;
+                }
+
+                VkRect2D scissor{
+                    {static_cast<int32_t>(x0), static_cast<int32_t>(y0)},
+                    {static_cast<uint32_t>(x1 - x0), static_cast<uint32_t>(y1 - y0)}};
+                vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+                vkCmdDrawIndexed(commandBuffer, command->elem_count, 1, firstIndex, 0, 0);
+                counters.drawCalls++;
+                counters.instances++;
+                counters.triangles += command->elem_count / 3;
+            }
+            firstIndex += command->elem_count;
+        }
+
+        // leave the pass' state as the render graph set it
+        VkRect2D scissor{{0, 0}, frameInfo.extent};
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "vhl_bindless_table.hpp"
+#include "vhl_device.hpp"
+#include "vhl_frame_info.hpp"
+#include "vhl_nuklear.hpp"
+#include "vhl_pipeline.hpp"
+#include "vhl_pipeline_manager.hpp"
+#include "vhl_texture.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vhl
+{
+	// Performance overlay drawn with nuklear at the end of the swap chain render pass: frame time
+	// graphs, CPU zones and GPU scopes of the previous frame, draw counters and memory usage.
+	// Vertices and indices are written into the frame's uniform ring, so nothing is allocated
+	// on the GPU per frame. The HUD takes no input.
+	class HudSystem
+	{
+	public:
+		static constexpr uint32_t FRAME_HISTORY = 120;
+		static constexpr float FONT_HEIGHT = 13.f;
+
+		// One line of the memory section
+		struct MemoryUsage
+		{
+			const char* name;
+			VkDeviceSize usedBytes;
+			VkDeviceSize capacityBytes;
+		};
+
+		HudSystem(
+			VhlDevice& device,
+			VhlPipelineManager& pipelineManager,
+			VkRenderPass renderPass,
+			VhlBindlessTable& bindlessTable);
+		~HudSystem();
+
+		HudSystem(const HudSystem&) = delete;
+		HudSystem& operator=(const HudSystem&) = delete;
+
+		// Call once per frame whether the HUD is shown or not, so the graphs are filled when it is
+		// opened. CPU zones between zonesBegin and zonesEnd (VhlProfiler::now()) on the calling
+		// thread are listed; gpuFrameTime is negative when unknown.
+		void addFrame(float cpuFrameTime, float gpuFrameTime, uint64_t zonesBegin, uint64_t zonesEnd);
+
+		// Inside the swap chain render pass, after everything else
+		void render(FrameInfo& frameInfo, const std::vector<MemoryUsage>& memoryUsage);
+
+	private:
+		struct HudVertex
+		{
+			float position[2];
+			float uv[2];
+			uint32_t color;
+		};
+
+		void createFontAtlas();
+		void createPipelineLayout();
+		void createPipeline(VkRenderPass renderPass);
+		void buildLayout(FrameInfo& frameInfo, const std::vector<MemoryUsage>& memoryUsage);
+		void recordDraws(FrameInfo& frameInfo);
+
+		VhlDevice& m_VhlDevice;
+		VhlPipelineManager& m_PipelineManager;
+		VhlBindlessTable& m_BindlessTable;
+
+		VhlPipelineManager::Handle m_VhlPipeline;
+		VkPipelineLayout m_PipelineLayout;  // owned by the manager's layout cache
+		ShaderReflection m_Reflection;
+
+		nk_context m_Context{};
+		nk_font_atlas m_FontAtlas{};
+		nk_draw_null_texture m_NullTexture{};
+		std::unique_ptr<VhlTexture> m_FontTexture;
+		// nk_convert output, reused every frame and copied into the ring
+		nk_buffer m_Commands{};
+		nk_buffer m_Vertices{};
+		nk_buffer m_Indices{};
+
+		std::array<float, FRAME_HISTORY> m_CpuFrameTimes{};
+		std::array<float, FRAME_HISTORY> m_GpuFrameTimes{};
+		uint32_t m_HistoryNext = 0;
+		uint32_t m_HistoryCount = 0;
+		uint64_t m_ZonesBegin = 0;
+		uint64_t m_ZonesEnd = 0;
+	};
+}
@@ -1,10 +1,13 @@
 #include "point_light_system.hpp"
 
+#include "vhl_profiler.hpp"
+
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <cassert>
 #include <stdexcept>
 #include <algorithm>
 
@@ -17,53 +20,52 @@ namespace vhl
         float radius;
     };
 
-    PointLightSystem::PointLightSystem(VhlDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : m_VhlDevice(device) 
+    PointLightSystem::PointLightSystem(
+        VhlDevice& device,
+        VhlPipelineManager& pipelineManager,
+        VkRenderPass renderPass,
+        VkDescriptorSetLayout globalSetLayout)
+        : m_VhlDevice(device), m_PipelineManager(pipelineManager)
     {
         createPipelineLayout(globalSetLayout);
         createPipeline(renderPass);
     }
       
-    PointLightSystem::~PointLightSystem() { vkDestroyPipelineLayout(m_VhlDevice.device(), m_PipelineLayout, nullptr); }
+    PointLightSystem::~PointLightSystem() 
+    {
+        // the worker may still be building against our layout
+        m_VhlPipeline->wait();
+    }
 
     void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) 
     {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(PointLightPushConstants);
-
-        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-        pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-        if (vkCreatePipelineLayout(m_VhlDevice.device(), &pipelineLayoutInfo, nullptr, &m_PipelineLayout) !=
-            VK_SUCCESS) 
+        m_Reflection = VhlPipeline::reflect("shaders/point_light.vert.spv", "shaders/point_light.frag.spv");
+        if (m_Reflection.pushConstantRange.size != sizeof(PointLightPushConstants))
         {
-            throw std::runtime_error("failed to create pipeline layout!");
+            throw std::runtime_error("failed to create point light pipeline layout: PointLightPushConstants is out of sync with the shader push constant block!");
         }
+
+        m_PipelineLayout = m_PipelineManager.getLayoutCache().getPipelineLayout(m_Reflection, {globalSetLayout});
     } 
 
     void PointLightSystem::createPipeline(VkRenderPass renderPass) 
     {
-        PipelineConfigInfo pipelineConfig{};
-        VhlPipeline::defaultPipelineConfigInfo(pipelineConfig);
-        VhlPipeline::enableAlphaBlending(pipelineConfig);
-        pipelineConfig.attributeDescriptions.clear();
-        pipelineConfig.bindingDescriptions.clear();
-        pipelineConfig.renderPass = renderPass;
-        pipelineConfig.pipelineLayout = m_PipelineLayout;
-        m_VhlPipeline = std::make_unique<VhlPipeline>(
-            m_VhlDevice,
+        auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+        VhlPipeline::defaultPipelineConfigInfo(*pipelineConfig);
+        VhlPipeline::enableAlphaBlending(*pipelineConfig);
+        // the billboard quad is generated in the vertex shader, so this drops every attribute
+        VhlPipeline::applyVertexInputs(m_Reflection, *pipelineConfig);
+        pipelineConfig->renderPass = renderPass;
+        pipelineConfig->pipelineLayout = m_PipelineLayout;
+        m_VhlPipeline = m_PipelineManager.createPipeline(
             "shaders/point_light.vert.spv",
             "shaders/point_light.frag.spv",
-            pipelineConfig);
+            std::move(pipelineConfig));
     }
       
     void PointLightSystem::update(FrameInfo& frameInfo, GlobalUBO& ubo)
     {
+        VHL_PROFILE_SCOPE("PointLightSystem::update");
         auto rotateLight = glm::rotate( glm::mat4(1.f), frameInfo.frameTime, {0.f, -1.f, 0.f});
 
         int lightIndex = 0;
@@ -87,7 +89,13 @@ namespace vhl
 
     void PointLightSystem::render(FrameInfo& frameInfo)
     {
-        m_VhlPipeline->bind(frameInfo.commandBuffer);
+        VHL_PROFILE_SCOPE("PointLightSystem::render");
+        VhlGpuScope gpuScope{frameInfo.gpuProfiler, frameInfo.commandBuffer, "point lights"};
+
+        // nothing to draw with until the worker has finished compiling
+        if (!m_VhlPipeline->bind(frameInfo.commandBuffer)) return;
+        auto& counters = frameInfo.renderStats.getCounters();
+        counters.pipelineBinds++;
 
         // sort lights
         std::vector<std::pair<float, VhlGameObject::id_t>> pairsArray;
@@ -112,9 +120,10 @@ namespace vhl
             m_PipelineLayout,
             0, 1,
             &frameInfo.globalDescriptorSet,
-            0,
-            nullptr
+            1,
+            &frameInfo.globalUboOffset
         );
+        counters.descriptorSetBinds++;
 
         // iterate through sorted lights in reverse order
         // however the pairsArray had already sorted in reverse order!
@@ -130,12 +139,16 @@ namespace vhl
             vkCmdPushConstants(
                 frameInfo.commandBuffer,
                 m_PipelineLayout,
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                m_Reflection.pushConstantRange.stageFlags,
                 0,
                 sizeof(PointLightPushConstants),
                 &push
             );
             vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
+            counters.pushConstantUpdates++;
+            counters.drawCalls++;
+            counters.instances++;
+            counters.triangles += 2;
         }
     }
 
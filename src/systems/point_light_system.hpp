@@ -5,6 +5,7 @@
 #include "vhl_frame_info.hpp"
 #include "vhl_game_object.hpp"
 #include "vhl_pipeline.hpp"
+#include "vhl_pipeline_manager.hpp"
 
 // std
 #include <memory>
@@ -15,7 +16,11 @@ namespace vhl
 	class PointLightSystem
 	{
 	public:
-		PointLightSystem(VhlDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+		PointLightSystem(
+			VhlDevice& device,
+			VhlPipelineManager& pipelineManager,
+			VkRenderPass renderPass,
+			VkDescriptorSetLayout globalSetLayout);
 		~PointLightSystem();
 
 		PointLightSystem(const PointLightSystem&) = delete;
@@ -29,8 +34,10 @@ namespace vhl
 		void createPipeline(VkRenderPass renderPass);
 
 		VhlDevice& m_VhlDevice;
+		VhlPipelineManager& m_PipelineManager;
 
-		std::unique_ptr<VhlPipeline> m_VhlPipeline;
-		VkPipelineLayout m_PipelineLayout;
+		VhlPipelineManager::Handle m_VhlPipeline;
+		VkPipelineLayout m_PipelineLayout;  // owned by the manager's layout cache
+		ShaderReflection m_Reflection;
 	};
 }
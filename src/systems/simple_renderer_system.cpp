@@ -1,94 +1,215 @@
 #include "simple_renderer_system.hpp"
 
+#include "vhl_profiler.hpp"
+
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cassert>
 #include <stdexcept>
+#include <vector>
 
 namespace vhl 
 {
-    struct SimplePushConstantData 
+    // Matches ObjectData in shader.vert: the affine model transform as three rows and the normal
+    // matrix as three columns, each padded to a vec4 (std430 mat3x4), then the bindless texture
+    struct ObjectData 
     {
-        glm::mat4 modelMatrix{1.f};
-        glm::mat4 normalMatrix{1.f};
+        glm::vec4 modelRows[3];
+        glm::vec4 normalColumns[3];
+        uint32_t textureIndex;
+        uint32_t padding[3];
     };
+    static_assert(sizeof(ObjectData) == 112, "ObjectData must match the std430 layout in shader.vert");
+
+    // set 2 of shader.vert, rewritten every frame from the frame descriptor allocator
+    static constexpr uint32_t OBJECT_SET = 2;
+
+    static ObjectData packObjectData(TransformComponent& transform, uint32_t textureIndex) 
+    {
+        glm::mat4 modelMatrix = transform.mat4();
+        glm::mat3 normalMatrix = transform.normalMatrix();
+
+        ObjectData data{};
+        for (int i = 0; i < 3; i++) 
+        {
+            data.modelRows[i] = glm::vec4(modelMatrix[0][i], modelMatrix[1][i], modelMatrix[2][i], modelMatrix[3][i]);
+            data.normalColumns[i] = glm::vec4(normalMatrix[i], 0.f);
+        }
+        data.textureIndex = textureIndex;
+        return data;
+    }
+
+    // World space planes of the view frustum with inward facing normals, for [0, 1] clip depth
+    static std::array<glm::vec4, 6> frustumPlanes(const glm::mat4& viewProjection)
+    {
+        auto row = [&](int i) { return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]); };
+        std::array<glm::vec4, 6> planes{
+            row(3) + row(0),
+            row(3) - row(0),
+            row(3) + row(1),
+            row(3) - row(1),
+            row(2),
+            row(3) - row(2),
+        };
+        for (auto& plane : planes)
+        {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return planes;
+    }
 
-    SimpleRenderSystem::SimpleRenderSystem(VhlDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : m_VhlDevice(device) 
+    SimpleRenderSystem::SimpleRenderSystem(
+        VhlDevice& device,
+        VhlPipelineManager& pipelineManager,
+        VkRenderPass renderPass,
+        VkDescriptorSetLayout globalSetLayout,
+        VhlBindlessTable& bindlessTable,
+        const VhlTexture& defaultTexture,
+        const LightingVariant& lightingVariant)
+        : m_VhlDevice(device),
+          m_PipelineManager(pipelineManager),
+          m_BindlessTable(bindlessTable),
+          m_DefaultTexture(defaultTexture),
+          m_RenderPass(renderPass)
     {
         createPipelineLayout(globalSetLayout);
-        createPipeline(renderPass);
+        createPipeline(lightingVariant, nullptr);
     }
       
-    SimpleRenderSystem::~SimpleRenderSystem() { vkDestroyPipelineLayout(m_VhlDevice.device(), m_PipelineLayout, nullptr); }
+    SimpleRenderSystem::~SimpleRenderSystem() 
+    {
+        // workers may still be building variants against our layout
+        m_PipelineManager.waitIdle();
+    }
 
     void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) 
     {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(SimplePushConstantData);
-
-        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-        pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-        if (vkCreatePipelineLayout(m_VhlDevice.device(), &pipelineLayoutInfo, nullptr, &m_PipelineLayout) !=
-            VK_SUCCESS) 
+        m_Reflection = VhlPipeline::reflect("shaders/shader.vert.spv", "shaders/shader.frag.spv");
+        if (m_Reflection.pushConstantRange.size != 0)
         {
-            throw std::runtime_error("failed to create pipeline layout!");
+            // draws go through the render queue, which records no push constants
+            throw std::runtime_error("failed to create simple render pipeline layout: shader declares push constants!");
         }
+
+        // set 0 is the global set and set 1 the bindless table, both owned by the app; the
+        // object set is derived from the shader
+        auto& layoutCache = m_PipelineManager.getLayoutCache();
+        m_ObjectSetLayout = layoutCache.getDescriptorSetLayout(m_Reflection.getSetBindings(OBJECT_SET));
+        m_PipelineLayout = layoutCache.getPipelineLayout(
+            m_Reflection, {globalSetLayout, m_BindlessTable.getDescriptorSetLayout()});
     } 
 
-    void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) 
+    void SimpleRenderSystem::createPipeline(const LightingVariant& lightingVariant, VhlPipelineManager::Handle fallback) 
     {
-        PipelineConfigInfo pipelineConfig{};
-        VhlPipeline::defaultPipelineConfigInfo(pipelineConfig);
-        pipelineConfig.renderPass = renderPass;
-        pipelineConfig.pipelineLayout = m_PipelineLayout;
-        m_VhlPipeline = std::make_unique<VhlPipeline>(
-            m_VhlDevice,
+        assert(
+            lightingVariant.maxLights > 0 && lightingVariant.maxLights <= MAX_LIGHTS &&
+            "Lighting variant must stay within the GlobalUBO light array");
+
+        auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+        VhlPipeline::defaultPipelineConfigInfo(*pipelineConfig);
+        VhlPipeline::applyVertexInputs(m_Reflection, *pipelineConfig);
+        pipelineConfig->renderPass = m_RenderPass;
+        pipelineConfig->pipelineLayout = m_PipelineLayout;
+
+        // constant ids match the layout(constant_id) declarations in shader.vert/shader.frag
+        VkBool32 specularEnabled = lightingVariant.specularEnabled ? VK_TRUE : VK_FALSE;
+        VhlPipeline::addSpecializationConstant(*pipelineConfig, 0, lightingVariant.maxLights);
+        VhlPipeline::addSpecializationConstant(*pipelineConfig, 1, specularEnabled);
+        VhlPipeline::addSpecializationConstant(*pipelineConfig, 2, lightingVariant.specularExponent);
+
+        // variants go through the registry, so a variant another system still holds is reused
+        m_VhlPipeline = m_PipelineManager.createPipeline(
             "shaders/shader.vert.spv",
             "shaders/shader.frag.spv",
-            pipelineConfig);
+            std::move(pipelineConfig),
+            std::move(fallback));
+    }
+
+    void SimpleRenderSystem::setLightingVariant(const LightingVariant& lightingVariant)
+    {
+        createPipeline(lightingVariant, m_VhlPipeline);
     }
       
 
     void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo)
     {
-        m_VhlPipeline->bind(frameInfo.commandBuffer);
-
-        vkCmdBindDescriptorSets(
-            frameInfo.commandBuffer,
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            m_PipelineLayout,
-            0, 1,
-            &frameInfo.globalDescriptorSet,
-            0,
-            nullptr
-        );
-
-        for (auto& kv : frameInfo.gameObjects) 
+        VHL_PROFILE_SCOPE("SimpleRenderSystem::renderGameObjects");
+        // cull against the frustum and report how large streamed textures appear on screen
+        auto planes = frustumPlanes(frameInfo.camera.getProjection() * frameInfo.camera.getView());
+        glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+        float pixelsPerUnit = frameInfo.camera.getProjection()[1][1] * static_cast<float>(frameInfo.extent.height);
+
+        std::vector<VhlGameObject*> visibleObjects;
+        for (auto& kv : frameInfo.gameObjects)
         {
             auto& obj = kv.second;
             if (obj.model == nullptr) continue;
-            SimplePushConstantData push{};
-            push.modelMatrix = obj.transform.mat4();
-            push.normalMatrix = obj.transform.normalMatrix();
-        
-            vkCmdPushConstants(
-                frameInfo.commandBuffer,
-                m_PipelineLayout,
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                0,
-                sizeof(SimplePushConstantData),
-                &push);
-            obj.model->bind(frameInfo.commandBuffer);
-            obj.model->draw(frameInfo.commandBuffer);
+
+            const auto& bounds = obj.model->getBoundingSphere();
+            glm::vec3 center = glm::vec3(obj.transform.mat4() * glm::vec4(bounds.center, 1.f));
+            glm::vec3 scale = glm::abs(obj.transform.scale);
+            float radius = bounds.radius * std::max(scale.x, std::max(scale.y, scale.z));
+
+            bool visible = std::all_of(planes.begin(), planes.end(), [&](const glm::vec4& plane) {
+                return glm::dot(glm::vec3(plane), center) + plane.w >= -radius;
+            });
+            if (!visible) continue;
+            visibleObjects.push_back(&obj);
+
+            if (obj.streamedTexture != nullptr)
+            {
+                // projected diameter of the bounding sphere, assuming the uvs span the texture once
+                float distance = std::max(glm::length(center - cameraPosition), radius);
+                obj.streamedTexture->requestScreenSize(radius * pixelsPerUnit / distance);
+            }
+        }
+        if (visibleObjects.empty()) return;
+        uint32_t objectCount = static_cast<uint32_t>(visibleObjects.size());
+
+        // per-object data is written once into this frame's ring block, draws only carry an index
+        auto objectBlock = frameInfo.uniformRing.allocate(objectCount * sizeof(ObjectData));
+        auto* objects = static_cast<ObjectData*>(objectBlock.mapped);
+
+        VkDescriptorSet objectSet;
+        auto objectBufferInfo = frameInfo.uniformRing.descriptorInfo(objectBlock);
+        if (!VhlDescriptorWriter(*m_ObjectSetLayout, frameInfo.frameDescriptorAllocator)
+                .writeBuffer(0, &objectBufferInfo)
+                .build(objectSet)) 
+        {
+            throw std::runtime_error("failed to allocate object descriptor set!");
+        }
+
+        // shared by all our draws, per-draw resources are picked by index
+        VhlRenderQueue::DescriptorBindings bindings{};
+        bindings.pipelineLayout = m_PipelineLayout;
+        bindings.descriptorSets = {frameInfo.globalDescriptorSet, m_BindlessTable.getDescriptorSet(), objectSet};
+        bindings.dynamicOffsets = {frameInfo.globalUboOffset};
+        uint32_t bindingsId = frameInfo.renderQueue.addDescriptorBindings(std::move(bindings));
+
+        uint32_t objectIndex = 0;
+        for (auto* obj : visibleObjects) 
+        {
+            uint32_t textureIndex = (obj->texture != nullptr ? *obj->texture : m_DefaultTexture).getBindlessIndex();
+            if (obj->streamedTexture != nullptr && obj->streamedTexture->getBindlessIndex() != VhlBindlessTable::INVALID_INDEX)
+            {
+                textureIndex = obj->streamedTexture->getBindlessIndex();
+            }
+            objects[objectIndex] = packObjectData(obj->transform, textureIndex);
+
+            // the queue records the draws sorted, this only describes them
+            VhlRenderQueue::DrawPacket packet{};
+            packet.pipeline = m_VhlPipeline.get();
+            packet.descriptorBindings = bindingsId;
+            packet.material = textureIndex;
+            packet.model = obj->model.get();
+            packet.depth = glm::length(obj->transform.translation - cameraPosition);
+            packet.objectIndex = objectIndex++;
+            frameInfo.renderQueue.submit(packet);
         }
     }
 
@@ -1,10 +1,13 @@
 #pragma once
 
+#include "vhl_bindless_table.hpp"
 #include "vhl_camera.hpp"
 #include "vhl_device.hpp"
 #include "vhl_frame_info.hpp"
 #include "vhl_game_object.hpp"
 #include "vhl_pipeline.hpp"
+#include "vhl_pipeline_manager.hpp"
+#include "vhl_texture.hpp"
 
 // std
 #include <memory>
@@ -12,10 +15,25 @@
 
 namespace vhl 
 {
+	// Compile-time lighting parameters, baked into shader.frag through specialization constants
+	struct LightingVariant
+	{
+		int32_t maxLights = MAX_LIGHTS;
+		bool specularEnabled = true;
+		float specularExponent = 256.f;
+	};
+
 	class SimpleRenderSystem
 	{
 	public:
-		SimpleRenderSystem(VhlDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+		SimpleRenderSystem(
+			VhlDevice& device,
+			VhlPipelineManager& pipelineManager,
+			VkRenderPass renderPass,
+			VkDescriptorSetLayout globalSetLayout,
+			VhlBindlessTable& bindlessTable,
+			const VhlTexture& defaultTexture,
+			const LightingVariant& lightingVariant = LightingVariant{});
 		~SimpleRenderSystem();
 
 		SimpleRenderSystem(const SimpleRenderSystem&) = delete;
@@ -23,13 +41,23 @@ namespace vhl
 
 		void renderGameObjects(FrameInfo& frameInfo);
 
+		// Requests the specialized pipeline for this variant; the current one keeps drawing until it is
+		// ready and is then released by the pipeline manager once no frame in flight uses it
+		void setLightingVariant(const LightingVariant& lightingVariant);
+
 	private:
 		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-		void createPipeline(VkRenderPass renderPass);
+		void createPipeline(const LightingVariant& lightingVariant, VhlPipelineManager::Handle fallback);
 
 		VhlDevice& m_VhlDevice;
-
-		std::unique_ptr<VhlPipeline> m_VhlPipeline;
-		VkPipelineLayout m_PipelineLayout;
+		VhlPipelineManager& m_PipelineManager;
+		VhlBindlessTable& m_BindlessTable;
+		const VhlTexture& m_DefaultTexture;
+		VkRenderPass m_RenderPass;
+
+		VhlPipelineManager::Handle m_VhlPipeline;
+		VkPipelineLayout m_PipelineLayout;  // owned by the manager's layout cache
+		std::shared_ptr<VhlDescriptorSetLayout> m_ObjectSetLayout;
+		ShaderReflection m_Reflection;
 	};
 }
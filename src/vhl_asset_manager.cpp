@@ -0,0 +1,142 @@
+#include "vhl_asset_manager.hpp"
+
+#include "vhl_profiler.hpp"
+#include "vhl_utils.hpp"
+
+// std
+#include <cassert>
+#include <filesystem>
+
+namespace vhl
+{
+    std::size_t VhlAssetManager::AssetKeyHash::operator()(const AssetKey& key) const
+    {
+        std::size_t seed = 0;
+        hashCombine(seed, key.path, key.options.scale, key.options.flipTexcoordY);
+        return seed;
+    }
+
+    VhlAssetManager::VhlAssetManager(VhlModelLoader& modelLoader, VkDeviceSize budgetBytes)
+        : m_ModelLoader(modelLoader), m_BudgetBytes(budgetBytes)
+    {
+    }
+
+    VkDeviceSize VhlAssetManager::geometryBytes(const VhlModel& model)
+    {
+        const auto& range = model.getMeshRange();
+        return static_cast<VkDeviceSize>(range.vertexCount) * model.getGeometryPool().getVertexStride() +
+               static_cast<VkDeviceSize>(range.indexCount) * sizeof(uint32_t);
+    }
+
+    void VhlAssetManager::loadModel(const std::string& filepath, Callback onLoaded, const ModelImportOptions& options)
+    {
+        // "models/a.obj" and "./models/../models/a.obj" are the same asset
+        std::error_code error;
+        auto canonicalPath = std::filesystem::weakly_canonical(filepath, error);
+        AssetKey key{error ? filepath : canonicalPath.string(), options};
+
+        auto& asset = m_Assets[key];
+        if (asset.loading)
+        {
+            m_Hits++;
+            asset.waiting.push_back(std::move(onLoaded));
+            return;
+        }
+        if (auto model = asset.model.lock())
+        {
+            m_Hits++;
+            touch(key, asset, model);
+            onLoaded(std::move(model));
+            return;
+        }
+
+        m_Misses++;
+        asset.loading = true;
+        asset.waiting.push_back(std::move(onLoaded));
+        m_ModelLoader.load(
+            key.path,
+            [this, key](std::shared_ptr<VhlModel> model) { onModelLoaded(key, std::move(model)); },
+            options);
+    }
+
+    void VhlAssetManager::onModelLoaded(const AssetKey& key, std::shared_ptr<VhlModel> model)
+    {
+        auto& asset = m_Assets[key];
+        asset.loading = false;
+        // a failed load passes nullptr on and is forgotten by the next update()
+        if (model != nullptr)
+        {
+            asset.model = model;
+            asset.bytes = geometryBytes(*model);
+            touch(key, asset, model);
+        }
+
+        // callbacks may request more assets, which can rehash m_Assets under us
+        auto waiting = std::move(asset.waiting);
+        asset.waiting.clear();
+        for (auto& callback : waiting)
+        {
+            callback(model);
+        }
+    }
+
+    void VhlAssetManager::touch(const AssetKey& key, Asset& asset, std::shared_ptr<VhlModel> model)
+    {
+        if (asset.cached != nullptr)
+        {
+            m_Lru.splice(m_Lru.begin(), m_Lru, asset.lruPosition);
+            return;
+        }
+        asset.cached = std::move(model);
+        m_Lru.push_front(key);
+        asset.lruPosition = m_Lru.begin();
+    }
+
+    void VhlAssetManager::update()
+    {
+        VHL_PROFILE_SCOPE("VhlAssetManager::update");
+        VkDeviceSize residentBytes = getStats().residentBytes;
+
+        // only models held by nothing but the cache can go, the others stay resident regardless
+        auto it = m_Lru.end();
+        while (residentBytes > m_BudgetBytes && it != m_Lru.begin())
+        {
+            --it;
+            auto& asset = m_Assets.at(*it);
+            if (asset.cached.use_count() > 1) continue;
+
+            residentBytes -= asset.bytes;
+            asset.cached.reset();
+            it = m_Lru.erase(it);
+        }
+
+        // forget assets whose model is gone, a later request loads them again
+        for (auto asset = m_Assets.begin(); asset != m_Assets.end();)
+        {
+            if (!asset->second.loading && asset->second.model.expired())
+            {
+                assert(asset->second.cached == nullptr && "Cached model cannot be expired");
+                asset = m_Assets.erase(asset);
+            }
+            else
+            {
+                ++asset;
+            }
+        }
+    }
+
+    VhlAssetManager::Stats VhlAssetManager::getStats() const
+    {
+        Stats stats{};
+        stats.hits = m_Hits;
+        stats.misses = m_Misses;
+        stats.budgetBytes = m_BudgetBytes;
+        for (const auto& kv : m_Assets)
+        {
+            if (kv.second.model.expired()) continue;
+            stats.residentModels++;
+            stats.residentBytes += kv.second.bytes;
+        }
+        return stats;
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "vhl_model.hpp"
+#include "vhl_model_loader.hpp"
+
+// std
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vhl
+{
+    // Deduplicates model loads by canonical path and import options. Every request for an asset
+    // gets the same shared VhlModel; the registry itself only keeps weak references plus a
+    // least-recently-used set of strong ones, so models nobody uses stay resident while they fit
+    // in the budget and are freed from the geometry pool once they do not.
+    class VhlAssetManager
+    {
+    public:
+        using Callback = VhlModelLoader::Callback;
+
+        struct Stats
+        {
+            uint32_t hits = 0;    // served from a resident model or joined a load in flight
+            uint32_t misses = 0;  // needed a load from disk
+            uint32_t residentModels = 0;
+            VkDeviceSize residentBytes = 0;  // geometry of every model still alive, used or cached
+            VkDeviceSize budgetBytes = 0;
+
+            float hitRate() const { return hits + misses > 0 ? static_cast<float>(hits) / (hits + misses) : 0.f; }
+        };
+
+        VhlAssetManager(VhlModelLoader& modelLoader, VkDeviceSize budgetBytes);
+
+        VhlAssetManager(const VhlAssetManager&) = delete;
+        VhlAssetManager& operator=(const VhlAssetManager&) = delete;
+
+        // Calls onLoaded right away when the model is resident, otherwise from the loader's
+        // update() once it has been uploaded (with nullptr if loading failed)
+        void loadModel(const std::string& filepath, Callback onLoaded, const ModelImportOptions& options = {});
+
+        // Call once per frame after the loader's update(). Drops cached models, least recently
+        // requested first, while the resident geometry exceeds the budget. Evicting only frees
+        // space inside the geometry pool, so the device-local heap is left to the pool's growth.
+        void update();
+
+        Stats getStats() const;
+
+    private:
+        struct AssetKey
+        {
+            std::string path;
+            ModelImportOptions options;
+
+            bool operator==(const AssetKey& other) const { return path == other.path && options == other.options; }
+        };
+
+        struct AssetKeyHash
+        {
+            std::size_t operator()(const AssetKey& key) const;
+        };
+
+        struct Asset
+        {
+            std::weak_ptr<VhlModel> model;
+            std::shared_ptr<VhlModel> cached;  // keeps the model resident while it is unused
+            std::list<AssetKey>::iterator lruPosition;  // valid while cached is set
+            VkDeviceSize bytes = 0;
+            bool loading = false;
+            std::vector<Callback> waiting;  // requests that arrived while loading
+        };
+
+        static VkDeviceSize geometryBytes(const VhlModel& model);
+
+        void onModelLoaded(const AssetKey& key, std::shared_ptr<VhlModel> model);
+        void touch(const AssetKey& key, Asset& asset, std::shared_ptr<VhlModel> model);
+
+        VhlModelLoader& m_ModelLoader;
+        VkDeviceSize m_BudgetBytes;
+
+        std::unordered_map<AssetKey, Asset, AssetKeyHash> m_Assets;
+        std::list<AssetKey> m_Lru;  // cached assets, most recently requested first
+
+        uint32_t m_Hits = 0;
+        uint32_t m_Misses = 0;
+    };
+}
@@ -0,0 +1,163 @@
+#include "vhl_bindless_table.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+namespace vhl
+{
+    uint32_t VhlBindlessTable::Slots::acquire()
+    {
+        if (!freeList.empty())
+        {
+            uint32_t index = freeList.back();
+            freeList.pop_back();
+            return index;
+        }
+        if (next == capacity)
+        {
+            throw std::runtime_error("bindless table is full!");
+        }
+        return next++;
+    }
+
+    void VhlBindlessTable::Slots::release(uint32_t index)
+    {
+        assert(index < next && "Releasing a bindless slot that was never handed out");
+        freeList.push_back(index);
+    }
+
+    VhlBindlessTable::VhlBindlessTable(VhlDevice& device, uint32_t maxStorageBuffers, uint32_t maxSampledImages)
+        : m_VhlDevice(device)
+    {
+        assert(maxStorageBuffers >= MIN_CAPACITY && maxSampledImages >= MIN_CAPACITY && "Bindless table capacity too small");
+
+        const auto& limits = m_VhlDevice.descriptorIndexingProperties;
+        maxStorageBuffers = std::min({
+            maxStorageBuffers,
+            limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+            limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+            limits.maxPerStageUpdateAfterBindResources});
+        // combined image samplers count against both the sampled image and the sampler limits
+        maxSampledImages = std::min({
+            maxSampledImages,
+            limits.maxDescriptorSetUpdateAfterBindSampledImages,
+            limits.maxDescriptorSetUpdateAfterBindSamplers,
+            limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            limits.maxPerStageDescriptorUpdateAfterBindSamplers});
+        // both bindings are visible to the same stages, sampled images get what storage buffers leave
+        if (maxSampledImages > limits.maxPerStageUpdateAfterBindResources - maxStorageBuffers)
+        {
+            maxSampledImages = limits.maxPerStageUpdateAfterBindResources - maxStorageBuffers;
+        }
+        if (maxSampledImages < MIN_CAPACITY)
+        {
+            throw std::runtime_error(
+                "failed to create bindless table: the device leaves " + std::to_string(maxSampledImages) +
+                " sampled image slots next to " + std::to_string(maxStorageBuffers) + " storage buffers, " +
+                "ask for fewer storage buffers!");
+        }
+        m_StorageBuffers.capacity = maxStorageBuffers;
+        m_SampledImages.capacity = maxSampledImages;
+
+        constexpr VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                                          VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                                          VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+        m_SetLayout = VhlDescriptorSetLayout::Builder(m_VhlDevice)
+            .addBinding(STORAGE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS, maxStorageBuffers)
+            .addBinding(SAMPLED_IMAGE_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_ALL_GRAPHICS, maxSampledImages)
+            .setBindingFlags(STORAGE_BUFFER_BINDING, bindingFlags)
+            .setBindingFlags(SAMPLED_IMAGE_BINDING, bindingFlags)
+            .setLayoutFlags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT)
+            .build();
+
+        m_Pool = VhlDescriptorPool::Builder(m_VhlDevice)
+            .setMaxSets(1)
+            .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxStorageBuffers)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxSampledImages)
+            .build();
+
+        if (!m_Pool->allocateDescriptor(m_SetLayout->getDescriptorSetLayout(), m_DescriptorSet))
+        {
+            throw std::runtime_error("failed to allocate bindless descriptor set!");
+        }
+    }
+
+    uint32_t VhlBindlessTable::addStorageBuffer(const VkDescriptorBufferInfo& bufferInfo)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        uint32_t index = m_StorageBuffers.acquire();
+        write(STORAGE_BUFFER_BINDING, index, &bufferInfo, nullptr);
+        return index;
+    }
+
+    uint32_t VhlBindlessTable::addSampledImage(const VkDescriptorImageInfo& imageInfo)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        uint32_t index = m_SampledImages.acquire();
+        write(SAMPLED_IMAGE_BINDING, index, nullptr, &imageInfo);
+        return index;
+    }
+
+    void VhlBindlessTable::updateStorageBuffer(uint32_t index, const VkDescriptorBufferInfo& bufferInfo)
+    {
+        assert(index < m_StorageBuffers.next && "Updating a storage buffer slot that was never handed out");
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        write(STORAGE_BUFFER_BINDING, index, &bufferInfo, nullptr);
+    }
+
+    void VhlBindlessTable::updateSampledImage(uint32_t index, const VkDescriptorImageInfo& imageInfo)
+    {
+        assert(index < m_SampledImages.next && "Updating a sampled image slot that was never handed out");
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        write(SAMPLED_IMAGE_BINDING, index, nullptr, &imageInfo);
+    }
+
+    void VhlBindlessTable::releaseStorageBuffer(uint32_t index)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_StorageBuffers.release(index);
+    }
+
+    void VhlBindlessTable::releaseSampledImage(uint32_t index)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_SampledImages.release(index);
+    }
+
+    void VhlBindlessTable::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set) const
+    {
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout,
+            set, 1,
+            &m_DescriptorSet,
+            0,
+            nullptr);
+    }
+
+    void VhlBindlessTable::write(
+        uint32_t binding,
+        uint32_t index,
+        const VkDescriptorBufferInfo* bufferInfo,
+        const VkDescriptorImageInfo* imageInfo)
+    {
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = m_DescriptorSet;
+        write.dstBinding = binding;
+        write.dstArrayElement = index;
+        write.descriptorCount = 1;
+        write.descriptorType = binding == STORAGE_BUFFER_BINDING ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+                                                                 : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pBufferInfo = bufferInfo;
+        write.pImageInfo = imageInfo;
+
+        vkUpdateDescriptorSets(m_VhlDevice.device(), 1, &write, 0, nullptr);
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "vhl_descriptors.hpp"
+#include "vhl_device.hpp"
+
+// std
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vhl
+{
+    // One large update-after-bind descriptor set holding every storage buffer and sampled image
+    // the renderer uses. Resources are referred to by their slot index from shaders, so the set
+    // is bound once per command buffer and never rebound between draws.
+    //
+    // GLSL side (set number is chosen by the pipeline layout, 1 by convention):
+    //   layout(set = 1, binding = 0) readonly buffer Buffers { ... } bindlessBuffers[];
+    //   layout(set = 1, binding = 1) uniform sampler2D bindlessTextures[];
+    class VhlBindlessTable
+    {
+    public:
+        static constexpr uint32_t STORAGE_BUFFER_BINDING = 0;
+        static constexpr uint32_t SAMPLED_IMAGE_BINDING = 1;
+        static constexpr uint32_t INVALID_INDEX = ~0u;
+        static constexpr uint32_t MIN_CAPACITY = 16;
+
+        // Capacities are clamped to the device's update-after-bind limits, sampled images to what
+        // the per-stage resource limit leaves after the storage buffers. Throws when that is less
+        // than MIN_CAPACITY.
+        VhlBindlessTable(VhlDevice& device, uint32_t maxStorageBuffers = 4096, uint32_t maxSampledImages = 4096);
+
+        VhlBindlessTable(const VhlBindlessTable&) = delete;
+        VhlBindlessTable& operator=(const VhlBindlessTable&) = delete;
+
+        uint32_t addStorageBuffer(const VkDescriptorBufferInfo& bufferInfo);
+        uint32_t addSampledImage(const VkDescriptorImageInfo& imageInfo);
+
+        // Only slots no pending command buffer reads may be rewritten or released
+        void updateStorageBuffer(uint32_t index, const VkDescriptorBufferInfo& bufferInfo);
+        void updateSampledImage(uint32_t index, const VkDescriptorImageInfo& imageInfo);
+        void releaseStorageBuffer(uint32_t index);
+        void releaseSampledImage(uint32_t index);
+
+        void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set) const;
+
+        VkDescriptorSetLayout getDescriptorSetLayout() const { return m_SetLayout->getDescriptorSetLayout(); }
+        VkDescriptorSet getDescriptorSet() const { return m_DescriptorSet; }
+        uint32_t getStorageBufferCapacity() const { return m_StorageBuffers.capacity; }
+        uint32_t getSampledImageCapacity() const { return m_SampledImages.capacity; }
+
+    private:
+        struct Slots
+        {
+            uint32_t capacity = 0;
+            uint32_t next = 0;
+            std::vector<uint32_t> freeList{};
+
+            uint32_t acquire();
+            void release(uint32_t index);
+        };
+
+        void write(
+            uint32_t binding,
+            uint32_t index,
+            const VkDescriptorBufferInfo* bufferInfo,
+            const VkDescriptorImageInfo* imageInfo);
+
+        VhlDevice& m_VhlDevice;
+        std::unique_ptr<VhlDescriptorSetLayout> m_SetLayout;
+        std::unique_ptr<VhlDescriptorPool> m_Pool;
+        VkDescriptorSet m_DescriptorSet = VK_NULL_HANDLE;
+
+        Slots m_StorageBuffers;
+        Slots m_SampledImages;
+        std::mutex m_Mutex;
+    };
+}
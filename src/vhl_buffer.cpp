@@ -53,7 +53,7 @@ namespace vhl {
 	{
         unmap();
         vkDestroyBuffer(m_VhlDevice.device(), buffer, nullptr);
-        vkFreeMemory(m_VhlDevice.device(), memory, nullptr);
+        m_VhlDevice.freeMemory(memory);
     }
 
     /**
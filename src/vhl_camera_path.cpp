@@ -0,0 +1,165 @@
+#include "vhl_camera_path.hpp"
+
+// libs
+#include <glm/gtc/constants.hpp>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace vhl
+{
+    namespace
+    {
+        // Hermite segment between p1 and p2 with finite-difference tangents, which reduces to
+        // Catmull-Rom when keyframes are evenly spaced and stays smooth when they are not
+        glm::vec3 catmullRom(
+            glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3,
+            float t0, float t1, float t2, float t3, float s)
+        {
+            glm::vec3 m1 = (p2 - p0) / std::max(t2 - t0, 1e-6f) * (t2 - t1);
+            glm::vec3 m2 = (p3 - p1) / std::max(t3 - t1, 1e-6f) * (t2 - t1);
+
+            float s2 = s * s;
+            float s3 = s2 * s;
+            return (2.f * s3 - 3.f * s2 + 1.f) * p1 + (s3 - 2.f * s2 + s) * m1 +
+                   (-2.f * s3 + 3.f * s2) * p2 + (s3 - s2) * m2;
+        }
+    }
+
+    void VhlCameraPath::addKeyframe(const Keyframe& keyframe)
+    {
+        assert((m_Keyframes.empty() || keyframe.time > m_Keyframes.back().time) && "Keyframes must be in increasing time");
+
+        Keyframe unwrapped = keyframe;
+        if (!m_Keyframes.empty())
+        {
+            // take the short way around from the previous yaw
+            float previousYaw = m_Keyframes.back().rotation.y;
+            float delta = unwrapped.rotation.y - previousYaw;
+            delta -= glm::two_pi<float>() * std::round(delta / glm::two_pi<float>());
+            unwrapped.rotation.y = previousYaw + delta;
+        }
+        m_Keyframes.push_back(unwrapped);
+    }
+
+    VhlCameraPath VhlCameraPath::loadFromFile(const std::string& filepath)
+    {
+        std::ifstream file{filepath};
+        if (!file)
+        {
+            throw std::runtime_error("failed to open camera path: " + filepath);
+        }
+
+        VhlCameraPath path{};
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#') continue;
+
+            std::istringstream stream{line};
+            Keyframe keyframe{};
+            stream >> keyframe.time
+                   >> keyframe.translation.x >> keyframe.translation.y >> keyframe.translation.z
+                   >> keyframe.rotation.x >> keyframe.rotation.y >> keyframe.rotation.z;
+            if (stream.fail())
+            {
+                throw std::runtime_error("malformed keyframe in camera path " + filepath + ": " + line);
+            }
+            if (!path.empty() && keyframe.time <= path.m_Keyframes.back().time)
+            {
+                throw std::runtime_error("keyframe times must increase in camera path " + filepath);
+            }
+            path.addKeyframe(keyframe);
+        }
+
+        if (path.m_Keyframes.size() < 2)
+        {
+            throw std::runtime_error("camera path needs at least two keyframes: " + filepath);
+        }
+        return path;
+    }
+
+    void VhlCameraPath::saveToFile(const std::string& filepath) const
+    {
+        std::ofstream file{filepath};
+        if (!file)
+        {
+            throw std::runtime_error("failed to write camera path: " + filepath);
+        }
+
+        file << "# time x y z pitch yaw roll\n" << std::setprecision(9);
+        for (const auto& keyframe : m_Keyframes)
+        {
+            file << keyframe.time << ' '
+                 << keyframe.translation.x << ' ' << keyframe.translation.y << ' ' << keyframe.translation.z << ' '
+                 << keyframe.rotation.x << ' ' << keyframe.rotation.y << ' ' << keyframe.rotation.z << '\n';
+        }
+    }
+
+    VhlCameraPath VhlCameraPath::orbit(glm::vec3 center, float radius, float height, float duration, uint32_t keyframeCount)
+    {
+        assert(keyframeCount >= 2 && "An orbit needs at least two keyframes");
+
+        VhlCameraPath path{};
+        for (uint32_t i = 0; i <= keyframeCount; i++)
+        {
+            float angle = glm::two_pi<float>() * i / keyframeCount;
+            glm::vec3 offset{radius * std::sin(angle), height, radius * std::cos(angle)};
+            glm::vec3 direction = glm::normalize(-offset);
+
+            Keyframe keyframe{};
+            keyframe.time = duration * i / keyframeCount;
+            keyframe.translation = center + offset;
+            // inverse of the forward vector VhlCamera::setViewYXZ builds from these angles
+            keyframe.rotation = {std::asin(-direction.y), std::atan2(direction.x, direction.z), 0.f};
+            path.addKeyframe(keyframe);
+        }
+        return path;
+    }
+
+    void VhlCameraPath::evaluate(float time, TransformComponent& transform) const
+    {
+        if (m_Keyframes.empty()) return;
+
+        if (time <= m_Keyframes.front().time || m_Keyframes.size() == 1)
+        {
+            transform.translation = m_Keyframes.front().translation;
+            transform.rotation = m_Keyframes.front().rotation;
+            return;
+        }
+        if (time >= m_Keyframes.back().time)
+        {
+            transform.translation = m_Keyframes.back().translation;
+            transform.rotation = m_Keyframes.back().rotation;
+            return;
+        }
+
+        auto next = std::upper_bound(
+            m_Keyframes.begin(), m_Keyframes.end(), time,
+            [](float t, const Keyframe& keyframe) { return t < keyframe.time; });
+        size_t i2 = static_cast<size_t>(next - m_Keyframes.begin());
+        size_t i1 = i2 - 1;
+        // the end keyframes repeat themselves as outer control points
+        size_t i0 = i1 > 0 ? i1 - 1 : i1;
+        size_t i3 = i2 + 1 < m_Keyframes.size() ? i2 + 1 : i2;
+
+        const auto& k0 = m_Keyframes[i0];
+        const auto& k1 = m_Keyframes[i1];
+        const auto& k2 = m_Keyframes[i2];
+        const auto& k3 = m_Keyframes[i3];
+        float s = (time - k1.time) / (k2.time - k1.time);
+
+        transform.translation = catmullRom(
+            k0.translation, k1.translation, k2.translation, k3.translation,
+            k0.time, k1.time, k2.time, k3.time, s);
+        transform.rotation = catmullRom(
+            k0.rotation, k1.rotation, k2.rotation, k3.rotation,
+            k0.time, k1.time, k2.time, k3.time, s);
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "vhl_game_object.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <string>
+#include <vector>
+
+namespace vhl
+{
+    // A camera flight through timed keyframes, evaluated as a Catmull-Rom spline so the same
+    // time always yields the same view. Paths are recorded from an interactive run or scripted,
+    // and stored as text, one "time x y z pitch yaw roll" keyframe per line.
+    class VhlCameraPath
+    {
+    public:
+        struct Keyframe
+        {
+            float time = 0.f;  // seconds from the start of the path
+            glm::vec3 translation{};
+            glm::vec3 rotation{};  // same angles as TransformComponent::rotation
+        };
+
+        // Keyframes must come in increasing time, yaw is unwrapped so turning past 2pi stays smooth
+        void addKeyframe(const Keyframe& keyframe);
+
+        // Throws if the file cannot be read or holds fewer than two keyframes
+        static VhlCameraPath loadFromFile(const std::string& filepath);
+        void saveToFile(const std::string& filepath) const;
+
+        // Scripted loop around center at the given height, looking at center
+        static VhlCameraPath orbit(glm::vec3 center, float radius, float height, float duration, uint32_t keyframeCount = 16);
+
+        // Times outside the path clamp to its first or last keyframe
+        void evaluate(float time, TransformComponent& transform) const;
+
+        float getDuration() const { return m_Keyframes.empty() ? 0.f : m_Keyframes.back().time; }
+        bool empty() const { return m_Keyframes.empty(); }
+        const std::vector<Keyframe>& getKeyframes() const { return m_Keyframes; }
+
+    private:
+        std::vector<Keyframe> m_Keyframes;
+    };
+}
@@ -1,8 +1,13 @@
 #include "vhl_descriptors.hpp"
+
+#include "vhl_utils.hpp"
  
 // std
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <stdexcept>
+#include <type_traits>
  
 namespace vhl {
  
@@ -24,27 +29,64 @@ namespace vhl {
         return *this;
     }
     
+    VhlDescriptorSetLayout::Builder& VhlDescriptorSetLayout::Builder::setBindingFlags(
+        uint32_t binding, VkDescriptorBindingFlags flags) 
+    {
+        assert(m_Bindings.count(binding) == 1 && "Binding flags set for a binding that was not added");
+        m_BindingFlags[binding] = flags;
+        return *this;
+    }
+
+    VhlDescriptorSetLayout::Builder& VhlDescriptorSetLayout::Builder::setLayoutFlags(
+        VkDescriptorSetLayoutCreateFlags flags) 
+    {
+        m_LayoutFlags = flags;
+        return *this;
+    }
+    
     std::unique_ptr<VhlDescriptorSetLayout> VhlDescriptorSetLayout::Builder::build() const 
     {
-        return std::make_unique<VhlDescriptorSetLayout>(m_VhlDevice, m_Bindings);
+        return std::make_unique<VhlDescriptorSetLayout>(m_VhlDevice, m_Bindings, m_BindingFlags, m_LayoutFlags);
+    }
+
+    std::shared_ptr<VhlDescriptorSetLayout> VhlDescriptorSetLayout::Builder::build(
+        VhlDescriptorLayoutCache& cache) const 
+    {
+        return cache.getLayout(m_Bindings, m_BindingFlags, m_LayoutFlags);
     }
     
     // *************** Descriptor Set Layout *********************
     
     VhlDescriptorSetLayout::VhlDescriptorSetLayout(
-        VhlDevice& vhlDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+        VhlDevice& vhlDevice,
+        std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+        const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags,
+        VkDescriptorSetLayoutCreateFlags layoutFlags)
         : m_VhlDevice{vhlDevice}, m_Bindings{bindings} 
     {
         std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+        std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
         for (const auto& kv : bindings) 
         {
             setLayoutBindings.push_back(kv.second);
+            auto flags = bindingFlags.find(kv.first);
+            setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
         }
     
         VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
         descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        descriptorSetLayoutInfo.flags = layoutFlags;
         descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
         descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        if (!bindingFlags.empty())
+        {
+            bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+            bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+            bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+            descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+        }
         
         if (vkCreateDescriptorSetLayout(
                 m_VhlDevice.device(),
@@ -125,8 +167,7 @@ namespace vhl {
         allocInfo.pSetLayouts = &descriptorSetLayout;
         allocInfo.descriptorSetCount = 1;
         
-        // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-        // a new pool whenever an old pool fills up. But this is beyond our current scope
+        // fixed size pool, VhlDescriptorAllocator is the one that grows when it fills up
         if (vkAllocateDescriptorSets(m_VhlDevice.device(), &allocInfo, &descriptor) != VK_SUCCESS) 
         {
             return false;
@@ -148,10 +189,296 @@ namespace vhl {
         vkResetDescriptorPool(m_VhlDevice.device(), m_DescriptorPool, 0);
     }
     
+    // *************** Descriptor Allocator *********************
+
+    namespace 
+    {
+        constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+    }
+
+    VhlDescriptorAllocator::VhlDescriptorAllocator(
+        VhlDevice& vhlDevice,
+        uint32_t initialSetsPerPool,
+        std::vector<PoolSizeRatio> poolSizeRatios)
+        : m_VhlDevice{vhlDevice}, m_PoolSizeRatios{std::move(poolSizeRatios)}, m_SetsPerPool{initialSetsPerPool} {}
+
+    VhlDescriptorAllocator::~VhlDescriptorAllocator() 
+    {
+        for (auto pool : m_UsedPools) 
+        {
+            vkDestroyDescriptorPool(m_VhlDevice.device(), pool, nullptr);
+        }
+        for (auto pool : m_FreePools) 
+        {
+            vkDestroyDescriptorPool(m_VhlDevice.device(), pool, nullptr);
+        }
+    }
+
+    std::vector<VhlDescriptorAllocator::PoolSizeRatio> VhlDescriptorAllocator::defaultPoolSizeRatios() 
+    {
+        return {
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.f},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.f}};
+    }
+
+    VkDescriptorPool VhlDescriptorAllocator::createPool(uint32_t setCount) 
+    {
+        std::vector<VkDescriptorPoolSize> poolSizes{};
+        for (const auto& ratio : m_PoolSizeRatios) 
+        {
+            uint32_t count = std::max(1u, static_cast<uint32_t>(ratio.ratio * setCount));
+            poolSizes.push_back({ratio.descriptorType, count});
+        }
+
+        VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+        descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        descriptorPoolInfo.pPoolSizes = poolSizes.data();
+        descriptorPoolInfo.maxSets = setCount;
+
+        VkDescriptorPool pool;
+        if (vkCreateDescriptorPool(m_VhlDevice.device(), &descriptorPoolInfo, nullptr, &pool) != VK_SUCCESS) 
+        {
+            throw std::runtime_error("failed to create descriptor pool!");
+        }
+        return pool;
+    }
+
+    VkDescriptorPool VhlDescriptorAllocator::acquirePool() 
+    {
+        if (!m_FreePools.empty()) 
+        {
+            auto pool = m_FreePools.back();
+            m_FreePools.pop_back();
+            return pool;
+        }
+
+        // each new pool is bigger than the last, so a busy allocator settles on a few large pools
+        auto pool = createPool(m_SetsPerPool);
+        m_SetsPerPool = std::min(m_SetsPerPool * 2, MAX_SETS_PER_POOL);
+        return pool;
+    }
+
+    bool VhlDescriptorAllocator::allocateDescriptor(
+        const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor) 
+    {
+        if (m_CurrentPool == VK_NULL_HANDLE) 
+        {
+            m_CurrentPool = acquirePool();
+            m_UsedPools.push_back(m_CurrentPool);
+        }
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = m_CurrentPool;
+        allocInfo.pSetLayouts = &descriptorSetLayout;
+        allocInfo.descriptorSetCount = 1;
+
+        VkResult result = vkAllocateDescriptorSets(m_VhlDevice.device(), &allocInfo, &descriptor);
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) 
+        {
+            // move on to a fresh pool, a failure there means the layout itself does not fit
+            m_CurrentPool = acquirePool();
+            m_UsedPools.push_back(m_CurrentPool);
+            allocInfo.descriptorPool = m_CurrentPool;
+            result = vkAllocateDescriptorSets(m_VhlDevice.device(), &allocInfo, &descriptor);
+        }
+        return result == VK_SUCCESS;
+    }
+
+    void VhlDescriptorAllocator::resetPools() 
+    {
+        for (auto pool : m_UsedPools) 
+        {
+            vkResetDescriptorPool(m_VhlDevice.device(), pool, 0);
+            m_FreePools.push_back(pool);
+        }
+        m_UsedPools.clear();
+        m_CurrentPool = VK_NULL_HANDLE;
+    }
+    
+    // *************** Descriptor Layout Cache *********************
+
+    bool VhlDescriptorLayoutCache::LayoutKey::operator==(const LayoutKey& other) const 
+    {
+        if (layoutFlags != other.layoutFlags || bindingFlags != other.bindingFlags ||
+            bindings.size() != other.bindings.size()) 
+        {
+            return false;
+        }
+        for (size_t i = 0; i < bindings.size(); i++) 
+        {
+            const auto& a = bindings[i];
+            const auto& b = other.bindings[i];
+            if (a.binding != b.binding || a.descriptorType != b.descriptorType ||
+                a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags ||
+                a.pImmutableSamplers != b.pImmutableSamplers) 
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::size_t VhlDescriptorLayoutCache::LayoutKeyHash::operator()(const LayoutKey& key) const 
+    {
+        std::size_t seed = 0;
+        hashCombine(seed, key.layoutFlags);
+        for (size_t i = 0; i < key.bindings.size(); i++) 
+        {
+            const auto& b = key.bindings[i];
+            hashCombine(seed, b.binding, b.descriptorType, b.descriptorCount, b.stageFlags, key.bindingFlags[i]);
+        }
+        return seed;
+    }
+
+    std::shared_ptr<VhlDescriptorSetLayout> VhlDescriptorLayoutCache::getLayout(
+        const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings,
+        const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags,
+        VkDescriptorSetLayoutCreateFlags layoutFlags) 
+    {
+        LayoutKey key{};
+        key.layoutFlags = layoutFlags;
+        for (const auto& kv : bindings) 
+        {
+            key.bindings.push_back(kv.second);
+        }
+        std::sort(key.bindings.begin(), key.bindings.end(), [](const auto& a, const auto& b) {
+            return a.binding < b.binding;
+        });
+        for (const auto& binding : key.bindings) 
+        {
+            auto flags = bindingFlags.find(binding.binding);
+            key.bindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+        }
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_Layouts.find(key);
+        if (it != m_Layouts.end()) 
+        {
+            return it->second;
+        }
+
+        auto setLayout = std::make_shared<VhlDescriptorSetLayout>(m_VhlDevice, bindings, bindingFlags, layoutFlags);
+        m_Layouts.emplace(std::move(key), setLayout);
+        return setLayout;
+    }
+
+    size_t VhlDescriptorLayoutCache::getLayoutCount() const 
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Layouts.size();
+    }
+
+    // *************** Descriptor Set Cache *********************
+
+    namespace 
+    {
+        // non-dispatchable handles are pointers on 64-bit platforms and uint64_t elsewhere
+        template <typename T>
+        uint64_t handleBits(T handle) 
+        {
+            if constexpr (std::is_pointer_v<T>) 
+            {
+                return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle));
+            }
+            else 
+            {
+                return static_cast<uint64_t>(handle);
+            }
+        }
+    }
+
+    bool VhlDescriptorSetCache::SetKey::operator==(const SetKey& other) const 
+    {
+        return setLayout == other.setLayout && resources == other.resources;
+    }
+
+    std::size_t VhlDescriptorSetCache::SetKeyHash::operator()(const SetKey& key) const 
+    {
+        std::size_t seed = 0;
+        hashCombine(seed, key.setLayout);
+        for (auto value : key.resources) 
+        {
+            hashCombine(seed, value);
+        }
+        return seed;
+    }
+
+    bool VhlDescriptorSetCache::getOrCreate(
+        const VhlDescriptorSetLayout& setLayout,
+        std::vector<VkWriteDescriptorSet> writes,
+        VkDescriptorSet& set) 
+    {
+        std::sort(writes.begin(), writes.end(), [](const auto& a, const auto& b) {
+            return a.dstBinding != b.dstBinding ? a.dstBinding < b.dstBinding : a.dstArrayElement < b.dstArrayElement;
+        });
+
+        SetKey key{};
+        key.setLayout = setLayout.getDescriptorSetLayout();
+        for (const auto& write : writes) 
+        {
+            key.resources.push_back(write.dstBinding);
+            key.resources.push_back(write.dstArrayElement);
+            key.resources.push_back(write.descriptorType);
+            for (uint32_t i = 0; i < write.descriptorCount; i++) 
+            {
+                if (write.pBufferInfo != nullptr) 
+                {
+                    key.resources.push_back(handleBits(write.pBufferInfo[i].buffer));
+                    key.resources.push_back(write.pBufferInfo[i].offset);
+                    key.resources.push_back(write.pBufferInfo[i].range);
+                }
+                else if (write.pImageInfo != nullptr) 
+                {
+                    key.resources.push_back(handleBits(write.pImageInfo[i].sampler));
+                    key.resources.push_back(handleBits(write.pImageInfo[i].imageView));
+                    key.resources.push_back(write.pImageInfo[i].imageLayout);
+                }
+            }
+        }
+
+        auto it = m_Sets.find(key);
+        if (it != m_Sets.end()) 
+        {
+            m_Stats.hits++;
+            set = it->second;
+            return true;
+        }
+
+        if (!m_Allocator.allocateDescriptor(key.setLayout, set)) 
+        {
+            return false;
+        }
+        for (auto& write : writes) 
+        {
+            write.dstSet = set;
+        }
+        vkUpdateDescriptorSets(m_VhlDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+        m_Stats.misses++;
+        m_Sets.emplace(std::move(key), set);
+        return true;
+    }
+
+    void VhlDescriptorSetCache::clear() 
+    {
+        m_Sets.clear();
+    }
+    
     // *************** Descriptor Writer *********************
     
     VhlDescriptorWriter::VhlDescriptorWriter(VhlDescriptorSetLayout& setLayout, VhlDescriptorPool& pool)
-        : m_SetLayout{setLayout}, m_Pool{pool} {}
+        : m_SetLayout{setLayout}, m_Pool{&pool} {}
+
+    VhlDescriptorWriter::VhlDescriptorWriter(VhlDescriptorSetLayout& setLayout, VhlDescriptorAllocator& allocator)
+        : m_SetLayout{setLayout}, m_Allocator{&allocator} {}
+
+    VhlDescriptorWriter::VhlDescriptorWriter(VhlDescriptorSetLayout& setLayout, VhlDescriptorSetCache& cache)
+        : m_SetLayout{setLayout}, m_Cache{&cache} {}
     
     VhlDescriptorWriter &VhlDescriptorWriter::writeBuffer(
         uint32_t binding, VkDescriptorBufferInfo *bufferInfo) 
@@ -199,7 +526,14 @@ namespace vhl {
         
     bool VhlDescriptorWriter::build(VkDescriptorSet& set) 
     {
-        bool success = m_Pool.allocateDescriptor(m_SetLayout.getDescriptorSetLayout(), set);
+        if (m_Cache != nullptr) 
+        {
+            return m_Cache->getOrCreate(m_SetLayout, m_Writes, set);
+        }
+
+        bool success = m_Pool != nullptr
+            ? m_Pool->allocateDescriptor(m_SetLayout.getDescriptorSetLayout(), set)
+            : m_Allocator->allocateDescriptor(m_SetLayout.getDescriptorSetLayout(), set);
         if (!success) 
         {
             return false;
@@ -214,7 +548,7 @@ namespace vhl {
         {
             write.dstSet = set;
         }
-        vkUpdateDescriptorSets(m_Pool.m_VhlDevice.device(), static_cast<uint32_t>(m_Writes.size()), m_Writes.data(), 0, nullptr);
+        vkUpdateDescriptorSets(m_SetLayout.m_VhlDevice.device(), static_cast<uint32_t>(m_Writes.size()), m_Writes.data(), 0, nullptr);
     }
  
 }  // namespace vhl
\ No newline at end of file
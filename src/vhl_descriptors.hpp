@@ -4,10 +4,13 @@
  
 // std
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
  
 namespace vhl {
+
+    class VhlDescriptorLayoutCache;
  
     class VhlDescriptorSetLayout 
     {
@@ -22,15 +25,25 @@ namespace vhl {
                 VkDescriptorType descriptorType,
                 VkShaderStageFlags stageFlags,
                 uint32_t count = 1);
+            // e.g. PARTIALLY_BOUND / UPDATE_AFTER_BIND for descriptor indexing
+            Builder& setBindingFlags(uint32_t binding, VkDescriptorBindingFlags flags);
+            Builder& setLayoutFlags(VkDescriptorSetLayoutCreateFlags flags);
             std::unique_ptr<VhlDescriptorSetLayout> build() const;
+            // Returns the cached layout when one with the same bindings and flags already exists
+            std::shared_ptr<VhlDescriptorSetLayout> build(VhlDescriptorLayoutCache& cache) const;
         
         private:
             VhlDevice& m_VhlDevice;
             std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> m_Bindings{};
+            std::unordered_map<uint32_t, VkDescriptorBindingFlags> m_BindingFlags{};
+            VkDescriptorSetLayoutCreateFlags m_LayoutFlags = 0;
         };
     
         VhlDescriptorSetLayout(
-            VhlDevice& vhlDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+            VhlDevice& vhlDevice,
+            std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+            const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags = {},
+            VkDescriptorSetLayoutCreateFlags layoutFlags = 0);
         ~VhlDescriptorSetLayout();
         VhlDescriptorSetLayout(const VhlDescriptorSetLayout &) = delete;
         VhlDescriptorSetLayout &operator=(const VhlDescriptorSetLayout &) = delete;
@@ -88,10 +101,133 @@ namespace vhl {
         friend class VhlDescriptorWriter;
     };
     
+    // Hands out descriptor sets from a chain of pools, creating a new (larger) pool whenever the
+    // current one runs out instead of failing. reset() recycles every pool at once, which makes it
+    // suitable both for long lived sets and for per-frame sets that are thrown away together.
+    class VhlDescriptorAllocator 
+    {
+    public:
+        struct PoolSizeRatio 
+        {
+            VkDescriptorType descriptorType;
+            float ratio;  // descriptors of this type per set
+        };
+
+        VhlDescriptorAllocator(
+            VhlDevice& vhlDevice,
+            uint32_t initialSetsPerPool = 64,
+            std::vector<PoolSizeRatio> poolSizeRatios = defaultPoolSizeRatios());
+        ~VhlDescriptorAllocator();
+        VhlDescriptorAllocator(const VhlDescriptorAllocator&) = delete;
+        VhlDescriptorAllocator &operator=(const VhlDescriptorAllocator&) = delete;
+
+        bool allocateDescriptor(const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet &descriptor);
+
+        // Invalidates every set handed out so far; only call once the GPU is done with them
+        void resetPools();
+
+        uint32_t getPoolCount() const { return static_cast<uint32_t>(m_UsedPools.size() + m_FreePools.size()); }
+
+        static std::vector<PoolSizeRatio> defaultPoolSizeRatios();
+
+    private:
+        VkDescriptorPool acquirePool();
+        VkDescriptorPool createPool(uint32_t setCount);
+
+        VhlDevice& m_VhlDevice;
+        std::vector<PoolSizeRatio> m_PoolSizeRatios;
+        uint32_t m_SetsPerPool;
+        VkDescriptorPool m_CurrentPool = VK_NULL_HANDLE;
+        std::vector<VkDescriptorPool> m_UsedPools;
+        std::vector<VkDescriptorPool> m_FreePools;
+    };
+    
+    // Deduplicates set layouts by their binding descriptions, flags included. Layouts live as
+    // long as the cache, so the returned handles can be stored freely.
+    class VhlDescriptorLayoutCache 
+    {
+    public:
+        VhlDescriptorLayoutCache(VhlDevice& vhlDevice) : m_VhlDevice{vhlDevice} {}
+        VhlDescriptorLayoutCache(const VhlDescriptorLayoutCache&) = delete;
+        VhlDescriptorLayoutCache &operator=(const VhlDescriptorLayoutCache&) = delete;
+
+        std::shared_ptr<VhlDescriptorSetLayout> getLayout(
+            const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings,
+            const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags = {},
+            VkDescriptorSetLayoutCreateFlags layoutFlags = 0);
+
+        size_t getLayoutCount() const;
+
+    private:
+        struct LayoutKey 
+        {
+            std::vector<VkDescriptorSetLayoutBinding> bindings;  // sorted by binding
+            std::vector<VkDescriptorBindingFlags> bindingFlags;
+            VkDescriptorSetLayoutCreateFlags layoutFlags;
+            bool operator==(const LayoutKey& other) const;
+        };
+
+        struct LayoutKeyHash 
+        {
+            std::size_t operator()(const LayoutKey& key) const;
+        };
+
+        VhlDevice& m_VhlDevice;
+        std::unordered_map<LayoutKey, std::shared_ptr<VhlDescriptorSetLayout>, LayoutKeyHash> m_Layouts;
+        mutable std::mutex m_Mutex;
+    };
+
+    // Returns an existing set when a layout is written with exactly the same resources again,
+    // skipping both the allocation and vkUpdateDescriptorSets. Sets come from the given allocator;
+    // call clear() whenever that allocator is reset or a resource bound through the cache is destroyed.
+    class VhlDescriptorSetCache 
+    {
+    public:
+        struct Stats 
+        {
+            uint32_t hits = 0;
+            uint32_t misses = 0;
+        };
+
+        VhlDescriptorSetCache(VhlDevice& vhlDevice, VhlDescriptorAllocator& allocator)
+            : m_VhlDevice{vhlDevice}, m_Allocator{allocator} {}
+        VhlDescriptorSetCache(const VhlDescriptorSetCache&) = delete;
+        VhlDescriptorSetCache &operator=(const VhlDescriptorSetCache&) = delete;
+
+        bool getOrCreate(
+            const VhlDescriptorSetLayout& setLayout,
+            std::vector<VkWriteDescriptorSet> writes,
+            VkDescriptorSet& set);
+
+        void clear();
+        Stats getStats() const { return m_Stats; }
+
+    private:
+        struct SetKey 
+        {
+            VkDescriptorSetLayout setLayout;
+            std::vector<uint64_t> resources;  // flattened bindings and the handles bound to them
+            bool operator==(const SetKey& other) const;
+        };
+
+        struct SetKeyHash 
+        {
+            std::size_t operator()(const SetKey& key) const;
+        };
+
+        VhlDevice& m_VhlDevice;
+        VhlDescriptorAllocator& m_Allocator;
+        std::unordered_map<SetKey, VkDescriptorSet, SetKeyHash> m_Sets;
+        Stats m_Stats{};
+    };
+    
     class VhlDescriptorWriter 
     {
     public:
         VhlDescriptorWriter(VhlDescriptorSetLayout& setLayout, VhlDescriptorPool& pool);
+        VhlDescriptorWriter(VhlDescriptorSetLayout& setLayout, VhlDescriptorAllocator& allocator);
+        // build() returns a shared set for identical writes, so never overwrite() a set built this way
+        VhlDescriptorWriter(VhlDescriptorSetLayout& setLayout, VhlDescriptorSetCache& cache);
         
         VhlDescriptorWriter& writeBuffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo);
         VhlDescriptorWriter& writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo);
@@ -101,7 +237,9 @@ namespace vhl {
         
     private:
         VhlDescriptorSetLayout& m_SetLayout;
-        VhlDescriptorPool& m_Pool;
+        VhlDescriptorPool* m_Pool = nullptr;
+        VhlDescriptorAllocator* m_Allocator = nullptr;
+        VhlDescriptorSetCache* m_Cache = nullptr;
         std::vector<VkWriteDescriptorSet> m_Writes;
     };
  
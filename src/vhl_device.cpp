@@ -1,13 +1,41 @@
 #include "vhl_device.hpp"
 
 // std headers
-
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <iostream>
 #include <set>
 #include <unordered_set>
 
 namespace vhl
 {
+    // descriptor indexing features VhlBindlessTable relies on
+    static bool supportsBindless(const VkPhysicalDeviceVulkan12Features& features)
+    {
+        return features.descriptorIndexing &&
+               features.runtimeDescriptorArray &&
+               features.descriptorBindingPartiallyBound &&
+               features.descriptorBindingStorageBufferUpdateAfterBind &&
+               features.descriptorBindingSampledImageUpdateAfterBind &&
+               features.descriptorBindingUpdateUnusedWhilePending &&
+               features.shaderStorageBufferArrayNonUniformIndexing &&
+               features.shaderSampledImageArrayNonUniformIndexing;
+    }
+
+    static bool hasDeviceExtension(VkPhysicalDevice device, const char* name)
+    {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+        return std::any_of(availableExtensions.begin(), availableExtensions.end(), [name](const VkExtensionProperties& extension)
+        {
+            return std::strcmp(extension.extensionName, name) == 0;
+        });
+    }
+
     // local callback functions
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData) 
     {
@@ -38,14 +66,23 @@ namespace vhl
     }
 
     // class member functions
-    VhlDevice::VhlDevice(VhlWindow& window) : m_VhlWindow(window)
+    VhlDevice::VhlDevice(VhlWindow& window) : m_VhlWindow(window), m_Headless(window.isHeadless())
     {
+        if (m_Headless)
+        {
+            deviceExtensions.clear();
+        }
+
         createInstance();
         setupDebugMessenger();
-        createSurface();
+        if (!m_Headless)
+        {
+            createSurface();
+        }
         pickPhysicalDevice();
         createLogicalDevice();
         createCommandPool();
+        updateMemoryBudget();
     }
 
     VhlDevice::~VhlDevice() 
@@ -58,7 +95,10 @@ namespace vhl
             DestroyDebugUtilsMessengerEXT(m_Instance, m_DebugMessenger, nullptr);
         }
       
-        vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
+        if (m_Surface != VK_NULL_HANDLE)
+        {
+            vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
+        }
         vkDestroyInstance(m_Instance, nullptr);
     }
 
@@ -75,7 +115,7 @@ namespace vhl
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_1;
+        appInfo.apiVersion = VK_API_VERSION_1_2;
     
         VkInstanceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -136,6 +176,14 @@ namespace vhl
         
         vkGetPhysicalDeviceProperties(m_PhysicalDevice, &properties);
         std::cout << "physical device: " << properties.deviceName << std::endl;
+        vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memoryProperties);
+
+        descriptorIndexingProperties = {};
+        descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &descriptorIndexingProperties;
+        vkGetPhysicalDeviceProperties2(m_PhysicalDevice, &properties2);
     }
 
     void VhlDevice::createLogicalDevice() 
@@ -156,16 +204,49 @@ namespace vhl
             queueCreateInfos.push_back(queueCreateInfo);
         }
       
-        VkPhysicalDeviceFeatures deviceFeatures = {};
-        deviceFeatures.samplerAnisotropy = VK_TRUE;
+        VkPhysicalDeviceVulkan12Features deviceFeatures12 = {};
+        deviceFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        deviceFeatures12.descriptorIndexing = VK_TRUE;
+        deviceFeatures12.runtimeDescriptorArray = VK_TRUE;
+        deviceFeatures12.descriptorBindingPartiallyBound = VK_TRUE;
+        deviceFeatures12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        deviceFeatures12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        deviceFeatures12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        deviceFeatures12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+        deviceFeatures12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+        // optional, VhlRenderQueue falls back to one draw call per packet without them
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &supportedFeatures);
+        multiDrawIndirectSupported = supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance;
+        // cooked .vtex textures fail to load without it
+        textureCompressionBCSupported = supportedFeatures.textureCompressionBC;
+        // VhlRenderStats only counts on the CPU side without it
+        pipelineStatisticsQuerySupported = supportedFeatures.pipelineStatisticsQuery;
+        // updateMemoryBudget() estimates from our own allocations without it
+        memoryBudgetSupported = hasDeviceExtension(m_PhysicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        if (memoryBudgetSupported)
+        {
+            deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+
+        VkPhysicalDeviceFeatures2 deviceFeatures = {};
+        deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        deviceFeatures.pNext = &deviceFeatures12;
+        deviceFeatures.features.samplerAnisotropy = VK_TRUE;
+        deviceFeatures.features.multiDrawIndirect = multiDrawIndirectSupported ? VK_TRUE : VK_FALSE;
+        deviceFeatures.features.drawIndirectFirstInstance = multiDrawIndirectSupported ? VK_TRUE : VK_FALSE;
+        deviceFeatures.features.textureCompressionBC = textureCompressionBCSupported ? VK_TRUE : VK_FALSE;
+        deviceFeatures.features.pipelineStatisticsQuery = pipelineStatisticsQuerySupported ? VK_TRUE : VK_FALSE;
       
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = &deviceFeatures;
       
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
       
-        createInfo.pEnabledFeatures = &deviceFeatures;
+        createInfo.pEnabledFeatures = nullptr;
         createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
         createInfo.ppEnabledExtensionNames = deviceExtensions.data();
       
@@ -214,18 +295,28 @@ namespace vhl
       
         bool extensionsSupported = checkDeviceExtensionSupport(device);
       
-        bool swapChainAdequate = false;
-        if (extensionsSupported) 
+        bool swapChainAdequate = m_Headless;
+        if (extensionsSupported && !m_Headless) 
         {
             SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
       
-        VkPhysicalDeviceFeatures supportedFeatures;
-        vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+        VkPhysicalDeviceVulkan12Features supportedFeatures12{};
+        supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 supportedFeatures{};
+        supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supportedFeatures.pNext = &supportedFeatures12;
+        if (deviceProperties.apiVersion >= VK_API_VERSION_1_2)
+        {
+            vkGetPhysicalDeviceFeatures2(device, &supportedFeatures);
+        }
       
         return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-               supportedFeatures.samplerAnisotropy;
+               supportedFeatures.features.samplerAnisotropy && supportsBindless(supportedFeatures12);
     }
       
     void VhlDevice::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) 
@@ -279,11 +370,14 @@ namespace vhl
       
     std::vector<const char*> VhlDevice::getRequiredExtensions() 
     {
-        uint32_t glfwExtensionCount = 0;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-      
-        std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        std::vector<const char*> extensions;
+        if (!m_Headless)
+        {
+            uint32_t glfwExtensionCount = 0;
+            const char** glfwExtensions;
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+            extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        }
       
         if (enableValidationLayers)
         {
@@ -358,9 +452,18 @@ namespace vhl
             if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) 
             {
                 indices.graphicsFamily = i;
+                indices.graphicsTimestampValidBits = queueFamily.timestampValidBits;
+                if (m_Headless)
+                {
+                    // nothing is presented, the graphics queue stands in for the present queue
+                    indices.presentFamily = i;
+                }
             }
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_Surface, &presentSupport);
+            if (!m_Headless)
+            {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_Surface, &presentSupport);
+            }
             if (queueFamily.queueCount > 0 && presentSupport) 
             {
                 indices.presentFamily = i;
@@ -404,6 +507,13 @@ namespace vhl
         return details;
     }
       
+    VkFormatProperties VhlDevice::getFormatProperties(VkFormat format)
+    {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(m_PhysicalDevice, format, &formatProperties);
+        return formatProperties;
+    }
+
     VkFormat VhlDevice::findSupportedFormat(
         const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features) 
     {
@@ -461,15 +571,7 @@ namespace vhl
         VkMemoryRequirements memRequirements;
         vkGetBufferMemoryRequirements(m_Device, buffer, &memRequirements);
       
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-      
-        if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate vertex buffer memory!");
-        }
-      
+        bufferMemory = allocateMemory(memRequirements, properties);
         vkBindBufferMemory(m_Device, buffer, bufferMemory, 0);
     }
       
@@ -562,20 +664,113 @@ namespace vhl
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(m_Device, image, &memRequirements);
       
+        imageMemory = allocateMemory(memRequirements, properties);
+        if (vkBindImageMemory(m_Device, image, imageMemory, 0) != VK_SUCCESS) 
+        {
+            throw std::runtime_error("failed to bind image memory!");
+        }
+    }
+
+    VkDeviceMemory VhlDevice::allocateMemory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties)
+    {
         VkMemoryAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-      
-        if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) 
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+
+        VkDeviceMemory memory;
+        if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
         {
-            throw std::runtime_error("failed to allocate image memory!");
+            throw std::runtime_error("failed to allocate device memory!");
         }
-      
-        if (vkBindImageMemory(m_Device, image, imageMemory, 0) != VK_SUCCESS) 
+
+        uint32_t heapIndex = memoryProperties.memoryTypes[allocInfo.memoryTypeIndex].heapIndex;
+        std::lock_guard<std::mutex> lock{m_AllocationMutex};
+        m_Allocations[memory] = {heapIndex, requirements.size};
+        m_HeapAllocated[heapIndex] += requirements.size;
+        return memory;
+    }
+
+    void VhlDevice::freeMemory(VkDeviceMemory memory)
+    {
+        if (memory == VK_NULL_HANDLE) return;
+
         {
-            throw std::runtime_error("failed to bind image memory!");
+            std::lock_guard<std::mutex> lock{m_AllocationMutex};
+            auto it = m_Allocations.find(memory);
+            assert(it != m_Allocations.end() && "Memory was not allocated by VhlDevice");
+            m_HeapAllocated[it->second.heapIndex] -= it->second.size;
+            m_Allocations.erase(it);
         }
+        vkFreeMemory(m_Device, memory, nullptr);
     }
 
-}
\ No newline at end of file
+    void VhlDevice::updateMemoryBudget()
+    {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        if (memoryBudgetSupported)
+        {
+            VkPhysicalDeviceMemoryProperties2 memoryProperties2{};
+            memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+            memoryProperties2.pNext = &budgetProperties;
+            vkGetPhysicalDeviceMemoryProperties2(m_PhysicalDevice, &memoryProperties2);
+        }
+
+        std::lock_guard<std::mutex> lock{m_AllocationMutex};
+        m_MemoryBudget.resize(memoryProperties.memoryHeapCount);
+        m_MemoryWarningLevels.resize(memoryProperties.memoryHeapCount);
+        for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; heap++)
+        {
+            auto& budget = m_MemoryBudget[heap];
+            budget.size = memoryProperties.memoryHeaps[heap].size;
+            budget.deviceLocal = memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+            budget.allocated = m_HeapAllocated[heap];
+            // some drivers report nothing for heaps this process has not touched yet
+            if (memoryBudgetSupported && budgetProperties.heapBudget[heap] > 0)
+            {
+                budget.budget = budgetProperties.heapBudget[heap];
+                budget.usage = budgetProperties.heapUsage[heap];
+            }
+            else
+            {
+                // the whole heap, the thresholds already keep the usage below it
+                budget.budget = budget.size;
+                budget.usage = budget.allocated;
+            }
+            m_HeapAllocatedAtUpdate[heap] = budget.allocated;
+
+            float fraction = static_cast<float>(budget.usage) / static_cast<float>(std::max<VkDeviceSize>(budget.budget, 1));
+            uint32_t level = fraction > MEMORY_CRITICAL_THRESHOLD ? 2 : fraction > MEMORY_WARNING_THRESHOLD ? 1 : 0;
+            if (level > m_MemoryWarningLevels[heap])
+            {
+                std::cerr << "memory heap " << heap << (budget.deviceLocal ? " (device local)" : "") << " at "
+                          << static_cast<int>(fraction * 100.f) << "% of its " << budget.budget / (1024 * 1024)
+                          << " MB budget, " << budget.allocated / (1024 * 1024) << " MB allocated by the engine"
+                          << (level == 2 ? ", allocations may start failing" : "") << std::endl;
+            }
+            m_MemoryWarningLevels[heap] = level;
+        }
+    }
+
+    uint32_t VhlDevice::findMemoryHeap(VkMemoryPropertyFlags properties)
+    {
+        return memoryProperties.memoryTypes[findMemoryType(~0u, properties)].heapIndex;
+    }
+
+    VkDeviceSize VhlDevice::fitToMemoryBudget(VkMemoryPropertyFlags properties, VkDeviceSize residentBytes, VkDeviceSize budgetBytes)
+    {
+        uint32_t heap = findMemoryHeap(properties);
+
+        std::lock_guard<std::mutex> lock{m_AllocationMutex};
+        const auto& budget = m_MemoryBudget[heap];
+        // the queried usage lags behind what was allocated or freed since
+        VkDeviceSize usage = budget.usage + m_HeapAllocated[heap];
+        usage = usage > m_HeapAllocatedAtUpdate[heap] ? usage - m_HeapAllocatedAtUpdate[heap] : 0;
+
+        auto limit = static_cast<VkDeviceSize>(budget.budget * static_cast<double>(MEMORY_WARNING_THRESHOLD));
+        // everything the heap holds besides this system's memory stays where it is
+        VkDeviceSize others = usage > residentBytes ? usage - residentBytes : 0;
+        return limit > others ? std::min(budgetBytes, limit - others) : 0;
+    }
+}
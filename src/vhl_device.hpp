@@ -3,7 +3,10 @@
 #include "vhl_window.hpp"
 
 // std lib headers
+#include <array>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <optional>
 
@@ -18,6 +21,7 @@ namespace vhl
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        uint32_t graphicsTimestampValidBits = 0;  // 0 when the graphics queue can't write timestamps
     
         bool isComplete() {
             return graphicsFamily.has_value() && presentFamily.has_value();
@@ -27,6 +31,21 @@ namespace vhl
     class VhlDevice
     {
     public:
+        // One memory heap as of the last updateMemoryBudget()
+        struct MemoryHeapBudget
+        {
+            VkDeviceSize size = 0;
+            VkDeviceSize budget = 0;  // what this process can allocate from the heap without trouble
+            VkDeviceSize usage = 0;  // by this process, including the driver's own allocations when reported
+            VkDeviceSize allocated = 0;  // by createBuffer and createImageWithInfo
+            bool deviceLocal = false;
+        };
+
+        // Streaming systems evict to keep every heap under the warning threshold of its budget.
+        // updateMemoryBudget() warns once a heap goes past it, and again past the critical one.
+        static constexpr float MEMORY_WARNING_THRESHOLD = 0.8f;
+        static constexpr float MEMORY_CRITICAL_THRESHOLD = 0.95f;
+
     #ifdef NDEBUG
         const bool enableValidationLayers = false;
     #else
@@ -47,12 +66,15 @@ namespace vhl
         VkSurfaceKHR surface() { return m_Surface; }
         VkQueue graphicsQueue() { return m_GraphicsQueue; }
         VkQueue presentQueue() { return m_PresentQueue; }
+        // No surface, no swapchain extension and no present support required, presentQueue() is the graphics queue
+        bool isHeadless() const { return m_Headless; }
 
         SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(m_PhysicalDevice); }
         uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
         QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(m_PhysicalDevice); }
         VkFormat findSupportedFormat(
             const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+        VkFormatProperties getFormatProperties(VkFormat format);
 
         // Buffer Helper Functions
         void createBuffer(
@@ -71,8 +93,29 @@ namespace vhl
             VkMemoryPropertyFlags properties,
             VkImage &image,
             VkDeviceMemory &imageMemory);
+        // Memory for resources bound by the caller, counted on its heap like the above
+        VkDeviceMemory allocateMemory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties);
+        // For memory from createBuffer, createImageWithInfo and allocateMemory, takes it off its heap's count
+        void freeMemory(VkDeviceMemory memory);
+
+        // Call once per frame. Queries VK_EXT_memory_budget when the device has it, otherwise the
+        // budget is the size of each heap and the usage is what VhlDevice allocated.
+        void updateMemoryBudget();
+        const std::vector<MemoryHeapBudget>& getMemoryBudget() const { return m_MemoryBudget; }
+        // Heap findMemoryType picks for these properties when any memory type is allowed
+        uint32_t findMemoryHeap(VkMemoryPropertyFlags properties);
+        // Lowers a system's own budget so that, holding residentBytes of the heap behind
+        // properties, it keeps that heap under MEMORY_WARNING_THRESHOLD of the device budget.
+        // Counts allocations made since the last updateMemoryBudget().
+        VkDeviceSize fitToMemoryBudget(VkMemoryPropertyFlags properties, VkDeviceSize residentBytes, VkDeviceSize budgetBytes);
 
         VkPhysicalDeviceProperties properties;
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties;
+        bool multiDrawIndirectSupported = false;  // multiDrawIndirect and drawIndirectFirstInstance
+        bool textureCompressionBCSupported = false;
+        bool pipelineStatisticsQuerySupported = false;
+        bool memoryBudgetSupported = false;  // VK_EXT_memory_budget
 
     private:
         void createInstance();
@@ -99,12 +142,26 @@ namespace vhl
         VkCommandPool m_CommandPool;
       
         VkDevice m_Device;
-        VkSurfaceKHR m_Surface;
+        VkSurfaceKHR m_Surface = VK_NULL_HANDLE;
         VkQueue m_GraphicsQueue;
         VkQueue m_PresentQueue;
       
         const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
-        const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
-
+        std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        bool m_Headless;
+
+        struct Allocation
+        {
+            uint32_t heapIndex;
+            VkDeviceSize size;
+        };
+
+        // loader workers create staging buffers
+        std::mutex m_AllocationMutex;
+        std::unordered_map<VkDeviceMemory, Allocation> m_Allocations;
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_HeapAllocated{};
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_HeapAllocatedAtUpdate{};
+        std::vector<MemoryHeapBudget> m_MemoryBudget;
+        std::vector<uint32_t> m_MemoryWarningLevels;  // 0 below the warning threshold, 1 past it, 2 past critical
     };
 }
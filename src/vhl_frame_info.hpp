@@ -1,7 +1,12 @@
 #pragma once
 
 #include "vhl_camera.hpp"
+#include "vhl_descriptors.hpp"
 #include "vhl_game_object.hpp"
+#include "vhl_gpu_profiler.hpp"
+#include "vhl_render_queue.hpp"
+#include "vhl_render_stats.hpp"
+#include "vhl_uniform_ring.hpp"
 
 // lib
 #include <vulkan/vulkan.h>
@@ -33,7 +38,14 @@ namespace vhl {
         VkCommandBuffer commandBuffer;
         VhlCamera& camera;
         VkDescriptorSet globalDescriptorSet;
+        uint32_t globalUboOffset;  // dynamic offset of this frame's GlobalUBO block in the uniform ring
         VhlGameObject::Map& gameObjects;
+        VhlDescriptorAllocator& frameDescriptorAllocator;  // sets allocated here live until this frame index is reused
+        VhlUniformRing& uniformRing;
+        VhlRenderQueue& renderQueue;  // draws submitted here are recorded by the app in sorted order
+        VkExtent2D extent;  // of the render target, for screen-space decisions such as texture streaming
+        VhlGpuProfiler& gpuProfiler;  // wrap recorded work in a VhlGpuScope to time it
+        VhlRenderStats& renderStats;  // systems add the draws and binds they record to its counters
     };
 }
 
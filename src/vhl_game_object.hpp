@@ -1,6 +1,8 @@
 #pragma once
 
 #include "vhl_model.hpp"
+#include "vhl_texture.hpp"
+#include "vhl_texture_streamer.hpp"
 
 // libs
 #include <glm/gtc/matrix_transform.hpp>
@@ -56,6 +58,8 @@ namespace vhl {
 
         // Optional pointer components
         std::shared_ptr<VhlModel> model{};
+        std::shared_ptr<VhlTexture> texture{};  // sampled with the model's uvs, white when unset
+        std::shared_ptr<VhlStreamedTexture> streamedTexture{};  // takes precedence over texture once resident
         std::unique_ptr<PointLightComponent> pointLight = nullptr;
     private:
         VhlGameObject(id_t objId) : id{objId} {}
@@ -0,0 +1,421 @@
+#include "vhl_geometry_pool.hpp"
+
+#include "vhl_swap_chain.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace vhl
+{
+    VhlGeometryPool::RangeAllocator::RangeAllocator(uint32_t capacity) : m_Capacity(capacity)
+    {
+        reset(capacity, 0);
+    }
+
+    bool VhlGeometryPool::RangeAllocator::allocate(uint32_t count, uint32_t& offset)
+    {
+        for (auto it = m_FreeRanges.begin(); it != m_FreeRanges.end(); ++it)
+        {
+            if (it->second < count) continue;
+
+            offset = it->first;
+            uint32_t remaining = it->second - count;
+            m_FreeRanges.erase(it);
+            if (remaining > 0)
+            {
+                m_FreeRanges.emplace(offset + count, remaining);
+            }
+            m_Used += count;
+            return true;
+        }
+        return false;
+    }
+
+    void VhlGeometryPool::RangeAllocator::free(uint32_t offset, uint32_t count)
+    {
+        assert(count <= m_Used && "Freeing more elements than were allocated");
+        m_Used -= count;
+
+        auto next = m_FreeRanges.lower_bound(offset);
+        if (next != m_FreeRanges.begin())
+        {
+            auto previous = std::prev(next);
+            assert(previous->first + previous->second <= offset && "Freeing a range that is already free");
+            if (previous->first + previous->second == offset)
+            {
+                offset = previous->first;
+                count += previous->second;
+                m_FreeRanges.erase(previous);
+            }
+        }
+        if (next != m_FreeRanges.end() && offset + count == next->first)
+        {
+            count += next->second;
+            m_FreeRanges.erase(next);
+        }
+        m_FreeRanges.emplace(offset, count);
+    }
+
+    void VhlGeometryPool::RangeAllocator::reset(uint32_t capacity, uint32_t used)
+    {
+        m_Capacity = capacity;
+        m_Used = used;
+        m_FreeRanges.clear();
+        if (used < capacity)
+        {
+            m_FreeRanges.emplace(used, capacity - used);
+        }
+    }
+
+    VhlGeometryPool::VhlGeometryPool(VhlDevice& device, uint32_t vertexStride, uint32_t vertexCapacity, uint32_t indexCapacity)
+        : m_VhlDevice(device),
+          m_VertexStride(vertexStride),
+          m_Vertices(vertexCapacity),
+          m_Indices(indexCapacity)
+    {
+        assert(vertexCapacity > 0 && indexCapacity > 0 && "Geometry pool cannot be empty");
+        m_VertexBuffer = createVertexBuffer(vertexCapacity);
+        m_IndexBuffer = createIndexBuffer(indexCapacity);
+    }
+
+    VhlGeometryPool::~VhlGeometryPool() {}
+
+    VkDeviceSize VhlGeometryPool::bufferBytes(uint32_t vertexCapacity, uint32_t indexCapacity) const
+    {
+        return static_cast<VkDeviceSize>(vertexCapacity) * m_VertexStride +
+               static_cast<VkDeviceSize>(indexCapacity) * sizeof(uint32_t);
+    }
+
+    std::unique_ptr<VhlBuffer> VhlGeometryPool::createVertexBuffer(uint32_t capacity) const
+    {
+        // transfer source as well, compaction copies out of the old buffers
+        return std::make_unique<VhlBuffer>(
+            m_VhlDevice,
+            m_VertexStride,
+            capacity,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    std::unique_ptr<VhlBuffer> VhlGeometryPool::createIndexBuffer(uint32_t capacity) const
+    {
+        return std::make_unique<VhlBuffer>(
+            m_VhlDevice,
+            sizeof(uint32_t),
+            capacity,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    bool VhlGeometryPool::tryAllocate(uint32_t vertexCount, uint32_t indexCount, MeshRange& range)
+    {
+        uint32_t vertexOffset;
+        if (!m_Vertices.allocate(vertexCount, vertexOffset)) return false;
+
+        uint32_t firstIndex;
+        if (!m_Indices.allocate(indexCount, firstIndex))
+        {
+            m_Vertices.free(vertexOffset, vertexCount);
+            return false;
+        }
+
+        range.firstIndex = firstIndex;
+        range.indexCount = indexCount;
+        range.vertexOffset = static_cast<int32_t>(vertexOffset);
+        range.vertexCount = vertexCount;
+        return true;
+    }
+
+    VhlGeometryPool::MeshId VhlGeometryPool::reserve(uint32_t vertexCount, uint32_t indexCount)
+    {
+        assert(vertexCount > 0 && indexCount > 0 && "Meshes in the geometry pool are always indexed");
+
+        MeshRange range{};
+        if (!tryAllocate(vertexCount, indexCount, range))
+        {
+            bool fitsAfterCompaction =
+                m_Vertices.getCapacity() - m_Vertices.getUsed() >= vertexCount &&
+                m_Indices.getCapacity() - m_Indices.getUsed() >= indexCount;
+            if (fitsAfterCompaction)
+            {
+                compact();
+            }
+            else
+            {
+                uint32_t vertexCapacity = m_Vertices.getCapacity();
+                while (vertexCapacity - m_Vertices.getUsed() < vertexCount) vertexCapacity *= 2;
+                uint32_t indexCapacity = m_Indices.getCapacity();
+                while (indexCapacity - m_Indices.getUsed() < indexCount) indexCapacity *= 2;
+
+                // the old buffers live until their meshes are copied, so growing needs both at once
+                VkDeviceSize currentBytes = bufferBytes(m_Vertices.getCapacity(), m_Indices.getCapacity());
+                VkDeviceSize neededBytes = currentBytes + bufferBytes(vertexCapacity, indexCapacity);
+                VkDeviceSize allowedBytes =
+                    m_VhlDevice.fitToMemoryBudget(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, currentBytes, neededBytes);
+                if (allowedBytes < neededBytes)
+                {
+                    // when doubling would run the heap short, grow by a quarter, or as much of it
+                    // as the budget leaves. Growing by just the mesh would rebuild on every load.
+                    uint32_t minVertexCapacity = std::max(m_Vertices.getCapacity(), m_Vertices.getUsed() + vertexCount);
+                    uint32_t minIndexCapacity = std::max(m_Indices.getCapacity(), m_Indices.getUsed() + indexCount);
+                    VkDeviceSize spareBytes = allowedBytes > currentBytes ? allowedBytes - currentBytes : 0;
+                    if (bufferBytes(minVertexCapacity, minIndexCapacity) > spareBytes)
+                    {
+                        throw std::runtime_error("failed to grow geometry pool: device local memory budget exhausted!");
+                    }
+
+                    vertexCapacity = std::max(minVertexCapacity, m_Vertices.getCapacity() + m_Vertices.getCapacity() / 4);
+                    indexCapacity = std::max(minIndexCapacity, m_Indices.getCapacity() + m_Indices.getCapacity() / 4);
+                    while (bufferBytes(vertexCapacity, indexCapacity) > spareBytes)
+                    {
+                        vertexCapacity = minVertexCapacity + (vertexCapacity - minVertexCapacity) / 2;
+                        indexCapacity = minIndexCapacity + (indexCapacity - minIndexCapacity) / 2;
+                    }
+                }
+                rebuild(vertexCapacity, indexCapacity);
+            }
+
+            if (!tryAllocate(vertexCount, indexCount, range))
+            {
+                throw std::runtime_error("failed to allocate mesh in geometry pool!");
+            }
+        }
+
+        MeshId mesh;
+        if (!m_FreeMeshIds.empty())
+        {
+            mesh = m_FreeMeshIds.back();
+            m_FreeMeshIds.pop_back();
+        }
+        else
+        {
+            mesh = static_cast<MeshId>(m_Meshes.size());
+            m_Meshes.emplace_back();
+        }
+        m_Meshes[mesh].range = range;
+        m_Meshes[mesh].live = true;
+        return mesh;
+    }
+
+    void VhlGeometryPool::recordUpload(
+        VkCommandBuffer commandBuffer,
+        MeshId mesh,
+        VkBuffer srcBuffer,
+        VkDeviceSize vertexSrcOffset,
+        VkDeviceSize indexSrcOffset) const
+    {
+        const auto& range = getRange(mesh);
+
+        VkBufferCopy vertexCopy{
+            vertexSrcOffset,
+            static_cast<VkDeviceSize>(range.vertexOffset) * m_VertexStride,
+            static_cast<VkDeviceSize>(range.vertexCount) * m_VertexStride};
+        vkCmdCopyBuffer(commandBuffer, srcBuffer, m_VertexBuffer->getBuffer(), 1, &vertexCopy);
+
+        VkBufferCopy indexCopy{
+            indexSrcOffset,
+            static_cast<VkDeviceSize>(range.firstIndex) * sizeof(uint32_t),
+            static_cast<VkDeviceSize>(range.indexCount) * sizeof(uint32_t)};
+        vkCmdCopyBuffer(commandBuffer, srcBuffer, m_IndexBuffer->getBuffer(), 1, &indexCopy);
+    }
+
+    void VhlGeometryPool::recordReuseBarrier(VkCommandBuffer commandBuffer)
+    {
+        // write after read, an execution dependency is enough
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            0, nullptr);
+    }
+
+    void VhlGeometryPool::recordUploadBarrier(VkCommandBuffer commandBuffer)
+    {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            0,
+            1, &barrier,
+            0, nullptr,
+            0, nullptr);
+    }
+
+    VhlGeometryPool::MeshId VhlGeometryPool::allocate(
+        const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+    {
+        MeshId mesh = reserve(vertexCount, indexCount);
+
+        // one staging buffer for both, vertices first
+        VkDeviceSize vertexBytes = static_cast<VkDeviceSize>(vertexCount) * m_VertexStride;
+        VkDeviceSize indexBytes = static_cast<VkDeviceSize>(indexCount) * sizeof(uint32_t);
+        VhlBuffer stagingBuffer{
+            m_VhlDevice,
+            vertexBytes + indexBytes,
+            1,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        };
+        stagingBuffer.map();
+        stagingBuffer.writeToBuffer(const_cast<void*>(vertices), vertexBytes, 0);
+        stagingBuffer.writeToBuffer(const_cast<uint32_t*>(indices), indexBytes, vertexBytes);
+
+        VkCommandBuffer commandBuffer = m_VhlDevice.beginSingleTimeCommands();
+        recordReuseBarrier(commandBuffer);
+        recordUpload(commandBuffer, mesh, stagingBuffer.getBuffer(), 0, vertexBytes);
+        recordUploadBarrier(commandBuffer);
+        m_VhlDevice.endSingleTimeCommands(commandBuffer);
+
+        return mesh;
+    }
+
+    void VhlGeometryPool::free(MeshId mesh)
+    {
+        assert(mesh < m_Meshes.size() && m_Meshes[mesh].live && "Freeing a mesh that is not in the pool");
+        assert(
+            std::none_of(m_Retired.begin(), m_Retired.end(), [mesh](const RetiredMesh& r) { return r.mesh == mesh; }) &&
+            "Freeing a mesh twice");
+        m_Retired.push_back({mesh, m_FrameNumber});
+    }
+
+    void VhlGeometryPool::update()
+    {
+        m_FrameNumber++;
+        releaseRetired(false);
+    }
+
+    void VhlGeometryPool::releaseMesh(MeshId mesh)
+    {
+        auto& range = m_Meshes[mesh].range;
+        m_Vertices.free(static_cast<uint32_t>(range.vertexOffset), range.vertexCount);
+        m_Indices.free(range.firstIndex, range.indexCount);
+        m_Meshes[mesh] = Mesh{};
+        m_FreeMeshIds.push_back(mesh);
+    }
+
+    void VhlGeometryPool::releaseRetired(bool all)
+    {
+        // frames recorded before the free may still be in flight, each holds on for at most
+        // MAX_FRAMES_IN_FLIGHT updates
+        auto released = std::partition(m_Retired.begin(), m_Retired.end(), [this, all](const RetiredMesh& retired) {
+            return !all && m_FrameNumber - retired.frame <= VhlSwapChain::MAX_FRAMES_IN_FLIGHT;
+        });
+        for (auto it = released; it != m_Retired.end(); ++it)
+        {
+            releaseMesh(it->mesh);
+        }
+        m_Retired.erase(released, m_Retired.end());
+    }
+
+    void VhlGeometryPool::compact()
+    {
+        rebuild(m_Vertices.getCapacity(), m_Indices.getCapacity());
+    }
+
+    // Copies every live mesh, packed in id order, into new buffers of the given capacity. Copying
+    // into fresh buffers rather than within the old ones keeps source and destination regions
+    // from overlapping.
+    void VhlGeometryPool::rebuild(uint32_t vertexCapacity, uint32_t indexCapacity)
+    {
+        // the copy below waits for the graphics queue to go idle before the old buffers are
+        // destroyed, so no frame in flight still draws a retired mesh by then and those need
+        // not move along. That wait is what makes dropping them safe.
+        releaseRetired(true);
+
+        auto vertexBuffer = createVertexBuffer(vertexCapacity);
+        auto indexBuffer = createIndexBuffer(indexCapacity);
+
+        std::vector<VkBufferCopy> vertexCopies;
+        std::vector<VkBufferCopy> indexCopies;
+        uint32_t vertexHead = 0;
+        uint32_t indexHead = 0;
+        for (auto& mesh : m_Meshes)
+        {
+            if (!mesh.live) continue;
+            auto& range = mesh.range;
+
+            vertexCopies.push_back({
+                static_cast<VkDeviceSize>(range.vertexOffset) * m_VertexStride,
+                static_cast<VkDeviceSize>(vertexHead) * m_VertexStride,
+                static_cast<VkDeviceSize>(range.vertexCount) * m_VertexStride});
+            indexCopies.push_back({
+                static_cast<VkDeviceSize>(range.firstIndex) * sizeof(uint32_t),
+                static_cast<VkDeviceSize>(indexHead) * sizeof(uint32_t),
+                static_cast<VkDeviceSize>(range.indexCount) * sizeof(uint32_t)});
+
+            range.vertexOffset = static_cast<int32_t>(vertexHead);
+            range.firstIndex = indexHead;
+            vertexHead += range.vertexCount;
+            indexHead += range.indexCount;
+        }
+
+        // submitted behind every frame already on the graphics queue and waited on, so the old
+        // buffers are idle once this returns. The barrier orders the copies after uploads that
+        // were submitted earlier but may not have finished yet.
+        VkCommandBuffer commandBuffer = m_VhlDevice.beginSingleTimeCommands();
+        if (!vertexCopies.empty())
+        {
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0,
+                1, &barrier,
+                0, nullptr,
+                0, nullptr);
+
+            vkCmdCopyBuffer(
+                commandBuffer, m_VertexBuffer->getBuffer(), vertexBuffer->getBuffer(),
+                static_cast<uint32_t>(vertexCopies.size()), vertexCopies.data());
+            vkCmdCopyBuffer(
+                commandBuffer, m_IndexBuffer->getBuffer(), indexBuffer->getBuffer(),
+                static_cast<uint32_t>(indexCopies.size()), indexCopies.data());
+            recordUploadBarrier(commandBuffer);
+        }
+        m_VhlDevice.endSingleTimeCommands(commandBuffer);
+
+        m_VertexBuffer = std::move(vertexBuffer);
+        m_IndexBuffer = std::move(indexBuffer);
+        m_Vertices.reset(vertexCapacity, vertexHead);
+        m_Indices.reset(indexCapacity, indexHead);
+    }
+
+    const VhlGeometryPool::MeshRange& VhlGeometryPool::getRange(MeshId mesh) const
+    {
+        assert(mesh < m_Meshes.size() && m_Meshes[mesh].live && "Mesh is not in the pool");
+        return m_Meshes[mesh].range;
+    }
+
+    void VhlGeometryPool::bind(VkCommandBuffer commandBuffer) const
+    {
+        VkBuffer buffers[] = { m_VertexBuffer->getBuffer() };
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    }
+
+    VhlGeometryPool::Stats VhlGeometryPool::getStats() const
+    {
+        Stats stats{};
+        stats.meshes = static_cast<uint32_t>(m_Meshes.size() - m_FreeMeshIds.size());
+        stats.verticesUsed = m_Vertices.getUsed();
+        stats.vertexCapacity = m_Vertices.getCapacity();
+        stats.indicesUsed = m_Indices.getUsed();
+        stats.indexCapacity = m_Indices.getCapacity();
+        stats.freeRanges = m_Vertices.getFreeRangeCount() + m_Indices.getFreeRangeCount();
+        return stats;
+    }
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "vhl_buffer.hpp"
+#include "vhl_device.hpp"
+
+// std
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace vhl
+{
+    // Sub-allocates the vertex and index data of many meshes from one device-local vertex buffer
+    // and one index buffer, so a whole scene is drawn with a single bind. Meshes are addressed
+    // by id because compaction and growth move their data; indices stay relative to the mesh's
+    // vertexOffset, so moving a mesh never rewrites its indices.
+    //
+    // allocate(), reserve() and compact() record transfers on the graphics queue and wait for it,
+    // so they must not be called while a frame is being recorded. Freed meshes keep their ranges
+    // until no frame in flight can still draw them.
+    class VhlGeometryPool
+    {
+    public:
+        using MeshId = uint32_t;
+
+        // Arguments of vkCmdDrawIndexed for the mesh
+        struct MeshRange
+        {
+            uint32_t firstIndex = 0;
+            uint32_t indexCount = 0;
+            int32_t vertexOffset = 0;
+            uint32_t vertexCount = 0;
+        };
+
+        struct Stats
+        {
+            uint32_t meshes = 0;
+            uint32_t verticesUsed = 0;
+            uint32_t vertexCapacity = 0;
+            uint32_t indicesUsed = 0;
+            uint32_t indexCapacity = 0;
+            uint32_t freeRanges = 0;  // holes in both buffers, a measure of fragmentation
+        };
+
+        VhlGeometryPool(VhlDevice& device, uint32_t vertexStride, uint32_t vertexCapacity, uint32_t indexCapacity);
+        ~VhlGeometryPool();
+
+        VhlGeometryPool(const VhlGeometryPool&) = delete;
+        VhlGeometryPool& operator=(const VhlGeometryPool&) = delete;
+
+        // Compacts and, if that is not enough, grows the buffers when the mesh does not fit. Growth
+        // doubles the buffers unless that would take the device-local heap past its budget, then
+        // steps by at most a quarter and throws once not even the mesh fits in the budget.
+        MeshId allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+        // The mesh's ranges are reused MAX_FRAMES_IN_FLIGHT update() calls later
+        void free(MeshId mesh);
+
+        // Call once per frame, before any mesh is reserved for it
+        void update();
+
+        // Asynchronous uploads: reserve every mesh of a batch first, since a reservation may move
+        // the meshes before it, then record the copies from a staging buffer holding the vertices
+        // at vertexSrcOffset and the indices at indexSrcOffset, followed by one upload barrier.
+        // Grows like allocate(), throwing before anything has moved.
+        MeshId reserve(uint32_t vertexCount, uint32_t indexCount);
+        void recordUpload(
+            VkCommandBuffer commandBuffer,
+            MeshId mesh,
+            VkBuffer srcBuffer,
+            VkDeviceSize vertexSrcOffset,
+            VkDeviceSize indexSrcOffset) const;
+        // Orders the uploads after earlier frames' draws, which may have read the ranges they
+        // reuse. Record before the copies.
+        static void recordReuseBarrier(VkCommandBuffer commandBuffer);
+        // Makes recorded uploads visible to vertex input
+        static void recordUploadBarrier(VkCommandBuffer commandBuffer);
+
+        // Moves all live meshes to the front of fresh buffers, closing the holes left by free()
+        void compact();
+
+        const MeshRange& getRange(MeshId mesh) const;
+        void bind(VkCommandBuffer commandBuffer) const;
+
+        VhlDevice& getDevice() const { return m_VhlDevice; }
+        uint32_t getVertexStride() const { return m_VertexStride; }
+        Stats getStats() const;
+
+    private:
+        // First-fit allocator over element ranges, merging neighbouring free ranges
+        class RangeAllocator
+        {
+        public:
+            explicit RangeAllocator(uint32_t capacity);
+
+            bool allocate(uint32_t count, uint32_t& offset);
+            void free(uint32_t offset, uint32_t count);
+            void reset(uint32_t capacity, uint32_t used);
+
+            uint32_t getCapacity() const { return m_Capacity; }
+            uint32_t getUsed() const { return m_Used; }
+            uint32_t getFreeRangeCount() const { return static_cast<uint32_t>(m_FreeRanges.size()); }
+
+        private:
+            std::map<uint32_t, uint32_t> m_FreeRanges;  // offset -> count
+            uint32_t m_Capacity;
+            uint32_t m_Used = 0;
+        };
+
+        struct Mesh
+        {
+            MeshRange range{};
+            bool live = false;
+        };
+
+        // A freed mesh whose ranges frames in flight may still read
+        struct RetiredMesh
+        {
+            MeshId mesh;
+            uint64_t frame;
+        };
+
+        VkDeviceSize bufferBytes(uint32_t vertexCapacity, uint32_t indexCapacity) const;
+        std::unique_ptr<VhlBuffer> createVertexBuffer(uint32_t capacity) const;
+        std::unique_ptr<VhlBuffer> createIndexBuffer(uint32_t capacity) const;
+        bool tryAllocate(uint32_t vertexCount, uint32_t indexCount, MeshRange& range);
+        void rebuild(uint32_t vertexCapacity, uint32_t indexCapacity);
+        void releaseMesh(MeshId mesh);
+        void releaseRetired(bool all);
+
+        VhlDevice& m_VhlDevice;
+        uint32_t m_VertexStride;
+
+        std::unique_ptr<VhlBuffer> m_VertexBuffer;
+        std::unique_ptr<VhlBuffer> m_IndexBuffer;
+        RangeAllocator m_Vertices;
+        RangeAllocator m_Indices;
+
+        std::vector<Mesh> m_Meshes;
+        std::vector<MeshId> m_FreeMeshIds;
+        std::vector<RetiredMesh> m_Retired;
+        uint64_t m_FrameNumber = 0;
+    };
+}
@@ -0,0 +1,205 @@
+#include "vhl_gpu_profiler.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace vhl
+{
+    VhlGpuProfiler::VhlGpuProfiler(VhlDevice& device, uint32_t framesInFlight)
+        : m_VhlDevice{device}, m_TimestampPeriod{device.properties.limits.timestampPeriod}
+    {
+        // guarantees timestamps on every graphics and compute queue
+        if (!m_VhlDevice.properties.limits.timestampComputeAndGraphics) return;
+        // the queue family's own count is what holds, 0 means it writes no timestamps at all
+        uint32_t validBits = m_VhlDevice.findPhysicalQueueFamilies().graphicsTimestampValidBits;
+        if (validBits == 0) return;
+        m_TimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+        m_Frames.resize(framesInFlight);
+        for (auto& frame : m_Frames)
+        {
+            VkQueryPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            poolInfo.queryCount = 2 * MAX_SCOPES_PER_FRAME;
+
+            if (vkCreateQueryPool(m_VhlDevice.device(), &poolInfo, nullptr, &frame.pool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create timestamp query pool!");
+            }
+            frame.records.reserve(MAX_SCOPES_PER_FRAME);
+        }
+    }
+
+    VhlGpuProfiler::~VhlGpuProfiler()
+    {
+        for (auto& frame : m_Frames)
+        {
+            vkDestroyQueryPool(m_VhlDevice.device(), frame.pool, nullptr);
+        }
+    }
+
+    void VhlGpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+    {
+        if (!isSupported()) return;
+        assert(m_Recording == nullptr && "Can't begin a GPU profiler frame while one is recording");
+        assert(frameIndex < m_Frames.size() && "Frame index out of range");
+
+        auto& frame = m_Frames[frameIndex];
+        resolve(frame);
+
+        vkCmdResetQueryPool(commandBuffer, frame.pool, 0, 2 * MAX_SCOPES_PER_FRAME);
+        frame.records.clear();
+        frame.queryCount = 0;
+        m_Recording = &frame;
+    }
+
+    void VhlGpuProfiler::endFrame()
+    {
+        if (!isSupported()) return;
+        assert(m_Recording != nullptr && "No GPU profiler frame is recording");
+        assert(m_OpenRecords.empty() && "GPU scopes must be closed before the frame ends");
+        m_Recording = nullptr;
+    }
+
+    void VhlGpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name)
+    {
+        if (!isSupported()) return;
+        assert(m_Recording != nullptr && "GPU scopes need a frame in progress");
+
+        ScopeRecord record{};
+        record.scope = scopeIndex(name);
+        record.depth = static_cast<uint32_t>(m_OpenRecords.size());
+        record.firstQuery = NO_QUERY;
+        if (m_Recording->queryCount + 2 <= 2 * MAX_SCOPES_PER_FRAME)
+        {
+            record.firstQuery = m_Recording->queryCount;
+            m_Recording->queryCount += 2;
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_Recording->pool, record.firstQuery);
+        }
+
+        m_OpenRecords.push_back(static_cast<uint32_t>(m_Recording->records.size()));
+        m_Recording->records.push_back(record);
+    }
+
+    void VhlGpuProfiler::endScope(VkCommandBuffer commandBuffer)
+    {
+        if (!isSupported()) return;
+        assert(!m_OpenRecords.empty() && "endScope without a matching beginScope");
+
+        const auto& record = m_Recording->records[m_OpenRecords.back()];
+        m_OpenRecords.pop_back();
+        if (record.firstQuery != NO_QUERY)
+        {
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_Recording->pool, record.firstQuery + 1);
+        }
+    }
+
+    void VhlGpuProfiler::resolve(FrameQueries& frame)
+    {
+        if (frame.queryCount == 0) return;
+
+        // the frame's fence has signalled, so the results are available without waiting
+        std::vector<uint64_t> timestamps(frame.queryCount);
+        VkResult result = vkGetQueryPoolResults(
+            m_VhlDevice.device(),
+            frame.pool,
+            0,
+            frame.queryCount,
+            timestamps.size() * sizeof(uint64_t),
+            timestamps.data(),
+            sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT);
+        if (result != VK_SUCCESS) return;
+
+        for (const auto& record : frame.records)
+        {
+            if (record.firstQuery == NO_QUERY) continue;
+
+            // bits above timestampValidBits are undefined, and the counter may wrap between the two
+            uint64_t begin = timestamps[record.firstQuery] & m_TimestampMask;
+            uint64_t end = timestamps[record.firstQuery + 1] & m_TimestampMask;
+            uint64_t ticks = (end - begin) & m_TimestampMask;
+            float time = static_cast<float>(ticks * m_TimestampPeriod * 1e-6);
+
+            auto& scope = m_Scopes[record.scope];
+            if (scope.historyCount == AVERAGE_WINDOW)
+            {
+                scope.historySum -= scope.history[scope.historyNext];
+            }
+            else
+            {
+                scope.historyCount++;
+            }
+            scope.history[scope.historyNext] = time;
+            scope.historySum += time;
+            scope.historyNext = (scope.historyNext + 1) % AVERAGE_WINDOW;
+            scope.lastTime = time;
+        }
+        m_LastResolved = frame.records;
+    }
+
+    uint32_t VhlGpuProfiler::scopeIndex(const char* name)
+    {
+        auto literal = m_ScopeLiterals.find(name);
+        if (literal != m_ScopeLiterals.end())
+        {
+            return literal->second;
+        }
+
+        // the same name may be a different literal in another translation unit
+        uint32_t index = static_cast<uint32_t>(m_Scopes.size());
+        auto it = m_ScopeIndices.find(name);
+        if (it != m_ScopeIndices.end())
+        {
+            index = it->second;
+        }
+        else
+        {
+            m_Scopes.emplace_back();
+            m_Scopes.back().name = name;
+            m_ScopeIndices.emplace(name, index);
+        }
+        m_ScopeLiterals.emplace(name, index);
+        return index;
+    }
+
+    const VhlGpuProfiler::ScopeStats* VhlGpuProfiler::findScope(const std::string& name) const
+    {
+        auto it = m_ScopeIndices.find(name);
+        return it != m_ScopeIndices.end() ? &m_Scopes[it->second] : nullptr;
+    }
+
+    float VhlGpuProfiler::getLastTime(const std::string& name) const
+    {
+        const auto* scope = findScope(name);
+        return scope != nullptr ? scope->lastTime : -1.f;
+    }
+
+    float VhlGpuProfiler::getAverageTime(const std::string& name) const
+    {
+        const auto* scope = findScope(name);
+        if (scope == nullptr || scope->historyCount == 0) return -1.f;
+        return scope->historySum / scope->historyCount;
+    }
+
+    std::vector<VhlGpuProfiler::ScopeTiming> VhlGpuProfiler::getTimings() const
+    {
+        std::vector<ScopeTiming> timings;
+        timings.reserve(m_LastResolved.size());
+        for (const auto& record : m_LastResolved)
+        {
+            if (record.firstQuery == NO_QUERY) continue;
+
+            const auto& scope = m_Scopes[record.scope];
+            ScopeTiming timing{};
+            timing.name = scope.name;
+            timing.depth = record.depth;
+            timing.lastTime = scope.lastTime;
+            timing.averageTime = scope.historySum / scope.historyCount;
+            timings.push_back(timing);
+        }
+        return timings;
+    }
+}
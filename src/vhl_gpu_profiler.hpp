@@ -0,0 +1,123 @@
+#pragma once
+
+#include "vhl_device.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vhl
+{
+    // Times named, possibly nested scopes of GPU work with timestamp queries. Every frame in flight
+    // has its own query pool, whose results are read back when that frame index comes around
+    // again and its fence has signalled, so reading never stalls. Times are kept per scope name
+    // as the latest value and an average over the last AVERAGE_WINDOW frames that recorded it.
+    class VhlGpuProfiler
+    {
+    public:
+        static constexpr uint32_t MAX_SCOPES_PER_FRAME = 64;
+        static constexpr uint32_t AVERAGE_WINDOW = 60;
+
+        struct ScopeTiming
+        {
+            std::string name;
+            uint32_t depth = 0;  // nesting level, 0 for outermost scopes
+            float lastTime = 0.f;  // ms
+            float averageTime = 0.f;  // ms
+        };
+
+        VhlGpuProfiler(VhlDevice& device, uint32_t framesInFlight);
+        ~VhlGpuProfiler();
+
+        VhlGpuProfiler(const VhlGpuProfiler&) = delete;
+        VhlGpuProfiler& operator=(const VhlGpuProfiler&) = delete;
+
+        // False when the device can't write timestamps on its graphics queue or its queue family
+        // reports no valid timestamp bits, every call is a no-op then
+        bool isSupported() const { return !m_Frames.empty(); }
+
+        // Call right after recording starts, once the fence of frameIndex's previous use has been
+        // waited on. Collects that frame's results and resets its queries.
+        void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+        void endFrame();
+
+        // Scopes must nest and close before endFrame(). Names are expected to be string literals;
+        // beyond MAX_SCOPES_PER_FRAME in one frame scopes are silently not timed.
+        void beginScope(VkCommandBuffer commandBuffer, const char* name);
+        void endScope(VkCommandBuffer commandBuffer);
+
+        // In ms, negative until a frame containing the scope has been read back
+        float getLastTime(const std::string& name) const;
+        float getAverageTime(const std::string& name) const;
+
+        // Scopes of the most recently read back frame, in recording order
+        std::vector<ScopeTiming> getTimings() const;
+
+    private:
+        static constexpr uint32_t NO_QUERY = ~0u;
+
+        struct ScopeRecord
+        {
+            uint32_t scope;  // index into m_Scopes
+            uint32_t depth;
+            uint32_t firstQuery;  // begin and end timestamp, NO_QUERY if the pool was full
+        };
+
+        struct FrameQueries
+        {
+            VkQueryPool pool = VK_NULL_HANDLE;
+            std::vector<ScopeRecord> records;
+            uint32_t queryCount = 0;
+        };
+
+        struct ScopeStats
+        {
+            std::string name;
+            std::array<float, AVERAGE_WINDOW> history{};
+            uint32_t historyCount = 0;
+            uint32_t historyNext = 0;
+            float historySum = 0.f;
+            float lastTime = -1.f;
+        };
+
+        void resolve(FrameQueries& frame);
+        uint32_t scopeIndex(const char* name);
+        const ScopeStats* findScope(const std::string& name) const;
+
+        VhlDevice& m_VhlDevice;
+        double m_TimestampPeriod;  // ns per tick
+        uint64_t m_TimestampMask = 0;  // the graphics queue's timestampValidBits
+
+        std::vector<FrameQueries> m_Frames;
+        FrameQueries* m_Recording = nullptr;
+        std::vector<uint32_t> m_OpenRecords;  // indices into m_Recording->records
+
+        std::vector<ScopeStats> m_Scopes;
+        std::unordered_map<std::string, uint32_t> m_ScopeIndices;
+        // keyed by address, so scopes of known literals never build a std::string
+        std::unordered_map<const char*, uint32_t> m_ScopeLiterals;
+        std::vector<ScopeRecord> m_LastResolved;
+    };
+
+    // Times the GPU work recorded into commandBuffer during its lifetime
+    class VhlGpuScope
+    {
+    public:
+        VhlGpuScope(VhlGpuProfiler& profiler, VkCommandBuffer commandBuffer, const char* name)
+            : m_Profiler{profiler}, m_CommandBuffer{commandBuffer}
+        {
+            m_Profiler.beginScope(m_CommandBuffer, name);
+        }
+        ~VhlGpuScope() { m_Profiler.endScope(m_CommandBuffer); }
+
+        VhlGpuScope(const VhlGpuScope&) = delete;
+        VhlGpuScope& operator=(const VhlGpuScope&) = delete;
+
+    private:
+        VhlGpuProfiler& m_Profiler;
+        VkCommandBuffer m_CommandBuffer;
+    };
+}
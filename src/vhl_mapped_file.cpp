@@ -0,0 +1,91 @@
+#include "vhl_mapped_file.hpp"
+
+// std
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vhl
+{
+#ifdef _WIN32
+    VhlMappedFile::VhlMappedFile(const std::string& filepath)
+    {
+        HANDLE file = CreateFileA(
+            filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("failed to open file: " + filepath);
+        }
+        m_File = file;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            CloseHandle(file);
+            throw std::runtime_error("failed to map empty file: " + filepath);
+        }
+        m_Size = static_cast<size_t>(fileSize.QuadPart);
+
+        m_Mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_Mapping != nullptr)
+        {
+            m_Data = static_cast<const uint8_t*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (m_Data == nullptr)
+        {
+            if (m_Mapping != nullptr) CloseHandle(m_Mapping);
+            CloseHandle(file);
+            throw std::runtime_error("failed to map file: " + filepath);
+        }
+    }
+
+    VhlMappedFile::~VhlMappedFile()
+    {
+        UnmapViewOfFile(m_Data);
+        CloseHandle(m_Mapping);
+        CloseHandle(m_File);
+    }
+#else
+    VhlMappedFile::VhlMappedFile(const std::string& filepath)
+    {
+        int file = open(filepath.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            throw std::runtime_error("failed to open file: " + filepath);
+        }
+
+        struct stat fileStat;
+        if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+        {
+            close(file);
+            throw std::runtime_error("failed to map empty file: " + filepath);
+        }
+        m_Size = static_cast<size_t>(fileStat.st_size);
+
+        // the mapping keeps its own reference to the file
+        void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (data == MAP_FAILED)
+        {
+            throw std::runtime_error("failed to map file: " + filepath);
+        }
+        madvise(data, m_Size, MADV_SEQUENTIAL);
+        m_Data = static_cast<const uint8_t*>(data);
+    }
+
+    VhlMappedFile::~VhlMappedFile()
+    {
+        munmap(const_cast<uint8_t*>(m_Data), m_Size);
+    }
+#endif
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vhl
+{
+    // Read-only memory mapping of a whole file, unmapped on destruction
+    class VhlMappedFile
+    {
+    public:
+        explicit VhlMappedFile(const std::string& filepath);
+        ~VhlMappedFile();
+
+        VhlMappedFile(const VhlMappedFile&) = delete;
+        VhlMappedFile& operator=(const VhlMappedFile&) = delete;
+
+        const uint8_t* data() const { return m_Data; }
+        size_t size() const { return m_Size; }
+
+    private:
+        const uint8_t* m_Data = nullptr;
+        size_t m_Size = 0;
+#ifdef _WIN32
+        void* m_File = nullptr;
+        void* m_Mapping = nullptr;
+#endif
+    };
+}
@@ -10,6 +10,7 @@
 // std
 #include <cassert>
 #include <cstring>
+#include <numeric>
 #include <unordered_map>
 
 namespace std
@@ -30,99 +31,56 @@ namespace std
 
 namespace vhl {
 
-    VhlModel::VhlModel(VhlDevice& device, const VhlModel::Builder& builder) : m_VhlDevice(device) 
+    VhlModel::VhlModel(VhlGeometryPool& geometryPool, const VhlModel::Builder& builder)
+        : m_GeometryPool(geometryPool), m_Bounds(builder.computeBoundingSphere())
     {
-        createVertexBuffers(builder.vertices);
-        createIndexBuffers(builder.indices);
-    }
+        assert(m_GeometryPool.getVertexStride() == sizeof(Vertex) && "Geometry pool has a different vertex layout");
 
-    VhlModel::~VhlModel() {}
+        uint32_t vertexCount = static_cast<uint32_t>(builder.vertices.size());
+        assert(vertexCount >= 3 && "Vertex count must be at least 3");
 
-    std::unique_ptr<VhlModel> VhlModel::createModelFromFile(VhlDevice& device, const std::string& filepath)
-    {
-        Builder builder{};
-        builder.loadModel(filepath);
-        
-        return std::make_unique<VhlModel>(device, builder);
+        // the pool only holds indexed meshes, unindexed ones get the trivial index list
+        std::vector<uint32_t> sequentialIndices;
+        const std::vector<uint32_t>* indices = &builder.indices;
+        if (indices->empty())
+        {
+            sequentialIndices.resize(vertexCount);
+            std::iota(sequentialIndices.begin(), sequentialIndices.end(), 0u);
+            indices = &sequentialIndices;
+        }
+
+        m_Mesh = m_GeometryPool.allocate(
+            builder.vertices.data(), vertexCount, indices->data(), static_cast<uint32_t>(indices->size()));
     }
 
-    void VhlModel::createVertexBuffers(const std::vector<Vertex>& vertices) 
+    VhlModel::VhlModel(VhlGeometryPool& geometryPool, VhlGeometryPool::MeshId mesh, const BoundingSphere& bounds)
+        : m_GeometryPool(geometryPool), m_Mesh(mesh), m_Bounds(bounds)
     {
-        m_VertexCount = static_cast<uint32_t>(vertices.size());
-        assert(m_VertexCount >= 3 && "Vertex count must be at least 3");
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * m_VertexCount;
-        uint32_t vertexSize = sizeof(vertices[0]);
-
-        VhlBuffer stagingBuffer{
-            m_VhlDevice,
-            vertexSize,
-            m_VertexCount,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        };
-        
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)vertices.data());
-
-        m_VertexBuffer = std::make_unique<VhlBuffer>(
-            m_VhlDevice,
-            vertexSize,
-            m_VertexCount,
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-        );
-
-        m_VhlDevice.copyBuffer(stagingBuffer.getBuffer(), m_VertexBuffer->getBuffer(), bufferSize);
+        assert(m_GeometryPool.getVertexStride() == sizeof(Vertex) && "Geometry pool has a different vertex layout");
     }
 
-    void VhlModel::createIndexBuffers(const std::vector<uint32_t>& indices) 
+    VhlModel::~VhlModel() 
     {
-        m_IndexCount = static_cast<uint32_t>(indices.size());
-        m_HasIndexBuffer = m_IndexCount > 0;
-
-        if (!m_HasIndexBuffer) return;
-
-        VkDeviceSize bufferSize = sizeof(indices[0]) * m_IndexCount;
-        uint32_t indexSize = sizeof(indices[0]);
+        m_GeometryPool.free(m_Mesh);
+    }
 
-        VhlBuffer stagingBuffer{
-            m_VhlDevice,
-            indexSize,
-            m_IndexCount,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        };
+    std::unique_ptr<VhlModel> VhlModel::createModelFromFile(VhlGeometryPool& geometryPool, const std::string& filepath)
+    {
+        Builder builder{};
+        builder.loadModel(filepath);
         
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)indices.data());
-
-        m_IndexBuffer = std::make_unique<VhlBuffer>(
-            m_VhlDevice,
-            indexSize,
-            m_IndexCount,
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-        );
-
-        m_VhlDevice.copyBuffer(stagingBuffer.getBuffer(), m_IndexBuffer->getBuffer(), bufferSize);
+        return std::make_unique<VhlModel>(geometryPool, builder);
     }
 
-    void VhlModel::draw(VkCommandBuffer commandBuffer) 
+    void VhlModel::draw(VkCommandBuffer commandBuffer, uint32_t firstInstance) 
     {
-        if (m_HasIndexBuffer) 
-            vkCmdDrawIndexed(commandBuffer, m_IndexCount, 1, 0, 0, 0);
-        else
-            vkCmdDraw(commandBuffer, m_VertexCount, 1, 0, 0);
+        const auto& range = getMeshRange();
+        vkCmdDrawIndexed(commandBuffer, range.indexCount, 1, range.firstIndex, range.vertexOffset, firstInstance);
     }
 
     void VhlModel::bind(VkCommandBuffer commandBuffer) 
     {
-        VkBuffer buffers[] = { m_VertexBuffer->getBuffer() };
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-
-        if (m_HasIndexBuffer)
-            vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+        m_GeometryPool.bind(commandBuffer);
     }
 
     std::vector<VkVertexInputBindingDescription> VhlModel::Vertex::getBindingDescriptions() 
@@ -147,7 +105,7 @@ namespace vhl {
         return attributeDescriptions;
     }
 
-    void VhlModel::Builder::loadModel(const std::string& filepath)
+    void VhlModel::Builder::loadModel(const std::string& filepath, const ModelImportOptions& options)
     {
         tinyobj::attrib_t attrib;
         std::vector<tinyobj::shape_t> shapes;
@@ -213,6 +171,37 @@ namespace vhl {
                 indices.push_back(uniqueVertices[vertex]);
             }
         }
+
+        for (auto& vertex : vertices)
+        {
+            vertex.position *= options.scale;
+            if (options.flipTexcoordY)
+            {
+                vertex.uv.y = 1.f - vertex.uv.y;
+            }
+        }
     }
 
+
+    VhlModel::BoundingSphere VhlModel::Builder::computeBoundingSphere() const
+    {
+        // centered on the bounding box, looser than a minimal sphere but good enough for culling
+        BoundingSphere bounds{};
+        if (vertices.empty()) return bounds;
+
+        glm::vec3 minPosition = vertices[0].position;
+        glm::vec3 maxPosition = vertices[0].position;
+        for (const auto& vertex : vertices)
+        {
+            minPosition = glm::min(minPosition, vertex.position);
+            maxPosition = glm::max(maxPosition, vertex.position);
+        }
+
+        bounds.center = 0.5f * (minPosition + maxPosition);
+        for (const auto& vertex : vertices)
+        {
+            bounds.radius = glm::max(bounds.radius, glm::length(vertex.position - bounds.center));
+        }
+        return bounds;
+    }
 }  // namespace vhl 
\ No newline at end of file
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "vhl_device.hpp"
-#include "vhl_buffer.hpp"
+#include "vhl_geometry_pool.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -13,8 +13,27 @@
 #include <memory>
 
 namespace vhl {
+    // Applied while loading, so differently imported copies of one file are different assets
+    struct ModelImportOptions
+    {
+        float scale = 1.f;           // uniform scale baked into the positions
+        bool flipTexcoordY = false;  // for files authored with a bottom-left uv origin
+
+        bool operator==(const ModelImportOptions& other) const
+        {
+            return scale == other.scale && flipTexcoordY == other.flipTexcoordY;
+        }
+    };
+
     class VhlModel {
     public:
+        // In model space, encloses every vertex
+        struct BoundingSphere
+        {
+            glm::vec3 center{};
+            float radius = 0.f;
+        };
+
         struct Vertex 
         {
             glm::vec3 position{};
@@ -39,31 +58,33 @@ namespace vhl {
             std::vector<Vertex> vertices{};
             std::vector<uint32_t> indices{};
 
-            void loadModel(const std::string& filepath);
+            void loadModel(const std::string& filepath, const ModelImportOptions& options = {});
+            BoundingSphere computeBoundingSphere() const;
         };
 
-        VhlModel(VhlDevice& device, const VhlModel::Builder& builder);
+        // The pool must use sizeof(Vertex) as its vertex stride
+        VhlModel(VhlGeometryPool& geometryPool, const VhlModel::Builder& builder);
+        // Takes ownership of a mesh already reserved in the pool, e.g. by VhlModelLoader
+        VhlModel(VhlGeometryPool& geometryPool, VhlGeometryPool::MeshId mesh, const BoundingSphere& bounds);
         ~VhlModel();
 
         VhlModel(const VhlModel&) = delete;
         VhlModel& operator=(const VhlModel&) = delete;
 
-        static std::unique_ptr<VhlModel> createModelFromFile(VhlDevice& device, const std::string& filepath);
+        static std::unique_ptr<VhlModel> createModelFromFile(VhlGeometryPool& geometryPool, const std::string& filepath);
 
+        // Binds the shared pool buffers, so any model of the same pool can draw afterwards
         void bind(VkCommandBuffer commandBuffer);
-        void draw(VkCommandBuffer commandBuffer);
+        void draw(VkCommandBuffer commandBuffer, uint32_t firstInstance = 0);
 
-    private:
-        void createVertexBuffers(const std::vector<Vertex>& vertices);
-        void createIndexBuffers(const std::vector<uint32_t>& indices);
+        VhlGeometryPool& getGeometryPool() const { return m_GeometryPool; }
+        VhlGeometryPool::MeshId getMesh() const { return m_Mesh; }
+        const VhlGeometryPool::MeshRange& getMeshRange() const { return m_GeometryPool.getRange(m_Mesh); }
+        const BoundingSphere& getBoundingSphere() const { return m_Bounds; }
 
-        VhlDevice& m_VhlDevice;
-
-        std::unique_ptr<VhlBuffer> m_VertexBuffer;
-        uint32_t m_VertexCount;
-        
-        bool m_HasIndexBuffer = false;
-        std::unique_ptr<VhlBuffer> m_IndexBuffer;
-        uint32_t m_IndexCount;
+    private:
+        VhlGeometryPool& m_GeometryPool;
+        VhlGeometryPool::MeshId m_Mesh;
+        BoundingSphere m_Bounds;
     };
 }  // namespace Vhl
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "vhl_model_loader.hpp"
+
+#include "vhl_profiler.hpp"
+#include "vhl_utils.hpp"
+
+// std
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+namespace vhl
+{
+    VhlModelLoader::VhlModelLoader(VhlGeometryPool& geometryPool, uint32_t workerCount)
+        : m_VhlDevice(geometryPool.getDevice()),
+          m_GeometryPool(geometryPool),
+          m_Queue(
+              geometryPool.getDevice(),
+              "model",
+              "model loader",
+              [this](std::vector<ParsedModel>& parsed, VkCommandBuffer commandBuffer)
+              { return recordUploads(parsed, commandBuffer); },
+              workerCount == 0 ? workerThreadShare(1, 4) : workerCount)
+    {
+    }
+
+    void VhlModelLoader::load(const std::string& filepath, Callback onLoaded, const ModelImportOptions& options)
+    {
+        m_Queue.push(
+            filepath,
+            [this, filepath, options] { return parseModel(filepath, options); },
+            std::move(onLoaded));
+    }
+
+    void VhlModelLoader::update()
+    {
+        VHL_PROFILE_SCOPE("VhlModelLoader::update");
+        m_Queue.update();
+    }
+
+    void VhlModelLoader::waitIdle()
+    {
+        m_Queue.waitIdle();
+    }
+
+    VhlModelLoader::ParsedModel VhlModelLoader::parseModel(const std::string& filepath, const ModelImportOptions& options)
+    {
+        VHL_PROFILE_SCOPE("parse model");
+        VhlModel::Builder builder{};
+        builder.loadModel(filepath, options);
+
+        uint32_t vertexCount = static_cast<uint32_t>(builder.vertices.size());
+        if (vertexCount < 3)
+        {
+            throw std::runtime_error("model has fewer than 3 vertices");
+        }
+        // the pool only holds indexed meshes
+        if (builder.indices.empty())
+        {
+            builder.indices.resize(vertexCount);
+            std::iota(builder.indices.begin(), builder.indices.end(), 0u);
+        }
+
+        ParsedModel parsed{};
+        parsed.vertexCount = vertexCount;
+        parsed.indexCount = static_cast<uint32_t>(builder.indices.size());
+        parsed.bounds = builder.computeBoundingSphere();
+
+        // written here rather than on the main thread, update() only records the copies
+        VkDeviceSize vertexBytes = sizeof(VhlModel::Vertex) * static_cast<VkDeviceSize>(parsed.vertexCount);
+        VkDeviceSize indexBytes = sizeof(uint32_t) * static_cast<VkDeviceSize>(parsed.indexCount);
+        parsed.stagingBuffer = std::make_unique<VhlBuffer>(
+            m_VhlDevice,
+            vertexBytes + indexBytes,
+            1,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        if (parsed.stagingBuffer->map() != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to map staging buffer");
+        }
+        parsed.stagingBuffer->writeToBuffer(builder.vertices.data(), vertexBytes, 0);
+        parsed.stagingBuffer->writeToBuffer(builder.indices.data(), indexBytes, vertexBytes);
+        parsed.stagingBuffer->unmap();
+        return parsed;
+    }
+
+    std::vector<std::shared_ptr<VhlModel>> VhlModelLoader::recordUploads(
+        std::vector<ParsedModel>& parsed, VkCommandBuffer commandBuffer)
+    {
+        // reserving may compact or grow the pool, which moves earlier meshes, so the copies are
+        // only recorded once every mesh of the batch has its final place
+        std::vector<std::shared_ptr<VhlModel>> models;
+        models.reserve(parsed.size());
+        for (auto& model : parsed)
+        {
+            try
+            {
+                auto mesh = m_GeometryPool.reserve(model.vertexCount, model.indexCount);
+                models.push_back(std::make_shared<VhlModel>(m_GeometryPool, mesh, model.bounds));
+            }
+            catch (const std::exception& e)
+            {
+                // the pool is left as it was, the model's callback gets nullptr
+                std::cerr << "model does not fit in the geometry pool: " << e.what() << std::endl;
+                models.push_back(nullptr);
+            }
+        }
+
+        VhlGeometryPool::recordReuseBarrier(commandBuffer);
+        for (size_t i = 0; i < parsed.size(); i++)
+        {
+            if (models[i] == nullptr) continue;
+            VkDeviceSize vertexBytes = sizeof(VhlModel::Vertex) * static_cast<VkDeviceSize>(parsed[i].vertexCount);
+            m_GeometryPool.recordUpload(
+                commandBuffer,
+                models[i]->getMesh(),
+                parsed[i].stagingBuffer->getBuffer(),
+                0,
+                vertexBytes);
+        }
+        VhlGeometryPool::recordUploadBarrier(commandBuffer);
+        return models;
+    }
+}
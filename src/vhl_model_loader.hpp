@@ -0,0 +1,70 @@
+#pragma once
+
+#include "vhl_buffer.hpp"
+#include "vhl_device.hpp"
+#include "vhl_geometry_pool.hpp"
+#include "vhl_model.hpp"
+#include "vhl_upload_queue.hpp"
+
+// std
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vhl
+{
+    // Loads models without blocking the frame loop. Workers parse the files and write the geometry
+    // into staging buffers; update() then reserves the meshes in the geometry pool, submits the
+    // copies on the graphics queue with a fence and, once that fence has signalled, hands each
+    // model to its callback. Objects simply have no model, and draw nothing, until then.
+    class VhlModelLoader
+    {
+    public:
+        using Callback = std::function<void(std::shared_ptr<VhlModel>)>;
+
+        // workerCount == 0 picks this pool's share of the hardware threads, see workerThreadShare
+        VhlModelLoader(VhlGeometryPool& geometryPool, uint32_t workerCount = 0);
+
+        VhlModelLoader(const VhlModelLoader&) = delete;
+        VhlModelLoader& operator=(const VhlModelLoader&) = delete;
+
+        // The callback runs on the thread calling update(). Files that fail to load are reported
+        // and their callback gets nullptr.
+        void load(const std::string& filepath, Callback onLoaded, const ModelImportOptions& options = {});
+
+        // Call once per frame, outside of command buffer recording. Submits the uploads of parsed
+        // models and publishes the ones whose upload has finished.
+        void update();
+
+        // Blocks until every requested model has been published
+        void waitIdle();
+
+        // Models requested but not yet published
+        uint32_t getPendingCount() const { return m_Queue.getPendingCount(); }
+
+        // Staging bytes the last update() submitted for upload
+        VkDeviceSize getUploadedBytes() const { return m_Queue.getUploadedBytes(); }
+
+        VhlGeometryPool& getGeometryPool() const { return m_GeometryPool; }
+
+    private:
+        // vertices followed by indices in the staging buffer
+        struct ParsedModel
+        {
+            std::unique_ptr<VhlBuffer> stagingBuffer;
+            uint32_t vertexCount = 0;
+            uint32_t indexCount = 0;
+            VhlModel::BoundingSphere bounds{};
+        };
+
+        ParsedModel parseModel(const std::string& filepath, const ModelImportOptions& options);
+        std::vector<std::shared_ptr<VhlModel>> recordUploads(std::vector<ParsedModel>& parsed, VkCommandBuffer commandBuffer);
+
+        VhlDevice& m_VhlDevice;
+        VhlGeometryPool& m_GeometryPool;
+
+        // last, its workers have to be joined before the rest goes away
+        VhlUploadQueue<ParsedModel, VhlModel> m_Queue;
+    };
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// Every translation unit must see nuklear with the same options, so include it through here.
+// The implementation is compiled in systems/hud_system.cpp.
+#define NK_INCLUDE_FIXED_TYPES
+#define NK_INCLUDE_DEFAULT_ALLOCATOR
+#define NK_INCLUDE_VERTEX_BUFFER_OUTPUT
+#define NK_INCLUDE_FONT_BAKING
+#define NK_INCLUDE_DEFAULT_FONT
+
+// libs
+#include <nuklear.h>
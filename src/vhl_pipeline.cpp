@@ -1,8 +1,10 @@
 #include "vhl_pipeline.hpp"
 
 #include "vhl_model.hpp"
+#include "vhl_utils.hpp"
 
 // std
+#include <algorithm>
 #include <fstream>
 #include <stdexcept>
 #include <iostream>
@@ -10,6 +12,136 @@
 
 namespace vhl 
 {
+    namespace
+    {
+        bool sameStencilOp(const VkStencilOpState& a, const VkStencilOpState& b)
+        {
+            return a.failOp == b.failOp && a.passOp == b.passOp && a.depthFailOp == b.depthFailOp &&
+                a.compareOp == b.compareOp && a.compareMask == b.compareMask &&
+                a.writeMask == b.writeMask && a.reference == b.reference;
+        }
+
+        void hashStencilOp(std::size_t& seed, const VkStencilOpState& op)
+        {
+            hashCombine(seed, op.failOp, op.passOp, op.depthFailOp, op.compareOp, op.compareMask, op.writeMask, op.reference);
+        }
+    }
+
+    std::size_t PipelineConfigInfo::hash() const
+    {
+        std::size_t seed = 0;
+
+        for (const auto& binding : bindingDescriptions)
+        {
+            hashCombine(seed, binding.binding, binding.stride, binding.inputRate);
+        }
+        for (const auto& attribute : attributeDescriptions)
+        {
+            hashCombine(seed, attribute.location, attribute.binding, attribute.format, attribute.offset);
+        }
+
+        hashCombine(seed, viewportInfo.viewportCount, viewportInfo.scissorCount);
+        hashCombine(seed, inputAssemblyInfo.topology, inputAssemblyInfo.primitiveRestartEnable);
+
+        const auto& raster = rasterizationInfo;
+        hashCombine(seed, raster.depthClampEnable, raster.rasterizerDiscardEnable, raster.polygonMode,
+            raster.cullMode, raster.frontFace, raster.depthBiasEnable, raster.depthBiasConstantFactor,
+            raster.depthBiasClamp, raster.depthBiasSlopeFactor, raster.lineWidth);
+
+        hashCombine(seed, multisampleInfo.rasterizationSamples, multisampleInfo.sampleShadingEnable,
+            multisampleInfo.minSampleShading, multisampleInfo.alphaToCoverageEnable, multisampleInfo.alphaToOneEnable);
+
+        const auto& blend = colorBlendAttachment;
+        hashCombine(seed, blend.blendEnable, blend.srcColorBlendFactor, blend.dstColorBlendFactor, blend.colorBlendOp,
+            blend.srcAlphaBlendFactor, blend.dstAlphaBlendFactor, blend.alphaBlendOp, blend.colorWriteMask);
+
+        const auto& depth = depthStencilInfo;
+        hashCombine(seed, depth.depthTestEnable, depth.depthWriteEnable, depth.depthCompareOp,
+            depth.depthBoundsTestEnable, depth.stencilTestEnable, depth.minDepthBounds, depth.maxDepthBounds);
+        hashStencilOp(seed, depth.front);
+        hashStencilOp(seed, depth.back);
+
+        for (auto dynamicState : dynamicStateEnables)
+        {
+            hashCombine(seed, dynamicState);
+        }
+
+        for (const auto& entry : specializationEntries)
+        {
+            hashCombine(seed, entry.constantID, entry.offset, entry.size);
+        }
+        for (auto byte : specializationData)
+        {
+            hashCombine(seed, byte);
+        }
+
+        hashCombine(seed, pipelineLayout, renderPass, subpass);
+        return seed;
+    }
+
+    bool PipelineConfigInfo::operator==(const PipelineConfigInfo& other) const
+    {
+        if (bindingDescriptions.size() != other.bindingDescriptions.size() ||
+            attributeDescriptions.size() != other.attributeDescriptions.size() ||
+            specializationEntries.size() != other.specializationEntries.size() ||
+            dynamicStateEnables != other.dynamicStateEnables ||
+            specializationData != other.specializationData)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < bindingDescriptions.size(); i++)
+        {
+            const auto& a = bindingDescriptions[i];
+            const auto& b = other.bindingDescriptions[i];
+            if (a.binding != b.binding || a.stride != b.stride || a.inputRate != b.inputRate) return false;
+        }
+        for (size_t i = 0; i < attributeDescriptions.size(); i++)
+        {
+            const auto& a = attributeDescriptions[i];
+            const auto& b = other.attributeDescriptions[i];
+            if (a.location != b.location || a.binding != b.binding || a.format != b.format || a.offset != b.offset) return false;
+        }
+        for (size_t i = 0; i < specializationEntries.size(); i++)
+        {
+            const auto& a = specializationEntries[i];
+            const auto& b = other.specializationEntries[i];
+            if (a.constantID != b.constantID || a.offset != b.offset || a.size != b.size) return false;
+        }
+
+        const auto& ra = rasterizationInfo;
+        const auto& rb = other.rasterizationInfo;
+        const auto& ma = multisampleInfo;
+        const auto& mb = other.multisampleInfo;
+        const auto& ba = colorBlendAttachment;
+        const auto& bb = other.colorBlendAttachment;
+        const auto& da = depthStencilInfo;
+        const auto& db = other.depthStencilInfo;
+
+        return viewportInfo.viewportCount == other.viewportInfo.viewportCount &&
+            viewportInfo.scissorCount == other.viewportInfo.scissorCount &&
+            inputAssemblyInfo.topology == other.inputAssemblyInfo.topology &&
+            inputAssemblyInfo.primitiveRestartEnable == other.inputAssemblyInfo.primitiveRestartEnable &&
+            ra.depthClampEnable == rb.depthClampEnable && ra.rasterizerDiscardEnable == rb.rasterizerDiscardEnable &&
+            ra.polygonMode == rb.polygonMode && ra.cullMode == rb.cullMode && ra.frontFace == rb.frontFace &&
+            ra.depthBiasEnable == rb.depthBiasEnable && ra.depthBiasConstantFactor == rb.depthBiasConstantFactor &&
+            ra.depthBiasClamp == rb.depthBiasClamp && ra.depthBiasSlopeFactor == rb.depthBiasSlopeFactor &&
+            ra.lineWidth == rb.lineWidth &&
+            ma.rasterizationSamples == mb.rasterizationSamples && ma.sampleShadingEnable == mb.sampleShadingEnable &&
+            ma.minSampleShading == mb.minSampleShading && ma.alphaToCoverageEnable == mb.alphaToCoverageEnable &&
+            ma.alphaToOneEnable == mb.alphaToOneEnable &&
+            ba.blendEnable == bb.blendEnable && ba.srcColorBlendFactor == bb.srcColorBlendFactor &&
+            ba.dstColorBlendFactor == bb.dstColorBlendFactor && ba.colorBlendOp == bb.colorBlendOp &&
+            ba.srcAlphaBlendFactor == bb.srcAlphaBlendFactor && ba.dstAlphaBlendFactor == bb.dstAlphaBlendFactor &&
+            ba.alphaBlendOp == bb.alphaBlendOp && ba.colorWriteMask == bb.colorWriteMask &&
+            da.depthTestEnable == db.depthTestEnable && da.depthWriteEnable == db.depthWriteEnable &&
+            da.depthCompareOp == db.depthCompareOp && da.depthBoundsTestEnable == db.depthBoundsTestEnable &&
+            da.stencilTestEnable == db.stencilTestEnable && da.minDepthBounds == db.minDepthBounds &&
+            da.maxDepthBounds == db.maxDepthBounds &&
+            sameStencilOp(da.front, db.front) && sameStencilOp(da.back, db.back) &&
+            pipelineLayout == other.pipelineLayout && renderPass == other.renderPass && subpass == other.subpass;
+    }
+
     VhlPipeline::VhlPipeline(
         VhlDevice& device, 
         const std::string& vertFilepath, 
@@ -66,6 +198,14 @@ namespace vhl
         createShaderModule(vertShaderCode, &m_VertShaderModule);
         createShaderModule(fragShaderCode, &m_FragShaderModule);
 
+        VkSpecializationInfo specializationInfo{};
+        specializationInfo.mapEntryCount = static_cast<uint32_t>(configInfo.specializationEntries.size());
+        specializationInfo.pMapEntries = configInfo.specializationEntries.data();
+        specializationInfo.dataSize = configInfo.specializationData.size();
+        specializationInfo.pData = configInfo.specializationData.data();
+        const VkSpecializationInfo* pSpecializationInfo =
+            configInfo.specializationEntries.empty() ? nullptr : &specializationInfo;
+
         VkPipelineShaderStageCreateInfo shaderStages[2];
         shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -73,14 +213,14 @@ namespace vhl
         shaderStages[0].pName = "main";
         shaderStages[0].flags = 0;
         shaderStages[0].pNext = nullptr;
-        shaderStages[0].pSpecializationInfo = nullptr;
+        shaderStages[0].pSpecializationInfo = pSpecializationInfo;
         shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
         shaderStages[1].module = m_FragShaderModule;
         shaderStages[1].pName = "main";
         shaderStages[1].flags = 0;
         shaderStages[1].pNext = nullptr;
-        shaderStages[1].pSpecializationInfo = nullptr;
+        shaderStages[1].pSpecializationInfo = pSpecializationInfo;
 
         auto& bindingDescriptions = configInfo.bindingDescriptions;
         auto& attributeDescriptions = configInfo.attributeDescriptions;
@@ -216,6 +356,38 @@ namespace vhl
         configInfo.attributeDescriptions = VhlModel::Vertex::getAttributeDescriptions();
     }
 
+    ShaderReflection VhlPipeline::reflect(const std::string& vertFilepath, const std::string& fragFilepath)
+    {
+        auto reflection = ShaderReflection::reflect(readFile(vertFilepath), VK_SHADER_STAGE_VERTEX_BIT);
+        reflection.merge(ShaderReflection::reflect(readFile(fragFilepath), VK_SHADER_STAGE_FRAGMENT_BIT));
+        return reflection;
+    }
+
+    void VhlPipeline::applyVertexInputs(const ShaderReflection& reflection, PipelineConfigInfo& configInfo)
+    {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+        for (const auto& input : reflection.vertexInputs)
+        {
+            auto it = std::find_if(
+                configInfo.attributeDescriptions.begin(),
+                configInfo.attributeDescriptions.end(),
+                [&](const auto& attribute) { return attribute.location == input.location; });
+            if (it == configInfo.attributeDescriptions.end() || it->format != input.format)
+            {
+                throw std::runtime_error(
+                    "vertex shader input at location " + std::to_string(input.location) +
+                    " does not match the vertex layout!");
+            }
+            attributeDescriptions.push_back(*it);
+        }
+
+        configInfo.attributeDescriptions = std::move(attributeDescriptions);
+        if (configInfo.attributeDescriptions.empty())
+        {
+            configInfo.bindingDescriptions.clear();
+        }
+    }
+
     void VhlPipeline::enableAlphaBlending(PipelineConfigInfo& configInfo)
     {
         configInfo.colorBlendAttachment.blendEnable = VK_TRUE;
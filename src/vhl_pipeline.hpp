@@ -1,8 +1,11 @@
 #pragma once
 
 #include "vhl_device.hpp"
+#include "vhl_shader_reflection.hpp"
 
+#include <cstdint>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace vhl 
@@ -26,6 +29,17 @@ namespace vhl
         VkPipelineLayout pipelineLayout = nullptr;
         VkRenderPass renderPass = nullptr;
         uint32_t subpass = 0;
+
+        // Specialization constants shared by the vertex and fragment stages. Constant ids a stage
+        // does not declare are ignored by that stage.
+        std::vector<VkSpecializationMapEntry> specializationEntries{};
+        std::vector<uint8_t> specializationData{};
+
+        // Hash and equality cover every piece of state that ends up in the VkPipeline.
+        // Render pass compatibility is approximated by the render pass handle itself.
+        std::size_t hash() const;
+        bool operator==(const PipelineConfigInfo& other) const;
+        bool operator!=(const PipelineConfigInfo& other) const { return !(*this == other); }
     };
     
     class VhlPipeline
@@ -46,6 +60,27 @@ namespace vhl
         static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
         static void enableAlphaBlending(PipelineConfigInfo& configInfo);
 
+        // Reads both SPIR-V modules and merges what they declare into one interface description
+        static ShaderReflection reflect(const std::string& vertFilepath, const std::string& fragFilepath);
+        // Keeps only the vertex attributes the vertex shader consumes, checking their formats
+        static void applyVertexInputs(const ShaderReflection& reflection, PipelineConfigInfo& configInfo);
+
+        // Booleans must be passed as VkBool32, GLSL spec constant bools are 32 bits wide
+        template <typename T>
+        static void addSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantId, const T& value)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Specialization constants must be plain data");
+
+            VkSpecializationMapEntry entry{};
+            entry.constantID = constantId;
+            entry.offset = static_cast<uint32_t>(configInfo.specializationData.size());
+            entry.size = sizeof(T);
+            configInfo.specializationEntries.push_back(entry);
+
+            const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+            configInfo.specializationData.insert(configInfo.specializationData.end(), bytes, bytes + sizeof(T));
+        }
+
     private:
         static std::vector<char> readFile(const std::string& filepath);
 
@@ -0,0 +1,96 @@
+#include "vhl_pipeline_layout_cache.hpp"
+
+#include "vhl_utils.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace vhl
+{
+    VhlPipelineLayoutCache::~VhlPipelineLayoutCache()
+    {
+        for (auto& kv : m_PipelineLayouts)
+        {
+            vkDestroyPipelineLayout(m_VhlDevice.device(), kv.second, nullptr);
+        }
+    }
+
+    bool VhlPipelineLayoutCache::PipelineLayoutKey::operator==(const PipelineLayoutKey& other) const
+    {
+        return setLayouts == other.setLayouts &&
+            pushConstantRange.stageFlags == other.pushConstantRange.stageFlags &&
+            pushConstantRange.offset == other.pushConstantRange.offset &&
+            pushConstantRange.size == other.pushConstantRange.size;
+    }
+
+    std::size_t VhlPipelineLayoutCache::KeyHash::operator()(const PipelineLayoutKey& key) const
+    {
+        std::size_t seed = 0;
+        for (auto setLayout : key.setLayouts)
+        {
+            hashCombine(seed, setLayout);
+        }
+        hashCombine(seed, key.pushConstantRange.stageFlags, key.pushConstantRange.offset, key.pushConstantRange.size);
+        return seed;
+    }
+
+    std::shared_ptr<VhlDescriptorSetLayout> VhlPipelineLayoutCache::getDescriptorSetLayout(
+        const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+    {
+        std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindingMap;
+        for (const auto& binding : bindings)
+        {
+            bindingMap[binding.binding] = binding;
+        }
+        return m_DescriptorLayoutCache.getLayout(bindingMap);
+    }
+
+    VkPipelineLayout VhlPipelineLayoutCache::getPipelineLayout(
+        const ShaderReflection& reflection,
+        const std::vector<VkDescriptorSetLayout>& externalSetLayouts)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        uint32_t setCount = std::max(reflection.setCount(), static_cast<uint32_t>(externalSetLayouts.size()));
+        PipelineLayoutKey key{};
+        key.setLayouts.resize(setCount);
+        for (uint32_t set = 0; set < setCount; set++)
+        {
+            if (set < externalSetLayouts.size() && externalSetLayouts[set] != VK_NULL_HANDLE)
+            {
+                key.setLayouts[set] = externalSetLayouts[set];
+                continue;
+            }
+
+            for (const auto& binding : reflection.getSetBindings(set))
+            {
+                if (binding.descriptorCount == 0)
+                {
+                    throw std::runtime_error("runtime sized descriptor arrays need an external set layout!");
+                }
+            }
+            key.setLayouts[set] = getDescriptorSetLayout(reflection.getSetBindings(set))->getDescriptorSetLayout();
+        }
+        key.pushConstantRange = reflection.pushConstantRange;
+
+        auto it = m_PipelineLayouts.find(key);
+        if (it != m_PipelineLayouts.end()) return it->second;
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(key.setLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = key.setLayouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = key.pushConstantRange.size != 0 ? 1 : 0;
+        pipelineLayoutInfo.pPushConstantRanges = &key.pushConstantRange;
+
+        VkPipelineLayout pipelineLayout;
+        if (vkCreatePipelineLayout(m_VhlDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+            VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+        m_PipelineLayouts.emplace(std::move(key), pipelineLayout);
+        return pipelineLayout;
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "vhl_descriptors.hpp"
+#include "vhl_device.hpp"
+#include "vhl_shader_reflection.hpp"
+
+// std
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace vhl
+{
+    // Owns every VkDescriptorSetLayout and VkPipelineLayout derived from shader reflection, so
+    // systems whose shaders declare the same interface share the same layout objects.
+    class VhlPipelineLayoutCache
+    {
+    public:
+        VhlPipelineLayoutCache(VhlDevice& device) : m_VhlDevice(device), m_DescriptorLayoutCache(device) {}
+        ~VhlPipelineLayoutCache();
+
+        VhlPipelineLayoutCache(const VhlPipelineLayoutCache&) = delete;
+        VhlPipelineLayoutCache& operator=(const VhlPipelineLayoutCache&) = delete;
+
+        std::shared_ptr<VhlDescriptorSetLayout> getDescriptorSetLayout(
+            const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+
+        // Sets present in externalSetLayouts (non-null entries) are used as given instead of being
+        // derived, for sets owned elsewhere such as the global UBO set.
+        VkPipelineLayout getPipelineLayout(
+            const ShaderReflection& reflection,
+            const std::vector<VkDescriptorSetLayout>& externalSetLayouts = {});
+
+        // Shared with set layouts built by hand through VhlDescriptorSetLayout::Builder
+        VhlDescriptorLayoutCache& getDescriptorLayoutCache() { return m_DescriptorLayoutCache; }
+
+        size_t descriptorSetLayoutCount() const { return m_DescriptorLayoutCache.getLayoutCount(); }
+        size_t pipelineLayoutCount() const { return m_PipelineLayouts.size(); }
+
+    private:
+        struct PipelineLayoutKey
+        {
+            std::vector<VkDescriptorSetLayout> setLayouts;
+            VkPushConstantRange pushConstantRange;
+            bool operator==(const PipelineLayoutKey& other) const;
+        };
+
+        struct KeyHash
+        {
+            std::size_t operator()(const PipelineLayoutKey& key) const;
+        };
+
+        VhlDevice& m_VhlDevice;
+        VhlDescriptorLayoutCache m_DescriptorLayoutCache;
+
+        std::unordered_map<PipelineLayoutKey, VkPipelineLayout, KeyHash> m_PipelineLayouts;
+        std::mutex m_Mutex;
+    };
+}
@@ -0,0 +1,277 @@
+#include "vhl_pipeline_manager.hpp"
+
+#include "vhl_profiler.hpp"
+#include "vhl_swap_chain.hpp"
+#include "vhl_utils.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace vhl
+{
+    bool VhlPipelineHandle::bind(VkCommandBuffer commandBuffer)
+    {
+        if (isReady())
+        {
+            m_Pipeline->bind(commandBuffer);
+            return true;
+        }
+        if (m_Fallback != nullptr)
+        {
+            return m_Fallback->bind(commandBuffer);
+        }
+        return false;
+    }
+
+    bool VhlPipelineManager::PipelineKey::operator==(const PipelineKey& other) const
+    {
+        return hash == other.hash && vertFilepath == other.vertFilepath && fragFilepath == other.fragFilepath &&
+            *configInfo == *other.configInfo;
+    }
+
+    VhlPipelineManager::VhlPipelineManager(VhlDevice& device, uint32_t workerCount)
+        : m_VhlDevice(device), m_LayoutCache(device)
+    {
+        if (workerCount == 0)
+        {
+            workerCount = workerThreadShare(2, 4);
+        }
+
+        m_Workers.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; i++)
+        {
+            m_Workers.emplace_back(&VhlPipelineManager::workerLoop, this);
+        }
+    }
+
+    VhlPipelineManager::~VhlPipelineManager()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_ShuttingDown = true;
+            // pending jobs are dropped, their broken promises release anyone waiting on them
+            m_Jobs.clear();
+        }
+        m_JobAvailable.notify_all();
+
+        for (auto& worker : m_Workers)
+        {
+            worker.join();
+        }
+    }
+
+    VhlPipelineManager::Handle VhlPipelineManager::createPipeline(
+        const std::string& vertFilepath,
+        const std::string& fragFilepath,
+        std::unique_ptr<PipelineConfigInfo> configInfo,
+        Handle fallback)
+    {
+        assert(configInfo != nullptr && "Cannot create pipeline: no configInfo provided");
+
+        PipelineKey key{vertFilepath, fragFilepath, std::move(configInfo), 0};
+        key.hash = key.configInfo->hash();
+        hashCombine(key.hash, vertFilepath, fragFilepath);
+
+        auto handle = std::make_shared<VhlPipelineHandle>();
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            auto it = m_Registry.find(key);
+            if (it != m_Registry.end())
+            {
+                m_CacheHits++;
+                return it->second;
+            }
+
+            handle->m_Fallback = std::move(fallback);
+
+            auto job = std::make_unique<Job>();
+            job->handle = handle;
+            job->vertFilepath = vertFilepath;
+            job->fragFilepath = fragFilepath;
+            job->configInfo = key.configInfo;
+            handle->m_Done = job->done.get_future().share();
+
+            m_Registry.emplace(std::move(key), handle);
+            m_Jobs.push_back(std::move(job));
+        }
+        m_JobAvailable.notify_one();
+
+        return handle;
+    }
+
+    void VhlPipelineManager::waitIdle()
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_JobsFinished.wait(lock, [this] { return m_Jobs.empty() && m_ActiveJobs == 0; });
+    }
+
+    uint32_t VhlPipelineManager::reloadShaders(const std::vector<std::string>& spvFilepaths)
+    {
+        auto usesShader = [&](const std::string& filepath)
+        { return std::find(spvFilepaths.begin(), spvFilepaths.end(), filepath) != spvFilepaths.end(); };
+
+        uint32_t queued = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (auto& kv : m_Registry)
+            {
+                const auto& key = kv.first;
+                if (!usesShader(key.vertFilepath) && !usesShader(key.fragFilepath)) continue;
+
+                auto job = std::make_unique<Job>();
+                job->handle = kv.second;
+                job->vertFilepath = key.vertFilepath;
+                job->fragFilepath = key.fragFilepath;
+                job->configInfo = key.configInfo;
+                job->reload = true;
+                m_Jobs.push_back(std::move(job));
+                queued++;
+            }
+        }
+        m_JobAvailable.notify_all();
+
+        return queued;
+    }
+
+    void VhlPipelineManager::applyReloads()
+    {
+        // one call per frame, so after this many calls every frame that could have bound a
+        // retired pipeline has had its fence waited on by the renderer
+        constexpr uint32_t RETIRE_FRAMES = VhlSwapChain::MAX_FRAMES_IN_FLIGHT + 1;
+
+        for (auto& retired : m_Retired)
+        {
+            retired.framesLeft--;
+        }
+        m_Retired.erase(
+            std::remove_if(m_Retired.begin(), m_Retired.end(), [](const auto& r) { return r.framesLeft == 0; }),
+            m_Retired.end());
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_Reloaded.begin();
+        while (it != m_Reloaded.end())
+        {
+            auto& handle = *it->handle;
+            // the initial build still owns m_Pipeline, try again next frame
+            if (!handle.isReady() && !handle.hasFailed())
+            {
+                ++it;
+                continue;
+            }
+
+            if (handle.m_Pipeline != nullptr)
+            {
+                m_Retired.push_back({std::move(handle.m_Pipeline), RETIRE_FRAMES});
+            }
+            handle.m_Pipeline = std::move(it->pipeline);
+            handle.m_Failed.store(false, std::memory_order_release);
+            handle.m_Ready.store(true, std::memory_order_release);
+            it = m_Reloaded.erase(it);
+        }
+
+        // a ready pipeline no longer needs the one it replaced
+        for (auto& kv : m_Registry)
+        {
+            auto& handle = *kv.second;
+            if (handle.isReady() && handle.m_Fallback != nullptr)
+            {
+                handle.m_Fallback.reset();
+            }
+        }
+
+        // held by the registry alone: no system draws with it, no job builds it and no handle
+        // falls back to it, so it only has to outlive the frames that may have bound it
+        for (auto registryIt = m_Registry.begin(); registryIt != m_Registry.end();)
+        {
+            if (registryIt->second.use_count() > 1)
+            {
+                ++registryIt;
+                continue;
+            }
+            if (registryIt->second->m_Pipeline != nullptr)
+            {
+                m_Retired.push_back({std::move(registryIt->second->m_Pipeline), RETIRE_FRAMES});
+            }
+            registryIt = m_Registry.erase(registryIt);
+        }
+    }
+
+    VhlPipelineManager::Stats VhlPipelineManager::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        Stats stats{};
+        stats.uniquePipelines = static_cast<uint32_t>(m_Registry.size());
+        stats.cacheHits = m_CacheHits;
+        return stats;
+    }
+
+    void VhlPipelineManager::workerLoop()
+    {
+        VHL_PROFILE_THREAD("pipeline compiler");
+        while (true)
+        {
+            std::unique_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_JobAvailable.wait(lock, [this] { return m_ShuttingDown || !m_Jobs.empty(); });
+                if (m_ShuttingDown) return;
+
+                job = std::move(m_Jobs.front());
+                m_Jobs.pop_front();
+                m_ActiveJobs++;
+            }
+
+            buildPipeline(*job);
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_ActiveJobs--;
+            }
+            m_JobsFinished.notify_all();
+        }
+    }
+
+    void VhlPipelineManager::buildPipeline(Job& job)
+    {
+        VHL_PROFILE_SCOPE("build pipeline");
+        auto& handle = *job.handle;
+        try
+        {
+            if (job.reload)
+            {
+                auto pipeline = std::make_unique<VhlPipeline>(
+                    m_VhlDevice,
+                    job.vertFilepath,
+                    job.fragFilepath,
+                    *job.configInfo);
+
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Reloaded.push_back({job.handle, std::move(pipeline)});
+                job.done.set_value();
+                return;
+            }
+
+            handle.m_Pipeline = std::make_unique<VhlPipeline>(
+                m_VhlDevice,
+                job.vertFilepath,
+                job.fragFilepath,
+                *job.configInfo);
+            handle.m_Ready.store(true, std::memory_order_release);
+        }
+        catch (const std::exception& e)
+        {
+            // keep rendering with the fallback rather than tearing down the app from a worker
+            std::cerr << "pipeline (" << job.vertFilepath << ", " << job.fragFilepath
+                      << ") failed to build: " << e.what() << std::endl;
+            // a failed reload leaves the working pipeline in place
+            if (!job.reload)
+            {
+                handle.m_Failed.store(true, std::memory_order_release);
+            }
+        }
+        job.done.set_value();
+    }
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "vhl_device.hpp"
+#include "vhl_pipeline.hpp"
+#include "vhl_pipeline_layout_cache.hpp"
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace vhl
+{
+    class VhlPipelineHandle
+    {
+    public:
+        VhlPipelineHandle() = default;
+
+        VhlPipelineHandle(const VhlPipelineHandle&) = delete;
+        VhlPipelineHandle& operator=(const VhlPipelineHandle&) = delete;
+
+        bool isReady() const { return m_Ready.load(std::memory_order_acquire); }
+        bool hasFailed() const { return m_Failed.load(std::memory_order_acquire); }
+
+        // Binds the compiled pipeline, or the fallback while this one is still compiling.
+        // Returns false when neither is usable yet, so the caller can skip its draws.
+        bool bind(VkCommandBuffer commandBuffer);
+
+        // Blocks until the worker has finished with this pipeline (successfully or not)
+        void wait() const { m_Done.wait(); }
+
+    private:
+        std::unique_ptr<VhlPipeline> m_Pipeline;
+        std::shared_ptr<VhlPipelineHandle> m_Fallback;
+        std::atomic<bool> m_Ready{false};
+        std::atomic<bool> m_Failed{false};
+        std::shared_future<void> m_Done;
+
+        friend class VhlPipelineManager;
+    };
+
+    // Also acts as the central pipeline registry: requests with identical shaders and
+    // PipelineConfigInfo share one VkPipeline instead of compiling it again, for as long as
+    // someone holds a handle to it.
+    class VhlPipelineManager
+    {
+    public:
+        using Handle = std::shared_ptr<VhlPipelineHandle>;
+
+        struct Stats
+        {
+            uint32_t uniquePipelines = 0;
+            uint32_t cacheHits = 0;
+        };
+
+        // workerCount == 0 picks this pool's share of the hardware threads, see workerThreadShare
+        VhlPipelineManager(VhlDevice& device, uint32_t workerCount = 0);
+        ~VhlPipelineManager();
+
+        VhlPipelineManager(const VhlPipelineManager&) = delete;
+        VhlPipelineManager& operator=(const VhlPipelineManager&) = delete;
+
+        // Queues the pipeline for creation on a worker thread and returns immediately, or returns
+        // the existing handle when an identical pipeline was already requested (the fallback is
+        // then ignored). The config is owned by the registry from here on.
+        Handle createPipeline(
+            const std::string& vertFilepath,
+            const std::string& fragFilepath,
+            std::unique_ptr<PipelineConfigInfo> configInfo,
+            Handle fallback = nullptr);
+
+        // Blocks until every queued pipeline has been built
+        void waitIdle();
+
+        // Queues a rebuild of every registered pipeline that uses one of these SPIR-V files.
+        // The current pipelines stay bound until applyReloads() swaps the new ones in.
+        uint32_t reloadShaders(const std::vector<std::string>& spvFilepaths);
+
+        // Call once per frame, outside of command buffer recording. Swaps in rebuilt pipelines,
+        // drops fallbacks of pipelines that are ready, and evicts pipelines nothing holds a handle
+        // to anymore. Replaced and evicted ones are destroyed once no frame in flight can still
+        // reference them.
+        void applyReloads();
+
+        Stats getStats() const;
+
+        // Pipeline and descriptor set layouts derived from shader reflection, shared between systems
+        VhlPipelineLayoutCache& getLayoutCache() { return m_LayoutCache; }
+
+    private:
+        struct PipelineKey
+        {
+            std::string vertFilepath;
+            std::string fragFilepath;
+            std::shared_ptr<const PipelineConfigInfo> configInfo;
+            std::size_t hash;
+
+            bool operator==(const PipelineKey& other) const;
+        };
+
+        struct PipelineKeyHash
+        {
+            std::size_t operator()(const PipelineKey& key) const { return key.hash; }
+        };
+
+        struct Job
+        {
+            Handle handle;
+            std::string vertFilepath;
+            std::string fragFilepath;
+            std::shared_ptr<const PipelineConfigInfo> configInfo;
+            std::promise<void> done;
+            bool reload = false;
+        };
+
+        struct ReloadedPipeline
+        {
+            Handle handle;
+            std::unique_ptr<VhlPipeline> pipeline;
+        };
+
+        struct RetiredPipeline
+        {
+            std::unique_ptr<VhlPipeline> pipeline;
+            uint32_t framesLeft;
+        };
+
+        void workerLoop();
+        void buildPipeline(Job& job);
+
+        VhlDevice& m_VhlDevice;
+        VhlPipelineLayoutCache m_LayoutCache;
+
+        std::vector<std::thread> m_Workers;
+        std::deque<std::unique_ptr<Job>> m_Jobs;
+        std::unordered_map<PipelineKey, Handle, PipelineKeyHash> m_Registry;
+        uint32_t m_CacheHits = 0;
+
+        std::vector<ReloadedPipeline> m_Reloaded;  // guarded by m_Mutex
+        std::vector<RetiredPipeline> m_Retired;    // main thread only
+
+        mutable std::mutex m_Mutex;
+        std::condition_variable m_JobAvailable;
+        std::condition_variable m_JobsFinished;
+        uint32_t m_ActiveJobs = 0;
+        bool m_ShuttingDown = false;
+    };
+}
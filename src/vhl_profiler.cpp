@@ -0,0 +1,234 @@
+#include "vhl_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace vhl
+{
+    namespace
+    {
+        struct Event
+        {
+            const char* name;
+            uint64_t start;
+            uint64_t end;
+        };
+
+        // an Event in the ring, atomic so writeChromeTrace may read it while its thread overwrites it
+        struct EventSlot
+        {
+            std::atomic<const char*> name;
+            std::atomic<uint64_t> start;
+            std::atomic<uint64_t> end;
+
+            Event load() const
+            {
+                return {name.load(std::memory_order_relaxed), start.load(std::memory_order_relaxed),
+                    end.load(std::memory_order_relaxed)};
+            }
+        };
+
+        // written only by its thread, read by writeChromeTrace. Slots below written hold complete
+        // events, slots below started - EVENTS_PER_THREAD may have been overwritten since.
+        struct ThreadBuffer
+        {
+            std::unique_ptr<EventSlot[]> events{new EventSlot[VhlProfiler::EVENTS_PER_THREAD]};
+            std::atomic<uint64_t> started{0};
+            std::atomic<uint64_t> written{0};
+            std::atomic<const char*> name{nullptr};
+            uint32_t id = 0;
+        };
+
+        std::atomic<bool> g_Enabled{false};
+
+        // buffers outlive their threads so zones of finished workers still show up in a trace
+        std::mutex g_BuffersMutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> g_Buffers;
+
+        ThreadBuffer& threadBuffer()
+        {
+            thread_local ThreadBuffer* buffer = nullptr;
+            if (buffer == nullptr)
+            {
+                std::lock_guard<std::mutex> lock(g_BuffersMutex);
+                g_Buffers.push_back(std::make_unique<ThreadBuffer>());
+                buffer = g_Buffers.back().get();
+                buffer->id = static_cast<uint32_t>(g_Buffers.size());
+            }
+            return *buffer;
+        }
+
+        void writeJsonString(std::ostream& out, const char* text)
+        {
+            out << '"';
+            for (const char* c = text; *c != '\0'; c++)
+            {
+                if (*c == '"' || *c == '\\') out << '\\';
+                out << *c;
+            }
+            out << '"';
+        }
+    }
+
+    void VhlProfiler::setEnabled(bool enabled) { g_Enabled.store(enabled, std::memory_order_relaxed); }
+
+    bool VhlProfiler::isEnabled() { return g_Enabled.load(std::memory_order_relaxed); }
+
+    void VhlProfiler::setThreadName(const char* name) { threadBuffer().name.store(name, std::memory_order_release); }
+
+    uint64_t VhlProfiler::now()
+    {
+        static const auto epoch = std::chrono::steady_clock::now();
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    void VhlProfiler::record(const char* name, uint64_t start, uint64_t end)
+    {
+        auto& buffer = threadBuffer();
+        uint64_t index = buffer.written.load(std::memory_order_relaxed);
+        // announced before the slot changes, so a reader that sees the new contents also sees this
+        buffer.started.store(index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        auto& slot = buffer.events[index % EVENTS_PER_THREAD];
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.start.store(start, std::memory_order_relaxed);
+        slot.end.store(end, std::memory_order_relaxed);
+        buffer.written.store(index + 1, std::memory_order_release);
+    }
+
+    void VhlProfiler::writeChromeTrace(const std::string& filepath)
+    {
+        std::ofstream out{filepath};
+        if (!out)
+        {
+            throw std::runtime_error("failed to open trace file: " + filepath);
+        }
+
+        std::lock_guard<std::mutex> lock(g_BuffersMutex);
+
+        out << std::fixed << std::setprecision(3);
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+        std::vector<Event> events;
+        for (const auto& buffer : g_Buffers)
+        {
+            const char* threadName = buffer->name.load(std::memory_order_acquire);
+            if (threadName != nullptr)
+            {
+                out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+                    << ",\"args\":{\"name\":";
+                writeJsonString(out, threadName);
+                out << "}}";
+                first = false;
+            }
+
+            // only slots published by the acquire load are copied
+            uint64_t written = buffer->written.load(std::memory_order_acquire);
+            uint64_t begin = written > EVENTS_PER_THREAD ? written - EVENTS_PER_THREAD : 0;
+            events.clear();
+            for (uint64_t index = begin; index < written; index++)
+            {
+                events.push_back(buffer->events[index % EVENTS_PER_THREAD].load());
+            }
+
+            // slots the thread started to overwrite while they were copied are dropped
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t started = buffer->started.load(std::memory_order_relaxed);
+            uint64_t firstValid = started > EVENTS_PER_THREAD ? started - EVENTS_PER_THREAD : 0;
+
+            for (uint64_t index = std::max(begin, firstValid); index < written; index++)
+            {
+                const auto& event = events[index - begin];
+                out << (first ? "" : ",\n") << "{\"name\":";
+                writeJsonString(out, event.name);
+                out << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                    << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+                first = false;
+            }
+        }
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+        if (!out)
+        {
+            throw std::runtime_error("failed to write trace file: " + filepath);
+        }
+    }
+
+    std::vector<VhlProfiler::ZoneTotal> VhlProfiler::getThreadZones(uint64_t begin, uint64_t end)
+    {
+        // only this thread writes its ring, so it can be read without synchronisation
+        auto& buffer = threadBuffer();
+        uint64_t written = buffer.written.load(std::memory_order_relaxed);
+        uint64_t first = written > EVENTS_PER_THREAD ? written - EVENTS_PER_THREAD : 0;
+
+        // zones are recorded as they end, so walk back until they end before the range
+        std::vector<Event> events;
+        for (uint64_t index = written; index > first; index--)
+        {
+            Event event = buffer.events[(index - 1) % EVENTS_PER_THREAD].load();
+            if (event.end < begin) break;
+            if (event.start >= begin && event.end <= end) events.push_back(event);
+        }
+        std::sort(events.begin(), events.end(), [](const Event& a, const Event& b)
+        {
+            return a.start != b.start ? a.start < b.start : a.end > b.end;
+        });
+
+        // merge into a tree keyed by parent and name, then flatten it depth first
+        struct Node
+        {
+            ZoneTotal total;
+            std::vector<size_t> children;
+        };
+        std::vector<Node> nodes;
+        std::vector<size_t> roots;
+        // open zones as (end, node), innermost last
+        std::vector<std::pair<uint64_t, size_t>> parents;
+        for (const auto& event : events)
+        {
+            while (!parents.empty() && parents.back().first < event.end) parents.pop_back();
+
+            auto& siblings = parents.empty() ? roots : nodes[parents.back().second].children;
+            auto it = std::find_if(siblings.begin(), siblings.end(), [&](size_t node)
+            {
+                return std::strcmp(nodes[node].total.name, event.name) == 0;
+            });
+            size_t node = nodes.size();
+            if (it != siblings.end())
+            {
+                node = *it;
+            }
+            else
+            {
+                siblings.push_back(node);
+                nodes.push_back({{event.name, static_cast<uint32_t>(parents.size()), 0, 0}, {}});
+            }
+            nodes[node].total.count++;
+            nodes[node].total.duration += event.end - event.start;
+            parents.emplace_back(event.end, node);
+        }
+
+        std::vector<ZoneTotal> totals;
+        totals.reserve(nodes.size());
+        std::vector<size_t> stack(roots.rbegin(), roots.rend());
+        while (!stack.empty())
+        {
+            const auto& node = nodes[stack.back()];
+            stack.pop_back();
+            totals.push_back(node.total);
+            stack.insert(stack.end(), node.children.rbegin(), node.children.rend());
+        }
+        return totals;
+    }
+}
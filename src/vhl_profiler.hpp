@@ -0,0 +1,92 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Set to 0 to compile every VHL_PROFILE_* macro away
+#ifndef VHL_PROFILING
+#define VHL_PROFILING 1
+#endif
+
+namespace vhl
+{
+    // CPU zone profiler. Each thread appends finished zones to its own fixed-size ring, so
+    // recording takes no lock and never allocates; the oldest zones are overwritten once a ring
+    // is full. Recording is off until setEnabled(true), a disabled zone costs one atomic load.
+    class VhlProfiler
+    {
+    public:
+        static constexpr uint32_t EVENTS_PER_THREAD = 1 << 16;
+
+        struct ZoneTotal
+        {
+            const char* name;
+            uint32_t depth;  // nesting level within the queried range
+            uint32_t count;  // zones of that name merged into this one
+            uint64_t duration;  // ns, summed over count
+        };
+
+        static void setEnabled(bool enabled);
+        static bool isEnabled();
+
+        // Shown as the thread's name in the trace, call from the thread itself
+        static void setThreadName(const char* name);
+
+        // ns since the profiler's epoch
+        static uint64_t now();
+
+        // name must outlive the profiler, string literals and __func__ do
+        static void record(const char* name, uint64_t start, uint64_t end);
+
+        // Writes every zone still held by the rings as Chrome trace-event JSON, loadable in
+        // chrome://tracing or Perfetto. Zones finishing while the file is written may be missing.
+        static void writeChromeTrace(const std::string& filepath);
+
+        // Zones the calling thread recorded within [begin, end], for live displays. Zones with the
+        // same name and parent are merged; the result is in order of first start, parents first.
+        static std::vector<ZoneTotal> getThreadZones(uint64_t begin, uint64_t end);
+    };
+
+    class VhlProfileZone
+    {
+    public:
+        explicit VhlProfileZone(const char* name)
+        {
+            if (VhlProfiler::isEnabled())
+            {
+                m_Name = name;
+                m_Start = VhlProfiler::now();
+            }
+        }
+
+        ~VhlProfileZone()
+        {
+            if (m_Name != nullptr)
+            {
+                VhlProfiler::record(m_Name, m_Start, VhlProfiler::now());
+            }
+        }
+
+        VhlProfileZone(const VhlProfileZone&) = delete;
+        VhlProfileZone& operator=(const VhlProfileZone&) = delete;
+
+    private:
+        const char* m_Name = nullptr;
+        uint64_t m_Start = 0;
+    };
+}
+
+#if VHL_PROFILING
+#define VHL_PROFILE_CONCAT_INNER(a, b) a##b
+#define VHL_PROFILE_CONCAT(a, b) VHL_PROFILE_CONCAT_INNER(a, b)
+// Records the rest of the enclosing block as a zone called name
+#define VHL_PROFILE_SCOPE(name) ::vhl::VhlProfileZone VHL_PROFILE_CONCAT(vhlProfileZone, __LINE__){name}
+#define VHL_PROFILE_FUNCTION() VHL_PROFILE_SCOPE(__func__)
+#define VHL_PROFILE_THREAD(name) ::vhl::VhlProfiler::setThreadName(name)
+#else
+#define VHL_PROFILE_SCOPE(name)
+#define VHL_PROFILE_FUNCTION()
+#define VHL_PROFILE_THREAD(name)
+#endif
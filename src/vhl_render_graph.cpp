@@ -0,0 +1,985 @@
+#include "vhl_render_graph.hpp"
+
+#include "vhl_utils.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace vhl
+{
+    namespace
+    {
+        // access bits that make memory available, the rest only need it visible
+        constexpr VkAccessFlags WRITE_ACCESS =
+            VK_ACCESS_SHADER_WRITE_BIT |
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+            VK_ACCESS_TRANSFER_WRITE_BIT |
+            VK_ACCESS_HOST_WRITE_BIT |
+            VK_ACCESS_MEMORY_WRITE_BIT;
+
+        constexpr VkPipelineStageFlags SHADER_STAGES =
+            VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+        struct AccessInfo
+        {
+            VkPipelineStageFlags stages;
+            VkAccessFlags access;
+            VkImageLayout layout;
+            VkImageUsageFlags usage;
+        };
+
+        AccessInfo imageAccessInfo(VhlRenderGraph::ImageAccess access)
+        {
+            using ImageAccess = VhlRenderGraph::ImageAccess;
+            switch (access)
+            {
+            case ImageAccess::SampledFragment:
+                return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT};
+            case ImageAccess::SampledCompute:
+                return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT};
+            case ImageAccess::StorageRead:
+                return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                    VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT};
+            case ImageAccess::StorageWrite:
+                return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT};
+            case ImageAccess::TransferSrc:
+                return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT};
+            case ImageAccess::TransferDst:
+                return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT};
+            }
+            throw std::runtime_error("unknown render graph image access!");
+        }
+
+        AccessInfo bufferAccessInfo(VhlRenderGraph::BufferAccess access)
+        {
+            using BufferAccess = VhlRenderGraph::BufferAccess;
+            switch (access)
+            {
+            case BufferAccess::VertexInput:
+                return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT};
+            case BufferAccess::IndexInput:
+                return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT};
+            case BufferAccess::Indirect:
+                return {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT};
+            case BufferAccess::Uniform:
+                return {SHADER_STAGES, VK_ACCESS_UNIFORM_READ_BIT};
+            case BufferAccess::StorageRead:
+                return {SHADER_STAGES, VK_ACCESS_SHADER_READ_BIT};
+            case BufferAccess::StorageWrite:
+                return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT};
+            case BufferAccess::TransferSrc:
+                return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT};
+            case BufferAccess::TransferDst:
+                return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT};
+            }
+            throw std::runtime_error("unknown render graph buffer access!");
+        }
+
+        bool isWriteAccess(VhlRenderGraph::ImageAccess access)
+        {
+            return access == VhlRenderGraph::ImageAccess::StorageWrite || access == VhlRenderGraph::ImageAccess::TransferDst;
+        }
+
+        bool isWriteAccess(VhlRenderGraph::BufferAccess access)
+        {
+            return access == VhlRenderGraph::BufferAccess::StorageWrite || access == VhlRenderGraph::BufferAccess::TransferDst;
+        }
+    }
+
+    // ---- PassBuilder ----
+
+    void VhlRenderGraph::PassBuilder::colorAttachment(
+        ImageHandle image, VkAttachmentLoadOp loadOp, VkClearColorValue clearValue)
+    {
+        assert(image.isValid() && image.index < m_Graph.m_Images.size() && "Invalid render graph image");
+        auto& pass = m_Graph.m_Passes[m_Pass];
+
+        Attachment attachment{image.index, loadOp, {}};
+        attachment.clearValue.color = clearValue;
+        pass.colorAttachments.push_back(attachment);
+
+        // blending reads the attachment whatever the load op
+        Access access{};
+        access.resource = image.index;
+        access.image = true;
+        access.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        access.access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        access.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        access.reads = loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+        access.writes = true;
+        access.discards = !access.reads;
+        m_Graph.addAccess(m_Pass, access);
+        m_Graph.m_Images[image.index].usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    }
+
+    void VhlRenderGraph::PassBuilder::depthAttachment(
+        ImageHandle image, VkAttachmentLoadOp loadOp, VkClearDepthStencilValue clearValue)
+    {
+        assert(image.isValid() && image.index < m_Graph.m_Images.size() && "Invalid render graph image");
+        auto& pass = m_Graph.m_Passes[m_Pass];
+        assert(pass.depthAttachment.image == INVALID_RESOURCE && "A pass has at most one depth attachment");
+        assert(isDepthFormat(m_Graph.m_Images[image.index].desc.format) && "Depth attachment needs a depth format");
+
+        pass.depthAttachment = {image.index, loadOp, {}};
+        pass.depthAttachment.clearValue.depthStencil = clearValue;
+
+        Access access{};
+        access.resource = image.index;
+        access.image = true;
+        access.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        access.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        access.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        access.reads = loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+        access.writes = true;
+        access.discards = !access.reads;
+        m_Graph.addAccess(m_Pass, access);
+        m_Graph.m_Images[image.index].usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    }
+
+    void VhlRenderGraph::PassBuilder::read(ImageHandle image, ImageAccess access)
+    {
+        assert(image.isValid() && image.index < m_Graph.m_Images.size() && "Invalid render graph image");
+        assert(!isWriteAccess(access) && "Image access doesn't read");
+        AccessInfo info = imageAccessInfo(access);
+        m_Graph.addAccess(m_Pass, {image.index, true, info.stages, info.access, info.layout, true, false, false});
+        m_Graph.m_Images[image.index].usage |= info.usage;
+    }
+
+    void VhlRenderGraph::PassBuilder::write(ImageHandle image, ImageAccess access)
+    {
+        assert(image.isValid() && image.index < m_Graph.m_Images.size() && "Invalid render graph image");
+        assert(isWriteAccess(access) && "Image access doesn't write");
+        AccessInfo info = imageAccessInfo(access);
+        m_Graph.addAccess(m_Pass, {image.index, true, info.stages, info.access, info.layout, false, true, false});
+        m_Graph.m_Images[image.index].usage |= info.usage;
+    }
+
+    void VhlRenderGraph::PassBuilder::read(BufferHandle buffer, BufferAccess access)
+    {
+        assert(buffer.isValid() && buffer.index < m_Graph.m_Buffers.size() && "Invalid render graph buffer");
+        assert(!isWriteAccess(access) && "Buffer access doesn't read");
+        AccessInfo info = bufferAccessInfo(access);
+        m_Graph.addAccess(m_Pass, {buffer.index, false, info.stages, info.access, VK_IMAGE_LAYOUT_UNDEFINED, true, false, false});
+    }
+
+    void VhlRenderGraph::PassBuilder::write(BufferHandle buffer, BufferAccess access)
+    {
+        assert(buffer.isValid() && buffer.index < m_Graph.m_Buffers.size() && "Invalid render graph buffer");
+        assert(isWriteAccess(access) && "Buffer access doesn't write");
+        AccessInfo info = bufferAccessInfo(access);
+        m_Graph.addAccess(m_Pass, {buffer.index, false, info.stages, info.access, VK_IMAGE_LAYOUT_UNDEFINED, false, true, false});
+    }
+
+    void VhlRenderGraph::PassBuilder::setSideEffect()
+    {
+        m_Graph.m_Passes[m_Pass].sideEffect = true;
+    }
+
+    // ---- VhlRenderGraph ----
+
+    VhlRenderGraph::VhlRenderGraph(VhlDevice& device, VhlGpuProfiler& gpuProfiler, uint32_t framesInFlight)
+        : m_VhlDevice{device}, m_GpuProfiler{gpuProfiler}
+    {
+        m_Frames.resize(framesInFlight);
+    }
+
+    VhlRenderGraph::~VhlRenderGraph()
+    {
+        for (auto& frame : m_Frames)
+        {
+            destroyFramebuffers(frame);
+            destroyTransients(frame);
+        }
+        for (auto& entry : m_RenderPasses)
+        {
+            vkDestroyRenderPass(m_VhlDevice.device(), entry.renderPass, nullptr);
+        }
+    }
+
+    void VhlRenderGraph::beginFrame(uint32_t frameIndex)
+    {
+        assert(frameIndex < m_Frames.size() && "Frame index out of range");
+        m_FrameIndex = frameIndex;
+
+        m_Passes.clear();
+        m_Images.clear();
+        m_Buffers.clear();
+        m_Transients.clear();
+        m_TransientIndices.clear();
+        m_FinalBarriers.clear();
+        m_FinalSrcStages = 0;
+        m_Compiled = false;
+    }
+
+    void VhlRenderGraph::releaseFramebuffers()
+    {
+        for (auto& frame : m_Frames)
+        {
+            destroyFramebuffers(frame);
+        }
+    }
+
+    VhlRenderGraph::ImageHandle VhlRenderGraph::createImage(const char* name, const ImageDesc& desc)
+    {
+        assert(desc.format != VK_FORMAT_UNDEFINED && desc.extent.width > 0 && desc.extent.height > 0 &&
+            "Transient images need a format and an extent");
+        Image image{};
+        image.name = name;
+        image.desc = desc;
+        image.imported = false;
+        m_Images.push_back(image);
+        return {static_cast<uint32_t>(m_Images.size() - 1)};
+    }
+
+    VhlRenderGraph::ImageHandle VhlRenderGraph::importImage(
+        const char* name,
+        VkImage image,
+        VkImageView view,
+        VkFormat format,
+        VkExtent2D extent,
+        VkImageLayout initialLayout,
+        VkImageLayout finalLayout)
+    {
+        Image imported{};
+        imported.name = name;
+        imported.desc = {format, extent};
+        imported.imported = true;
+        imported.image = image;
+        imported.view = view;
+        imported.initialLayout = initialLayout;
+        imported.finalLayout = finalLayout;
+        m_Images.push_back(imported);
+        return {static_cast<uint32_t>(m_Images.size() - 1)};
+    }
+
+    VhlRenderGraph::BufferHandle VhlRenderGraph::importBuffer(const char* name, VkBuffer buffer)
+    {
+        m_Buffers.push_back({name, buffer});
+        return {static_cast<uint32_t>(m_Buffers.size() - 1)};
+    }
+
+    void VhlRenderGraph::addPass(const char* name, const Setup& setup, Execute execute)
+    {
+        assert(!m_Compiled && "Can't add passes to a compiled render graph");
+        Pass pass{};
+        pass.name = name;
+        pass.execute = std::move(execute);
+        m_Passes.push_back(std::move(pass));
+
+        PassBuilder builder{*this, static_cast<uint32_t>(m_Passes.size() - 1)};
+        setup(builder);
+    }
+
+    void VhlRenderGraph::addAccess(uint32_t pass, const Access& access)
+    {
+        auto& accesses = m_Passes[pass].accesses;
+        for (const auto& other : accesses)
+        {
+            assert((other.resource != access.resource || other.image != access.image) &&
+                "A pass can access a resource only once");
+        }
+        accesses.push_back(access);
+    }
+
+    void VhlRenderGraph::compile()
+    {
+        assert(!m_Compiled && "Render graph already compiled this frame");
+
+        cullPasses();
+        computeLifetimes();
+        allocateTransients();
+        computeBarriers();
+        createRenderPasses();
+
+        m_Stats.passes = 0;
+        m_Stats.culledPasses = 0;
+        m_Stats.barriers = m_FinalBarriers.empty() ? 0 : 1;
+        m_Stats.imageBarriers = static_cast<uint32_t>(m_FinalBarriers.size());
+        m_Stats.bufferBarriers = 0;
+        for (const auto& pass : m_Passes)
+        {
+            if (!pass.live)
+            {
+                m_Stats.culledPasses++;
+                continue;
+            }
+            m_Stats.passes++;
+            if (!pass.imageBarriers.empty() || !pass.bufferBarriers.empty()) m_Stats.barriers++;
+            m_Stats.imageBarriers += static_cast<uint32_t>(pass.imageBarriers.size());
+            m_Stats.bufferBarriers += static_cast<uint32_t>(pass.bufferBarriers.size());
+        }
+
+        m_Compiled = true;
+    }
+
+    void VhlRenderGraph::cullPasses()
+    {
+        // walking backwards, a resource is needed while a later live pass reads what it holds.
+        // imported resources are outputs of the frame
+        std::vector<bool> neededImages(m_Images.size());
+        for (size_t i = 0; i < m_Images.size(); i++)
+        {
+            neededImages[i] = m_Images[i].imported;
+        }
+        std::vector<bool> neededBuffers(m_Buffers.size(), true);
+
+        for (size_t p = m_Passes.size(); p-- > 0;)
+        {
+            auto& pass = m_Passes[p];
+            pass.live = pass.sideEffect;
+            for (const auto& access : pass.accesses)
+            {
+                auto& needed = access.image ? neededImages : neededBuffers;
+                if (access.writes && needed[access.resource]) pass.live = true;
+            }
+            if (!pass.live) continue;
+
+            // what the pass replaces as a whole isn't needed from earlier passes, what it reads is.
+            // a partial write leaves the rest to the earlier passes, so it changes neither
+            for (const auto& access : pass.accesses)
+            {
+                auto& needed = access.image ? neededImages : neededBuffers;
+                if (access.discards) needed[access.resource] = false;
+            }
+            for (const auto& access : pass.accesses)
+            {
+                auto& needed = access.image ? neededImages : neededBuffers;
+                if (access.reads) needed[access.resource] = true;
+            }
+        }
+    }
+
+    void VhlRenderGraph::computeLifetimes()
+    {
+        for (uint32_t p = 0; p < m_Passes.size(); p++)
+        {
+            if (!m_Passes[p].live) continue;
+            for (const auto& access : m_Passes[p].accesses)
+            {
+                if (!access.image) continue;
+                auto& image = m_Images[access.resource];
+                if (image.firstPass == INVALID_RESOURCE) image.firstPass = p;
+                image.lastPass = p;
+            }
+        }
+
+        m_TransientIndices.assign(m_Images.size(), INVALID_RESOURCE);
+        for (uint32_t i = 0; i < m_Images.size(); i++)
+        {
+            if (m_Images[i].imported || m_Images[i].firstPass == INVALID_RESOURCE) continue;
+            m_TransientIndices[i] = static_cast<uint32_t>(m_Transients.size());
+            m_Transients.push_back(i);
+        }
+    }
+
+    void VhlRenderGraph::allocateTransients()
+    {
+        auto& frame = m_Frames[m_FrameIndex];
+
+        size_t seed = 0;
+        for (uint32_t i : m_Transients)
+        {
+            const auto& image = m_Images[i];
+            hashCombine(seed, image.desc.format, image.desc.extent.width, image.desc.extent.height,
+                image.usage, image.firstPass, image.lastPass);
+        }
+        uint64_t signature = static_cast<uint64_t>(seed);
+
+        if (signature != frame.signature || frame.images.size() != m_Transients.size())
+        {
+            // the framebuffers hold views of the images about to go
+            destroyFramebuffers(frame);
+            destroyTransients(frame);
+            frame.signature = signature;
+            frame.images.resize(m_Transients.size());
+
+            std::vector<VkMemoryRequirements> requirements(m_Transients.size());
+            for (size_t t = 0; t < m_Transients.size(); t++)
+            {
+                const auto& image = m_Images[m_Transients[t]];
+
+                VkImageCreateInfo imageInfo{};
+                imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+                imageInfo.imageType = VK_IMAGE_TYPE_2D;
+                imageInfo.format = image.desc.format;
+                imageInfo.extent = {image.desc.extent.width, image.desc.extent.height, 1};
+                imageInfo.mipLevels = 1;
+                imageInfo.arrayLayers = 1;
+                imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+                imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+                imageInfo.usage = image.usage;
+                imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+                imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+                if (vkCreateImage(m_VhlDevice.device(), &imageInfo, nullptr, &frame.images[t].image) != VK_SUCCESS)
+                {
+                    throw std::runtime_error("failed to create render graph image!");
+                }
+                vkGetImageMemoryRequirements(m_VhlDevice.device(), frame.images[t].image, &requirements[t]);
+                frame.images[t].size = requirements[t].size;
+            }
+
+            // largest first, each into the first block none of whose images is alive at the same time
+            std::vector<uint32_t> order(m_Transients.size());
+            for (uint32_t t = 0; t < order.size(); t++) order[t] = t;
+            std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                { return requirements[a].size > requirements[b].size; });
+
+            for (uint32_t t : order)
+            {
+                const auto& image = m_Images[m_Transients[t]];
+                uint32_t block = INVALID_RESOURCE;
+                for (uint32_t b = 0; b < frame.blocks.size() && block == INVALID_RESOURCE; b++)
+                {
+                    if ((frame.blocks[b].memoryTypeBits & requirements[t].memoryTypeBits) == 0) continue;
+                    bool overlaps = false;
+                    for (uint32_t other : frame.blocks[b].images)
+                    {
+                        const auto& otherImage = m_Images[m_Transients[other]];
+                        overlaps |= image.firstPass <= otherImage.lastPass && otherImage.firstPass <= image.lastPass;
+                    }
+                    if (!overlaps) block = b;
+                }
+                if (block == INVALID_RESOURCE)
+                {
+                    block = static_cast<uint32_t>(frame.blocks.size());
+                    frame.blocks.emplace_back();
+                }
+
+                auto& memoryBlock = frame.blocks[block];
+                memoryBlock.size = std::max(memoryBlock.size, requirements[t].size);
+                memoryBlock.memoryTypeBits &= requirements[t].memoryTypeBits;
+                memoryBlock.images.push_back(t);
+                frame.images[t].block = block;
+            }
+
+            for (auto& memoryBlock : frame.blocks)
+            {
+                std::sort(memoryBlock.images.begin(), memoryBlock.images.end(), [&](uint32_t a, uint32_t b)
+                    { return m_Images[m_Transients[a]].firstPass < m_Images[m_Transients[b]].firstPass; });
+
+                // every image sits at offset 0, so the largest alignment is met too
+                VkMemoryRequirements blockRequirements{};
+                blockRequirements.size = memoryBlock.size;
+                blockRequirements.memoryTypeBits = memoryBlock.memoryTypeBits;
+                memoryBlock.memory = m_VhlDevice.allocateMemory(blockRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+                for (uint32_t t : memoryBlock.images)
+                {
+                    vkBindImageMemory(m_VhlDevice.device(), frame.images[t].image, memoryBlock.memory, 0);
+                }
+            }
+
+            for (size_t t = 0; t < m_Transients.size(); t++)
+            {
+                const auto& image = m_Images[m_Transients[t]];
+
+                VkImageViewCreateInfo viewInfo{};
+                viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+                viewInfo.image = frame.images[t].image;
+                viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+                viewInfo.format = image.desc.format;
+                viewInfo.subresourceRange.aspectMask = aspectMask(image.desc.format);
+                viewInfo.subresourceRange.baseMipLevel = 0;
+                viewInfo.subresourceRange.levelCount = 1;
+                viewInfo.subresourceRange.baseArrayLayer = 0;
+                viewInfo.subresourceRange.layerCount = 1;
+
+                if (vkCreateImageView(m_VhlDevice.device(), &viewInfo, nullptr, &frame.images[t].view) != VK_SUCCESS)
+                {
+                    throw std::runtime_error("failed to create render graph image view!");
+                }
+            }
+        }
+
+        m_Stats.transientImages = static_cast<uint32_t>(m_Transients.size());
+        m_Stats.transientBytes = 0;
+        m_Stats.allocatedBytes = 0;
+        for (const auto& physicalImage : frame.images)
+        {
+            m_Stats.transientBytes += physicalImage.size;
+        }
+        for (const auto& memoryBlock : frame.blocks)
+        {
+            m_Stats.allocatedBytes += memoryBlock.size;
+            for (size_t k = 1; k < memoryBlock.images.size(); k++)
+            {
+                m_Images[m_Transients[memoryBlock.images[k]]].aliasedAfter = m_Transients[memoryBlock.images[k - 1]];
+            }
+        }
+    }
+
+    void VhlRenderGraph::destroyTransients(FrameResources& frame)
+    {
+        for (auto& physicalImage : frame.images)
+        {
+            vkDestroyImageView(m_VhlDevice.device(), physicalImage.view, nullptr);
+            vkDestroyImage(m_VhlDevice.device(), physicalImage.image, nullptr);
+        }
+        for (auto& memoryBlock : frame.blocks)
+        {
+            m_VhlDevice.freeMemory(memoryBlock.memory);
+        }
+        frame.images.clear();
+        frame.blocks.clear();
+        frame.signature = 0;
+    }
+
+    void VhlRenderGraph::destroyFramebuffers(FrameResources& frame)
+    {
+        for (auto& cached : frame.framebuffers)
+        {
+            vkDestroyFramebuffer(m_VhlDevice.device(), cached.framebuffer, nullptr);
+        }
+        frame.framebuffers.clear();
+    }
+
+    void VhlRenderGraph::computeBarriers()
+    {
+        std::vector<ResourceState> imageStates(m_Images.size());
+        std::vector<ResourceState> bufferStates(m_Buffers.size());
+
+        // whatever came before the frame: earlier submissions, and for the swap chain the
+        // acquire semaphore wait, which an execution dependency on ALL_COMMANDS chains onto
+        for (size_t i = 0; i < m_Images.size(); i++)
+        {
+            if (!m_Images[i].imported) continue;
+            auto& state = imageStates[i];
+            state.layout = m_Images[i].initialLayout;
+            if (state.layout == VK_IMAGE_LAYOUT_UNDEFINED)
+            {
+                state.readStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            }
+            else
+            {
+                state.writeStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+                state.writeAccess = VK_ACCESS_MEMORY_WRITE_BIT;
+            }
+        }
+        for (auto& state : bufferStates)
+        {
+            state.writeStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            state.writeAccess = VK_ACCESS_MEMORY_WRITE_BIT;
+        }
+
+        for (uint32_t p = 0; p < m_Passes.size(); p++)
+        {
+            auto& pass = m_Passes[p];
+            if (!pass.live) continue;
+
+            for (const auto& access : pass.accesses)
+            {
+                if (!access.image)
+                {
+                    transition(pass, access.resource, false, access, bufferStates[access.resource], nullptr);
+                    continue;
+                }
+
+                // the first use of an aliased image waits for the one that had the memory before
+                const auto& image = m_Images[access.resource];
+                const ResourceState* aliasedState = nullptr;
+                if (image.firstPass == p && image.aliasedAfter != INVALID_RESOURCE)
+                {
+                    aliasedState = &imageStates[image.aliasedAfter];
+                }
+                transition(pass, access.resource, true, access, imageStates[access.resource], aliasedState);
+            }
+        }
+
+        for (uint32_t i = 0; i < m_Images.size(); i++)
+        {
+            const auto& image = m_Images[i];
+            const auto& state = imageStates[i];
+            if (!image.imported || image.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED ||
+                state.layout == image.finalLayout)
+            {
+                continue;
+            }
+
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = state.writeAccess;
+            barrier.dstAccessMask = 0;
+            barrier.oldLayout = state.layout;
+            barrier.newLayout = image.finalLayout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = image.image;
+            barrier.subresourceRange = {aspectMask(image.desc.format), 0, 1, 0, 1};
+            m_FinalBarriers.push_back(barrier);
+
+            VkPipelineStageFlags srcStages = state.writeStages | state.readStages;
+            if (srcStages == 0) srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            m_FinalSrcStages |= srcStages;
+        }
+    }
+
+    void VhlRenderGraph::transition(
+        Pass& pass, uint32_t resource, bool image, const Access& access, ResourceState& state,
+        const ResourceState* aliasedState)
+    {
+        bool layoutChange = image && state.layout != access.layout;
+        bool visible = (state.visibleStages & access.stages) == access.stages &&
+            (state.visibleAccess & access.access) == access.access;
+
+        bool needed = layoutChange || aliasedState != nullptr;
+        if (access.writes)
+        {
+            // write after write, write after read
+            needed |= state.writeStages != 0 || state.readStages != 0;
+        }
+        else
+        {
+            // read after write
+            needed |= state.writeStages != 0 && !visible;
+        }
+
+        if (needed)
+        {
+            VkPipelineStageFlags srcStages = state.writeStages;
+            VkAccessFlags srcAccess = state.writeAccess;
+            if (access.writes || layoutChange) srcStages |= state.readStages;
+            if (aliasedState != nullptr)
+            {
+                srcStages |= aliasedState->writeStages | aliasedState->readStages;
+                srcAccess |= aliasedState->writeAccess;
+            }
+            if (srcStages == 0) srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+            if (image)
+            {
+                const auto& graphImage = m_Images[resource];
+                VkImageMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.srcAccessMask = srcAccess;
+                barrier.dstAccessMask = access.access;
+                // an aliased image's previous contents belong to another image
+                barrier.oldLayout = aliasedState != nullptr ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+                barrier.newLayout = access.layout;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = imageHandle(resource);
+                barrier.subresourceRange = {aspectMask(graphImage.desc.format), 0, 1, 0, 1};
+                pass.imageBarriers.push_back(barrier);
+            }
+            else
+            {
+                VkBufferMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                barrier.srcAccessMask = srcAccess;
+                barrier.dstAccessMask = access.access;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.buffer = m_Buffers[resource].buffer;
+                barrier.offset = 0;
+                barrier.size = VK_WHOLE_SIZE;
+                pass.bufferBarriers.push_back(barrier);
+            }
+            pass.srcStages |= srcStages;
+            pass.dstStages |= access.stages;
+        }
+
+        if (access.writes)
+        {
+            state.layout = access.layout;
+            state.writeStages = access.stages;
+            state.writeAccess = access.access & WRITE_ACCESS;
+            state.readStages = 0;
+            state.visibleStages = 0;
+            state.visibleAccess = 0;
+        }
+        else if (layoutChange)
+        {
+            // later accesses are ordered after the transition through the stages that waited for it
+            state.layout = access.layout;
+            state.writeStages = access.stages;
+            state.readStages = access.stages;
+            state.visibleStages = access.stages;
+            state.visibleAccess = access.access;
+        }
+        else
+        {
+            if (needed)
+            {
+                state.visibleStages |= access.stages;
+                state.visibleAccess |= access.access;
+            }
+            state.readStages |= access.stages;
+        }
+    }
+
+    void VhlRenderGraph::createRenderPasses()
+    {
+        for (uint32_t p = 0; p < m_Passes.size(); p++)
+        {
+            auto& pass = m_Passes[p];
+            if (!pass.live) continue;
+            bool hasDepth = pass.depthAttachment.image != INVALID_RESOURCE;
+            if (pass.colorAttachments.empty() && !hasDepth) continue;
+
+            std::vector<VkFormat> formats;
+            std::vector<VkAttachmentLoadOp> loadOps;
+            std::vector<VkAttachmentStoreOp> storeOps;
+            auto addAttachment = [&](const Attachment& attachment)
+            {
+                const auto& image = m_Images[attachment.image];
+                formats.push_back(image.desc.format);
+                loadOps.push_back(attachment.loadOp);
+                // nothing after this pass reads a transient image that ends here
+                storeOps.push_back(image.imported || image.lastPass > p
+                    ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE);
+            };
+            for (const auto& attachment : pass.colorAttachments) addAttachment(attachment);
+            if (hasDepth) addAttachment(pass.depthAttachment);
+
+            pass.renderPass = findRenderPass(formats, loadOps, storeOps, hasDepth);
+        }
+    }
+
+    VkRenderPass VhlRenderGraph::getRenderPass(const std::vector<VkFormat>& colorFormats, VkFormat depthFormat)
+    {
+        std::vector<VkFormat> formats = colorFormats;
+        std::vector<VkAttachmentLoadOp> loadOps(colorFormats.size(), VK_ATTACHMENT_LOAD_OP_CLEAR);
+        std::vector<VkAttachmentStoreOp> storeOps(colorFormats.size(), VK_ATTACHMENT_STORE_OP_STORE);
+        bool hasDepth = depthFormat != VK_FORMAT_UNDEFINED;
+        if (hasDepth)
+        {
+            formats.push_back(depthFormat);
+            loadOps.push_back(VK_ATTACHMENT_LOAD_OP_CLEAR);
+            storeOps.push_back(VK_ATTACHMENT_STORE_OP_DONT_CARE);
+        }
+        return findRenderPass(formats, loadOps, storeOps, hasDepth);
+    }
+
+    VkRenderPass VhlRenderGraph::findRenderPass(
+        const std::vector<VkFormat>& formats,
+        const std::vector<VkAttachmentLoadOp>& loadOps,
+        const std::vector<VkAttachmentStoreOp>& storeOps,
+        bool hasDepth)
+    {
+        for (const auto& entry : m_RenderPasses)
+        {
+            if (entry.formats == formats && entry.loadOps == loadOps && entry.storeOps == storeOps &&
+                entry.hasDepth == hasDepth)
+            {
+                return entry.renderPass;
+            }
+        }
+
+        // layouts are handled by the graph's barriers, so the render pass never transitions
+        std::vector<VkAttachmentDescription> attachments(formats.size());
+        std::vector<VkAttachmentReference> colorRefs;
+        VkAttachmentReference depthRef{};
+        for (uint32_t i = 0; i < formats.size(); i++)
+        {
+            bool depth = hasDepth && i + 1 == formats.size();
+            VkImageLayout layout = depth
+                ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+            auto& attachment = attachments[i];
+            attachment.format = formats[i];
+            attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+            attachment.loadOp = loadOps[i];
+            attachment.storeOp = storeOps[i];
+            attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.initialLayout = layout;
+            attachment.finalLayout = layout;
+
+            if (depth) depthRef = {i, layout};
+            else colorRefs.push_back({i, layout});
+        }
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+        subpass.pColorAttachments = colorRefs.data();
+        subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+
+        VkRenderPass renderPass;
+        if (vkCreateRenderPass(m_VhlDevice.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create render graph render pass!");
+        }
+        m_RenderPasses.push_back({formats, loadOps, storeOps, hasDepth, renderPass});
+        return renderPass;
+    }
+
+    void VhlRenderGraph::execute(VkCommandBuffer commandBuffer)
+    {
+        assert(m_Compiled && "Render graph must be compiled before it is executed");
+
+        for (const auto& pass : m_Passes)
+        {
+            if (!pass.live) continue;
+
+            if (!pass.imageBarriers.empty() || !pass.bufferBarriers.empty())
+            {
+                vkCmdPipelineBarrier(
+                    commandBuffer,
+                    pass.srcStages,
+                    pass.dstStages,
+                    0,
+                    0, nullptr,
+                    static_cast<uint32_t>(pass.bufferBarriers.size()), pass.bufferBarriers.data(),
+                    static_cast<uint32_t>(pass.imageBarriers.size()), pass.imageBarriers.data());
+            }
+
+            m_GpuProfiler.beginScope(commandBuffer, pass.name);
+            if (pass.renderPass != VK_NULL_HANDLE) beginRenderPass(commandBuffer, pass);
+            if (pass.execute) pass.execute(commandBuffer);
+            if (pass.renderPass != VK_NULL_HANDLE) vkCmdEndRenderPass(commandBuffer);
+            m_GpuProfiler.endScope(commandBuffer);
+        }
+
+        if (!m_FinalBarriers.empty())
+        {
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                m_FinalSrcStages,
+                VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                0,
+                0, nullptr,
+                0, nullptr,
+                static_cast<uint32_t>(m_FinalBarriers.size()), m_FinalBarriers.data());
+        }
+    }
+
+    void VhlRenderGraph::beginRenderPass(VkCommandBuffer commandBuffer, const Pass& pass)
+    {
+        std::vector<VkImageView> views;
+        std::vector<VkClearValue> clearValues;
+        for (const auto& attachment : pass.colorAttachments)
+        {
+            views.push_back(imageView(attachment.image));
+            clearValues.push_back(attachment.clearValue);
+        }
+        if (pass.depthAttachment.image != INVALID_RESOURCE)
+        {
+            views.push_back(imageView(pass.depthAttachment.image));
+            clearValues.push_back(pass.depthAttachment.clearValue);
+        }
+
+        uint32_t firstImage = pass.colorAttachments.empty()
+            ? pass.depthAttachment.image : pass.colorAttachments[0].image;
+        VkExtent2D extent = m_Images[firstImage].desc.extent;
+
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = pass.renderPass;
+        renderPassInfo.framebuffer = findFramebuffer(pass.renderPass, views, extent);
+        renderPassInfo.renderArea.offset = {0, 0};
+        renderPassInfo.renderArea.extent = extent;
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        renderPassInfo.pClearValues = clearValues.data();
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float>(extent.width);
+        viewport.height = static_cast<float>(extent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        VkRect2D scissor{{0, 0}, extent};
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    }
+
+    VkFramebuffer VhlRenderGraph::findFramebuffer(
+        VkRenderPass renderPass, const std::vector<VkImageView>& views, VkExtent2D extent)
+    {
+        // a handful per frame: one per raster pass and, through the imported image, swap chain image
+        auto& frame = m_Frames[m_FrameIndex];
+        for (const auto& cached : frame.framebuffers)
+        {
+            if (cached.renderPass == renderPass && cached.views == views &&
+                cached.extent.width == extent.width && cached.extent.height == extent.height)
+            {
+                return cached.framebuffer;
+            }
+        }
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+        framebufferInfo.pAttachments = views.data();
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
+        framebufferInfo.layers = 1;
+
+        VkFramebuffer framebuffer;
+        if (vkCreateFramebuffer(m_VhlDevice.device(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create render graph framebuffer!");
+        }
+        frame.framebuffers.push_back({renderPass, views, extent, framebuffer});
+        return framebuffer;
+    }
+
+    VkImage VhlRenderGraph::getImage(ImageHandle image) const
+    {
+        assert(m_Compiled && image.isValid() && image.index < m_Images.size() && "Invalid render graph image");
+        return imageHandle(image.index);
+    }
+
+    VkImageView VhlRenderGraph::imageView(uint32_t image) const
+    {
+        if (m_Images[image].imported) return m_Images[image].view;
+        return m_Frames[m_FrameIndex].images[m_TransientIndices[image]].view;
+    }
+
+    VkImage VhlRenderGraph::imageHandle(uint32_t image) const
+    {
+        if (m_Images[image].imported) return m_Images[image].image;
+        return m_Frames[m_FrameIndex].images[m_TransientIndices[image]].image;
+    }
+
+    bool VhlRenderGraph::isDepthFormat(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+        case VK_FORMAT_D32_SFLOAT:
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    VkImageAspectFlags VhlRenderGraph::aspectMask(VkFormat format)
+    {
+        // barriers on combined formats have to name both aspects
+        switch (format)
+        {
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        default:
+            return isDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+        }
+    }
+}
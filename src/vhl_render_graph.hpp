@@ -0,0 +1,315 @@
+#pragma once
+
+#include "vhl_device.hpp"
+#include "vhl_gpu_profiler.hpp"
+
+// std
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace vhl
+{
+    // A frame recorded as passes that declare which images and buffers they read and write.
+    // compile() drops the passes whose results nothing uses, works out the layout transitions and
+    // pipeline barriers the remaining ones need, and places transient images in memory, letting
+    // images whose lifetimes do not overlap share it. execute() then records everything.
+    //
+    // Passes run in the order they were added, which always satisfies their dependencies since a
+    // pass can only read what was written before it. The graph is declared anew every frame;
+    // transient images and the framebuffers of raster passes are kept per frame in flight and
+    // reused while frames declare the same ones, so the steady state allocates nothing. Each pass
+    // is timed as a GPU scope of its name.
+    class VhlRenderGraph
+    {
+    public:
+        static constexpr uint32_t INVALID_RESOURCE = ~0u;
+
+        struct ImageHandle
+        {
+            uint32_t index = INVALID_RESOURCE;
+            bool isValid() const { return index != INVALID_RESOURCE; }
+        };
+
+        struct BufferHandle
+        {
+            uint32_t index = INVALID_RESOURCE;
+            bool isValid() const { return index != INVALID_RESOURCE; }
+        };
+
+        // How a pass uses an image besides as an attachment
+        enum class ImageAccess
+        {
+            SampledFragment,
+            SampledCompute,
+            StorageRead,  // compute
+            StorageWrite,  // compute
+            TransferSrc,
+            TransferDst,
+        };
+
+        enum class BufferAccess
+        {
+            VertexInput,
+            IndexInput,
+            Indirect,
+            Uniform,  // any shader stage
+            StorageRead,  // any shader stage
+            StorageWrite,  // compute
+            TransferSrc,
+            TransferDst,
+        };
+
+        // A transient image, created and aliased by the graph. Usage follows from how passes access it.
+        struct ImageDesc
+        {
+            VkFormat format = VK_FORMAT_UNDEFINED;
+            VkExtent2D extent{};
+        };
+
+        class PassBuilder
+        {
+        public:
+            // Attachments make the pass a raster pass, run inside a render pass over all of them
+            // with the viewport and scissor covering the first one. LOAD reads what earlier passes
+            // wrote, CLEAR and DONT_CARE replace it.
+            void colorAttachment(ImageHandle image, VkAttachmentLoadOp loadOp, VkClearColorValue clearValue = {});
+            void depthAttachment(
+                ImageHandle image, VkAttachmentLoadOp loadOp, VkClearDepthStencilValue clearValue = {1.f, 0});
+
+            // Writes besides attachments may leave parts of the resource untouched, so the passes
+            // that wrote it before are kept as long as a later pass needs it
+            void read(ImageHandle image, ImageAccess access);
+            void write(ImageHandle image, ImageAccess access);
+            void read(BufferHandle buffer, BufferAccess access);
+            void write(BufferHandle buffer, BufferAccess access);
+
+            // Keeps the pass even when nothing uses what it writes
+            void setSideEffect();
+
+        private:
+            friend class VhlRenderGraph;
+            PassBuilder(VhlRenderGraph& graph, uint32_t pass) : m_Graph{graph}, m_Pass{pass} {}
+
+            VhlRenderGraph& m_Graph;
+            uint32_t m_Pass;
+        };
+
+        using Setup = std::function<void(PassBuilder&)>;
+        using Execute = std::function<void(VkCommandBuffer)>;
+
+        struct Stats
+        {
+            uint32_t passes = 0;
+            uint32_t culledPasses = 0;
+            uint32_t barriers = 0;  // vkCmdPipelineBarrier calls
+            uint32_t imageBarriers = 0;
+            uint32_t bufferBarriers = 0;
+            uint32_t transientImages = 0;
+            VkDeviceSize transientBytes = 0;  // what the transient images would take on their own
+            VkDeviceSize allocatedBytes = 0;  // what they take aliased
+        };
+
+        VhlRenderGraph(VhlDevice& device, VhlGpuProfiler& gpuProfiler, uint32_t framesInFlight);
+        ~VhlRenderGraph();
+
+        VhlRenderGraph(const VhlRenderGraph&) = delete;
+        VhlRenderGraph& operator=(const VhlRenderGraph&) = delete;
+
+        // Forgets the previous declaration. Call once the fence of frameIndex's previous use has
+        // been waited on, its transient images and framebuffers are reused from here on.
+        void beginFrame(uint32_t frameIndex);
+
+        // Destroys every cached framebuffer. Call with the device idle before the views of
+        // imported images go away, e.g. when the swap chain is recreated.
+        void releaseFramebuffers();
+
+        ImageHandle createImage(const char* name, const ImageDesc& desc);
+        // An image owned elsewhere, e.g. by the swap chain. Its contents are kept unless
+        // initialLayout is UNDEFINED, and it is left in finalLayout after the frame.
+        ImageHandle importImage(
+            const char* name,
+            VkImage image,
+            VkImageView view,
+            VkFormat format,
+            VkExtent2D extent,
+            VkImageLayout initialLayout,
+            VkImageLayout finalLayout);
+        BufferHandle importBuffer(const char* name, VkBuffer buffer);
+
+        // Names are expected to be string literals, like GPU profiler scopes. setup runs right
+        // away, execute in execute() if the pass survives culling.
+        void addPass(const char* name, const Setup& setup, Execute execute);
+
+        void compile();
+        void execute(VkCommandBuffer commandBuffer);
+
+        // The image behind a handle, for passes that record transfers on it. Transient images only
+        // exist once compile() has placed them, so call it from a pass's execute.
+        VkImage getImage(ImageHandle image) const;
+
+        // Of the last compile()
+        const Stats& getStats() const { return m_Stats; }
+
+        // A single subpass render pass with these attachments, color first. Pipelines built
+        // against it can be used in any raster pass with the same formats.
+        VkRenderPass getRenderPass(const std::vector<VkFormat>& colorFormats, VkFormat depthFormat);
+
+    private:
+        struct Access
+        {
+            uint32_t resource;
+            bool image;
+            VkPipelineStageFlags stages;
+            VkAccessFlags access;
+            VkImageLayout layout;  // images only
+            bool reads;
+            bool writes;
+            bool discards;  // replaces all of the contents, only CLEAR and DONT_CARE attachments do
+        };
+
+        struct Attachment
+        {
+            uint32_t image;
+            VkAttachmentLoadOp loadOp;
+            VkClearValue clearValue;
+        };
+
+        struct Pass
+        {
+            const char* name;
+            Execute execute;
+            std::vector<Access> accesses;
+            std::vector<Attachment> colorAttachments;
+            Attachment depthAttachment{INVALID_RESOURCE, VK_ATTACHMENT_LOAD_OP_DONT_CARE, {}};
+            bool sideEffect = false;
+
+            // filled in by compile()
+            bool live = false;
+            std::vector<VkImageMemoryBarrier> imageBarriers;
+            std::vector<VkBufferMemoryBarrier> bufferBarriers;
+            VkPipelineStageFlags srcStages = 0;
+            VkPipelineStageFlags dstStages = 0;
+            VkRenderPass renderPass = VK_NULL_HANDLE;
+        };
+
+        struct Image
+        {
+            const char* name;
+            ImageDesc desc;
+            bool imported;
+            VkImage image = VK_NULL_HANDLE;
+            VkImageView view = VK_NULL_HANDLE;
+            VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            // filled in by compile()
+            VkImageUsageFlags usage = 0;
+            uint32_t firstPass = INVALID_RESOURCE;  // live passes only
+            uint32_t lastPass = 0;
+            uint32_t aliasedAfter = INVALID_RESOURCE;  // image that used the memory before, if any
+        };
+
+        struct Buffer
+        {
+            const char* name;
+            VkBuffer buffer;
+        };
+
+        // Synchronisation state of a resource while compile() walks the passes
+        struct ResourceState
+        {
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkPipelineStageFlags writeStages = 0;  // of the last write
+            VkAccessFlags writeAccess = 0;
+            VkPipelineStageFlags readStages = 0;  // reads since the last write
+            VkPipelineStageFlags visibleStages = 0;  // the last write has been made visible to these
+            VkAccessFlags visibleAccess = 0;
+        };
+
+        // A transient image, backed by memory it may share with others
+        struct PhysicalImage
+        {
+            VkImage image = VK_NULL_HANDLE;
+            VkImageView view = VK_NULL_HANDLE;
+            VkDeviceSize size = 0;
+            uint32_t block = 0;
+        };
+
+        struct MemoryBlock
+        {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize size = 0;
+            uint32_t memoryTypeBits = ~0u;
+            std::vector<uint32_t> images;  // transient indices in order of first use
+        };
+
+        struct CachedFramebuffer
+        {
+            VkRenderPass renderPass;
+            std::vector<VkImageView> views;
+            VkExtent2D extent;
+            VkFramebuffer framebuffer;
+        };
+
+        struct FrameResources
+        {
+            uint64_t signature = 0;  // of the transient images the resources were made for
+            std::vector<PhysicalImage> images;
+            std::vector<MemoryBlock> blocks;
+            // created by execute(), destroyed along with the transients or by releaseFramebuffers()
+            std::vector<CachedFramebuffer> framebuffers;
+        };
+
+        struct RenderPassEntry
+        {
+            std::vector<VkFormat> formats;
+            std::vector<VkAttachmentLoadOp> loadOps;
+            std::vector<VkAttachmentStoreOp> storeOps;
+            bool hasDepth;
+            VkRenderPass renderPass;
+        };
+
+        static bool isDepthFormat(VkFormat format);
+        static VkImageAspectFlags aspectMask(VkFormat format);
+
+        void addAccess(uint32_t pass, const Access& access);
+        void cullPasses();
+        void computeLifetimes();
+        void allocateTransients();
+        void destroyTransients(FrameResources& frame);
+        void destroyFramebuffers(FrameResources& frame);
+        void computeBarriers();
+        void transition(
+            Pass& pass, uint32_t resource, bool image, const Access& access, ResourceState& state,
+            const ResourceState* aliasedState);
+        void createRenderPasses();
+        VkRenderPass findRenderPass(
+            const std::vector<VkFormat>& formats,
+            const std::vector<VkAttachmentLoadOp>& loadOps,
+            const std::vector<VkAttachmentStoreOp>& storeOps,
+            bool hasDepth);
+        void beginRenderPass(VkCommandBuffer commandBuffer, const Pass& pass);
+        VkFramebuffer findFramebuffer(VkRenderPass renderPass, const std::vector<VkImageView>& views, VkExtent2D extent);
+        VkImageView imageView(uint32_t image) const;
+        VkImage imageHandle(uint32_t image) const;
+
+        VhlDevice& m_VhlDevice;
+        VhlGpuProfiler& m_GpuProfiler;
+
+        std::vector<Pass> m_Passes;
+        std::vector<Image> m_Images;
+        std::vector<Buffer> m_Buffers;
+        std::vector<uint32_t> m_Transients;  // image index of every live transient image
+        std::vector<uint32_t> m_TransientIndices;  // per image, index into m_Transients or INVALID_RESOURCE
+        // final transitions of imported images, recorded after the last pass
+        std::vector<VkImageMemoryBarrier> m_FinalBarriers;
+        VkPipelineStageFlags m_FinalSrcStages = 0;
+        bool m_Compiled = false;
+
+        std::vector<FrameResources> m_Frames;
+        uint32_t m_FrameIndex = 0;
+        std::vector<RenderPassEntry> m_RenderPasses;
+        Stats m_Stats{};
+    };
+}
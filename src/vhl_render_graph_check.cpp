@@ -0,0 +1,167 @@
+#include "vhl_render_graph_check.hpp"
+
+// std
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace vhl
+{
+    namespace
+    {
+        // what the clear attachment leaves in every texel of FORMAT
+        constexpr uint8_t EXPECTED_TEXEL[4] = {0, 255, 0, 255};
+
+        VkClearColorValue expectedColor()
+        {
+            VkClearColorValue color{};
+            color.float32[1] = 1.f;
+            color.float32[3] = 1.f;
+            return color;
+        }
+
+        VkImageSubresourceLayers colorLayers() { return {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1}; }
+
+        void clearImage(VkCommandBuffer commandBuffer, VkImage image)
+        {
+            // red, so a pass that should have been culled shows up in the pixels too
+            VkClearColorValue color{};
+            color.float32[0] = 1.f;
+            color.float32[3] = 1.f;
+            VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+            vkCmdClearColorImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &range);
+        }
+
+        void copyImage(VkCommandBuffer commandBuffer, VkImage src, VkImage dst)
+        {
+            VkImageCopy region{};
+            region.srcSubresource = colorLayers();
+            region.dstSubresource = colorLayers();
+            region.extent = {VhlRenderGraphCheck::SIZE, VhlRenderGraphCheck::SIZE, 1};
+            vkCmdCopyImage(
+                commandBuffer,
+                src, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1, &region);
+        }
+    }
+
+    VhlRenderGraphCheck::VhlRenderGraphCheck(VhlDevice& device)
+    {
+        m_Readback = std::make_unique<VhlBuffer>(
+            device,
+            sizeof(EXPECTED_TEXEL),
+            SIZE * SIZE,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        if (m_Readback->map() != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to map render graph check readback buffer!");
+        }
+    }
+
+    void VhlRenderGraphCheck::addPasses(VhlRenderGraph& graph)
+    {
+        using ImageAccess = VhlRenderGraph::ImageAccess;
+        using PassBuilder = VhlRenderGraph::PassBuilder;
+
+        const VhlRenderGraph::ImageDesc desc{FORMAT, {SIZE, SIZE}};
+        auto first = graph.createImage("graph check first", desc);
+        auto second = graph.createImage("graph check second", desc);
+        auto third = graph.createImage("graph check third", desc);
+        auto unused = graph.createImage("graph check unused", desc);
+        auto readback = graph.importBuffer("graph check readback", m_Readback->getBuffer());
+
+        // culled: the clear attachment of the next pass replaces all of it
+        graph.addPass(
+            "graph check overwritten",
+            [&](PassBuilder& pass) { pass.write(first, ImageAccess::TransferDst); },
+            [&graph, first](VkCommandBuffer commandBuffer) { clearImage(commandBuffer, graph.getImage(first)); });
+        graph.addPass(
+            "graph check clear",
+            [&](PassBuilder& pass) { pass.colorAttachment(first, VK_ATTACHMENT_LOAD_OP_CLEAR, expectedColor()); },
+            nullptr);
+        graph.addPass(
+            "graph check copy",
+            [&](PassBuilder& pass)
+            {
+                pass.read(first, ImageAccess::TransferSrc);
+                pass.write(second, ImageAccess::TransferDst);
+            },
+            [&graph, first, second](VkCommandBuffer commandBuffer)
+            { copyImage(commandBuffer, graph.getImage(first), graph.getImage(second)); });
+        // third is first used after first's last use, so the two share memory
+        graph.addPass(
+            "graph check copy again",
+            [&](PassBuilder& pass)
+            {
+                pass.read(second, ImageAccess::TransferSrc);
+                pass.write(third, ImageAccess::TransferDst);
+            },
+            [&graph, second, third](VkCommandBuffer commandBuffer)
+            { copyImage(commandBuffer, graph.getImage(second), graph.getImage(third)); });
+        graph.addPass(
+            "graph check readback",
+            [&](PassBuilder& pass)
+            {
+                pass.read(third, ImageAccess::TransferSrc);
+                pass.write(readback, VhlRenderGraph::BufferAccess::TransferDst);
+            },
+            [this, &graph, third](VkCommandBuffer commandBuffer)
+            {
+                VkBufferImageCopy region{};
+                region.imageSubresource = colorLayers();
+                region.imageExtent = {SIZE, SIZE, 1};
+                vkCmdCopyImageToBuffer(
+                    commandBuffer,
+                    graph.getImage(third),
+                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    m_Readback->getBuffer(),
+                    1,
+                    &region);
+
+                // verify() reads it on the host
+                VkMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+                vkCmdPipelineBarrier(
+                    commandBuffer,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    VK_PIPELINE_STAGE_HOST_BIT,
+                    0,
+                    1, &barrier,
+                    0, nullptr,
+                    0, nullptr);
+            });
+        // culled: nothing reads what it writes
+        graph.addPass(
+            "graph check unused",
+            [&](PassBuilder& pass) { pass.write(unused, ImageAccess::TransferDst); },
+            [&graph, unused](VkCommandBuffer commandBuffer) { clearImage(commandBuffer, graph.getImage(unused)); });
+    }
+
+    void VhlRenderGraphCheck::verify(const VhlRenderGraph::Stats& stats) const
+    {
+        if (stats.culledPasses != CULLED_PASSES)
+        {
+            throw std::runtime_error(
+                "render graph check failed: " + std::to_string(stats.culledPasses) + " passes culled instead of " +
+                std::to_string(CULLED_PASSES) + "!");
+        }
+        if (stats.allocatedBytes >= stats.transientBytes)
+        {
+            throw std::runtime_error("render graph check failed: no transient images share memory!");
+        }
+
+        const auto* texels = static_cast<const uint8_t*>(m_Readback->getMappedMemory());
+        for (uint32_t i = 0; i < SIZE * SIZE; i++)
+        {
+            if (std::memcmp(texels + i * sizeof(EXPECTED_TEXEL), EXPECTED_TEXEL, sizeof(EXPECTED_TEXEL)) != 0)
+            {
+                throw std::runtime_error(
+                    "render graph check failed: texel " + std::to_string(i) + " differs from the cleared color!");
+            }
+        }
+    }
+}
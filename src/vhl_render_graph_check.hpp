@@ -0,0 +1,38 @@
+#pragma once
+
+#include "vhl_buffer.hpp"
+#include "vhl_device.hpp"
+#include "vhl_render_graph.hpp"
+
+// std
+#include <memory>
+
+namespace vhl
+{
+    // Offscreen transfer passes that make a frame's render graph do what the swap chain pass alone
+    // never asks of it: cull a pass whose output a later CLEAR attachment replaces, cull a pass
+    // nothing reads, let transient images share memory and order several passes with barriers.
+    // The chain ends by copying a cleared image into a host visible buffer that verify() checks.
+    class VhlRenderGraphCheck
+    {
+    public:
+        static constexpr VkFormat FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+        static constexpr uint32_t SIZE = 64;
+        static constexpr uint32_t CULLED_PASSES = 2;
+
+        explicit VhlRenderGraphCheck(VhlDevice& device);
+
+        VhlRenderGraphCheck(const VhlRenderGraphCheck&) = delete;
+        VhlRenderGraphCheck& operator=(const VhlRenderGraphCheck&) = delete;
+
+        // Call every frame before the graph is compiled
+        void addPasses(VhlRenderGraph& graph);
+
+        // Call with the device idle after the last frame. Throws when the graph's stats or the
+        // copied pixels are not what the passes should have produced.
+        void verify(const VhlRenderGraph::Stats& stats) const;
+
+    private:
+        std::unique_ptr<VhlBuffer> m_Readback;
+    };
+}
@@ -0,0 +1,263 @@
+#include "vhl_render_queue.hpp"
+
+#include "vhl_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+
+namespace vhl
+{
+    namespace
+    {
+        constexpr uint32_t PIPELINE_BITS = 12;
+        constexpr uint32_t BINDINGS_BITS = 8;
+        constexpr uint32_t MATERIAL_BITS = 12;
+        constexpr uint32_t MODEL_BITS = 12;
+        constexpr uint32_t DEPTH_BITS = 16;
+
+        constexpr uint32_t DEPTH_SHIFT = 0;
+        constexpr uint32_t MODEL_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+        constexpr uint32_t MATERIAL_SHIFT = MODEL_SHIFT + MODEL_BITS;
+        constexpr uint32_t BINDINGS_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+        constexpr uint32_t PIPELINE_SHIFT = BINDINGS_SHIFT + BINDINGS_BITS;
+        constexpr uint32_t PASS_SHIFT = PIPELINE_SHIFT + PIPELINE_BITS;
+
+        // a wrapped value would spill into the neighbouring fields, so it is clamped instead. The
+        // draws sharing the clamped value may batch worse, flush() still compares the real state.
+        uint64_t field(uint64_t value, uint32_t bits, uint32_t shift, uint32_t& overflows)
+        {
+            uint64_t maxValue = (uint64_t{1} << bits) - 1;
+            if (value > maxValue)
+            {
+                overflows++;
+                value = maxValue;
+            }
+            return value << shift;
+        }
+
+        // The bit pattern of a non-negative float orders like the float itself, so its top bits
+        // are a cheap logarithmic depth bucket
+        uint64_t quantizeDepth(float depth)
+        {
+            if (!(depth > 0.f)) return 0;
+            uint32_t bits;
+            std::memcpy(&bits, &depth, sizeof(bits));
+            return bits >> (32 - DEPTH_BITS);
+        }
+    }
+
+    VhlRenderQueue::VhlRenderQueue(VhlDevice& device)
+        : m_MultiDrawIndirect(device.multiDrawIndirectSupported && device.properties.limits.maxDrawIndirectCount > 1),
+          m_MaxDrawIndirectCount(device.properties.limits.maxDrawIndirectCount)
+    {
+    }
+
+    uint32_t VhlRenderQueue::addDescriptorBindings(DescriptorBindings bindings)
+    {
+        m_DescriptorBindings.push_back(std::move(bindings));
+        return static_cast<uint32_t>(m_DescriptorBindings.size() - 1);
+    }
+
+    void VhlRenderQueue::submit(const DrawPacket& packet)
+    {
+        assert(packet.pipeline != nullptr && packet.model != nullptr && "Draw packet needs a pipeline and a model");
+        assert(packet.descriptorBindings < m_DescriptorBindings.size() && "Unknown descriptor bindings id");
+
+        m_Keys.push_back(makeSortKey(packet));
+        m_Packets.push_back(packet);
+    }
+
+    uint64_t VhlRenderQueue::makeSortKey(const DrawPacket& packet)
+    {
+        auto pipelineId = m_PipelineIds.emplace(packet.pipeline, static_cast<uint32_t>(m_PipelineIds.size())).first->second;
+        auto modelId = m_ModelIds.emplace(packet.model, static_cast<uint32_t>(m_ModelIds.size())).first->second;
+
+        uint64_t depth = quantizeDepth(packet.depth);
+        if (packet.pass == Pass::Translucent)
+        {
+            depth = ((uint64_t{1} << DEPTH_BITS) - 1) - depth;
+        }
+
+        return field(static_cast<uint64_t>(packet.pass), 4, PASS_SHIFT, m_KeyOverflows) |
+               field(pipelineId, PIPELINE_BITS, PIPELINE_SHIFT, m_KeyOverflows) |
+               field(packet.descriptorBindings, BINDINGS_BITS, BINDINGS_SHIFT, m_KeyOverflows) |
+               field(packet.material, MATERIAL_BITS, MATERIAL_SHIFT, m_KeyOverflows) |
+               field(modelId, MODEL_BITS, MODEL_SHIFT, m_KeyOverflows) |
+               field(depth, DEPTH_BITS, DEPTH_SHIFT, m_KeyOverflows);
+    }
+
+    // LSD radix sort of packet indices by key, one byte per pass. Passes where every key has the
+    // same byte are skipped, which with dense ids is most of the upper ones.
+    void VhlRenderQueue::sortPackets()
+    {
+        const size_t count = m_Keys.size();
+        m_Order.resize(count);
+        m_Scratch.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            m_Order[i] = i;
+        }
+
+        for (uint32_t shift = 0; shift < 64; shift += 8)
+        {
+            std::array<uint32_t, 256> histogram{};
+            for (uint32_t index : m_Order)
+            {
+                histogram[(m_Keys[index] >> shift) & 0xff]++;
+            }
+            if (histogram[(m_Keys[m_Order[0]] >> shift) & 0xff] == count) continue;
+
+            uint32_t sum = 0;
+            for (auto& bucket : histogram)
+            {
+                uint32_t bucketCount = bucket;
+                bucket = sum;
+                sum += bucketCount;
+            }
+            for (uint32_t index : m_Order)
+            {
+                m_Scratch[histogram[(m_Keys[index] >> shift) & 0xff]++] = index;
+            }
+            m_Order.swap(m_Scratch);
+        }
+    }
+
+    void VhlRenderQueue::flush(VkCommandBuffer commandBuffer, VhlUniformRing& uniformRing)
+    {
+        VHL_PROFILE_SCOPE("VhlRenderQueue::flush");
+        m_Stats = {};
+        m_Stats.keyOverflows = m_KeyOverflows;
+        if (m_Packets.empty())
+        {
+            clear();
+            return;
+        }
+
+        sortPackets();
+
+        VhlPipelineHandle* boundPipeline = nullptr;
+        bool pipelineUsable = false;
+        const DescriptorBindings* boundBindings = nullptr;
+        const VhlGeometryPool* boundGeometry = nullptr;
+
+        size_t begin = 0;
+        while (begin < m_Order.size())
+        {
+            const auto& packet = m_Packets[m_Order[begin]];
+
+            if (packet.pipeline != boundPipeline)
+            {
+                boundPipeline = packet.pipeline;
+                // a pipeline still compiling without fallback skips its draws
+                pipelineUsable = boundPipeline->bind(commandBuffer);
+                if (pipelineUsable) m_Stats.pipelineBinds++;
+            }
+            if (!pipelineUsable)
+            {
+                begin++;
+                continue;
+            }
+
+            const auto& bindings = m_DescriptorBindings[packet.descriptorBindings];
+            if (&bindings != boundBindings)
+            {
+                boundBindings = &bindings;
+                vkCmdBindDescriptorSets(
+                    commandBuffer,
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    bindings.pipelineLayout,
+                    bindings.firstSet,
+                    static_cast<uint32_t>(bindings.descriptorSets.size()),
+                    bindings.descriptorSets.data(),
+                    static_cast<uint32_t>(bindings.dynamicOffsets.size()),
+                    bindings.dynamicOffsets.data());
+                m_Stats.descriptorSetBinds++;
+            }
+
+            const auto* geometry = &packet.model->getGeometryPool();
+            if (geometry != boundGeometry)
+            {
+                boundGeometry = geometry;
+                packet.model->bind(commandBuffer);
+                m_Stats.vertexBufferBinds++;
+            }
+
+            // the run of packets that need no state change in between
+            size_t end = begin + 1;
+            while (end < m_Order.size())
+            {
+                const auto& next = m_Packets[m_Order[end]];
+                if (next.pipeline != packet.pipeline ||
+                    next.descriptorBindings != packet.descriptorBindings ||
+                    &next.model->getGeometryPool() != geometry) break;
+                end++;
+            }
+
+            recordDraws(commandBuffer, uniformRing, begin, end);
+            begin = end;
+        }
+
+        clear();
+    }
+
+    void VhlRenderQueue::recordDraws(VkCommandBuffer commandBuffer, VhlUniformRing& uniformRing, size_t begin, size_t end)
+    {
+        uint32_t count = static_cast<uint32_t>(end - begin);
+        m_Stats.draws += count;
+        for (size_t i = begin; i < end; i++)
+        {
+            m_Stats.triangles += m_Packets[m_Order[i]].model->getMeshRange().indexCount / 3;
+        }
+
+        if (!m_MultiDrawIndirect || count == 1)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                const auto& packet = m_Packets[m_Order[i]];
+                packet.model->draw(commandBuffer, packet.objectIndex);
+            }
+            m_Stats.drawCalls += count;
+            return;
+        }
+
+        auto block = uniformRing.allocate(count * sizeof(VkDrawIndexedIndirectCommand));
+        auto* commands = static_cast<VkDrawIndexedIndirectCommand*>(block.mapped);
+        for (size_t i = begin; i < end; i++)
+        {
+            const auto& packet = m_Packets[m_Order[i]];
+            const auto& range = packet.model->getMeshRange();
+
+            auto& command = commands[i - begin];
+            command.indexCount = range.indexCount;
+            command.instanceCount = 1;
+            command.firstIndex = range.firstIndex;
+            command.vertexOffset = range.vertexOffset;
+            command.firstInstance = packet.objectIndex;
+        }
+
+        for (uint32_t first = 0; first < count; first += m_MaxDrawIndirectCount)
+        {
+            uint32_t drawCount = std::min(count - first, m_MaxDrawIndirectCount);
+            vkCmdDrawIndexedIndirect(
+                commandBuffer,
+                uniformRing.getBuffer(),
+                block.offset + first * sizeof(VkDrawIndexedIndirectCommand),
+                drawCount,
+                sizeof(VkDrawIndexedIndirectCommand));
+            m_Stats.drawCalls++;
+        }
+    }
+
+    void VhlRenderQueue::clear()
+    {
+        m_Packets.clear();
+        m_Keys.clear();
+        m_DescriptorBindings.clear();
+        m_PipelineIds.clear();
+        m_ModelIds.clear();
+        m_KeyOverflows = 0;
+    }
+}
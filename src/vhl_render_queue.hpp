@@ -0,0 +1,104 @@
+#pragma once
+
+#include "vhl_device.hpp"
+#include "vhl_model.hpp"
+#include "vhl_pipeline_manager.hpp"
+#include "vhl_uniform_ring.hpp"
+
+// std
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace vhl
+{
+    // Collects the frame's draws, sorts them by a 64-bit key and records them while skipping
+    // pipeline, descriptor set and vertex/index buffer binds that would not change any state.
+    // Consecutive draws sharing pipeline, descriptor bindings and geometry pool are merged into
+    // one multi-draw indirect call when the device supports it.
+    //
+    // Key layout, most significant first:
+    //   pass (4) | pipeline (12) | descriptor bindings (8) | material (12) | model (12) | depth (16)
+    // Pipelines, descriptor bindings and models get dense ids in order of first use each frame.
+    // Values past a field's range are clamped to its maximum, costing batching but not correctness.
+    class VhlRenderQueue
+    {
+    public:
+        enum class Pass : uint8_t
+        {
+            Opaque = 0,       // front to back
+            Translucent = 1,  // back to front
+        };
+
+        // Everything bound for a group of draws besides the pipeline: sets from firstSet on, plus
+        // the dynamic offsets they need
+        struct DescriptorBindings
+        {
+            VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+            uint32_t firstSet = 0;
+            std::vector<VkDescriptorSet> descriptorSets{};
+            std::vector<uint32_t> dynamicOffsets{};
+        };
+
+        struct DrawPacket
+        {
+            Pass pass = Pass::Opaque;
+            VhlPipelineHandle* pipeline = nullptr;
+            uint32_t descriptorBindings = 0;  // id returned by addDescriptorBindings
+            uint32_t material = 0;
+            VhlModel* model = nullptr;
+            float depth = 0.f;  // distance from the camera
+
+            uint32_t objectIndex = 0;  // drawn as firstInstance, shaders read it as gl_InstanceIndex
+        };
+
+        struct Stats
+        {
+            uint32_t draws = 0;
+            uint32_t drawCalls = 0;  // vkCmdDraw* calls recorded for those draws
+            uint32_t pipelineBinds = 0;
+            uint32_t descriptorSetBinds = 0;
+            uint32_t vertexBufferBinds = 0;
+            uint64_t triangles = 0;
+            uint32_t keyOverflows = 0;  // key fields clamped because a frame had too many distinct values
+        };
+
+        explicit VhlRenderQueue(VhlDevice& device);
+
+        VhlRenderQueue(const VhlRenderQueue&) = delete;
+        VhlRenderQueue& operator=(const VhlRenderQueue&) = delete;
+
+        uint32_t addDescriptorBindings(DescriptorBindings bindings);
+        void submit(const DrawPacket& packet);
+
+        // Sorts and records everything submitted since the last flush, then empties the queue.
+        // Indirect commands are written into the frame's ring.
+        void flush(VkCommandBuffer commandBuffer, VhlUniformRing& uniformRing);
+
+        // Counters of the last flush
+        const Stats& getStats() const { return m_Stats; }
+
+    private:
+        uint64_t makeSortKey(const DrawPacket& packet);
+        void sortPackets();
+        void recordDraws(VkCommandBuffer commandBuffer, VhlUniformRing& uniformRing, size_t begin, size_t end);
+        void clear();
+
+        bool m_MultiDrawIndirect;
+        uint32_t m_MaxDrawIndirectCount;
+
+        std::vector<DrawPacket> m_Packets;
+        std::vector<DescriptorBindings> m_DescriptorBindings;
+        std::vector<uint64_t> m_Keys;
+
+        std::unordered_map<VhlPipelineHandle*, uint32_t> m_PipelineIds;
+        std::unordered_map<VhlModel*, uint32_t> m_ModelIds;
+        uint32_t m_KeyOverflows = 0;  // since the last flush
+
+        // radix sort scratch, kept to avoid reallocating every frame
+        std::vector<uint32_t> m_Order;
+        std::vector<uint32_t> m_Scratch;
+
+        Stats m_Stats{};
+    };
+}
@@ -0,0 +1,152 @@
+#include "vhl_render_stats.hpp"
+
+// std
+#include <array>
+#include <cassert>
+#include <iomanip>
+#include <stdexcept>
+
+namespace vhl
+{
+    // results come back in bit order: input primitives, vertex invocations, clipping primitives, fragment invocations
+    static constexpr VkQueryPipelineStatisticFlags PIPELINE_STATISTICS =
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+    static constexpr uint32_t PIPELINE_STATISTIC_COUNT = 4;
+
+    VhlRenderStats::VhlRenderStats(VhlDevice& device, uint32_t framesInFlight) : m_VhlDevice{device}
+    {
+        if (!m_VhlDevice.pipelineStatisticsQuerySupported) return;
+
+        m_Frames.resize(framesInFlight);
+        for (auto& frame : m_Frames)
+        {
+            VkQueryPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            poolInfo.queryCount = 1;
+            poolInfo.pipelineStatistics = PIPELINE_STATISTICS;
+
+            if (vkCreateQueryPool(m_VhlDevice.device(), &poolInfo, nullptr, &frame.pool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create pipeline statistics query pool!");
+            }
+        }
+    }
+
+    VhlRenderStats::~VhlRenderStats()
+    {
+        for (auto& frame : m_Frames)
+        {
+            vkDestroyQueryPool(m_VhlDevice.device(), frame.pool, nullptr);
+        }
+    }
+
+    void VhlRenderStats::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+    {
+        m_FrameNumber++;
+        m_Counters = {};
+
+        if (!isPipelineStatisticsSupported()) return;
+        assert(m_Recording == nullptr && "Can't begin a render stats frame while one is recording");
+        assert(frameIndex < m_Frames.size() && "Frame index out of range");
+
+        auto& frame = m_Frames[frameIndex];
+        resolve(frame);
+
+        frame.recorded = false;
+        frame.frameNumber = m_FrameNumber;
+        if (m_PipelineStatisticsEnabled)
+        {
+            // has to happen outside the render pass
+            vkCmdResetQueryPool(commandBuffer, frame.pool, 0, 1);
+            m_Recording = &frame;
+        }
+    }
+
+    void VhlRenderStats::endFrame()
+    {
+        assert(!m_PassQueryActive && "The pass must end before the frame");
+        m_LastCounters = m_Counters;
+        m_Recording = nullptr;
+    }
+
+    void VhlRenderStats::beginPass(VkCommandBuffer commandBuffer)
+    {
+        if (m_Recording == nullptr || m_Recording->recorded) return;
+
+        vkCmdBeginQuery(commandBuffer, m_Recording->pool, 0, 0);
+        m_PassQueryActive = true;
+    }
+
+    void VhlRenderStats::endPass(VkCommandBuffer commandBuffer)
+    {
+        if (!m_PassQueryActive) return;
+
+        vkCmdEndQuery(commandBuffer, m_Recording->pool, 0);
+        m_Recording->recorded = true;
+        m_PassQueryActive = false;
+    }
+
+    void VhlRenderStats::resolve(FrameQuery& frame)
+    {
+        if (!frame.recorded) return;
+
+        // the frame's fence has signalled, so the results are available without waiting
+        std::array<uint64_t, PIPELINE_STATISTIC_COUNT> results{};
+        VkResult result = vkGetQueryPoolResults(
+            m_VhlDevice.device(),
+            frame.pool,
+            0,
+            1,
+            sizeof(results),
+            results.data(),
+            sizeof(results),
+            VK_QUERY_RESULT_64_BIT);
+        if (result != VK_SUCCESS) return;
+
+        m_PipelineStatistics.frameNumber = frame.frameNumber;
+        m_PipelineStatistics.inputPrimitives = results[0];
+        m_PipelineStatistics.vertexInvocations = results[1];
+        m_PipelineStatistics.clippingPrimitives = results[2];
+        m_PipelineStatistics.fragmentInvocations = results[3];
+        m_HasPipelineStatistics = true;
+    }
+
+    VhlRenderStatsLogger::VhlRenderStatsLogger(const std::string& filepath) : m_File{filepath}
+    {
+        if (!m_File)
+        {
+            throw std::runtime_error("failed to open stats file: " + filepath);
+        }
+        m_File << "frame,cpu_ms,draw_calls,instances,triangles,pipeline_binds,descriptor_set_binds,"
+                  "push_constant_updates,buffer_binds,bytes_uploaded,gpu_frame,gpu_ms,input_primitives,"
+                  "vertex_invocations,clipping_primitives,fragment_invocations\n";
+        m_File << std::fixed << std::setprecision(4);
+    }
+
+    void VhlRenderStatsLogger::log(const VhlRenderStats& stats, float cpuFrameTime, float gpuFrameTime)
+    {
+        const auto& counters = stats.getLastCounters();
+        m_File << stats.getFrameNumber() << ',' << cpuFrameTime << ',' << counters.drawCalls << ',' << counters.instances << ','
+               << counters.triangles << ',' << counters.pipelineBinds << ',' << counters.descriptorSetBinds << ','
+               << counters.pushConstantUpdates << ',' << counters.bufferBinds << ',' << counters.bytesUploaded << ',';
+
+        if (stats.hasPipelineStatistics())
+        {
+            const auto& statistics = stats.getPipelineStatistics();
+            m_File << statistics.frameNumber << ',';
+            if (gpuFrameTime >= 0.f) m_File << gpuFrameTime;
+            m_File << ',' << statistics.inputPrimitives << ',' << statistics.vertexInvocations << ','
+                   << statistics.clippingPrimitives << ',' << statistics.fragmentInvocations << '\n';
+        }
+        else
+        {
+            m_File << ',';
+            if (gpuFrameTime >= 0.f) m_File << gpuFrameTime;
+            m_File << ",,,,\n";
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "vhl_device.hpp"
+
+// std
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace vhl
+{
+    // Per-frame counters of the work recorded on the CPU, filled in by VhlRenderer and the render
+    // systems while they record. When the device supports pipelineStatisticsQuery and it is
+    // enabled, the swap chain pass is also measured on the GPU with a pipeline statistics query;
+    // like VhlGpuProfiler every frame in flight has its own query, read back when that frame
+    // index comes around again, so those numbers arrive MAX_FRAMES_IN_FLIGHT frames late.
+    class VhlRenderStats
+    {
+    public:
+        struct Counters
+        {
+            uint32_t drawCalls = 0;  // vkCmdDraw* calls, a multi-draw indirect call counts once
+            uint32_t instances = 0;  // instances drawn by those calls
+            uint64_t triangles = 0;
+            uint32_t pipelineBinds = 0;
+            uint32_t descriptorSetBinds = 0;  // vkCmdBindDescriptorSets calls
+            uint32_t pushConstantUpdates = 0;
+            uint32_t bufferBinds = 0;  // vertex and index buffer binds
+            VkDeviceSize bytesUploaded = 0;  // uniform ring writes plus staging uploads submitted this frame
+        };
+
+        struct PipelineStatistics
+        {
+            uint64_t frameNumber = 0;  // frame the values were measured in
+            uint64_t inputPrimitives = 0;
+            uint64_t vertexInvocations = 0;
+            uint64_t clippingPrimitives = 0;  // primitives left after clipping
+            uint64_t fragmentInvocations = 0;
+        };
+
+        VhlRenderStats(VhlDevice& device, uint32_t framesInFlight);
+        ~VhlRenderStats();
+
+        VhlRenderStats(const VhlRenderStats&) = delete;
+        VhlRenderStats& operator=(const VhlRenderStats&) = delete;
+
+        bool isPipelineStatisticsSupported() const { return !m_Frames.empty(); }
+        // Off by default, the query can cost some GPU time on tilers. Takes effect on the next frame.
+        void setPipelineStatisticsEnabled(bool enabled) { m_PipelineStatisticsEnabled = enabled; }
+        bool isPipelineStatisticsEnabled() const { return m_PipelineStatisticsEnabled && isPipelineStatisticsSupported(); }
+
+        // Call right after recording starts, once the fence of frameIndex's previous use has been
+        // waited on. Collects that frame's query results and starts counting a new frame.
+        void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+        void endFrame();
+
+        // Around the swap chain render pass, inside it
+        void beginPass(VkCommandBuffer commandBuffer);
+        void endPass(VkCommandBuffer commandBuffer);
+
+        // The frame being recorded, systems add what they record
+        Counters& getCounters() { return m_Counters; }
+        // The last frame that went through endFrame()
+        const Counters& getLastCounters() const { return m_LastCounters; }
+        // Number of the frame being recorded or last recorded, counting beginFrame() calls from 1
+        uint64_t getFrameNumber() const { return m_FrameNumber; }
+
+        // False until a frame measured with the query has been read back
+        bool hasPipelineStatistics() const { return m_HasPipelineStatistics; }
+        const PipelineStatistics& getPipelineStatistics() const { return m_PipelineStatistics; }
+
+    private:
+        struct FrameQuery
+        {
+            VkQueryPool pool = VK_NULL_HANDLE;
+            uint64_t frameNumber = 0;
+            bool recorded = false;
+        };
+
+        void resolve(FrameQuery& frame);
+
+        VhlDevice& m_VhlDevice;
+        std::vector<FrameQuery> m_Frames;
+        FrameQuery* m_Recording = nullptr;
+        bool m_PipelineStatisticsEnabled = false;
+        bool m_PassQueryActive = false;
+
+        uint64_t m_FrameNumber = 0;
+        Counters m_Counters{};
+        Counters m_LastCounters{};
+
+        bool m_HasPipelineStatistics = false;
+        PipelineStatistics m_PipelineStatistics{};
+    };
+
+    // Writes one CSV row per frame: the frame's counters and CPU time, then the GPU time and
+    // pipeline statistics of the latest frame read back. gpu_frame holds that frame's number when
+    // pipeline statistics are recorded, GPU columns stay empty while nothing has been read back.
+    class VhlRenderStatsLogger
+    {
+    public:
+        explicit VhlRenderStatsLogger(const std::string& filepath);
+
+        VhlRenderStatsLogger(const VhlRenderStatsLogger&) = delete;
+        VhlRenderStatsLogger& operator=(const VhlRenderStatsLogger&) = delete;
+
+        // Call after endFrame(). cpuFrameTime and gpuFrameTime in ms, a negative gpuFrameTime is
+        // written as empty.
+        void log(const VhlRenderStats& stats, float cpuFrameTime, float gpuFrameTime);
+
+    private:
+        std::ofstream m_File;
+    };
+}
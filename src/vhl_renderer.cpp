@@ -1,8 +1,11 @@
 #include "vhl_renderer.hpp"
 
+#include "vhl_buffer.hpp"
+#include "vhl_profiler.hpp"
+
 // std
-#include <array>
 #include <cassert>
+#include <fstream>
 #include <stdexcept>
 
 namespace vhl {
@@ -12,6 +15,17 @@ namespace vhl {
     {
         recreateSwapChain();
         createCommandBuffers();
+
+        for (int i = 0; i < VhlSwapChain::MAX_FRAMES_IN_FLIGHT; i++) 
+        {
+            m_FrameDescriptorAllocators.push_back(std::make_unique<VhlDescriptorAllocator>(m_VhlDevice));
+        }
+        m_UniformRing = std::make_unique<VhlUniformRing>(
+            m_VhlDevice, UNIFORM_RING_BYTES_PER_FRAME, VhlSwapChain::MAX_FRAMES_IN_FLIGHT);
+        m_GpuProfiler = std::make_unique<VhlGpuProfiler>(m_VhlDevice, VhlSwapChain::MAX_FRAMES_IN_FLIGHT);
+        m_RenderStats = std::make_unique<VhlRenderStats>(m_VhlDevice, VhlSwapChain::MAX_FRAMES_IN_FLIGHT);
+        m_RenderGraph = std::make_unique<VhlRenderGraph>(
+            m_VhlDevice, *m_GpuProfiler, VhlSwapChain::MAX_FRAMES_IN_FLIGHT);
     }
 
     VhlRenderer::~VhlRenderer() { freeCommandBuffers(); }
@@ -25,6 +39,8 @@ namespace vhl {
             glfwWaitEvents();
         }
         vkDeviceWaitIdle(m_VhlDevice.device());
+        // cached framebuffers hold the old swap chain views, not created yet on the first call
+        if (m_RenderGraph != nullptr) m_RenderGraph->releaseFramebuffers();
 
         if (m_VhlSwapChain == nullptr) 
         {
@@ -71,6 +87,7 @@ namespace vhl {
 
     VkCommandBuffer VhlRenderer::beginFrame() 
     {
+        VHL_PROFILE_SCOPE("VhlRenderer::beginFrame");
         assert(!m_IsFrameStarted && "Can't call beginFrame while already in progress");
 
         auto result = m_VhlSwapChain->acquireNextImage(&m_CurrentImageIndex);
@@ -87,6 +104,22 @@ namespace vhl {
 
         m_IsFrameStarted = true;
 
+        // acquireNextImage waited on this frame's fence, so its previous sets, ring blocks and
+        // render graph resources are no longer in use
+        m_FrameDescriptorAllocators[m_CurrentFrameIndex]->resetPools();
+        m_UniformRing->beginFrame(m_CurrentFrameIndex);
+        m_RenderGraph->beginFrame(m_CurrentFrameIndex);
+
+        // presented, or read back by saveLastFrame when headless
+        m_SwapChainImage = m_RenderGraph->importImage(
+            "swap chain",
+            m_VhlSwapChain->getImage(m_CurrentImageIndex),
+            m_VhlSwapChain->getImageView(m_CurrentImageIndex),
+            m_VhlSwapChain->getSwapChainImageFormat(),
+            m_VhlSwapChain->getSwapChainExtent(),
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            m_VhlDevice.isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
         auto commandBuffer = getCurrentCommandBuffer();
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -95,13 +128,29 @@ namespace vhl {
         {
             throw std::runtime_error("failed to begin recording command buffer!");
         }
+
+        // reads back what this frame index recorded MAX_FRAMES_IN_FLIGHT frames ago
+        m_GpuProfiler->beginFrame(commandBuffer, m_CurrentFrameIndex);
+        m_GpuProfiler->beginScope(commandBuffer, FRAME_SCOPE);
+        m_RenderStats->beginFrame(commandBuffer, m_CurrentFrameIndex);
         return commandBuffer;
     }
 
     void VhlRenderer::endFrame() 
     {
+        VHL_PROFILE_SCOPE("VhlRenderer::endFrame");
         assert(m_IsFrameStarted && "Can't call endFrame while frame is not in progress");
         auto commandBuffer = getCurrentCommandBuffer();
+        {
+            VHL_PROFILE_SCOPE("render graph");
+            m_RenderGraph->compile();
+            m_RenderGraph->execute(commandBuffer);
+        }
+        m_GpuProfiler->endScope(commandBuffer);
+        m_GpuProfiler->endFrame();
+        // everything the frame wrote into the ring is read by the GPU
+        m_RenderStats->getCounters().bytesUploaded += m_UniformRing->getBytesUsed();
+        m_RenderStats->endFrame();
         if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) 
         {
             throw std::runtime_error("failed to record command buffer!");
@@ -123,48 +172,100 @@ namespace vhl {
         m_CurrentFrameIndex = (m_CurrentFrameIndex + 1) % VhlSwapChain::MAX_FRAMES_IN_FLIGHT;
     }
 
-    void VhlRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) 
+    void VhlRenderer::addSwapChainPass(std::function<void(VkCommandBuffer)> record)
     {
-        assert(m_IsFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
-        assert(
-            commandBuffer == getCurrentCommandBuffer() &&
-            "Can't begin render pass on command buffer from a different frame");
-
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = m_VhlSwapChain->getRenderPass();
-        renderPassInfo.framebuffer = m_VhlSwapChain->getFrameBuffer(m_CurrentImageIndex);
-
-        renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = m_VhlSwapChain->getSwapChainExtent();
-
-        std::array<VkClearValue, 2> clearValues{};
-        clearValues[0].color = {0.02f, 0.02f, 0.02f, 1.0f};
-        clearValues[1].depthStencil = {1.0f, 0};
-        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-        renderPassInfo.pClearValues = clearValues.data();
-
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = static_cast<float>(m_VhlSwapChain->getSwapChainExtent().width);
-        viewport.height = static_cast<float>(m_VhlSwapChain->getSwapChainExtent().height);
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        VkRect2D scissor{{0, 0}, m_VhlSwapChain->getSwapChainExtent()};
-        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        assert(m_IsFrameStarted && "Can't call addSwapChainPass if frame is not in progress");
+
+        auto depth = m_RenderGraph->createImage(
+            "depth", {m_VhlSwapChain->getDepthFormat(), m_VhlSwapChain->getSwapChainExtent()});
+        m_RenderGraph->addPass(
+            RENDER_PASS_SCOPE,
+            [&](VhlRenderGraph::PassBuilder& pass)
+            {
+                pass.colorAttachment(m_SwapChainImage, VK_ATTACHMENT_LOAD_OP_CLEAR, {{0.02f, 0.02f, 0.02f, 1.0f}});
+                pass.depthAttachment(depth, VK_ATTACHMENT_LOAD_OP_CLEAR);
+            },
+            [this, record = std::move(record)](VkCommandBuffer commandBuffer)
+            {
+                m_RenderStats->beginPass(commandBuffer);
+                record(commandBuffer);
+                m_RenderStats->endPass(commandBuffer);
+            });
     }
 
-    void VhlRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) 
+    void VhlRenderer::saveLastFrame(const std::string& filepath)
     {
-        assert(m_IsFrameStarted && "Can't call endSwapChainRenderPass if frame is not in progress");
-        assert(
-            commandBuffer == getCurrentCommandBuffer() &&
-            "Can't end render pass on command buffer from a different frame");
-        vkCmdEndRenderPass(commandBuffer);
+        assert(m_VhlDevice.isHeadless() && "Only offscreen images can be read back");
+        assert(!m_IsFrameStarted && "Can't save a frame while one is in progress");
+
+        vkDeviceWaitIdle(m_VhlDevice.device());
+
+        VkExtent2D extent = m_VhlSwapChain->getSwapChainExtent();
+        VkImage image = m_VhlSwapChain->getImage(m_CurrentImageIndex);
+
+        VhlBuffer readbackBuffer{
+            m_VhlDevice,
+            4,
+            extent.width * extent.height,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+
+        VkCommandBuffer commandBuffer = m_VhlDevice.beginSingleTimeCommands();
+
+        // the render graph left the image in TRANSFER_SRC_OPTIMAL, make its color writes visible to the copy
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {extent.width, extent.height, 1};
+        vkCmdCopyImageToBuffer(
+            commandBuffer,
+            image,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            readbackBuffer.getBuffer(),
+            1,
+            &region);
+
+        m_VhlDevice.endSingleTimeCommands(commandBuffer);
+
+        readbackBuffer.map();
+        auto pixels = static_cast<const uint8_t*>(readbackBuffer.getMappedMemory());
+        bool bgra = m_VhlSwapChain->getSwapChainImageFormat() == VK_FORMAT_B8G8R8A8_SRGB;
+
+        std::vector<uint8_t> rgb(static_cast<size_t>(extent.width) * extent.height * 3);
+        for (size_t i = 0; i < static_cast<size_t>(extent.width) * extent.height; i++)
+        {
+            rgb[i * 3 + 0] = pixels[i * 4 + (bgra ? 2 : 0)];
+            rgb[i * 3 + 1] = pixels[i * 4 + 1];
+            rgb[i * 3 + 2] = pixels[i * 4 + (bgra ? 0 : 2)];
+        }
+
+        std::ofstream file{filepath, std::ios::binary};
+        if (!file)
+        {
+            throw std::runtime_error("failed to open " + filepath + " for writing!");
+        }
+        file << "P6\n" << extent.width << " " << extent.height << "\n255\n";
+        file.write(reinterpret_cast<const char*>(rgb.data()), static_cast<std::streamsize>(rgb.size()));
     }
 
 }  // namespace Vhl
\ No newline at end of file
@@ -1,25 +1,40 @@
 #pragma once
 
+#include "vhl_descriptors.hpp"
 #include "vhl_device.hpp"
+#include "vhl_gpu_profiler.hpp"
+#include "vhl_render_graph.hpp"
+#include "vhl_render_stats.hpp"
 #include "vhl_swap_chain.hpp"
+#include "vhl_uniform_ring.hpp"
 #include "vhl_window.hpp"
 
 // std
 #include <cassert>
+#include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace vhl {
     class VhlRenderer {
     public:
+        static constexpr VkDeviceSize UNIFORM_RING_BYTES_PER_FRAME = 4 * 1024 * 1024;
+
         VhlRenderer(VhlWindow& window, VhlDevice& device);
         ~VhlRenderer();
 
         VhlRenderer(const VhlRenderer&) = delete;
         VhlRenderer& operator=(const VhlRenderer&) = delete;
 
-        VkRenderPass getSwapChainRenderPass() const { return m_VhlSwapChain->getRenderPass(); }
+        // Compatible with the pass addSwapChainPass() declares, for building pipelines
+        VkRenderPass getSwapChainRenderPass() const
+        {
+            return m_RenderGraph->getRenderPass(
+                {m_VhlSwapChain->getSwapChainImageFormat()}, m_VhlSwapChain->getDepthFormat());
+        }
         float getAspectRatio() const { return m_VhlSwapChain->extentAspectRatio(); }
+        VkExtent2D getSwapChainExtent() const { return m_VhlSwapChain->getSwapChainExtent(); }
         bool isFrameInProgress() const { return m_IsFrameStarted; }
 
         VkCommandBuffer getCurrentCommandBuffer() const 
@@ -34,10 +49,47 @@ namespace vhl {
             return m_CurrentFrameIndex;
         }
 
+        // Transient descriptor sets for the current frame, recycled when this frame index comes around again
+        VhlDescriptorAllocator& getFrameDescriptorAllocator() const 
+        {
+            assert(m_IsFrameStarted && "Cannot get frame descriptor allocator when frame not in progress");
+            return *m_FrameDescriptorAllocators[m_CurrentFrameIndex];
+        }
+
+        // Per-frame uniform/storage memory, rewound to this frame's region in beginFrame()
+        VhlUniformRing& getUniformRing() const { return *m_UniformRing; }
+
+        // Every frame is timed as FRAME_SCOPE and its swap chain render pass as RENDER_PASS_SCOPE,
+        // other render graph passes under their names, systems add their own scopes inside
+        static constexpr const char* FRAME_SCOPE = "frame";
+        static constexpr const char* RENDER_PASS_SCOPE = "swap chain pass";
+        VhlGpuProfiler& getGpuProfiler() const { return *m_GpuProfiler; }
+
+        // GPU time of the most recent frame whose results have come back, MAX_FRAMES_IN_FLIGHT
+        // frames behind. Negative until then or without timestamp support.
+        float getLastGpuFrameTime() const { return m_GpuProfiler->getLastTime(FRAME_SCOPE); }
+
+        // Draw and bind counters of the frame, systems add to getCounters() while recording. The
+        // swap chain pass is measured with pipeline statistics once they are enabled on it.
+        VhlRenderStats& getRenderStats() const { return *m_RenderStats; }
+
+        // Declared anew by every frame, beginFrame() imports the acquired swap chain image and
+        // endFrame() compiles and records the graph
+        VhlRenderGraph& getRenderGraph() const { return *m_RenderGraph; }
+        VhlRenderGraph::ImageHandle getSwapChainImage() const
+        {
+            assert(m_IsFrameStarted && "Cannot get swap chain image when frame not in progress");
+            return m_SwapChainImage;
+        }
+
         VkCommandBuffer beginFrame();
         void endFrame();
-        void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
-        void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
+        // Adds the pass drawing into the swap chain image, cleared along with a transient depth
+        // buffer. record runs in endFrame(), with the viewport and scissor set to the whole image.
+        void addSwapChainPass(std::function<void(VkCommandBuffer)> record);
+
+        // Headless only, waits for the device and writes the last submitted frame as a binary PPM
+        void saveLastFrame(const std::string& filepath);
 
     private:
         void createCommandBuffers();
@@ -48,6 +100,12 @@ namespace vhl {
         VhlDevice& m_VhlDevice;
         std::unique_ptr<VhlSwapChain> m_VhlSwapChain;
         std::vector<VkCommandBuffer> m_CommandBuffers;
+        std::vector<std::unique_ptr<VhlDescriptorAllocator>> m_FrameDescriptorAllocators;
+        std::unique_ptr<VhlUniformRing> m_UniformRing;
+        std::unique_ptr<VhlGpuProfiler> m_GpuProfiler;
+        std::unique_ptr<VhlRenderStats> m_RenderStats;
+        std::unique_ptr<VhlRenderGraph> m_RenderGraph;
+        VhlRenderGraph::ImageHandle m_SwapChainImage;
 
         uint32_t m_CurrentImageIndex;
         int m_CurrentFrameIndex{0};
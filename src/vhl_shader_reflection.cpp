@@ -0,0 +1,437 @@
+#include "vhl_shader_reflection.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace vhl
+{
+    namespace
+    {
+        // The handful of SPIR-V enumerants we need, from the SPIR-V specification
+        constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+        enum Op : uint32_t
+        {
+            OpTypeBool = 20,
+            OpTypeInt = 21,
+            OpTypeFloat = 22,
+            OpTypeVector = 23,
+            OpTypeMatrix = 24,
+            OpTypeImage = 25,
+            OpTypeSampler = 26,
+            OpTypeSampledImage = 27,
+            OpTypeArray = 28,
+            OpTypeRuntimeArray = 29,
+            OpTypeStruct = 30,
+            OpTypePointer = 32,
+            OpConstant = 43,
+            OpSpecConstant = 50,
+            OpVariable = 59,
+            OpDecorate = 71,
+            OpMemberDecorate = 72,
+        };
+
+        enum Decoration : uint32_t
+        {
+            DecorationBlock = 2,
+            DecorationBufferBlock = 3,
+            DecorationArrayStride = 6,
+            DecorationMatrixStride = 7,
+            DecorationBuiltIn = 11,
+            DecorationLocation = 30,
+            DecorationBinding = 33,
+            DecorationDescriptorSet = 34,
+            DecorationOffset = 35,
+        };
+
+        enum StorageClass : uint32_t
+        {
+            StorageClassUniformConstant = 0,
+            StorageClassInput = 1,
+            StorageClassUniform = 2,
+            StorageClassPushConstant = 9,
+            StorageClassStorageBuffer = 12,
+        };
+
+        constexpr uint32_t DIM_BUFFER = 5;
+        constexpr uint32_t DIM_SUBPASS_DATA = 6;
+
+        struct Decorations
+        {
+            std::unordered_map<uint32_t, uint32_t> values;                     // decoration -> first literal
+            std::vector<std::unordered_map<uint32_t, uint32_t>> memberValues;  // per struct member
+
+            bool has(uint32_t decoration) const { return values.count(decoration) != 0; }
+            uint32_t get(uint32_t decoration, uint32_t fallback = 0) const
+            {
+                auto it = values.find(decoration);
+                return it == values.end() ? fallback : it->second;
+            }
+            uint32_t getMember(uint32_t member, uint32_t decoration, uint32_t fallback = 0) const
+            {
+                if (member >= memberValues.size()) return fallback;
+                auto it = memberValues[member].find(decoration);
+                return it == memberValues[member].end() ? fallback : it->second;
+            }
+        };
+
+        struct Variable
+        {
+            uint32_t id;
+            uint32_t pointerType;
+            uint32_t storageClass;
+        };
+
+        class SpirvModule
+        {
+        public:
+            explicit SpirvModule(const std::vector<char>& code)
+            {
+                if (code.size() < 5 * sizeof(uint32_t) || code.size() % sizeof(uint32_t) != 0)
+                {
+                    throw std::runtime_error("failed to reflect shader: not a SPIR-V module!");
+                }
+                m_Words.resize(code.size() / sizeof(uint32_t));
+                std::memcpy(m_Words.data(), code.data(), code.size());
+                if (m_Words[0] != SPIRV_MAGIC)
+                {
+                    throw std::runtime_error("failed to reflect shader: bad SPIR-V magic number!");
+                }
+                parse();
+            }
+
+            const std::vector<Variable>& variables() const { return m_Variables; }
+
+            const std::vector<uint32_t>& type(uint32_t id) const
+            {
+                auto it = m_Types.find(id);
+                if (it == m_Types.end())
+                {
+                    throw std::runtime_error("failed to reflect shader: unknown SPIR-V type id!");
+                }
+                return it->second;
+            }
+
+            const Decorations& decorations(uint32_t id) const
+            {
+                static const Decorations none{};
+                auto it = m_Decorations.find(id);
+                return it == m_Decorations.end() ? none : it->second;
+            }
+
+            uint32_t constant(uint32_t id) const
+            {
+                auto it = m_Constants.find(id);
+                if (it == m_Constants.end())
+                {
+                    throw std::runtime_error("failed to reflect shader: array length is not a constant!");
+                }
+                return it->second;
+            }
+
+            // Byte size of a type as laid out in a block, using the explicit strides glslang emits
+            uint32_t sizeOf(uint32_t typeId, uint32_t matrixStride = 0) const
+            {
+                const auto& t = type(typeId);
+                switch (t[0])
+                {
+                    case OpTypeBool: return 4;
+                    case OpTypeInt:
+                    case OpTypeFloat: return t[1] / 8;
+                    case OpTypeVector: return t[2] * sizeOf(t[1]);
+                    case OpTypeMatrix: return t[2] * (matrixStride != 0 ? matrixStride : sizeOf(t[1]));
+                    case OpTypeArray:
+                    {
+                        uint32_t stride = decorations(typeId).get(DecorationArrayStride);
+                        if (stride == 0) stride = sizeOf(t[1], matrixStride);
+                        return constant(t[2]) * stride;
+                    }
+                    case OpTypeRuntimeArray: return 0;
+                    case OpTypeStruct: return structExtent(typeId).second;
+                    default: return 0;
+                }
+            }
+
+            // [first member offset, end of last member) of a block
+            std::pair<uint32_t, uint32_t> structExtent(uint32_t structId) const
+            {
+                const auto& t = type(structId);
+                const auto& deco = decorations(structId);
+                uint32_t begin = UINT32_MAX;
+                uint32_t end = 0;
+                for (uint32_t member = 0; member + 1 < t.size(); member++)
+                {
+                    uint32_t offset = deco.getMember(member, DecorationOffset);
+                    uint32_t stride = deco.getMember(member, DecorationMatrixStride);
+                    begin = std::min(begin, offset);
+                    end = std::max(end, offset + sizeOf(t[member + 1], stride));
+                }
+                return {begin == UINT32_MAX ? 0 : begin, end};
+            }
+
+        private:
+            void parse()
+            {
+                size_t i = 5;
+                while (i < m_Words.size())
+                {
+                    uint32_t wordCount = m_Words[i] >> 16;
+                    uint32_t opcode = m_Words[i] & 0xffff;
+                    if (wordCount == 0 || i + wordCount > m_Words.size())
+                    {
+                        throw std::runtime_error("failed to reflect shader: truncated SPIR-V instruction!");
+                    }
+                    const uint32_t* operands = &m_Words[i + 1];
+                    uint32_t operandCount = wordCount - 1;
+
+                    switch (opcode)
+                    {
+                        case OpDecorate:
+                            if (operandCount >= 2)
+                            {
+                                m_Decorations[operands[0]].values[operands[1]] = operandCount >= 3 ? operands[2] : 1;
+                            }
+                            break;
+                        case OpMemberDecorate:
+                            if (operandCount >= 3)
+                            {
+                                auto& members = m_Decorations[operands[0]].memberValues;
+                                if (members.size() <= operands[1]) members.resize(operands[1] + 1);
+                                members[operands[1]][operands[2]] = operandCount >= 4 ? operands[3] : 1;
+                            }
+                            break;
+                        case OpConstant:
+                        case OpSpecConstant:
+                            if (operandCount >= 3) m_Constants[operands[1]] = operands[2];
+                            break;
+                        case OpVariable:
+                            m_Variables.push_back({operands[1], operands[0], operands[2]});
+                            break;
+                        default:
+                            if (opcode >= OpTypeBool && opcode <= OpTypePointer && operandCount >= 1)
+                            {
+                                // stored as {opcode, operands after the result id...}
+                                std::vector<uint32_t> t{opcode};
+                                t.insert(t.end(), operands + 1, operands + operandCount);
+                                m_Types[operands[0]] = std::move(t);
+                            }
+                            break;
+                    }
+                    i += wordCount;
+                }
+            }
+
+            std::vector<uint32_t> m_Words;
+            std::unordered_map<uint32_t, std::vector<uint32_t>> m_Types;
+            std::unordered_map<uint32_t, Decorations> m_Decorations;
+            std::unordered_map<uint32_t, uint32_t> m_Constants;
+            std::vector<Variable> m_Variables;
+        };
+
+        VkFormat vertexInputFormat(const SpirvModule& module, uint32_t typeId, uint32_t& size)
+        {
+            const auto& t = module.type(typeId);
+            uint32_t componentCount = 1;
+            uint32_t componentType = typeId;
+            if (t[0] == OpTypeVector)
+            {
+                componentType = t[1];
+                componentCount = t[2];
+            }
+
+            const auto& c = module.type(componentType);
+            if ((c[0] != OpTypeFloat && c[0] != OpTypeInt) || c[1] != 32 || componentCount > 4)
+            {
+                throw std::runtime_error("failed to reflect shader: unsupported vertex input type!");
+            }
+            size = 4 * componentCount;
+
+            static const VkFormat floatFormats[] = {
+                VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+            static const VkFormat intFormats[] = {
+                VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+            static const VkFormat uintFormats[] = {
+                VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+
+            if (c[0] == OpTypeFloat) return floatFormats[componentCount - 1];
+            return c[2] != 0 ? intFormats[componentCount - 1] : uintFormats[componentCount - 1];
+        }
+
+        VkDescriptorType descriptorTypeOf(const SpirvModule& module, uint32_t typeId, uint32_t storageClass)
+        {
+            const auto& t = module.type(typeId);
+            if (storageClass == StorageClassStorageBuffer) return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            if (storageClass == StorageClassUniform)
+            {
+                return module.decorations(typeId).has(DecorationBufferBlock) ?
+                    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            }
+
+            switch (t[0])
+            {
+                case OpTypeSampler: return VK_DESCRIPTOR_TYPE_SAMPLER;
+                case OpTypeSampledImage: return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                case OpTypeImage:
+                {
+                    uint32_t dim = t[2];
+                    uint32_t sampled = t[6];
+                    if (dim == DIM_BUFFER)
+                    {
+                        return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+                    }
+                    if (dim == DIM_SUBPASS_DATA) return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+                    return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+                }
+                default:
+                    throw std::runtime_error("failed to reflect shader: unsupported descriptor type!");
+            }
+        }
+    }
+
+    ShaderReflection ShaderReflection::reflect(const std::vector<char>& spirv, VkShaderStageFlagBits stage)
+    {
+        SpirvModule module{spirv};
+        ShaderReflection reflection{};
+
+        for (const auto& variable : module.variables())
+        {
+            const auto& pointer = module.type(variable.pointerType);
+            uint32_t pointeeType = pointer[2];
+            const auto& deco = module.decorations(variable.id);
+
+            switch (variable.storageClass)
+            {
+                case StorageClassInput:
+                {
+                    // gl_VertexIndex and friends carry BuiltIn instead of a location
+                    if (stage != VK_SHADER_STAGE_VERTEX_BIT || !deco.has(DecorationLocation)) break;
+                    if (deco.has(DecorationBuiltIn)) break;
+
+                    VertexInput input{};
+                    input.location = deco.get(DecorationLocation);
+                    input.format = vertexInputFormat(module, pointeeType, input.size);
+                    reflection.vertexInputs.push_back(input);
+                    break;
+                }
+                case StorageClassPushConstant:
+                {
+                    auto extent = module.structExtent(pointeeType);
+                    reflection.pushConstantRange.stageFlags = stage;
+                    reflection.pushConstantRange.offset = extent.first;
+                    reflection.pushConstantRange.size = extent.second - extent.first;
+                    break;
+                }
+                case StorageClassUniformConstant:
+                case StorageClassUniform:
+                case StorageClassStorageBuffer:
+                {
+                    DescriptorBinding binding{};
+                    binding.set = deco.get(DecorationDescriptorSet);
+                    binding.binding = deco.get(DecorationBinding);
+                    binding.descriptorCount = 1;
+                    binding.stageFlags = stage;
+
+                    uint32_t resourceType = pointeeType;
+                    const auto& t = module.type(resourceType);
+                    if (t[0] == OpTypeArray)
+                    {
+                        binding.descriptorCount = module.constant(t[2]);
+                        resourceType = t[1];
+                    }
+                    else if (t[0] == OpTypeRuntimeArray)
+                    {
+                        binding.descriptorCount = 0;
+                        resourceType = t[1];
+                    }
+                    binding.descriptorType = descriptorTypeOf(module, resourceType, variable.storageClass);
+                    reflection.descriptorBindings.push_back(binding);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(),
+            [](const auto& a, const auto& b) { return a.location < b.location; });
+        return reflection;
+    }
+
+    void ShaderReflection::merge(const ShaderReflection& other)
+    {
+        for (const auto& binding : other.descriptorBindings)
+        {
+            auto it = std::find_if(descriptorBindings.begin(), descriptorBindings.end(),
+                [&](const auto& b) { return b.set == binding.set && b.binding == binding.binding; });
+            if (it == descriptorBindings.end())
+            {
+                descriptorBindings.push_back(binding);
+                continue;
+            }
+            assert(it->descriptorType == binding.descriptorType && "Shader stages disagree on a descriptor type");
+            it->stageFlags |= binding.stageFlags;
+            // a runtime sized array in either stage leaves the binding unbounded
+            if (it->descriptorCount != 0)
+            {
+                it->descriptorCount =
+                    binding.descriptorCount == 0 ? 0 : std::max(it->descriptorCount, binding.descriptorCount);
+            }
+        }
+
+        if (other.pushConstantRange.size != 0)
+        {
+            if (pushConstantRange.size == 0)
+            {
+                pushConstantRange = other.pushConstantRange;
+            }
+            else
+            {
+                uint32_t begin = std::min(pushConstantRange.offset, other.pushConstantRange.offset);
+                uint32_t end = std::max(
+                    pushConstantRange.offset + pushConstantRange.size,
+                    other.pushConstantRange.offset + other.pushConstantRange.size);
+                pushConstantRange.stageFlags |= other.pushConstantRange.stageFlags;
+                pushConstantRange.offset = begin;
+                pushConstantRange.size = end - begin;
+            }
+        }
+
+        if (vertexInputs.empty())
+        {
+            vertexInputs = other.vertexInputs;
+        }
+    }
+
+    uint32_t ShaderReflection::setCount() const
+    {
+        uint32_t count = 0;
+        for (const auto& binding : descriptorBindings)
+        {
+            count = std::max(count, binding.set + 1);
+        }
+        return count;
+    }
+
+    std::vector<VkDescriptorSetLayoutBinding> ShaderReflection::getSetBindings(uint32_t set) const
+    {
+        std::vector<VkDescriptorSetLayoutBinding> bindings{};
+        for (const auto& binding : descriptorBindings)
+        {
+            if (binding.set != set) continue;
+
+            VkDescriptorSetLayoutBinding layoutBinding{};
+            layoutBinding.binding = binding.binding;
+            layoutBinding.descriptorType = binding.descriptorType;
+            layoutBinding.descriptorCount = binding.descriptorCount;
+            layoutBinding.stageFlags = binding.stageFlags;
+            bindings.push_back(layoutBinding);
+        }
+        std::sort(bindings.begin(), bindings.end(),
+            [](const auto& a, const auto& b) { return a.binding < b.binding; });
+        return bindings;
+    }
+}
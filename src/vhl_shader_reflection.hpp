@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace vhl
+{
+    // Interface of a shader module as read from its SPIR-V: what it binds, what it pushes and
+    // which vertex attributes it consumes. Only the subset of SPIR-V glslang emits for graphics
+    // shaders is understood.
+    struct ShaderReflection
+    {
+        struct DescriptorBinding
+        {
+            uint32_t set;
+            uint32_t binding;
+            VkDescriptorType descriptorType;
+            uint32_t descriptorCount;  // 0 for runtime sized arrays
+            VkShaderStageFlags stageFlags;
+        };
+
+        struct VertexInput
+        {
+            uint32_t location;
+            VkFormat format;
+            uint32_t size;
+        };
+
+        std::vector<DescriptorBinding> descriptorBindings{};
+        std::vector<VertexInput> vertexInputs{};
+        VkPushConstantRange pushConstantRange{};  // size == 0 when there is no push constant block
+
+        static ShaderReflection reflect(const std::vector<char>& spirv, VkShaderStageFlagBits stage);
+
+        // Folds another stage into this one: bindings are unioned by set/binding with the larger
+        // array size, or 0 when either stage sizes it at runtime, push constant ranges merged into
+        // one range covering both stages, vertex inputs kept from either.
+        void merge(const ShaderReflection& other);
+
+        uint32_t setCount() const;
+        std::vector<VkDescriptorSetLayoutBinding> getSetBindings(uint32_t set) const;
+    };
+}
@@ -0,0 +1,193 @@
+#include "vhl_shader_watcher.hpp"
+
+#include "vhl_profiler.hpp"
+
+// std
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace vhl
+{
+    namespace
+    {
+        // quiet period after the last event before compiling, editors often write a file in bursts
+        constexpr int DEBOUNCE_MS = 100;
+        constexpr auto POLL_INTERVAL = std::chrono::milliseconds(250);
+    }
+
+    VhlShaderWatcher::VhlShaderWatcher(const std::string& shaderDirectory, const std::string& compiler)
+        : m_ShaderDirectory(shaderDirectory), m_Compiler(compiler)
+    {
+        if (!std::filesystem::is_directory(m_ShaderDirectory))
+        {
+            throw std::runtime_error("failed to watch shader directory: " + shaderDirectory);
+        }
+
+#ifdef __linux__
+        m_InotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_InotifyFd < 0 ||
+            inotify_add_watch(m_InotifyFd, shaderDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        {
+            if (m_InotifyFd >= 0) close(m_InotifyFd);
+            throw std::runtime_error("failed to set up inotify for " + shaderDirectory + "!");
+        }
+#else
+        std::unordered_set<std::string> ignored;
+        pollChanges(ignored);
+#endif
+
+        m_Thread = std::thread(&VhlShaderWatcher::watchLoop, this);
+    }
+
+    VhlShaderWatcher::~VhlShaderWatcher()
+    {
+        m_Running.store(false);
+        m_Thread.join();
+
+#ifdef __linux__
+        close(m_InotifyFd);
+#endif
+    }
+
+    std::string VhlShaderWatcher::defaultCompiler()
+    {
+#ifdef VHL_GLSLANG_VALIDATOR
+        return VHL_GLSLANG_VALIDATOR;
+#else
+        return "glslangValidator";
+#endif
+    }
+
+    std::vector<std::string> VhlShaderWatcher::takeRecompiled()
+    {
+        std::vector<std::string> recompiled;
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        recompiled.swap(m_Recompiled);
+        return recompiled;
+    }
+
+    bool VhlShaderWatcher::isShaderSource(const std::filesystem::path& path)
+    {
+        // same stages the CMake shader target compiles
+        static const std::unordered_set<std::string> extensions{
+            ".vert", ".frag", ".comp", ".geom", ".tesc", ".tese", ".mesh", ".task", ".rgen", ".rchit", ".rmiss"};
+        return extensions.count(path.extension().string()) != 0;
+    }
+
+    void VhlShaderWatcher::watchLoop()
+    {
+        VHL_PROFILE_THREAD("shader watcher");
+        std::unordered_set<std::string> changed;
+        while (m_Running.load())
+        {
+            if (!waitForChanges(changed)) continue;
+
+            for (const auto& sourceName : changed)
+            {
+                if (compile(sourceName))
+                {
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    m_Recompiled.push_back((m_ShaderDirectory / (sourceName + ".spv")).generic_string());
+                }
+            }
+            changed.clear();
+        }
+    }
+
+    // Returns true once a burst of changes has settled and `changed` holds the sources to compile
+    bool VhlShaderWatcher::waitForChanges(std::unordered_set<std::string>& changed)
+    {
+#ifdef __linux__
+        pollfd pfd{};
+        pfd.fd = m_InotifyFd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, DEBOUNCE_MS) <= 0)
+        {
+            return !changed.empty();
+        }
+
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(m_InotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* ptr = buffer; ptr < buffer + length;)
+            {
+                auto* event = reinterpret_cast<const inotify_event*>(ptr);
+                if (event->len > 0 && isShaderSource(event->name))
+                {
+                    changed.insert(event->name);
+                }
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+        return false;
+#else
+        std::this_thread::sleep_for(POLL_INTERVAL);
+        pollChanges(changed);
+        return !changed.empty();
+#endif
+    }
+
+    void VhlShaderWatcher::pollChanges(std::unordered_set<std::string>& changed)
+    {
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(m_ShaderDirectory, error))
+        {
+            if (!entry.is_regular_file() || !isShaderSource(entry.path())) continue;
+
+            auto name = entry.path().filename().string();
+            auto writeTime = entry.last_write_time(error);
+            if (error) continue;
+
+            auto it = m_Timestamps.find(name);
+            if (it == m_Timestamps.end())
+            {
+                m_Timestamps.emplace(name, writeTime);
+            }
+            else if (it->second != writeTime)
+            {
+                it->second = writeTime;
+                changed.insert(name);
+            }
+        }
+    }
+
+    bool VhlShaderWatcher::compile(const std::string& sourceName)
+    {
+        auto source = (m_ShaderDirectory / sourceName).string();
+        auto spvPath = (m_ShaderDirectory / (sourceName + ".spv")).string();
+        auto tempPath = spvPath + ".tmp";
+
+        // compile next to the target and rename, so a reader never sees a half written module
+        std::string command = "\"" + m_Compiler + "\" -V \"" + source + "\" -o \"" + tempPath + "\"";
+#ifdef _WIN32
+        // cmd.exe strips the outer pair of quotes
+        command = "\"" + command + "\"";
+#endif
+        std::cout << "recompiling " << source << std::endl;
+        if (std::system(command.c_str()) != 0)
+        {
+            std::cerr << "failed to compile " << source << ", keeping the previous SPIR-V" << std::endl;
+            std::error_code error;
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, spvPath, error);
+        if (error)
+        {
+            std::cerr << "failed to replace " << spvPath << ": " << error.message() << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace vhl
+{
+    // Watches a directory of GLSL sources and recompiles changed files to <source>.spv on a
+    // background thread. Uses inotify on Linux and falls back to polling timestamps elsewhere.
+    class VhlShaderWatcher
+    {
+    public:
+        VhlShaderWatcher(const std::string& shaderDirectory, const std::string& compiler = defaultCompiler());
+        ~VhlShaderWatcher();
+
+        VhlShaderWatcher(const VhlShaderWatcher&) = delete;
+        VhlShaderWatcher& operator=(const VhlShaderWatcher&) = delete;
+
+        // SPIR-V paths that were successfully recompiled since the last call, in the same
+        // "<directory>/<name>.spv" form the pipelines were created with
+        std::vector<std::string> takeRecompiled();
+
+        static std::string defaultCompiler();
+
+    private:
+        static bool isShaderSource(const std::filesystem::path& path);
+
+        void watchLoop();
+        bool waitForChanges(std::unordered_set<std::string>& changed);
+        void pollChanges(std::unordered_set<std::string>& changed);
+        bool compile(const std::string& sourceName);
+
+        std::filesystem::path m_ShaderDirectory;
+        std::string m_Compiler;
+
+        std::atomic<bool> m_Running{true};
+        std::thread m_Thread;
+
+        std::mutex m_Mutex;
+        std::vector<std::string> m_Recompiled;
+
+        int m_InotifyFd = -1;
+        std::unordered_map<std::string, std::filesystem::file_time_type> m_Timestamps;
+    };
+}
@@ -1,7 +1,8 @@
 #include "vhl_swap_chain.hpp"
 
+#include "vhl_profiler.hpp"
+
 // std
-#include <array>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -27,11 +28,16 @@ namespace vhl {
 
     void VhlSwapChain::init()
     {
-        createSwapChain();
+        if (m_VhlDevice.isHeadless())
+        {
+            createOffscreenImages();
+        }
+        else
+        {
+            createSwapChain();
+        }
         createImageViews();
-        createRenderPass();
-        createDepthResources();
-        createFramebuffers();
+        m_SwapChainDepthFormat = findDepthFormat();
         createSyncObjects();
     }
 
@@ -48,20 +54,12 @@ namespace vhl {
             m_SwapChain = nullptr;
         }
 
-        for (int i = 0; i < m_DepthImages.size(); i++) 
+        for (size_t i = 0; i < m_OffscreenImageMemorys.size(); i++) 
         {
-            vkDestroyImageView(m_VhlDevice.device(), m_DepthImageViews[i], nullptr);
-            vkDestroyImage(m_VhlDevice.device(), m_DepthImages[i], nullptr);
-            vkFreeMemory(m_VhlDevice.device(), m_DepthImageMemorys[i], nullptr);
+            vkDestroyImage(m_VhlDevice.device(), m_SwapChainImages[i], nullptr);
+            m_VhlDevice.freeMemory(m_OffscreenImageMemorys[i]);
         }
 
-        for (auto framebuffer : m_SwapChainFramebuffers) 
-        {
-            vkDestroyFramebuffer(m_VhlDevice.device(), framebuffer, nullptr);
-        }
-
-        vkDestroyRenderPass(m_VhlDevice.device(), m_RenderPass, nullptr);
-
         // cleanup synchronization objects
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) 
         {
@@ -73,13 +71,24 @@ namespace vhl {
 
     VkResult VhlSwapChain::acquireNextImage(uint32_t* imageIndex) 
     {
-        vkWaitForFences(
-            m_VhlDevice.device(),
-            1,
-            &m_InFlightFences[m_CurrentFrame],
-            VK_TRUE,
-            std::numeric_limits<uint64_t>::max());
+        {
+            VHL_PROFILE_SCOPE("wait for frame fence");
+            vkWaitForFences(
+                m_VhlDevice.device(),
+                1,
+                &m_InFlightFences[m_CurrentFrame],
+                VK_TRUE,
+                std::numeric_limits<uint64_t>::max());
+        }
 
+        if (m_VhlDevice.isHeadless())
+        {
+            // one offscreen image per frame in flight, free again once that frame's fence signalled
+            *imageIndex = static_cast<uint32_t>(m_CurrentFrame);
+            return VK_SUCCESS;
+        }
+
+        VHL_PROFILE_SCOPE("acquire image");
         VkResult result = vkAcquireNextImageKHR(
             m_VhlDevice.device(),
             m_SwapChain,
@@ -96,6 +105,7 @@ namespace vhl {
     {
         if (m_ImagesInFlight[*imageIndex] != VK_NULL_HANDLE) 
         {
+            VHL_PROFILE_SCOPE("wait for image fence");
             vkWaitForFences(m_VhlDevice.device(), 1, &m_ImagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
         }
         m_ImagesInFlight[*imageIndex] = m_InFlightFences[m_CurrentFrame];
@@ -116,11 +126,27 @@ namespace vhl {
         submitInfo.signalSemaphoreCount = 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
+        if (m_VhlDevice.isHeadless())
+        {
+            // nothing to acquire from or present to
+            submitInfo.waitSemaphoreCount = 0;
+            submitInfo.signalSemaphoreCount = 0;
+        }
+
         vkResetFences(m_VhlDevice.device(), 1, &m_InFlightFences[m_CurrentFrame]);
-        if (vkQueueSubmit(m_VhlDevice.graphicsQueue(), 1, &submitInfo, m_InFlightFences[m_CurrentFrame]) !=
-            VK_SUCCESS) 
         {
-            throw std::runtime_error("failed to submit draw command buffer!");
+            VHL_PROFILE_SCOPE("queue submit");
+            if (vkQueueSubmit(m_VhlDevice.graphicsQueue(), 1, &submitInfo, m_InFlightFences[m_CurrentFrame]) !=
+                VK_SUCCESS) 
+            {
+                throw std::runtime_error("failed to submit draw command buffer!");
+            }
+        }
+
+        if (m_VhlDevice.isHeadless())
+        {
+            m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+            return VK_SUCCESS;
         }
 
         VkPresentInfoKHR presentInfo = {};
@@ -135,6 +161,7 @@ namespace vhl {
 
         presentInfo.pImageIndices = imageIndex;
 
+        VHL_PROFILE_SCOPE("present");
         auto result = vkQueuePresentKHR(m_VhlDevice.presentQueue(), &presentInfo);
 
         m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
@@ -209,144 +236,30 @@ namespace vhl {
         m_SwapChainExtent = extent;
     }
 
-    void VhlSwapChain::createImageViews() 
-    {
-        m_SwapChainImageViews.resize(m_SwapChainImages.size());
-        for (size_t i = 0; i < m_SwapChainImages.size(); i++) 
-        {
-            VkImageViewCreateInfo viewInfo{};
-            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-            viewInfo.image = m_SwapChainImages[i];
-            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-            viewInfo.format = m_SwapChainImageFormat;
-            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            viewInfo.subresourceRange.baseMipLevel = 0;
-            viewInfo.subresourceRange.levelCount = 1;
-            viewInfo.subresourceRange.baseArrayLayer = 0;
-            viewInfo.subresourceRange.layerCount = 1;
-
-            if (vkCreateImageView(m_VhlDevice.device(), &viewInfo, nullptr, &m_SwapChainImageViews[i]) != VK_SUCCESS) 
-            {
-                throw std::runtime_error("failed to create texture image view!");
-            }
-        }
-    }
-
-    void VhlSwapChain::createRenderPass() 
+    void VhlSwapChain::createOffscreenImages()
     {
-        VkAttachmentDescription depthAttachment{};
-        depthAttachment.format = findDepthFormat();
-        depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-        depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-        VkAttachmentReference depthAttachmentRef{};
-        depthAttachmentRef.attachment = 1;
-        depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-        VkAttachmentDescription colorAttachment = {};
-        colorAttachment.format = getSwapChainImageFormat();
-        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-        VkAttachmentReference colorAttachmentRef = {};
-        colorAttachmentRef.attachment = 0;
-        colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-        VkSubpassDescription subpass = {};
-        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-        subpass.colorAttachmentCount = 1;
-        subpass.pColorAttachments = &colorAttachmentRef;
-        subpass.pDepthStencilAttachment = &depthAttachmentRef;
-
-        VkSubpassDependency dependency = {};
-        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        dependency.srcAccessMask = 0;
-        dependency.srcStageMask =
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        dependency.dstSubpass = 0;
-        dependency.dstStageMask =
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        dependency.dstAccessMask =
-            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-        std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
-        VkRenderPassCreateInfo renderPassInfo = {};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-        renderPassInfo.pAttachments = attachments.data();
-        renderPassInfo.subpassCount = 1;
-        renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
-
-        if (vkCreateRenderPass(m_VhlDevice.device(), &renderPassInfo, nullptr, &m_RenderPass) != VK_SUCCESS) 
-        {
-            throw std::runtime_error("failed to create render pass!");
-        }
-    }
-
-    void VhlSwapChain::createFramebuffers() 
-    {
-        m_SwapChainFramebuffers.resize(imageCount());
-        for (size_t i = 0; i < imageCount(); i++) 
-        {
-            std::array<VkImageView, 2> attachments = { m_SwapChainImageViews[i], m_DepthImageViews[i] };
-
-            VkExtent2D swapChainExtent = getSwapChainExtent();
-            VkFramebufferCreateInfo framebufferInfo = {};
-            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            framebufferInfo.renderPass = m_RenderPass;
-            framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-            framebufferInfo.pAttachments = attachments.data();
-            framebufferInfo.width = swapChainExtent.width;
-            framebufferInfo.height = swapChainExtent.height;
-            framebufferInfo.layers = 1;
-
-            if (vkCreateFramebuffer(
-                m_VhlDevice.device(),
-                &framebufferInfo,
-                nullptr,
-                &m_SwapChainFramebuffers[i]) != VK_SUCCESS) 
-            {
-                throw std::runtime_error("failed to create framebuffer!");
-            }
-        }
-    }
-
-    void VhlSwapChain::createDepthResources() 
-    {
-        VkFormat depthFormat = findDepthFormat();
-        m_SwapChainDepthFormat = depthFormat;
-        VkExtent2D swapChainExtent = getSwapChainExtent();
+        VkFormat format = m_VhlDevice.findSupportedFormat(
+            {VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB},
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT);
 
-        m_DepthImages.resize(imageCount());
-        m_DepthImageMemorys.resize(imageCount());
-        m_DepthImageViews.resize(imageCount());
+        m_SwapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+        m_OffscreenImageMemorys.resize(MAX_FRAMES_IN_FLIGHT);
 
-        for (int i = 0; i < m_DepthImages.size(); i++) 
+        for (size_t i = 0; i < m_SwapChainImages.size(); i++) 
         {
             VkImageCreateInfo imageInfo{};
             imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
             imageInfo.imageType = VK_IMAGE_TYPE_2D;
-            imageInfo.extent.width = swapChainExtent.width;
-            imageInfo.extent.height = swapChainExtent.height;
+            imageInfo.extent.width = m_WindowExtent.width;
+            imageInfo.extent.height = m_WindowExtent.height;
             imageInfo.extent.depth = 1;
             imageInfo.mipLevels = 1;
             imageInfo.arrayLayers = 1;
-            imageInfo.format = depthFormat;
+            imageInfo.format = format;
             imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
             imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+            imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
             imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
             imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
             imageInfo.flags = 0;
@@ -354,21 +267,31 @@ namespace vhl {
             m_VhlDevice.createImageWithInfo(
                 imageInfo,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                m_DepthImages[i],
-                m_DepthImageMemorys[i]);
+                m_SwapChainImages[i],
+                m_OffscreenImageMemorys[i]);
+        }
+
+        m_SwapChainImageFormat = format;
+        m_SwapChainExtent = m_WindowExtent;
+    }
 
+    void VhlSwapChain::createImageViews() 
+    {
+        m_SwapChainImageViews.resize(m_SwapChainImages.size());
+        for (size_t i = 0; i < m_SwapChainImages.size(); i++) 
+        {
             VkImageViewCreateInfo viewInfo{};
             viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-            viewInfo.image = m_DepthImages[i];
+            viewInfo.image = m_SwapChainImages[i];
             viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-            viewInfo.format = depthFormat;
-            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+            viewInfo.format = m_SwapChainImageFormat;
+            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
             viewInfo.subresourceRange.baseMipLevel = 0;
             viewInfo.subresourceRange.levelCount = 1;
             viewInfo.subresourceRange.baseArrayLayer = 0;
             viewInfo.subresourceRange.layerCount = 1;
 
-            if (vkCreateImageView(m_VhlDevice.device(), &viewInfo, nullptr, &m_DepthImageViews[i]) != VK_SUCCESS) 
+            if (vkCreateImageView(m_VhlDevice.device(), &viewInfo, nullptr, &m_SwapChainImageViews[i]) != VK_SUCCESS) 
             {
                 throw std::runtime_error("failed to create texture image view!");
             }
@@ -13,6 +13,9 @@
 namespace vhl 
 {
 
+    // Images and their presentation only, render passes and depth buffers come from the renderer's
+    // render graph. On a headless device the swap chain owns plain offscreen color images instead, one
+    // per frame in flight, which the graph leaves in TRANSFER_SRC_OPTIMAL so they can be read back
     class VhlSwapChain {
     public:
         static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
@@ -24,11 +27,11 @@ namespace vhl
         VhlSwapChain(const VhlSwapChain&) = delete;
         VhlSwapChain& operator=(const VhlSwapChain&) = delete;
 
-        VkFramebuffer getFrameBuffer(int index) { return m_SwapChainFramebuffers[index]; }
-        VkRenderPass getRenderPass() { return m_RenderPass; }
         VkImageView getImageView(int index) { return m_SwapChainImageViews[index]; }
+        VkImage getImage(int index) { return m_SwapChainImages[index]; }
         size_t imageCount() { return m_SwapChainImages.size(); }
         VkFormat getSwapChainImageFormat() { return m_SwapChainImageFormat; }
+        VkFormat getDepthFormat() { return m_SwapChainDepthFormat; }
         VkExtent2D getSwapChainExtent() { return m_SwapChainExtent; }
         uint32_t width() { return m_SwapChainExtent.width; }
         uint32_t height() { return m_SwapChainExtent.height; }
@@ -50,10 +53,8 @@ namespace vhl
     private:
         void init();
         void createSwapChain();
+        void createOffscreenImages();
         void createImageViews();
-        void createDepthResources();
-        void createRenderPass();
-        void createFramebuffers();
         void createSyncObjects();
 
         // Helper functions
@@ -67,19 +68,14 @@ namespace vhl
         VkFormat m_SwapChainDepthFormat;
         VkExtent2D m_SwapChainExtent;
 
-        std::vector<VkFramebuffer> m_SwapChainFramebuffers;
-        VkRenderPass m_RenderPass;
-
-        std::vector<VkImage> m_DepthImages;
-        std::vector<VkDeviceMemory> m_DepthImageMemorys;
-        std::vector<VkImageView> m_DepthImageViews;
         std::vector<VkImage> m_SwapChainImages;
+        std::vector<VkDeviceMemory> m_OffscreenImageMemorys;  // headless only, swapchain images are owned by the swapchain
         std::vector<VkImageView> m_SwapChainImageViews;
 
         VhlDevice& m_VhlDevice;
         VkExtent2D m_WindowExtent;
 
-        VkSwapchainKHR m_SwapChain;
+        VkSwapchainKHR m_SwapChain = VK_NULL_HANDLE;
         std::shared_ptr<VhlSwapChain> m_OldSwapChain;
 
         std::vector<VkSemaphore> m_ImageAvailableSemaphores;
@@ -0,0 +1,398 @@
+#include "vhl_texture.hpp"
+
+#include "vhl_mapped_file.hpp"
+#include "vhl_texture_container.hpp"
+
+// libs
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+namespace vhl
+{
+    VhlTexture::VhlTexture(
+        VhlDevice& device, VhlBindlessTable& bindlessTable, uint32_t width, uint32_t height, VkFormat format, uint32_t mipLevels)
+        : m_VhlDevice(device),
+          m_BindlessTable(bindlessTable),
+          m_Width(width),
+          m_Height(height),
+          m_MipLevels(mipLevels),
+          m_Format(format)
+    {
+        assert(width > 0 && height > 0 && "Texture cannot be empty");
+        assert(mipLevels >= 1 && mipLevels <= mipLevelCount(width, height) && "Invalid texture mip level count");
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = m_Format;
+        imageInfo.extent = {m_Width, m_Height, 1};
+        imageInfo.mipLevels = m_MipLevels;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        // transfer source for the mip blits
+        imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        m_VhlDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_Image, m_ImageMemory);
+
+        createImageView();
+        createSampler();
+
+        // nothing samples the slot before the upload has been submitted
+        m_BindlessIndex = m_BindlessTable.addSampledImage(descriptorInfo());
+    }
+
+    VhlTexture::~VhlTexture()
+    {
+        m_BindlessTable.releaseSampledImage(m_BindlessIndex);
+        vkDestroySampler(m_VhlDevice.device(), m_Sampler, nullptr);
+        vkDestroyImageView(m_VhlDevice.device(), m_ImageView, nullptr);
+        vkDestroyImage(m_VhlDevice.device(), m_Image, nullptr);
+        m_VhlDevice.freeMemory(m_ImageMemory);
+    }
+
+    std::unique_ptr<VhlTexture> VhlTexture::createTextureFromFile(
+        VhlDevice& device, VhlBindlessTable& bindlessTable, const std::string& filepath)
+    {
+        StagedTexture staged = stageFile(device, filepath);
+
+        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+        auto texture = createFromStaged(device, bindlessTable, staged, commandBuffer);
+        device.endSingleTimeCommands(commandBuffer);
+
+        return texture;
+    }
+
+    std::unique_ptr<VhlTexture> VhlTexture::createSolidColor(VhlDevice& device, VhlBindlessTable& bindlessTable, uint32_t rgba)
+    {
+        return createFromPixels(device, bindlessTable, 1, 1, &rgba);
+    }
+
+    std::unique_ptr<VhlTexture> VhlTexture::createFromPixels(
+        VhlDevice& device, VhlBindlessTable& bindlessTable, uint32_t width, uint32_t height, const void* pixels, VkFormat format)
+    {
+        VhlBuffer stagingBuffer{
+            device,
+            4 * static_cast<VkDeviceSize>(width) * height,
+            1,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        };
+        stagingBuffer.map();
+        stagingBuffer.writeToBuffer(const_cast<void*>(pixels));
+
+        auto texture = std::make_unique<VhlTexture>(device, bindlessTable, width, height, format, 1);
+
+        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+        texture->recordUploadAndGenerateMips(commandBuffer, stagingBuffer.getBuffer());
+        device.endSingleTimeCommands(commandBuffer);
+
+        return texture;
+    }
+
+    VhlTexture::StagedTexture VhlTexture::stageFile(VhlDevice& device, const std::string& filepath)
+    {
+        StagedTexture staged{};
+
+        if (std::filesystem::path(filepath).extension() == texture_container::FILE_EXTENSION)
+        {
+            VhlMappedFile file{filepath};
+            texture_container::Header header;
+            std::vector<texture_container::Level> levels;
+            if (const char* error = texture_container::read(file.data(), file.size(), header, levels))
+            {
+                throw std::runtime_error("failed to read texture container " + filepath + ": " + error);
+            }
+
+            staged.format = static_cast<VkFormat>(header.vkFormat);
+            if (!canSample(device, staged.format))
+            {
+                throw std::runtime_error("failed to load texture " + filepath + ": format not supported by the device");
+            }
+            if (header.levelCount > mipLevelCount(header.pixelWidth, header.pixelHeight))
+            {
+                throw std::runtime_error("failed to load texture " + filepath + ": too many levels");
+            }
+
+            // the levels are already laid out for the copy, so the file goes up as is
+            staged.stagingBuffer = std::make_unique<VhlBuffer>(
+                device,
+                file.size(),
+                1,
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            if (staged.stagingBuffer->map() != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to map staging buffer");
+            }
+            std::memcpy(staged.stagingBuffer->getMappedMemory(), file.data(), file.size());
+            staged.stagingBuffer->unmap();
+
+            staged.width = header.pixelWidth;
+            staged.height = header.pixelHeight;
+            for (const auto& level : levels)
+            {
+                staged.levelOffsets.push_back(level.byteOffset);
+            }
+            return staged;
+        }
+
+        int width, height, channels;
+        stbi_uc* pixels = stbi_load(filepath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (pixels == nullptr)
+        {
+            throw std::runtime_error("failed to load texture " + filepath + ": " + stbi_failure_reason());
+        }
+
+        try
+        {
+            VkDeviceSize imageSize = static_cast<VkDeviceSize>(width) * height * 4;
+            staged.stagingBuffer = std::make_unique<VhlBuffer>(
+                device,
+                imageSize,
+                1,
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            if (staged.stagingBuffer->map() != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to map staging buffer");
+            }
+            staged.stagingBuffer->writeToBuffer(pixels, imageSize);
+            staged.stagingBuffer->unmap();
+        }
+        catch (...)
+        {
+            stbi_image_free(pixels);
+            throw;
+        }
+        stbi_image_free(pixels);
+
+        staged.width = static_cast<uint32_t>(width);
+        staged.height = static_cast<uint32_t>(height);
+        staged.format = VK_FORMAT_R8G8B8A8_SRGB;
+        return staged;
+    }
+
+    std::unique_ptr<VhlTexture> VhlTexture::createFromStaged(
+        VhlDevice& device, VhlBindlessTable& bindlessTable, const StagedTexture& staged, VkCommandBuffer commandBuffer)
+    {
+        assert(staged.stagingBuffer != nullptr && "Cannot create a texture without staged texels");
+
+        if (!staged.levelOffsets.empty())
+        {
+            auto texture = std::make_unique<VhlTexture>(
+                device, bindlessTable, staged.width, staged.height, staged.format, static_cast<uint32_t>(staged.levelOffsets.size()));
+            texture->recordUploadLevels(commandBuffer, staged.stagingBuffer->getBuffer(), staged.levelOffsets);
+            return texture;
+        }
+
+        uint32_t mipLevels = canGenerateMips(device, staged.format) ? mipLevelCount(staged.width, staged.height) : 1;
+        auto texture = std::make_unique<VhlTexture>(device, bindlessTable, staged.width, staged.height, staged.format, mipLevels);
+        texture->recordUploadAndGenerateMips(commandBuffer, staged.stagingBuffer->getBuffer());
+        return texture;
+    }
+
+    uint32_t VhlTexture::mipLevelCount(uint32_t width, uint32_t height)
+    {
+        uint32_t levels = 1;
+        for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+        {
+            levels++;
+        }
+        return levels;
+    }
+
+    bool VhlTexture::canGenerateMips(VhlDevice& device, VkFormat format)
+    {
+        auto formatProperties = device.getFormatProperties(format);
+        VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+            VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (formatProperties.optimalTilingFeatures & required) == required;
+    }
+
+    bool VhlTexture::canSample(VhlDevice& device, VkFormat format)
+    {
+        bool blockCompressed = format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+        if (blockCompressed && !device.textureCompressionBCSupported) return false;
+
+        auto formatProperties = device.getFormatProperties(format);
+        return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+    }
+
+    void VhlTexture::recordUploadAndGenerateMips(VkCommandBuffer commandBuffer, VkBuffer srcBuffer)
+    {
+        recordLayoutTransition(
+            commandBuffer, 0, m_MipLevels,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            0, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {m_Width, m_Height, 1};
+        vkCmdCopyBufferToImage(commandBuffer, srcBuffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        // each level is blitted from the one above it, which is moved to TRANSFER_SRC first
+        int32_t mipWidth = static_cast<int32_t>(m_Width);
+        int32_t mipHeight = static_cast<int32_t>(m_Height);
+        for (uint32_t level = 1; level < m_MipLevels; level++)
+        {
+            recordLayoutTransition(
+                commandBuffer, level - 1, 1,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+            int32_t nextWidth = std::max(mipWidth / 2, 1);
+            int32_t nextHeight = std::max(mipHeight / 2, 1);
+
+            VkImageBlit blit{};
+            blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1};
+            blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+            blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+            blit.dstOffsets[1] = {nextWidth, nextHeight, 1};
+            vkCmdBlitImage(
+                commandBuffer,
+                m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1, &blit,
+                VK_FILTER_LINEAR);
+
+            recordLayoutTransition(
+                commandBuffer, level - 1, 1,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+            mipWidth = nextWidth;
+            mipHeight = nextHeight;
+        }
+
+        // the last level was only ever written
+        recordLayoutTransition(
+            commandBuffer, m_MipLevels - 1, 1,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    }
+
+    void VhlTexture::recordUploadLevels(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, const std::vector<VkDeviceSize>& levelOffsets)
+    {
+        assert(levelOffsets.size() == m_MipLevels && "Every texture level needs an offset");
+
+        recordLayoutTransition(
+            commandBuffer, 0, m_MipLevels,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            0, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        // zero row length and image height mean tightly packed, in blocks for compressed formats
+        std::vector<VkBufferImageCopy> regions(m_MipLevels);
+        for (uint32_t level = 0; level < m_MipLevels; level++)
+        {
+            auto& region = regions[level];
+            region.bufferOffset = levelOffsets[level];
+            region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+            region.imageExtent = {std::max(m_Width >> level, 1u), std::max(m_Height >> level, 1u), 1};
+        }
+        vkCmdCopyBufferToImage(
+            commandBuffer,
+            srcBuffer,
+            m_Image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(regions.size()),
+            regions.data());
+
+        recordLayoutTransition(
+            commandBuffer, 0, m_MipLevels,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    }
+
+    VkDescriptorImageInfo VhlTexture::descriptorInfo() const
+    {
+        return VkDescriptorImageInfo{m_Sampler, m_ImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    }
+
+    void VhlTexture::createImageView()
+    {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = m_Image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = m_Format;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = m_MipLevels;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(m_VhlDevice.device(), &viewInfo, nullptr, &m_ImageView) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create texture image view!");
+        }
+    }
+
+    void VhlTexture::createSampler()
+    {
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        // samplerAnisotropy is required by isDeviceSuitable
+        samplerInfo.anisotropyEnable = VK_TRUE;
+        samplerInfo.maxAnisotropy = m_VhlDevice.properties.limits.maxSamplerAnisotropy;
+        samplerInfo.compareEnable = VK_FALSE;
+        samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+        samplerInfo.minLod = 0.f;
+        samplerInfo.maxLod = static_cast<float>(m_MipLevels);
+        samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+        samplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+        if (vkCreateSampler(m_VhlDevice.device(), &samplerInfo, nullptr, &m_Sampler) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create texture sampler!");
+        }
+    }
+
+    void VhlTexture::recordLayoutTransition(
+        VkCommandBuffer commandBuffer,
+        uint32_t baseMipLevel,
+        uint32_t levelCount,
+        VkImageLayout oldLayout,
+        VkImageLayout newLayout,
+        VkAccessFlags srcAccessMask,
+        VkAccessFlags dstAccessMask,
+        VkPipelineStageFlags srcStage,
+        VkPipelineStageFlags dstStage)
+    {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = m_Image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, baseMipLevel, levelCount, 0, 1};
+        barrier.srcAccessMask = srcAccessMask;
+        barrier.dstAccessMask = dstAccessMask;
+
+        vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+}
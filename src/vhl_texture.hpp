@@ -0,0 +1,109 @@
+#pragma once
+
+#include "vhl_bindless_table.hpp"
+#include "vhl_buffer.hpp"
+#include "vhl_device.hpp"
+
+// std
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vhl
+{
+    // A sampled 2D image with its full mip chain, view and anisotropic sampler. Every texture
+    // owns a slot in the bindless table, so shaders address it by getBindlessIndex().
+    class VhlTexture
+    {
+    public:
+        // Texel data of a texture waiting in a staging buffer for its upload
+        struct StagedTexture
+        {
+            std::unique_ptr<VhlBuffer> stagingBuffer;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            VkFormat format = VK_FORMAT_UNDEFINED;
+            // offset of every precomputed level in the staging buffer, empty when only mip 0 was staged
+            std::vector<VkDeviceSize> levelOffsets;
+        };
+
+        // The image is left undefined until one of the record* calls has been submitted
+        VhlTexture(VhlDevice& device, VhlBindlessTable& bindlessTable, uint32_t width, uint32_t height, VkFormat format, uint32_t mipLevels);
+        ~VhlTexture();
+
+        VhlTexture(const VhlTexture&) = delete;
+        VhlTexture& operator=(const VhlTexture&) = delete;
+
+        // Decodes and uploads synchronously, waiting on the graphics queue
+        static std::unique_ptr<VhlTexture> createTextureFromFile(VhlDevice& device, VhlBindlessTable& bindlessTable, const std::string& filepath);
+        // 1x1 texture, e.g. the white default for untextured objects; rgba is packed R in the low byte
+        static std::unique_ptr<VhlTexture> createSolidColor(VhlDevice& device, VhlBindlessTable& bindlessTable, uint32_t rgba);
+        // Single level texture from tightly packed RGBA8 texels, uploaded synchronously. For images
+        // drawn at their own size such as a UI font atlas, which want a UNORM format.
+        static std::unique_ptr<VhlTexture> createFromPixels(
+            VhlDevice& device,
+            VhlBindlessTable& bindlessTable,
+            uint32_t width,
+            uint32_t height,
+            const void* pixels,
+            VkFormat format = VK_FORMAT_R8G8B8A8_SRGB);
+
+        // Decodes an image to RGBA8 with stb_image, or memory-maps a cooked .vtex container (see
+        // vhl_texture_container.hpp) and copies it into the staging buffer as is. Throws on failure,
+        // safe to call from worker threads.
+        static StagedTexture stageFile(VhlDevice& device, const std::string& filepath);
+        // Creates the texture for staged texels and records their upload into commandBuffer
+        static std::unique_ptr<VhlTexture> createFromStaged(
+            VhlDevice& device, VhlBindlessTable& bindlessTable, const StagedTexture& staged, VkCommandBuffer commandBuffer);
+
+        static uint32_t mipLevelCount(uint32_t width, uint32_t height);
+        // Blitting the chain needs blit src/dst and linear filtering support for the format with optimal tiling
+        static bool canGenerateMips(VhlDevice& device, VkFormat format);
+        // Block compressed formats also need the textureCompressionBC feature
+        static bool canSample(VhlDevice& device, VkFormat format);
+
+        // Copies mip 0 from tightly packed RGBA8 texels at the start of srcBuffer, blits the rest
+        // of the chain down from it and leaves every level ready for sampling
+        void recordUploadAndGenerateMips(VkCommandBuffer commandBuffer, VkBuffer srcBuffer);
+        // Copies every level from its offset in srcBuffer, e.g. block compressed levels cooked offline
+        void recordUploadLevels(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, const std::vector<VkDeviceSize>& levelOffsets);
+
+        uint32_t getBindlessIndex() const { return m_BindlessIndex; }
+        uint32_t getWidth() const { return m_Width; }
+        uint32_t getHeight() const { return m_Height; }
+        uint32_t getMipLevels() const { return m_MipLevels; }
+        VkFormat getFormat() const { return m_Format; }
+        VkImage getImage() const { return m_Image; }
+        VkImageView getImageView() const { return m_ImageView; }
+        VkSampler getSampler() const { return m_Sampler; }
+        VkDescriptorImageInfo descriptorInfo() const;
+
+    private:
+        void createImageView();
+        void createSampler();
+        void recordLayoutTransition(
+            VkCommandBuffer commandBuffer,
+            uint32_t baseMipLevel,
+            uint32_t levelCount,
+            VkImageLayout oldLayout,
+            VkImageLayout newLayout,
+            VkAccessFlags srcAccessMask,
+            VkAccessFlags dstAccessMask,
+            VkPipelineStageFlags srcStage,
+            VkPipelineStageFlags dstStage);
+
+        VhlDevice& m_VhlDevice;
+        VhlBindlessTable& m_BindlessTable;
+
+        uint32_t m_Width;
+        uint32_t m_Height;
+        uint32_t m_MipLevels;
+        VkFormat m_Format;
+
+        VkImage m_Image = VK_NULL_HANDLE;
+        VkDeviceMemory m_ImageMemory = VK_NULL_HANDLE;
+        VkImageView m_ImageView = VK_NULL_HANDLE;
+        VkSampler m_Sampler = VK_NULL_HANDLE;
+        uint32_t m_BindlessIndex = VhlBindlessTable::INVALID_INDEX;
+    };
+}
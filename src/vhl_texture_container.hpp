@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// std
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace vhl
+{
+    // Layout of the .vtex files written by tools/texture_cooker, modelled on KTX2: a fixed header,
+    // a level index with one entry per mip (mip 0 first), then the block compressed level data
+    // stored smallest level first so a reader can stop early. Every level starts on a 16 byte
+    // boundary, which satisfies the bufferOffset rules of vkCmdCopyBufferToImage for BC formats,
+    // so the file can be copied into a staging buffer as is. All fields are little endian.
+    namespace texture_container
+    {
+        constexpr uint8_t IDENTIFIER[12] = {0xAB, 'V', 'H', 'L', ' ', '1', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+        constexpr uint64_t LEVEL_ALIGNMENT = 16;
+        constexpr const char* FILE_EXTENSION = ".vtex";
+
+        struct Header
+        {
+            uint8_t identifier[12];
+            uint32_t vkFormat;                // one of the block compressed formats in blockBytes
+            uint32_t pixelWidth;
+            uint32_t pixelHeight;
+            uint32_t levelCount;
+            uint32_t supercompressionScheme;  // reserved, always 0
+        };
+
+        struct Level
+        {
+            uint64_t byteOffset;              // from the start of the file
+            uint64_t byteLength;
+            uint64_t uncompressedByteLength;  // the same level as RGBA8, for reports
+        };
+
+        static_assert(sizeof(Header) == 32, "Texture container header must be tightly packed");
+        static_assert(sizeof(Level) == 24, "Texture container level must be tightly packed");
+
+        inline uint32_t blockCount(uint32_t pixels) { return (pixels + 3) / 4; }
+
+        // Bytes per 4x4 block of the formats the cooker writes, 0 for any other format
+        inline uint32_t blockBytes(uint32_t vkFormat)
+        {
+            switch (vkFormat)
+            {
+                case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+                    return 8;
+                case VK_FORMAT_BC5_UNORM_BLOCK:
+                case VK_FORMAT_BC7_UNORM_BLOCK:
+                case VK_FORMAT_BC7_SRGB_BLOCK:
+                    return 16;
+                default:
+                    return 0;
+            }
+        }
+
+        inline bool hasIdentifier(const Header& header)
+        {
+            return std::memcmp(header.identifier, IDENTIFIER, sizeof(IDENTIFIER)) == 0;
+        }
+
+        // Returns nullptr when data holds a well formed container, otherwise what is wrong with it
+        inline const char* read(const uint8_t* data, size_t size, Header& header, std::vector<Level>& levels)
+        {
+            if (size < sizeof(Header)) return "file is too small";
+            std::memcpy(&header, data, sizeof(Header));
+            if (!hasIdentifier(header)) return "not a texture container";
+            if (header.supercompressionScheme != 0) return "unsupported supercompression scheme";
+            if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.levelCount == 0 || header.levelCount > 32)
+            {
+                return "invalid texture dimensions";
+            }
+            // past the 1x1 level of the chain
+            if ((header.pixelWidth >> (header.levelCount - 1)) == 0 && (header.pixelHeight >> (header.levelCount - 1)) == 0)
+            {
+                return "too many levels";
+            }
+            uint32_t formatBlockBytes = blockBytes(header.vkFormat);
+            if (formatBlockBytes == 0) return "unsupported format";
+
+            size_t indexEnd = sizeof(Header) + header.levelCount * sizeof(Level);
+            if (size < indexEnd) return "truncated level index";
+            levels.resize(header.levelCount);
+            std::memcpy(levels.data(), data + sizeof(Header), header.levelCount * sizeof(Level));
+
+            for (uint32_t i = 0; i < header.levelCount; i++)
+            {
+                const auto& level = levels[i];
+                uint32_t width = std::max(header.pixelWidth >> i, 1u);
+                uint32_t height = std::max(header.pixelHeight >> i, 1u);
+                if (level.byteLength != blockCount(width) * static_cast<uint64_t>(blockCount(height)) * formatBlockBytes)
+                {
+                    return "level size does not match its dimensions";
+                }
+                if (level.byteOffset % LEVEL_ALIGNMENT != 0) return "misaligned level";
+                if (level.byteOffset < indexEnd || level.byteLength > size || level.byteOffset > size - level.byteLength)
+                {
+                    return "truncated level data";
+                }
+            }
+            return nullptr;
+        }
+    }
+}
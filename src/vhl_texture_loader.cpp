@@ -0,0 +1,55 @@
+#include "vhl_texture_loader.hpp"
+
+#include "vhl_profiler.hpp"
+#include "vhl_utils.hpp"
+
+namespace vhl
+{
+    VhlTextureLoader::VhlTextureLoader(VhlDevice& device, VhlBindlessTable& bindlessTable, uint32_t workerCount)
+        : m_VhlDevice(device),
+          m_BindlessTable(bindlessTable),
+          m_Queue(
+              device,
+              "texture",
+              "texture loader",
+              [this](std::vector<VhlTexture::StagedTexture>& staged, VkCommandBuffer commandBuffer)
+              { return recordUploads(staged, commandBuffer); },
+              workerCount == 0 ? workerThreadShare(1, 4) : workerCount)
+    {
+    }
+
+    void VhlTextureLoader::load(const std::string& filepath, Callback onLoaded)
+    {
+        m_Queue.push(
+            filepath,
+            [this, filepath]
+            {
+                VHL_PROFILE_SCOPE("decode texture");
+                return VhlTexture::stageFile(m_VhlDevice, filepath);
+            },
+            std::move(onLoaded));
+    }
+
+    void VhlTextureLoader::update()
+    {
+        VHL_PROFILE_SCOPE("VhlTextureLoader::update");
+        m_Queue.update();
+    }
+
+    void VhlTextureLoader::waitIdle()
+    {
+        m_Queue.waitIdle();
+    }
+
+    std::vector<std::shared_ptr<VhlTexture>> VhlTextureLoader::recordUploads(
+        std::vector<VhlTexture::StagedTexture>& staged, VkCommandBuffer commandBuffer)
+    {
+        std::vector<std::shared_ptr<VhlTexture>> textures;
+        textures.reserve(staged.size());
+        for (auto& texture : staged)
+        {
+            textures.push_back(VhlTexture::createFromStaged(m_VhlDevice, m_BindlessTable, texture, commandBuffer));
+        }
+        return textures;
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "vhl_bindless_table.hpp"
+#include "vhl_buffer.hpp"
+#include "vhl_device.hpp"
+#include "vhl_texture.hpp"
+#include "vhl_upload_queue.hpp"
+
+// std
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vhl
+{
+    // The texture counterpart of VhlModelLoader: workers decode images with stb_image, or map cooked
+    // .vtex containers, into staging buffers, update() records the uploads (and mip generation for
+    // decoded images) into one fenced command buffer and hands each texture to its callback once
+    // that fence has signalled.
+    class VhlTextureLoader
+    {
+    public:
+        using Callback = std::function<void(std::shared_ptr<VhlTexture>)>;
+
+        // workerCount == 0 picks this pool's share of the hardware threads, see workerThreadShare
+        VhlTextureLoader(VhlDevice& device, VhlBindlessTable& bindlessTable, uint32_t workerCount = 0);
+
+        VhlTextureLoader(const VhlTextureLoader&) = delete;
+        VhlTextureLoader& operator=(const VhlTextureLoader&) = delete;
+
+        // The callback runs on the thread calling update(), with nullptr if the file failed to load
+        void load(const std::string& filepath, Callback onLoaded);
+
+        // Call once per frame, outside of command buffer recording
+        void update();
+
+        // Blocks until every requested texture has been published
+        void waitIdle();
+
+        uint32_t getPendingCount() const { return m_Queue.getPendingCount(); }
+
+        // Staging bytes the last update() submitted for upload
+        VkDeviceSize getUploadedBytes() const { return m_Queue.getUploadedBytes(); }
+
+    private:
+        std::vector<std::shared_ptr<VhlTexture>> recordUploads(
+            std::vector<VhlTexture::StagedTexture>& staged, VkCommandBuffer commandBuffer);
+
+        VhlDevice& m_VhlDevice;
+        VhlBindlessTable& m_BindlessTable;
+
+        // last, its workers have to be joined before the rest goes away
+        VhlUploadQueue<VhlTexture::StagedTexture, VhlTexture> m_Queue;
+    };
+}
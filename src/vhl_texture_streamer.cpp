@@ -0,0 +1,412 @@
+#include "vhl_texture_streamer.hpp"
+
+#include "vhl_profiler.hpp"
+#include "vhl_swap_chain.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace vhl
+{
+    VhlStreamedTexture::VhlStreamedTexture(const std::string& filepath) : m_Path(filepath), m_File(filepath)
+    {
+        if (const char* error = texture_container::read(m_File.data(), m_File.size(), m_Header, m_Levels))
+        {
+            throw std::runtime_error("failed to read texture container " + filepath + ": " + error);
+        }
+        if (m_Header.levelCount > VhlTexture::mipLevelCount(m_Header.pixelWidth, m_Header.pixelHeight))
+        {
+            throw std::runtime_error("failed to stream texture " + filepath + ": too many levels");
+        }
+
+        m_TailLevel = m_Header.levelCount - 1;
+        for (uint32_t level = 0; level < m_Header.levelCount; level++)
+        {
+            if (std::max(m_Header.pixelWidth >> level, m_Header.pixelHeight >> level) <= VhlTextureStreamer::TAIL_SIZE)
+            {
+                m_TailLevel = level;
+                break;
+            }
+        }
+    }
+
+    void VhlStreamedTexture::requestScreenSize(float pixels)
+    {
+        if (!(pixels > 0.f)) return;
+
+        // one texel per pixel along the larger side
+        float texels = static_cast<float>(std::max(m_Header.pixelWidth, m_Header.pixelHeight));
+        uint32_t level = 0;
+        if (pixels < texels)
+        {
+            level = std::min(static_cast<uint32_t>(std::log2(texels / pixels)), m_Header.levelCount - 1);
+        }
+        m_RequestedLevel = std::min(m_RequestedLevel, level);
+    }
+
+    VkDeviceSize VhlStreamedTexture::chainBytes(uint32_t firstLevel) const
+    {
+        VkDeviceSize bytes = 0;
+        for (uint32_t level = firstLevel; level < m_Header.levelCount; level++)
+        {
+            bytes += m_Levels[level].byteLength;
+        }
+        return bytes;
+    }
+
+    VhlTextureStreamer::VhlTextureStreamer(
+        VhlDevice& device, VhlBindlessTable& bindlessTable, VkDeviceSize budgetBytes, VkDeviceSize uploadBudgetBytes)
+        : m_VhlDevice(device),
+          m_BindlessTable(bindlessTable),
+          m_BudgetBytes(budgetBytes),
+          m_EffectiveBudgetBytes(budgetBytes),
+          m_UploadBudgetBytes(uploadBudgetBytes)
+    {
+    }
+
+    VhlTextureStreamer::~VhlTextureStreamer()
+    {
+        submitUploads();
+        for (auto& upload : m_Uploads)
+        {
+            vkWaitForFences(m_VhlDevice.device(), 1, &upload.fence, VK_TRUE, UINT64_MAX);
+            destroyUpload(upload);
+        }
+        releaseRetired(true);
+    }
+
+    std::shared_ptr<VhlStreamedTexture> VhlTextureStreamer::open(const std::string& filepath)
+    {
+        std::shared_ptr<VhlStreamedTexture> texture{new VhlStreamedTexture(filepath)};
+        if (!VhlTexture::canSample(m_VhlDevice, static_cast<VkFormat>(texture->m_Header.vkFormat)))
+        {
+            throw std::runtime_error("failed to stream texture " + filepath + ": format not supported by the device");
+        }
+
+        m_Lru.push_back(texture.get());
+        texture->m_LruPosition = std::prev(m_Lru.end());
+        texture->m_WantedLevel = texture->m_TailLevel;
+        m_Textures.push_back(texture);
+        return texture;
+    }
+
+    void VhlTextureStreamer::update()
+    {
+        VHL_PROFILE_SCOPE("VhlTextureStreamer::update");
+        m_FrameNumber++;
+        m_UploadedBytes = 0;
+
+        releaseRetired(false);
+        publishUploads();
+        forgetUnused();
+        updateWantedLevels();
+
+        VkDeviceSize committedTotal = 0;
+        for (const auto& texture : m_Textures)
+        {
+            committedTotal += committedBytes(*texture);
+        }
+        // give memory back before the device-local heap runs out, whatever our own budget says
+        m_EffectiveBudgetBytes = m_VhlDevice.fitToMemoryBudget(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, committedTotal, m_BudgetBytes);
+        streamIn(committedTotal);
+        // mip tails are uploaded regardless of the budget, make up for them with older textures
+        if (committedTotal > m_EffectiveBudgetBytes)
+        {
+            evict(committedTotal, 0, nullptr);
+        }
+
+        submitUploads();
+    }
+
+    void VhlTextureStreamer::waitIdle()
+    {
+        submitUploads();
+        for (auto& upload : m_Uploads)
+        {
+            vkWaitForFences(m_VhlDevice.device(), 1, &upload.fence, VK_TRUE, UINT64_MAX);
+        }
+        publishUploads();
+    }
+
+    uint32_t VhlTextureStreamer::committedLevel(const VhlStreamedTexture& texture)
+    {
+        return texture.m_PendingLevel != VhlStreamedTexture::NO_LEVEL ? texture.m_PendingLevel : texture.m_ResidentLevel;
+    }
+
+    VkDeviceSize VhlTextureStreamer::committedBytes(const VhlStreamedTexture& texture)
+    {
+        uint32_t level = committedLevel(texture);
+        return level != VhlStreamedTexture::NO_LEVEL ? texture.chainBytes(level) : 0;
+    }
+
+    void VhlTextureStreamer::forgetUnused()
+    {
+        // an upload in flight still points at its texture, it goes once that has been published
+        auto unused = std::partition(m_Textures.begin(), m_Textures.end(), [](const auto& texture) {
+            return texture.use_count() > 1 || texture->m_PendingLevel != VhlStreamedTexture::NO_LEVEL;
+        });
+        for (auto it = unused; it != m_Textures.end(); ++it)
+        {
+            m_Lru.erase((*it)->m_LruPosition);
+            retire(std::move((*it)->m_Resident));
+        }
+        m_Textures.erase(unused, m_Textures.end());
+    }
+
+    void VhlTextureStreamer::updateWantedLevels()
+    {
+        for (auto& texture : m_Textures)
+        {
+            // textures nobody asked for only need their tail, but keep what they have until the budget runs out
+            if (texture->m_RequestedLevel == VhlStreamedTexture::NO_LEVEL)
+            {
+                texture->m_WantedLevel = texture->m_TailLevel;
+                continue;
+            }
+
+            texture->m_WantedLevel = std::min(texture->m_RequestedLevel, texture->m_TailLevel);
+            texture->m_RequestedLevel = VhlStreamedTexture::NO_LEVEL;
+            texture->m_LastRequestedFrame = m_FrameNumber;
+            m_Lru.splice(m_Lru.begin(), m_Lru, texture->m_LruPosition);
+        }
+    }
+
+    void VhlTextureStreamer::streamIn(VkDeviceSize& committedTotal)
+    {
+        std::vector<VhlStreamedTexture*> candidates;
+        for (auto& texture : m_Textures)
+        {
+            if (texture->m_PendingLevel != VhlStreamedTexture::NO_LEVEL) continue;
+            if (texture->m_ResidentLevel == VhlStreamedTexture::NO_LEVEL || texture->m_ResidentLevel > texture->m_WantedLevel)
+            {
+                candidates.push_back(texture.get());
+            }
+        }
+
+        // textures without any level first, then the ones furthest from what they need
+        std::sort(candidates.begin(), candidates.end(), [](const VhlStreamedTexture* a, const VhlStreamedTexture* b) {
+            bool aEmpty = a->m_ResidentLevel == VhlStreamedTexture::NO_LEVEL;
+            bool bEmpty = b->m_ResidentLevel == VhlStreamedTexture::NO_LEVEL;
+            if (aEmpty != bEmpty) return aEmpty;
+            if (aEmpty) return false;
+            return a->m_ResidentLevel - a->m_WantedLevel > b->m_ResidentLevel - b->m_WantedLevel;
+        });
+
+        for (auto* texture : candidates)
+        {
+            bool tail = texture->m_ResidentLevel == VhlStreamedTexture::NO_LEVEL;
+            // one level at a time, so every frame shows a little more detail
+            uint32_t level = tail ? texture->m_TailLevel : texture->m_ResidentLevel - 1;
+            VkDeviceSize uploadBytes = texture->chainBytes(level);
+            VkDeviceSize growth = uploadBytes - committedBytes(*texture);
+
+            if (!tail)
+            {
+                // at least one upload per frame, or levels larger than the budget would never arrive
+                if (m_UploadedBytes > 0 && m_UploadedBytes + uploadBytes > m_UploadBudgetBytes) continue;
+                if (committedTotal + growth > m_EffectiveBudgetBytes)
+                {
+                    evict(committedTotal, growth, texture);
+                    if (committedTotal + growth > m_EffectiveBudgetBytes) continue;
+                }
+            }
+
+            schedule(*texture, level);
+            committedTotal += growth;
+        }
+    }
+
+    void VhlTextureStreamer::evict(VkDeviceSize& committedTotal, VkDeviceSize neededBytes, const VhlStreamedTexture* keep)
+    {
+        // least recently requested first; what is on screen this frame stays
+        for (auto it = m_Lru.rbegin(); it != m_Lru.rend() && committedTotal + neededBytes > m_EffectiveBudgetBytes; ++it)
+        {
+            auto* texture = *it;
+            if (texture == keep || texture->m_LastRequestedFrame == m_FrameNumber) continue;
+            if (texture->m_PendingLevel != VhlStreamedTexture::NO_LEVEL) continue;
+            if (texture->m_ResidentLevel == VhlStreamedTexture::NO_LEVEL || texture->m_ResidentLevel >= texture->m_TailLevel) continue;
+
+            committedTotal -= texture->chainBytes(texture->m_ResidentLevel) - texture->chainBytes(texture->m_TailLevel);
+            schedule(*texture, texture->m_TailLevel);
+            m_Evictions++;
+        }
+    }
+
+    void VhlTextureStreamer::schedule(VhlStreamedTexture& texture, uint32_t level)
+    {
+        assert(texture.m_PendingLevel == VhlStreamedTexture::NO_LEVEL && "Texture already has an upload in flight");
+
+        if (m_Recording.commandBuffer == VK_NULL_HANDLE)
+        {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandPool = m_VhlDevice.getCommandPool();
+            allocInfo.commandBufferCount = 1;
+            if (vkAllocateCommandBuffers(m_VhlDevice.device(), &allocInfo, &m_Recording.commandBuffer) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to allocate texture streaming command buffer!");
+            }
+
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(m_Recording.commandBuffer, &beginInfo);
+        }
+
+        // every level of the new image comes from the mapped file, the coarser ones again rather
+        // than copied from the old image, which frames in flight may still be sampling
+        uint32_t levelCount = texture.m_Header.levelCount - level;
+        std::vector<VkDeviceSize> offsets(levelCount);
+        VkDeviceSize stagingBytes = 0;
+        for (uint32_t i = 0; i < levelCount; i++)
+        {
+            stagingBytes = (stagingBytes + texture_container::LEVEL_ALIGNMENT - 1) / texture_container::LEVEL_ALIGNMENT *
+                           texture_container::LEVEL_ALIGNMENT;
+            offsets[i] = stagingBytes;
+            stagingBytes += texture.m_Levels[level + i].byteLength;
+        }
+
+        auto stagingBuffer = std::make_unique<VhlBuffer>(
+            m_VhlDevice,
+            stagingBytes,
+            1,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        if (stagingBuffer->map() != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to map texture streaming staging buffer!");
+        }
+        auto* mapped = static_cast<uint8_t*>(stagingBuffer->getMappedMemory());
+        for (uint32_t i = 0; i < levelCount; i++)
+        {
+            const auto& source = texture.m_Levels[level + i];
+            std::memcpy(mapped + offsets[i], texture.m_File.data() + source.byteOffset, source.byteLength);
+        }
+        stagingBuffer->unmap();
+
+        auto version = std::make_shared<VhlTexture>(
+            m_VhlDevice,
+            m_BindlessTable,
+            std::max(texture.m_Header.pixelWidth >> level, 1u),
+            std::max(texture.m_Header.pixelHeight >> level, 1u),
+            static_cast<VkFormat>(texture.m_Header.vkFormat),
+            levelCount);
+        version->recordUploadLevels(m_Recording.commandBuffer, stagingBuffer->getBuffer(), offsets);
+
+        texture.m_PendingLevel = level;
+        m_UploadedBytes += stagingBytes;
+        m_Recording.textures.push_back(&texture);
+        m_Recording.versions.push_back(std::move(version));
+        m_Recording.levels.push_back(level);
+        m_Recording.stagingBuffers.push_back(std::move(stagingBuffer));
+    }
+
+    void VhlTextureStreamer::submitUploads()
+    {
+        if (m_Recording.commandBuffer == VK_NULL_HANDLE) return;
+
+        if (vkEndCommandBuffer(m_Recording.commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record texture streaming command buffer!");
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(m_VhlDevice.device(), &fenceInfo, nullptr, &m_Recording.fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create texture streaming fence!");
+        }
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &m_Recording.commandBuffer;
+        if (vkQueueSubmit(m_VhlDevice.graphicsQueue(), 1, &submitInfo, m_Recording.fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit texture streaming upload!");
+        }
+
+        m_Uploads.push_back(std::move(m_Recording));
+        m_Recording = Upload{};
+    }
+
+    void VhlTextureStreamer::publishUploads()
+    {
+        auto it = m_Uploads.begin();
+        while (it != m_Uploads.end())
+        {
+            if (vkGetFenceStatus(m_VhlDevice.device(), it->fence) != VK_SUCCESS)
+            {
+                ++it;
+                continue;
+            }
+
+            for (size_t i = 0; i < it->textures.size(); i++)
+            {
+                auto* texture = it->textures[i];
+                retire(std::move(texture->m_Resident));
+                texture->m_Resident = std::move(it->versions[i]);
+                texture->m_ResidentLevel = it->levels[i];
+                texture->m_PendingLevel = VhlStreamedTexture::NO_LEVEL;
+            }
+            destroyUpload(*it);
+            it = m_Uploads.erase(it);
+        }
+    }
+
+    void VhlTextureStreamer::retire(std::shared_ptr<VhlTexture> texture)
+    {
+        if (texture == nullptr) return;
+        m_Retired.push_back({std::move(texture), m_FrameNumber});
+    }
+
+    void VhlTextureStreamer::releaseRetired(bool all)
+    {
+        // frames recorded before the swap may still be in flight, each holds on for at most
+        // MAX_FRAMES_IN_FLIGHT updates
+        auto released = std::remove_if(m_Retired.begin(), m_Retired.end(), [this, all](const Retired& retired) {
+            return all || m_FrameNumber - retired.frame > VhlSwapChain::MAX_FRAMES_IN_FLIGHT;
+        });
+        m_Retired.erase(released, m_Retired.end());
+    }
+
+    void VhlTextureStreamer::destroyUpload(Upload& upload)
+    {
+        vkDestroyFence(m_VhlDevice.device(), upload.fence, nullptr);
+        vkFreeCommandBuffers(m_VhlDevice.device(), m_VhlDevice.getCommandPool(), 1, &upload.commandBuffer);
+        upload.stagingBuffers.clear();
+        upload.versions.clear();
+    }
+
+    VhlTextureStreamer::Stats VhlTextureStreamer::getStats() const
+    {
+        Stats stats{};
+        stats.textures = static_cast<uint32_t>(m_Textures.size());
+        stats.budgetBytes = m_BudgetBytes;
+        stats.effectiveBudgetBytes = m_EffectiveBudgetBytes;
+        stats.uploadedBytes = m_UploadedBytes;
+        stats.uploadBudgetBytes = m_UploadBudgetBytes;
+        stats.evictions = m_Evictions;
+        for (const auto& upload : m_Uploads)
+        {
+            stats.pendingUploads += static_cast<uint32_t>(upload.textures.size());
+        }
+
+        for (const auto& texture : m_Textures)
+        {
+            stats.totalLevels += texture->m_Header.levelCount;
+            if (texture->m_ResidentLevel == VhlStreamedTexture::NO_LEVEL) continue;
+
+            stats.residentLevels += texture->m_Header.levelCount - texture->m_ResidentLevel;
+            stats.residentBytes += texture->chainBytes(texture->m_ResidentLevel);
+            if (texture->m_ResidentLevel <= texture->m_WantedLevel) stats.texturesAtWantedLevel++;
+        }
+        return stats;
+    }
+}
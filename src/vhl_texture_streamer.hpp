@@ -0,0 +1,164 @@
+#pragma once
+
+#include "vhl_bindless_table.hpp"
+#include "vhl_buffer.hpp"
+#include "vhl_device.hpp"
+#include "vhl_mapped_file.hpp"
+#include "vhl_texture.hpp"
+#include "vhl_texture_container.hpp"
+
+// std
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vhl
+{
+    // A cooked .vtex texture whose finer levels come and go with demand. Only the levels from
+    // getResidentLevel() down to the smallest live on the GPU; the image is swapped for a new one,
+    // with a new bindless slot, whenever that changes, so read getBindlessIndex() every frame.
+    class VhlStreamedTexture
+    {
+    public:
+        static constexpr uint32_t NO_LEVEL = ~0u;
+
+        VhlStreamedTexture(const VhlStreamedTexture&) = delete;
+        VhlStreamedTexture& operator=(const VhlStreamedTexture&) = delete;
+
+        // Called during culling with the size in pixels the texture covers on screen, the finest
+        // level asked for by any caller this frame is the one streamed in
+        void requestScreenSize(float pixels);
+
+        // INVALID_INDEX until the first levels have been uploaded
+        uint32_t getBindlessIndex() const
+        {
+            return m_Resident != nullptr ? m_Resident->getBindlessIndex() : VhlBindlessTable::INVALID_INDEX;
+        }
+        const std::string& getPath() const { return m_Path; }
+        uint32_t getWidth() const { return m_Header.pixelWidth; }
+        uint32_t getHeight() const { return m_Header.pixelHeight; }
+        uint32_t getLevelCount() const { return m_Header.levelCount; }
+        // finest level on the GPU, NO_LEVEL while nothing is
+        uint32_t getResidentLevel() const { return m_ResidentLevel; }
+
+    private:
+        VhlStreamedTexture(const std::string& filepath);
+
+        // bytes of the levels from firstLevel down to the smallest
+        VkDeviceSize chainBytes(uint32_t firstLevel) const;
+
+        std::string m_Path;
+        VhlMappedFile m_File;
+        texture_container::Header m_Header;
+        std::vector<texture_container::Level> m_Levels;
+        uint32_t m_TailLevel = 0;  // coarsest levels kept resident as long as the texture exists
+
+        std::shared_ptr<VhlTexture> m_Resident;
+        uint32_t m_ResidentLevel = NO_LEVEL;
+        uint32_t m_PendingLevel = NO_LEVEL;  // level of the upload in flight, if any
+        uint32_t m_RequestedLevel = NO_LEVEL;  // finest level asked for since the last update()
+        uint32_t m_WantedLevel = NO_LEVEL;
+        uint64_t m_LastRequestedFrame = 0;
+        std::list<VhlStreamedTexture*>::iterator m_LruPosition;
+
+        friend class VhlTextureStreamer;
+    };
+
+    // Streams the levels of VhlStreamedTextures in and out. update() turns the screen sizes
+    // reported during culling into wanted levels and uploads missing ones a level at a time, at
+    // most uploadBudgetBytes per frame. While the resident levels exceed the memory budget, the
+    // textures requested least recently are dropped back to their mip tail. The budget is lowered
+    // by VhlDevice::fitToMemoryBudget while the device-local heap runs short.
+    class VhlTextureStreamer
+    {
+    public:
+        // Levels no larger than this are uploaded as soon as a texture is opened and never evicted
+        static constexpr uint32_t TAIL_SIZE = 64;
+
+        struct Stats
+        {
+            uint32_t textures = 0;
+            uint32_t texturesAtWantedLevel = 0;  // nothing left to stream in for them
+            uint32_t residentLevels = 0;
+            uint32_t totalLevels = 0;
+            uint32_t pendingUploads = 0;
+            VkDeviceSize residentBytes = 0;
+            VkDeviceSize budgetBytes = 0;
+            VkDeviceSize effectiveBudgetBytes = 0;  // budgetBytes as lowered for the device-local heap
+            VkDeviceSize uploadedBytes = 0;  // in the last update()
+            VkDeviceSize uploadBudgetBytes = 0;
+            uint32_t evictions = 0;  // since the streamer was created
+        };
+
+        VhlTextureStreamer(VhlDevice& device, VhlBindlessTable& bindlessTable, VkDeviceSize budgetBytes, VkDeviceSize uploadBudgetBytes);
+        ~VhlTextureStreamer();
+
+        VhlTextureStreamer(const VhlTextureStreamer&) = delete;
+        VhlTextureStreamer& operator=(const VhlTextureStreamer&) = delete;
+
+        // Maps the container and schedules its mip tail, throws if the file cannot be streamed.
+        // The texture is forgotten once nothing else holds the returned pointer.
+        std::shared_ptr<VhlStreamedTexture> open(const std::string& filepath);
+
+        // Call once per frame, outside of command buffer recording and after culling has
+        // requested the screen sizes of the previous frame
+        void update();
+
+        // Blocks until every upload in flight has been published
+        void waitIdle();
+
+        Stats getStats() const;
+        // Staging bytes the last update() submitted, the cheap part of getStats()
+        VkDeviceSize getUploadedBytes() const { return m_UploadedBytes; }
+
+    private:
+        struct Upload
+        {
+            std::vector<VhlStreamedTexture*> textures;
+            std::vector<std::shared_ptr<VhlTexture>> versions;
+            std::vector<uint32_t> levels;
+            std::vector<std::unique_ptr<VhlBuffer>> stagingBuffers;
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            VkFence fence = VK_NULL_HANDLE;
+        };
+
+        // A replaced image, destroyed once no frame in flight can still sample it
+        struct Retired
+        {
+            std::shared_ptr<VhlTexture> texture;
+            uint64_t frame;
+        };
+
+        static uint32_t committedLevel(const VhlStreamedTexture& texture);
+        static VkDeviceSize committedBytes(const VhlStreamedTexture& texture);
+
+        void forgetUnused();
+        void updateWantedLevels();
+        void streamIn(VkDeviceSize& committedTotal);
+        void evict(VkDeviceSize& committedTotal, VkDeviceSize neededBytes, const VhlStreamedTexture* keep);
+        void schedule(VhlStreamedTexture& texture, uint32_t level);
+        void submitUploads();
+        void publishUploads();
+        void releaseRetired(bool all);
+        void retire(std::shared_ptr<VhlTexture> texture);
+        void destroyUpload(Upload& upload);
+
+        VhlDevice& m_VhlDevice;
+        VhlBindlessTable& m_BindlessTable;
+        VkDeviceSize m_BudgetBytes;
+        VkDeviceSize m_EffectiveBudgetBytes;  // for the current update()
+        VkDeviceSize m_UploadBudgetBytes;
+
+        std::vector<std::shared_ptr<VhlStreamedTexture>> m_Textures;
+        std::list<VhlStreamedTexture*> m_Lru;  // most recently requested first
+        Upload m_Recording{};  // scheduled this update(), submitted at its end
+        std::vector<Upload> m_Uploads;
+        std::vector<Retired> m_Retired;
+
+        uint64_t m_FrameNumber = 0;
+        VkDeviceSize m_UploadedBytes = 0;
+        uint32_t m_Evictions = 0;
+    };
+}
@@ -0,0 +1,66 @@
+#include "vhl_uniform_ring.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace vhl
+{
+    VhlUniformRing::VhlUniformRing(VhlDevice& device, VkDeviceSize bytesPerFrame, uint32_t frameCount)
+    {
+        const auto& limits = device.properties.limits;
+        m_Alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+
+        // coherent memory, so blocks written during recording need no flush before submit; also
+        // usable as an indirect, vertex or index buffer for draw data built on the CPU
+        m_Buffer = std::make_unique<VhlBuffer>(
+            device,
+            VhlBuffer::getAlignment(bytesPerFrame, m_Alignment),
+            frameCount,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            m_Alignment);
+        if (m_Buffer->map() != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to map uniform ring buffer!");
+        }
+    }
+
+    void VhlUniformRing::beginFrame(uint32_t frameIndex)
+    {
+        assert(frameIndex < m_Buffer->getInstanceCount() && "Frame index outside of the uniform ring");
+
+        m_FrameBegin = m_Buffer->getAlignmentSize() * frameIndex;
+        m_FrameEnd = m_FrameBegin + m_Buffer->getInstanceSize();
+        m_Head = m_FrameBegin;
+    }
+
+    VhlUniformRing::Allocation VhlUniformRing::allocate(VkDeviceSize size)
+    {
+        VkDeviceSize offset = VhlBuffer::getAlignment(m_Head, m_Alignment);
+        if (offset + size > m_FrameEnd)
+        {
+            throw std::runtime_error("uniform ring is out of space for this frame!");
+        }
+        m_Head = offset + size;
+        m_PeakBytesUsed = std::max(m_PeakBytesUsed, getBytesUsed());
+
+        Allocation allocation{};
+        allocation.mapped = static_cast<char*>(m_Buffer->getMappedMemory()) + offset;
+        allocation.offset = static_cast<uint32_t>(offset);
+        allocation.size = size;
+        return allocation;
+    }
+
+    VkDescriptorBufferInfo VhlUniformRing::descriptorInfo(VkDeviceSize range) const
+    {
+        return VkDescriptorBufferInfo{m_Buffer->getBuffer(), 0, range};
+    }
+
+    VkDescriptorBufferInfo VhlUniformRing::descriptorInfo(const Allocation& allocation) const
+    {
+        return VkDescriptorBufferInfo{m_Buffer->getBuffer(), allocation.offset, allocation.size};
+    }
+}
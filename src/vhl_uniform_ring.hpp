@@ -0,0 +1,65 @@
+#pragma once
+
+#include "vhl_buffer.hpp"
+#include "vhl_device.hpp"
+
+// std
+#include <cstring>
+#include <memory>
+
+namespace vhl
+{
+    // A persistently mapped buffer split into one region per frame in flight. Systems bump-allocate
+    // aligned blocks for per-frame, per-pass or per-draw data and bind them through a
+    // *_DYNAMIC descriptor, passing the block offset as the dynamic offset. A region is recycled
+    // when beginFrame() is called for the same frame index again, after its fence has been waited on.
+    class VhlUniformRing
+    {
+    public:
+        struct Allocation
+        {
+            void* mapped = nullptr;
+            uint32_t offset = 0;  // dynamic offset, relative to the start of the buffer
+            VkDeviceSize size = 0;
+        };
+
+        VhlUniformRing(VhlDevice& device, VkDeviceSize bytesPerFrame, uint32_t frameCount);
+
+        VhlUniformRing(const VhlUniformRing&) = delete;
+        VhlUniformRing& operator=(const VhlUniformRing&) = delete;
+
+        void beginFrame(uint32_t frameIndex);
+
+        // Aligned to both the uniform and the storage buffer offset alignment, so a block can be
+        // bound through either descriptor type
+        Allocation allocate(VkDeviceSize size);
+
+        template <typename T>
+        Allocation push(const T& value)
+        {
+            auto allocation = allocate(sizeof(T));
+            std::memcpy(allocation.mapped, &value, sizeof(T));
+            return allocation;
+        }
+
+        // range is the largest block a single dynamic binding will read
+        VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) const;
+        // For binding one block through a regular (non-dynamic) descriptor
+        VkDescriptorBufferInfo descriptorInfo(const Allocation& allocation) const;
+
+        VkBuffer getBuffer() const { return m_Buffer->getBuffer(); }
+        VkDeviceSize getAlignment() const { return m_Alignment; }
+        VkDeviceSize getBytesPerFrame() const { return m_Buffer->getInstanceSize(); }
+        VkDeviceSize getBytesUsed() const { return m_Head - m_FrameBegin; }
+        VkDeviceSize getPeakBytesUsed() const { return m_PeakBytesUsed; }
+
+    private:
+        std::unique_ptr<VhlBuffer> m_Buffer;
+        VkDeviceSize m_Alignment;
+
+        VkDeviceSize m_FrameBegin = 0;
+        VkDeviceSize m_FrameEnd = 0;
+        VkDeviceSize m_Head = 0;
+        VkDeviceSize m_PeakBytesUsed = 0;
+    };
+}
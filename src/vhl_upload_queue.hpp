@@ -0,0 +1,344 @@
+#pragma once
+
+#include "vhl_buffer.hpp"
+#include "vhl_device.hpp"
+#include "vhl_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vhl
+{
+    // The worker pool and fenced submission shared by the asset loaders. Workers run each request's
+    // stage function, which reads the file into a staging buffer; update() hands every staged entry
+    // to the record function, which creates the resources and records their uploads into one command
+    // buffer, submits that with a fence and, once the fence has signalled, passes each resource to
+    // its callback. Staged keeps its staging buffer in a std::unique_ptr<VhlBuffer> stagingBuffer.
+    template <typename Staged, typename Resource>
+    class VhlUploadQueue
+    {
+    public:
+        using Callback = std::function<void(std::shared_ptr<Resource>)>;
+        // Runs on a worker and throws when the file can't be loaded
+        using StageFunction = std::function<Staged()>;
+        // Runs on the thread calling update(), returns one resource per staged entry in the same
+        // order, nullptr for those it could not create
+        using RecordFunction =
+            std::function<std::vector<std::shared_ptr<Resource>>(std::vector<Staged>&, VkCommandBuffer)>;
+
+        // resourceName only shows up in messages, threadName has to outlive the profiler
+        VhlUploadQueue(
+            VhlDevice& device,
+            const char* resourceName,
+            const char* threadName,
+            RecordFunction record,
+            uint32_t workerCount);
+        ~VhlUploadQueue();
+
+        VhlUploadQueue(const VhlUploadQueue&) = delete;
+        VhlUploadQueue& operator=(const VhlUploadQueue&) = delete;
+
+        // The callback runs on the thread calling update(). Files that fail to load are reported
+        // and their callback gets nullptr.
+        void push(const std::string& filepath, StageFunction stage, Callback onLoaded);
+
+        // Call once per frame, outside of command buffer recording. Submits the uploads of staged
+        // entries and publishes the ones whose upload has finished.
+        void update();
+
+        // Blocks until every pushed request has been published
+        void waitIdle();
+
+        // Requests pushed but not yet published
+        uint32_t getPendingCount() const { return m_Pending.load(std::memory_order_acquire); }
+
+        // Staging bytes the last update() submitted for upload
+        VkDeviceSize getUploadedBytes() const { return m_UploadedBytes; }
+
+    private:
+        struct Request
+        {
+            std::string filepath;
+            StageFunction stage;
+            Callback onLoaded;
+        };
+
+        // no staging buffer when staging failed
+        struct StagedRequest
+        {
+            Callback onLoaded;
+            Staged staged;
+        };
+
+        struct Upload
+        {
+            std::vector<std::shared_ptr<Resource>> resources;
+            std::vector<Callback> callbacks;
+            std::vector<std::unique_ptr<VhlBuffer>> stagingBuffers;
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            VkFence fence = VK_NULL_HANDLE;
+        };
+
+        void workerLoop();
+        void stage(Request& request);
+        void submitUploads();
+        void publishUploads();
+        void destroyUpload(Upload& upload);
+
+        VhlDevice& m_VhlDevice;
+        const char* m_ResourceName;
+        const char* m_ThreadName;
+        RecordFunction m_Record;
+
+        std::vector<std::thread> m_Workers;
+        std::deque<Request> m_Requests;       // guarded by m_Mutex
+        std::vector<StagedRequest> m_Staged;  // guarded by m_Mutex
+        std::vector<Upload> m_Uploads;        // main thread only
+        std::atomic<uint32_t> m_Pending{0};
+        VkDeviceSize m_UploadedBytes = 0;     // main thread only
+
+        mutable std::mutex m_Mutex;
+        std::condition_variable m_RequestAvailable;
+        std::condition_variable m_RequestsFinished;
+        uint32_t m_ActiveRequests = 0;
+        bool m_ShuttingDown = false;
+    };
+
+    template <typename Staged, typename Resource>
+    VhlUploadQueue<Staged, Resource>::VhlUploadQueue(
+        VhlDevice& device, const char* resourceName, const char* threadName, RecordFunction record, uint32_t workerCount)
+        : m_VhlDevice(device), m_ResourceName(resourceName), m_ThreadName(threadName), m_Record(std::move(record))
+    {
+        m_Workers.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; i++)
+        {
+            m_Workers.emplace_back(&VhlUploadQueue::workerLoop, this);
+        }
+    }
+
+    template <typename Staged, typename Resource>
+    VhlUploadQueue<Staged, Resource>::~VhlUploadQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_ShuttingDown = true;
+            m_Requests.clear();
+        }
+        m_RequestAvailable.notify_all();
+
+        for (auto& worker : m_Workers)
+        {
+            worker.join();
+        }
+
+        // the copies may still be running, the staging buffers and resources have to outlive them
+        for (auto& upload : m_Uploads)
+        {
+            vkWaitForFences(m_VhlDevice.device(), 1, &upload.fence, VK_TRUE, UINT64_MAX);
+            destroyUpload(upload);
+        }
+    }
+
+    template <typename Staged, typename Resource>
+    void VhlUploadQueue<Staged, Resource>::push(const std::string& filepath, StageFunction stage, Callback onLoaded)
+    {
+        m_Pending.fetch_add(1, std::memory_order_acq_rel);
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Requests.push_back({filepath, std::move(stage), std::move(onLoaded)});
+        }
+        m_RequestAvailable.notify_one();
+    }
+
+    template <typename Staged, typename Resource>
+    void VhlUploadQueue<Staged, Resource>::update()
+    {
+        m_UploadedBytes = 0;
+        publishUploads();
+        submitUploads();
+    }
+
+    template <typename Staged, typename Resource>
+    void VhlUploadQueue<Staged, Resource>::waitIdle()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_RequestsFinished.wait(lock, [this] { return m_Requests.empty() && m_ActiveRequests == 0; });
+        }
+        submitUploads();
+
+        for (auto& upload : m_Uploads)
+        {
+            vkWaitForFences(m_VhlDevice.device(), 1, &upload.fence, VK_TRUE, UINT64_MAX);
+        }
+        publishUploads();
+    }
+
+    template <typename Staged, typename Resource>
+    void VhlUploadQueue<Staged, Resource>::workerLoop()
+    {
+        VHL_PROFILE_THREAD(m_ThreadName);
+        while (true)
+        {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_RequestAvailable.wait(lock, [this] { return m_ShuttingDown || !m_Requests.empty(); });
+                if (m_ShuttingDown) return;
+
+                request = std::move(m_Requests.front());
+                m_Requests.pop_front();
+                m_ActiveRequests++;
+            }
+
+            stage(request);
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_ActiveRequests--;
+            }
+            m_RequestsFinished.notify_all();
+        }
+    }
+
+    template <typename Staged, typename Resource>
+    void VhlUploadQueue<Staged, Resource>::stage(Request& request)
+    {
+        StagedRequest staged{};
+        staged.onLoaded = std::move(request.onLoaded);
+
+        try
+        {
+            staged.staged = request.stage();
+        }
+        catch (const std::exception& e)
+        {
+            // a missing file should not take the app down from a worker, update() reports the
+            // failure on the main thread
+            std::cerr << m_ResourceName << " " << request.filepath << " failed to load: " << e.what() << std::endl;
+            staged.staged = Staged{};
+        }
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Staged.push_back(std::move(staged));
+    }
+
+    template <typename Staged, typename Resource>
+    void VhlUploadQueue<Staged, Resource>::submitUploads()
+    {
+        std::vector<StagedRequest> staged;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            staged.swap(m_Staged);
+        }
+
+        auto failed = std::partition(
+            staged.begin(), staged.end(), [](const auto& request) { return request.staged.stagingBuffer != nullptr; });
+        for (auto it = failed; it != staged.end(); ++it)
+        {
+            it->onLoaded(nullptr);
+            m_Pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+        staged.erase(failed, staged.end());
+        if (staged.empty()) return;
+
+        Upload upload{};
+        std::vector<Staged> batch;
+        batch.reserve(staged.size());
+        for (auto& request : staged)
+        {
+            upload.callbacks.push_back(std::move(request.onLoaded));
+            batch.push_back(std::move(request.staged));
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = m_VhlDevice.getCommandPool();
+        allocInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(m_VhlDevice.device(), &allocInfo, &upload.commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error(std::string("failed to allocate ") + m_ResourceName + " upload command buffer!");
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(upload.commandBuffer, &beginInfo);
+
+        upload.resources = m_Record(batch, upload.commandBuffer);
+        assert(upload.resources.size() == batch.size() && "record function must return one resource per staged entry");
+
+        for (auto& entry : batch)
+        {
+            m_UploadedBytes += entry.stagingBuffer->getBufferSize();
+            upload.stagingBuffers.push_back(std::move(entry.stagingBuffer));
+        }
+
+        if (vkEndCommandBuffer(upload.commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error(std::string("failed to record ") + m_ResourceName + " upload command buffer!");
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(m_VhlDevice.device(), &fenceInfo, nullptr, &upload.fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error(std::string("failed to create ") + m_ResourceName + " upload fence!");
+        }
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &upload.commandBuffer;
+        if (vkQueueSubmit(m_VhlDevice.graphicsQueue(), 1, &submitInfo, upload.fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error(std::string("failed to submit ") + m_ResourceName + " upload!");
+        }
+
+        m_Uploads.push_back(std::move(upload));
+    }
+
+    template <typename Staged, typename Resource>
+    void VhlUploadQueue<Staged, Resource>::publishUploads()
+    {
+        auto it = m_Uploads.begin();
+        while (it != m_Uploads.end())
+        {
+            if (vkGetFenceStatus(m_VhlDevice.device(), it->fence) != VK_SUCCESS)
+            {
+                ++it;
+                continue;
+            }
+
+            for (size_t i = 0; i < it->resources.size(); i++)
+            {
+                it->callbacks[i](std::move(it->resources[i]));
+                m_Pending.fetch_sub(1, std::memory_order_acq_rel);
+            }
+            destroyUpload(*it);
+            it = m_Uploads.erase(it);
+        }
+    }
+
+    template <typename Staged, typename Resource>
+    void VhlUploadQueue<Staged, Resource>::destroyUpload(Upload& upload)
+    {
+        vkDestroyFence(m_VhlDevice.device(), upload.fence, nullptr);
+        vkFreeCommandBuffers(m_VhlDevice.device(), m_VhlDevice.getCommandPool(), 1, &upload.commandBuffer);
+        upload.stagingBuffers.clear();
+        upload.resources.clear();
+    }
+}
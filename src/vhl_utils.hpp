@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <functional>
+#include <thread>
 
 namespace vhl {
 
@@ -12,4 +15,14 @@ namespace vhl {
         (hashCombine(seed, rest), ...);
     };
 
+    // The engine's worker pools split the hardware threads besides the main thread between them,
+    // so together they never outnumber the cores. Each gets numerator / denominator of them, and
+    // at least one. The shares in use: pipeline compiles 2/4, model and texture loading 1/4 each.
+    inline uint32_t workerThreadShare(uint32_t numerator, uint32_t denominator)
+    {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        uint32_t workerThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+        return std::max(1u, workerThreads * numerator / denominator);
+    }
+
 }  // namespace vhl
\ No newline at end of file
@@ -1,20 +1,34 @@
 #include "vhl_window.hpp"
 
+#include <cassert>
 #include <stdexcept>
 
 namespace vhl 
 {
-	VhlWindow::VhlWindow(int w, int h, std::string name) : m_Width(w), m_Height(h), m_WindowName(name)
+	VhlWindow::VhlWindow(int w, int h, std::string name, bool headless)
+		: m_Width(w), m_Height(h), m_Headless(headless), m_WindowName(name)
 	{
-		initWindow();
+		if (!m_Headless)
+		{
+			initWindow();
+		}
 	}
 
 	VhlWindow::~VhlWindow()
 	{
+		if (m_Headless) return;
 		glfwDestroyWindow(m_Window);
 		glfwTerminate();
 	}
 
+	void VhlWindow::pollEvents()
+	{
+		if (!m_Headless)
+		{
+			glfwPollEvents();
+		}
+	}
+
 	void VhlWindow::initWindow()
 	{
 		glfwInit();
@@ -29,6 +43,7 @@ namespace vhl
 
 	void VhlWindow::createWindowSurface(VkInstance instance, VkSurfaceKHR* pSurface)
 	{
+		assert(!m_Headless && "Headless windows have no surface");
 		if (glfwCreateWindowSurface(instance, m_Window, nullptr, pSurface) != VK_SUCCESS) {
             throw std::runtime_error("failed to create window surface!");
         }
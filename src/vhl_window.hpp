@@ -9,18 +9,21 @@ namespace vhl
 {
 	class VhlWindow {
 	public:
-		VhlWindow(int w, int h, std::string name);
+		// A headless window never touches GLFW, the renderer then draws into offscreen images of this size
+		VhlWindow(int w, int h, std::string name, bool headless = false);
 		~VhlWindow();
 
 		// Delete copy constructor and copy assignment
 		VhlWindow(const VhlWindow&) = delete;
 		VhlWindow& operator=(const VhlWindow&) = delete;
 
-		bool shouldClose() { return glfwWindowShouldClose(m_Window); }
+		bool shouldClose() { return !m_Headless && glfwWindowShouldClose(m_Window); }
+		bool isHeadless() const { return m_Headless; }
+		void pollEvents();
 		VkExtent2D getExtent() { return { static_cast<uint32_t>(m_Width), static_cast<uint32_t>(m_Height) }; }
 		bool wasWindowResized() const { return m_FramebufferResized; }
 		void resetWindowResizedFlag() { m_FramebufferResized = false; }
-		GLFWwindow* getGLFWwindow() const { return m_Window; };
+		GLFWwindow* getGLFWwindow() const { return m_Window; };  // nullptr when headless
 
 		void createWindowSurface(VkInstance instance, VkSurfaceKHR* pSurface);
 
@@ -31,8 +34,9 @@ namespace vhl
 		int m_Width;
 		int m_Height;
 		bool m_FramebufferResized = false;
+		bool m_Headless;
 
 		std::string m_WindowName;
-		GLFWwindow* m_Window;
+		GLFWwindow* m_Window = nullptr;
 	};
 }
\ No newline at end of file
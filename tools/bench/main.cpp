@@ -0,0 +1,252 @@
+#include "app.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct BenchOptions
+    {
+        std::string scene = "vases";
+        std::string cameraPath = "orbit";
+        uint32_t frames = 600;
+        uint32_t warmupFrames = 60;  // rendered but not measured, lets streaming and caches settle
+        float timestep = 1.f / 60.f;
+        int width = 1280;
+        int height = 720;
+        std::string outputPath = "bench.json";
+        std::string tracePath{};  // CPU zones of the whole run as a Chrome trace, off when empty
+        std::string statsPath{};  // per-frame counters of the whole run as CSV, off when empty
+        bool graphCheck = false;  // adds and verifies the render graph check passes, see VhlRenderGraphCheck
+    };
+
+    void printUsage()
+    {
+        std::cerr << "usage: vhuiluna_bench [--scene vases|vase_grid] [--camera-path orbit|<file>] [--frames N]\n"
+                     "                      [--warmup N] [--timestep seconds] [--width W] [--height H]\n"
+                     "                      [--output <file.json>] [--trace <trace.json>] [--stats <stats.csv>]\n"
+                     "                      [--graph-check]" << std::endl;
+    }
+
+    BenchOptions parseOptions(int argc, char** argv)
+    {
+        BenchOptions options{};
+        for (int i = 1; i < argc; i++)
+        {
+            bool hasValue = i + 1 < argc;
+            if (std::strcmp(argv[i], "--scene") == 0 && hasValue)
+            {
+                options.scene = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--camera-path") == 0 && hasValue)
+            {
+                options.cameraPath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--frames") == 0 && hasValue)
+            {
+                options.frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue)
+            {
+                options.warmupFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (std::strcmp(argv[i], "--timestep") == 0 && hasValue)
+            {
+                options.timestep = std::stof(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--width") == 0 && hasValue)
+            {
+                options.width = std::stoi(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--height") == 0 && hasValue)
+            {
+                options.height = std::stoi(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--output") == 0 && hasValue)
+            {
+                options.outputPath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--trace") == 0 && hasValue)
+            {
+                options.tracePath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--stats") == 0 && hasValue)
+            {
+                options.statsPath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--graph-check") == 0)
+            {
+                options.graphCheck = true;
+            }
+            else
+            {
+                printUsage();
+                throw std::runtime_error(std::string("unknown argument ") + argv[i]);
+            }
+        }
+
+        if (options.frames == 0 || options.timestep <= 0.f || options.width <= 0 || options.height <= 0)
+        {
+            throw std::runtime_error("frames, timestep, width and height must be positive");
+        }
+        return options;
+    }
+
+    struct Distribution
+    {
+        double mean = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+    };
+
+    // nearest-rank percentiles
+    Distribution summarize(std::vector<double> values)
+    {
+        Distribution distribution{};
+        if (values.empty()) return distribution;
+
+        std::sort(values.begin(), values.end());
+        auto percentile = [&values](double p)
+        {
+            size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+            return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+        };
+
+        distribution.mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+        distribution.min = values.front();
+        distribution.max = values.back();
+        distribution.p50 = percentile(50.0);
+        distribution.p95 = percentile(95.0);
+        distribution.p99 = percentile(99.0);
+        return distribution;
+    }
+
+    void writeDistribution(std::ostream& out, const char* name, const Distribution& distribution, bool last = false)
+    {
+        out << "  \"" << name << "\": { "
+            << "\"mean\": " << distribution.mean << ", "
+            << "\"min\": " << distribution.min << ", "
+            << "\"max\": " << distribution.max << ", "
+            << "\"p50\": " << distribution.p50 << ", "
+            << "\"p95\": " << distribution.p95 << ", "
+            << "\"p99\": " << distribution.p99 << " }" << (last ? "\n" : ",\n");
+    }
+
+    std::string escapeJson(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\') escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+}
+
+// Renders a scene headless along a camera path at a fixed timestep and writes frame time
+// percentiles, GPU time and draw counts as JSON, so runs on the same machine compare between commits
+int main(int argc, char** argv)
+{
+    try
+    {
+        BenchOptions options = parseOptions(argc, argv);
+
+        std::vector<vhl::HuiFrameSample> samples;
+        samples.reserve(options.frames);
+
+        vhl::HuiAppOptions appOptions{};
+        appOptions.width = options.width;
+        appOptions.height = options.height;
+        appOptions.headless = true;
+        appOptions.frameCount = options.warmupFrames + options.frames;
+        appOptions.scene = options.scene;
+        appOptions.cameraPath = options.cameraPath;
+        appOptions.fixedTimestep = options.timestep;
+        appOptions.tracePath = options.tracePath;
+        appOptions.statsPath = options.statsPath;
+        appOptions.pipelineStatistics = !options.statsPath.empty();
+        appOptions.renderGraphCheck = options.graphCheck;
+        appOptions.onFrame = [&samples, &options](const vhl::HuiFrameSample& sample)
+        {
+            if (sample.frameNumber >= options.warmupFrames)
+            {
+                samples.push_back(sample);
+            }
+        };
+
+        vhl::HuiApp app{appOptions};
+        std::string deviceName = app.getDeviceName();
+        app.run();
+
+        std::vector<double> cpuTimes;
+        std::vector<double> gpuTimes;
+        std::vector<double> draws;
+        std::vector<double> drawCalls;
+        std::vector<double> triangles;
+        std::vector<double> pipelineBinds;
+        std::vector<double> descriptorSetBinds;
+        for (const auto& sample : samples)
+        {
+            cpuTimes.push_back(sample.cpuFrameTime);
+            if (sample.gpuFrameTime >= 0.f) gpuTimes.push_back(sample.gpuFrameTime);
+            draws.push_back(sample.counters.instances);
+            drawCalls.push_back(sample.counters.drawCalls);
+            triangles.push_back(static_cast<double>(sample.counters.triangles));
+            pipelineBinds.push_back(sample.counters.pipelineBinds);
+            descriptorSetBinds.push_back(sample.counters.descriptorSetBinds);
+        }
+        Distribution cpu = summarize(cpuTimes);
+        Distribution gpu = summarize(gpuTimes);
+
+        std::ofstream out{options.outputPath};
+        if (!out)
+        {
+            throw std::runtime_error("failed to open " + options.outputPath + " for writing");
+        }
+        out << std::fixed << std::setprecision(4);
+        out << "{\n"
+            << "  \"scene\": \"" << escapeJson(options.scene) << "\",\n"
+            << "  \"camera_path\": \"" << escapeJson(options.cameraPath) << "\",\n"
+            << "  \"device\": \"" << escapeJson(deviceName) << "\",\n"
+            << "  \"width\": " << options.width << ",\n"
+            << "  \"height\": " << options.height << ",\n"
+            << "  \"timestep\": " << options.timestep << ",\n"
+            << "  \"warmup_frames\": " << options.warmupFrames << ",\n"
+            << "  \"frames\": " << samples.size() << ",\n"
+            << "  \"gpu_frames\": " << gpuTimes.size() << ",\n";
+        writeDistribution(out, "cpu_frame_ms", cpu);
+        writeDistribution(out, "gpu_frame_ms", gpu);
+        writeDistribution(out, "draws", summarize(draws));
+        writeDistribution(out, "draw_calls", summarize(drawCalls));
+        writeDistribution(out, "triangles", summarize(triangles));
+        writeDistribution(out, "pipeline_binds", summarize(pipelineBinds));
+        writeDistribution(out, "descriptor_set_binds", summarize(descriptorSetBinds), true);
+        out << "}\n";
+
+        std::cout << std::fixed << std::setprecision(3)
+                  << "bench " << options.scene << ": cpu p50 " << cpu.p50 << " ms, p95 " << cpu.p95 << " ms, p99 "
+                  << cpu.p99 << " ms, gpu p50 " << gpu.p50 << " ms over " << samples.size() << " frames -> "
+                  << options.outputPath << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
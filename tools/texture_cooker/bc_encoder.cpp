@@ -0,0 +1,580 @@
+#include "bc_encoder.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace vhl
+{
+    namespace bc
+    {
+        namespace
+        {
+            constexpr int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+            // Principal axis of the points through power iteration on their covariance matrix
+            template <int N>
+            void principalAxis(const float points[][N], int count, float mean[N], float axis[N])
+            {
+                for (int c = 0; c < N; c++)
+                {
+                    mean[c] = 0.f;
+                    for (int i = 0; i < count; i++) mean[c] += points[i][c];
+                    mean[c] /= static_cast<float>(std::max(count, 1));
+                }
+
+                float covariance[N][N] = {};
+                for (int i = 0; i < count; i++)
+                {
+                    for (int a = 0; a < N; a++)
+                    {
+                        for (int b = 0; b < N; b++)
+                        {
+                            covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+                        }
+                    }
+                }
+
+                for (int c = 0; c < N; c++) axis[c] = 1.f;
+                for (int iteration = 0; iteration < 8; iteration++)
+                {
+                    float next[N] = {};
+                    float length = 0.f;
+                    for (int a = 0; a < N; a++)
+                    {
+                        for (int b = 0; b < N; b++) next[a] += covariance[a][b] * axis[b];
+                        length = std::max(length, std::abs(next[a]));
+                    }
+                    // flat block, any axis will do
+                    if (length < 1e-6f) break;
+                    for (int c = 0; c < N; c++) axis[c] = next[c] / length;
+                }
+
+                float length = 0.f;
+                for (int c = 0; c < N; c++) length += axis[c] * axis[c];
+                length = std::sqrt(length);
+                for (int c = 0; c < N; c++) axis[c] /= length;
+            }
+
+            // Endpoints minimizing the squared error for fixed interpolation weights, weight w blends
+            // w * a + (1 - w) * b; returns false when the system is singular
+            template <int N>
+            bool leastSquaresEndpoints(const float points[][N], const float weights[], int count, float a[N], float b[N])
+            {
+                float aa = 0.f, bb = 0.f, ab = 0.f;
+                float ax[N] = {};
+                float bx[N] = {};
+                for (int i = 0; i < count; i++)
+                {
+                    float alpha = weights[i];
+                    float beta = 1.f - alpha;
+                    aa += alpha * alpha;
+                    bb += beta * beta;
+                    ab += alpha * beta;
+                    for (int c = 0; c < N; c++)
+                    {
+                        ax[c] += alpha * points[i][c];
+                        bx[c] += beta * points[i][c];
+                    }
+                }
+
+                float determinant = aa * bb - ab * ab;
+                if (std::abs(determinant) < 1e-6f) return false;
+                for (int c = 0; c < N; c++)
+                {
+                    a[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.f, 255.f);
+                    b[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.f, 255.f);
+                }
+                return true;
+            }
+
+            class BitWriter
+            {
+            public:
+                explicit BitWriter(uint8_t* data) : m_Data(data) {}
+
+                void write(uint32_t value, int bitCount)
+                {
+                    for (int i = 0; i < bitCount; i++, m_Position++)
+                    {
+                        if (value & (1u << i)) m_Data[m_Position >> 3] |= static_cast<uint8_t>(1u << (m_Position & 7));
+                    }
+                }
+
+            private:
+                uint8_t* m_Data;
+                int m_Position = 0;
+            };
+
+            class BitReader
+            {
+            public:
+                explicit BitReader(const uint8_t* data) : m_Data(data) {}
+
+                uint32_t read(int bitCount)
+                {
+                    uint32_t value = 0;
+                    for (int i = 0; i < bitCount; i++, m_Position++)
+                    {
+                        value |= static_cast<uint32_t>((m_Data[m_Position >> 3] >> (m_Position & 7)) & 1) << i;
+                    }
+                    return value;
+                }
+
+            private:
+                const uint8_t* m_Data;
+                int m_Position = 0;
+            };
+
+            // ---- BC1 ----
+
+            uint16_t packRgb565(const float color[3])
+            {
+                auto quantize = [](float value, float maxValue) {
+                    return static_cast<uint16_t>(std::clamp(std::lround(value * maxValue / 255.f), 0L, static_cast<long>(maxValue)));
+                };
+                return static_cast<uint16_t>(
+                    (quantize(color[0], 31.f) << 11) | (quantize(color[1], 63.f) << 5) | quantize(color[2], 31.f));
+            }
+
+            void unpackRgb565(uint16_t packed, int color[3])
+            {
+                int r = (packed >> 11) & 31;
+                int g = (packed >> 5) & 63;
+                int b = packed & 31;
+                color[0] = (r << 3) | (r >> 2);
+                color[1] = (g << 2) | (g >> 4);
+                color[2] = (b << 3) | (b >> 2);
+            }
+
+            // Palette as the decoder computes it, index 3 is transparent black in three color mode
+            void bc1Palette(uint16_t color0, uint16_t color1, int palette[4][4])
+            {
+                unpackRgb565(color0, palette[0]);
+                unpackRgb565(color1, palette[1]);
+                palette[0][3] = palette[1][3] = 255;
+                for (int c = 0; c < 3; c++)
+                {
+                    if (color0 > color1)
+                    {
+                        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                    }
+                    else
+                    {
+                        palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                        palette[3][c] = 0;
+                    }
+                }
+                palette[2][3] = 255;
+                palette[3][3] = color0 > color1 ? 255 : 0;
+            }
+
+            struct Bc1Candidate
+            {
+                uint16_t color0;
+                uint16_t color1;
+                uint32_t indices;
+                float error;
+            };
+
+            Bc1Candidate bc1Evaluate(uint16_t color0, uint16_t color1, const float points[16][3], const bool transparent[16])
+            {
+                Bc1Candidate candidate{color0, color1, 0, 0.f};
+                int palette[4][4];
+                bc1Palette(color0, color1, palette);
+                // the transparent entry only ever holds transparent texels
+                int opaqueEntries = color0 > color1 ? 4 : 3;
+
+                for (int i = 0; i < 16; i++)
+                {
+                    uint32_t best = 3;
+                    if (!transparent[i])
+                    {
+                        float bestError = std::numeric_limits<float>::max();
+                        for (int entry = 0; entry < opaqueEntries; entry++)
+                        {
+                            float error = 0.f;
+                            for (int c = 0; c < 3; c++)
+                            {
+                                float delta = points[i][c] - static_cast<float>(palette[entry][c]);
+                                error += delta * delta;
+                            }
+                            if (error < bestError)
+                            {
+                                bestError = error;
+                                best = static_cast<uint32_t>(entry);
+                            }
+                        }
+                        candidate.error += bestError;
+                    }
+                    candidate.indices |= best << (2 * i);
+                }
+                return candidate;
+            }
+
+            // Orders the endpoints for the mode the block needs and evaluates them
+            Bc1Candidate bc1Fit(const float a[3], const float b[3], bool hasTransparent, const float points[16][3], const bool transparent[16])
+            {
+                uint16_t color0 = packRgb565(a);
+                uint16_t color1 = packRgb565(b);
+                bool fourColors = color0 > color1;
+                if (fourColors == hasTransparent) std::swap(color0, color1);
+                return bc1Evaluate(color0, color1, points, transparent);
+            }
+
+            // ---- BC4 ----
+
+            void encodeBC4(const uint8_t values[16], uint8_t block[8])
+            {
+                uint8_t minValue = *std::min_element(values, values + 16);
+                uint8_t maxValue = *std::max_element(values, values + 16);
+
+                // eight value mode, a flat block decodes every index to the first endpoint
+                int palette[8];
+                palette[0] = maxValue;
+                palette[1] = minValue;
+                for (int i = 2; i < 8; i++)
+                {
+                    palette[i] = ((8 - i) * maxValue + (i - 1) * minValue + 3) / 7;
+                }
+
+                uint64_t indices = 0;
+                for (int i = 0; i < 16; i++)
+                {
+                    uint64_t best = 0;
+                    int bestError = std::numeric_limits<int>::max();
+                    for (int entry = 0; entry < 8; entry++)
+                    {
+                        int error = std::abs(values[i] - palette[entry]);
+                        if (error < bestError)
+                        {
+                            bestError = error;
+                            best = static_cast<uint64_t>(entry);
+                        }
+                    }
+                    indices |= best << (3 * i);
+                }
+
+                block[0] = maxValue;
+                block[1] = minValue;
+                for (int i = 0; i < 6; i++)
+                {
+                    block[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+                }
+            }
+
+            void decodeBC4(const uint8_t block[8], uint8_t values[16])
+            {
+                int palette[8];
+                palette[0] = block[0];
+                palette[1] = block[1];
+                if (palette[0] > palette[1])
+                {
+                    for (int i = 2; i < 8; i++) palette[i] = ((8 - i) * palette[0] + (i - 1) * palette[1] + 3) / 7;
+                }
+                else
+                {
+                    for (int i = 2; i < 6; i++) palette[i] = ((6 - i) * palette[0] + (i - 1) * palette[1] + 2) / 5;
+                    palette[6] = 0;
+                    palette[7] = 255;
+                }
+
+                uint64_t indices = 0;
+                for (int i = 0; i < 6; i++) indices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+                for (int i = 0; i < 16; i++)
+                {
+                    values[i] = static_cast<uint8_t>(palette[(indices >> (3 * i)) & 7]);
+                }
+            }
+
+            // ---- BC7 mode 6 ----
+
+            struct Bc7Candidate
+            {
+                int endpoints[2][4];  // 7 bit values
+                int pBits[2];
+                uint8_t indices[16];
+                float error;
+            };
+
+            void bc7Evaluate(const float points[16][4], Bc7Candidate& candidate)
+            {
+                int colors[2][4];
+                for (int e = 0; e < 2; e++)
+                {
+                    for (int c = 0; c < 4; c++) colors[e][c] = (candidate.endpoints[e][c] << 1) | candidate.pBits[e];
+                }
+
+                int palette[16][4];
+                for (int i = 0; i < 16; i++)
+                {
+                    for (int c = 0; c < 4; c++)
+                    {
+                        palette[i][c] = ((64 - BC7_WEIGHTS[i]) * colors[0][c] + BC7_WEIGHTS[i] * colors[1][c] + 32) >> 6;
+                    }
+                }
+
+                candidate.error = 0.f;
+                for (int i = 0; i < 16; i++)
+                {
+                    float bestError = std::numeric_limits<float>::max();
+                    for (int entry = 0; entry < 16; entry++)
+                    {
+                        float error = 0.f;
+                        for (int c = 0; c < 4; c++)
+                        {
+                            float delta = points[i][c] - static_cast<float>(palette[entry][c]);
+                            error += delta * delta;
+                        }
+                        if (error < bestError)
+                        {
+                            bestError = error;
+                            candidate.indices[i] = static_cast<uint8_t>(entry);
+                        }
+                    }
+                    candidate.error += bestError;
+                }
+            }
+
+            // Tries every p-bit combination for the float endpoints and keeps the best in best
+            void bc7Fit(const float a[4], const float b[4], const float points[16][4], Bc7Candidate& best)
+            {
+                for (int pBits = 0; pBits < 4; pBits++)
+                {
+                    Bc7Candidate candidate{};
+                    candidate.pBits[0] = pBits & 1;
+                    candidate.pBits[1] = pBits >> 1;
+                    for (int c = 0; c < 4; c++)
+                    {
+                        candidate.endpoints[0][c] = std::clamp(static_cast<int>(std::lround((a[c] - candidate.pBits[0]) / 2.f)), 0, 127);
+                        candidate.endpoints[1][c] = std::clamp(static_cast<int>(std::lround((b[c] - candidate.pBits[1]) / 2.f)), 0, 127);
+                    }
+                    bc7Evaluate(points, candidate);
+                    if (candidate.error < best.error) best = candidate;
+                }
+            }
+        }
+
+        void encodeBC1(const uint8_t texels[64], uint8_t block[8])
+        {
+            float points[16][3];
+            float opaquePoints[16][3];
+            bool transparent[16];
+            int opaqueCount = 0;
+            for (int i = 0; i < 16; i++)
+            {
+                transparent[i] = texels[4 * i + 3] < 128;
+                for (int c = 0; c < 3; c++) points[i][c] = texels[4 * i + c];
+                if (!transparent[i])
+                {
+                    std::memcpy(opaquePoints[opaqueCount++], points[i], sizeof(points[i]));
+                }
+            }
+            bool hasTransparent = opaqueCount < 16;
+
+            std::memset(block, 0, BC1_BLOCK_SIZE);
+            if (opaqueCount == 0)
+            {
+                // color0 <= color1 with every index pointing at transparent black
+                std::memset(block + 4, 0xFF, 4);
+                return;
+            }
+
+            float mean[3], axis[3];
+            principalAxis<3>(opaquePoints, opaqueCount, mean, axis);
+            float minT = std::numeric_limits<float>::max();
+            float maxT = std::numeric_limits<float>::lowest();
+            for (int i = 0; i < opaqueCount; i++)
+            {
+                float t = 0.f;
+                for (int c = 0; c < 3; c++) t += (opaquePoints[i][c] - mean[c]) * axis[c];
+                minT = std::min(minT, t);
+                maxT = std::max(maxT, t);
+            }
+            // pull the extremes in a little, they are rarely the best endpoints
+            float inset = (maxT - minT) / 16.f;
+            float a[3], b[3];
+            for (int c = 0; c < 3; c++)
+            {
+                a[c] = std::clamp(mean[c] + axis[c] * (maxT - inset), 0.f, 255.f);
+                b[c] = std::clamp(mean[c] + axis[c] * (minT + inset), 0.f, 255.f);
+            }
+            Bc1Candidate best = bc1Fit(a, b, hasTransparent, points, transparent);
+
+            for (int iteration = 0; iteration < 2; iteration++)
+            {
+                bool fourColors = best.color0 > best.color1;
+                float weights[16];
+                float fitPoints[16][3];
+                int fitCount = 0;
+                for (int i = 0; i < 16; i++)
+                {
+                    uint32_t index = (best.indices >> (2 * i)) & 3;
+                    if (transparent[i]) continue;
+                    constexpr float fourColorWeights[4] = {1.f, 0.f, 2.f / 3.f, 1.f / 3.f};
+                    constexpr float threeColorWeights[4] = {1.f, 0.f, 0.5f, 0.f};
+                    weights[fitCount] = fourColors ? fourColorWeights[index] : threeColorWeights[index];
+                    std::memcpy(fitPoints[fitCount++], points[i], sizeof(points[i]));
+                }
+                if (!leastSquaresEndpoints<3>(fitPoints, weights, fitCount, a, b)) break;
+
+                Bc1Candidate candidate = bc1Fit(a, b, hasTransparent, points, transparent);
+                if (candidate.error >= best.error) break;
+                best = candidate;
+            }
+
+            block[0] = static_cast<uint8_t>(best.color0);
+            block[1] = static_cast<uint8_t>(best.color0 >> 8);
+            block[2] = static_cast<uint8_t>(best.color1);
+            block[3] = static_cast<uint8_t>(best.color1 >> 8);
+            for (int i = 0; i < 4; i++) block[4 + i] = static_cast<uint8_t>(best.indices >> (8 * i));
+        }
+
+        void encodeBC5(const uint8_t texels[64], uint8_t block[16])
+        {
+            uint8_t red[16], green[16];
+            for (int i = 0; i < 16; i++)
+            {
+                red[i] = texels[4 * i];
+                green[i] = texels[4 * i + 1];
+            }
+            encodeBC4(red, block);
+            encodeBC4(green, block + 8);
+        }
+
+        void encodeBC7(const uint8_t texels[64], uint8_t block[16])
+        {
+            float points[16][4];
+            for (int i = 0; i < 16; i++)
+            {
+                for (int c = 0; c < 4; c++) points[i][c] = texels[4 * i + c];
+            }
+
+            float mean[4], axis[4];
+            principalAxis<4>(points, 16, mean, axis);
+            float minT = std::numeric_limits<float>::max();
+            float maxT = std::numeric_limits<float>::lowest();
+            for (int i = 0; i < 16; i++)
+            {
+                float t = 0.f;
+                for (int c = 0; c < 4; c++) t += (points[i][c] - mean[c]) * axis[c];
+                minT = std::min(minT, t);
+                maxT = std::max(maxT, t);
+            }
+
+            float a[4], b[4];
+            for (int c = 0; c < 4; c++)
+            {
+                a[c] = std::clamp(mean[c] + axis[c] * minT, 0.f, 255.f);
+                b[c] = std::clamp(mean[c] + axis[c] * maxT, 0.f, 255.f);
+            }
+            Bc7Candidate best{};
+            best.error = std::numeric_limits<float>::max();
+            bc7Fit(a, b, points, best);
+
+            for (int iteration = 0; iteration < 2 && best.error > 0.f; iteration++)
+            {
+                // index weights blend towards endpoint 1, the least squares fit blends towards a
+                float weights[16];
+                for (int i = 0; i < 16; i++) weights[i] = 1.f - BC7_WEIGHTS[best.indices[i]] / 64.f;
+                if (!leastSquaresEndpoints<4>(points, weights, 16, a, b)) break;
+
+                float previousError = best.error;
+                bc7Fit(a, b, points, best);
+                if (best.error >= previousError) break;
+            }
+
+            // the anchor texel stores its index without the most significant bit
+            if (best.indices[0] & 8)
+            {
+                for (int c = 0; c < 4; c++) std::swap(best.endpoints[0][c], best.endpoints[1][c]);
+                std::swap(best.pBits[0], best.pBits[1]);
+                for (auto& index : best.indices) index = static_cast<uint8_t>(15 - index);
+            }
+
+            std::memset(block, 0, BC7_BLOCK_SIZE);
+            BitWriter writer{block};
+            writer.write(1u << 6, 7);
+            for (int c = 0; c < 4; c++)
+            {
+                writer.write(static_cast<uint32_t>(best.endpoints[0][c]), 7);
+                writer.write(static_cast<uint32_t>(best.endpoints[1][c]), 7);
+            }
+            writer.write(static_cast<uint32_t>(best.pBits[0]), 1);
+            writer.write(static_cast<uint32_t>(best.pBits[1]), 1);
+            for (int i = 0; i < 16; i++)
+            {
+                writer.write(best.indices[i], i == 0 ? 3 : 4);
+            }
+        }
+
+        void decodeBC1(const uint8_t block[8], uint8_t texels[64])
+        {
+            uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+            uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+            int palette[4][4];
+            bc1Palette(color0, color1, palette);
+
+            uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+            for (int i = 0; i < 16; i++)
+            {
+                const int* color = palette[(indices >> (2 * i)) & 3];
+                for (int c = 0; c < 4; c++) texels[4 * i + c] = static_cast<uint8_t>(color[c]);
+            }
+        }
+
+        void decodeBC5(const uint8_t block[16], uint8_t texels[64])
+        {
+            uint8_t red[16], green[16];
+            decodeBC4(block, red);
+            decodeBC4(block + 8, green);
+            for (int i = 0; i < 16; i++)
+            {
+                texels[4 * i] = red[i];
+                texels[4 * i + 1] = green[i];
+                texels[4 * i + 2] = 0;
+                texels[4 * i + 3] = 255;
+            }
+        }
+
+        void decodeBC7(const uint8_t block[16], uint8_t texels[64])
+        {
+            BitReader reader{block};
+            if (reader.read(7) != (1u << 6))
+            {
+                for (int i = 0; i < 16; i++)
+                {
+                    texels[4 * i] = 255;
+                    texels[4 * i + 1] = 0;
+                    texels[4 * i + 2] = 255;
+                    texels[4 * i + 3] = 255;
+                }
+                return;
+            }
+
+            int colors[2][4];
+            for (int c = 0; c < 4; c++)
+            {
+                colors[0][c] = static_cast<int>(reader.read(7));
+                colors[1][c] = static_cast<int>(reader.read(7));
+            }
+            for (int e = 0; e < 2; e++)
+            {
+                int pBit = static_cast<int>(reader.read(1));
+                for (int c = 0; c < 4; c++) colors[e][c] = (colors[e][c] << 1) | pBit;
+            }
+
+            for (int i = 0; i < 16; i++)
+            {
+                int weight = BC7_WEIGHTS[reader.read(i == 0 ? 3 : 4)];
+                for (int c = 0; c < 4; c++)
+                {
+                    texels[4 * i + c] = static_cast<uint8_t>(((64 - weight) * colors[0][c] + weight * colors[1][c] + 32) >> 6);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// std
+#include <cstdint>
+
+namespace vhl
+{
+    // CPU block encoders for the formats the cooker writes. Every function takes one 4x4 block of
+    // RGBA8 texels in row order (64 bytes) and writes the encoded block; the decoders do the reverse
+    // and are used to measure the quality of the encoded result.
+    namespace bc
+    {
+        constexpr uint32_t BC1_BLOCK_SIZE = 8;
+        constexpr uint32_t BC5_BLOCK_SIZE = 16;
+        constexpr uint32_t BC7_BLOCK_SIZE = 16;
+
+        // RGB with 1 bit alpha, texels with alpha below 128 become transparent black
+        void encodeBC1(const uint8_t texels[64], uint8_t block[8]);
+        // two BC4 channels from R and G, meant for tangent space normal maps
+        void encodeBC5(const uint8_t texels[64], uint8_t block[16]);
+        // RGBA in mode 6 only: one subset, 7.7.7.7 endpoints with p-bits and 4 bit indices
+        void encodeBC7(const uint8_t texels[64], uint8_t block[16]);
+
+        void decodeBC1(const uint8_t block[8], uint8_t texels[64]);
+        // writes R and G, B = 0 and A = 255
+        void decodeBC5(const uint8_t block[16], uint8_t texels[64]);
+        // only decodes mode 6, other modes decode to opaque magenta
+        void decodeBC7(const uint8_t block[16], uint8_t texels[64]);
+    }
+}
@@ -0,0 +1,446 @@
+#include "bc_encoder.hpp"
+#include "vhl_texture_container.hpp"
+
+// libs
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include <vulkan/vulkan.h>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Offline texture cooker: decodes an image, builds its mip chain, block compresses every level on
+// the CPU and writes a .vtex container (vhl_texture_container.hpp) that VhlTexture uploads as is.
+// Prints a quality/size report and can append it to a CSV file for batch runs.
+namespace vhl
+{
+    namespace
+    {
+        enum class Codec
+        {
+            BC1,
+            BC5,
+            BC7,
+        };
+
+        struct Options
+        {
+            std::string input;
+            std::string output;
+            Codec codec = Codec::BC7;
+            bool linear = false;
+            std::string reportPath;
+        };
+
+        struct Image
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            std::vector<uint8_t> texels;  // RGBA8
+        };
+
+        struct LevelReport
+        {
+            uint32_t width;
+            uint32_t height;
+            uint64_t bytes;
+            uint64_t uncompressedBytes;
+            double squaredError;
+            uint64_t samples;
+        };
+
+        constexpr uint32_t CHANNELS = 4;
+
+        void printUsage()
+        {
+            std::cout << "usage: texture_cooker <input image> <output.vtex> [--format bc1|bc5|bc7] [--linear] [--report <file.csv>]\n"
+                      << "  --format  bc7 (default) for color, bc1 for opaque or cut-out color at half the size,\n"
+                      << "            bc5 for tangent space normal maps (red and green only)\n"
+                      << "  --linear  store bc1/bc7 as UNORM instead of SRGB and build mips without gamma\n"
+                      << "  --report  append a line with sizes and PSNR to a CSV file" << std::endl;
+        }
+
+        Options parseOptions(int argc, char** argv)
+        {
+            Options options{};
+            std::vector<std::string> positional;
+            for (int i = 1; i < argc; i++)
+            {
+                std::string argument = argv[i];
+                if (argument == "--format" && i + 1 < argc)
+                {
+                    std::string format = argv[++i];
+                    if (format == "bc1") options.codec = Codec::BC1;
+                    else if (format == "bc5") options.codec = Codec::BC5;
+                    else if (format == "bc7") options.codec = Codec::BC7;
+                    else throw std::runtime_error("unknown format " + format);
+                }
+                else if (argument == "--linear")
+                {
+                    options.linear = true;
+                }
+                else if (argument == "--report" && i + 1 < argc)
+                {
+                    options.reportPath = argv[++i];
+                }
+                else if (!argument.empty() && argument[0] == '-')
+                {
+                    throw std::runtime_error("unknown option " + argument);
+                }
+                else
+                {
+                    positional.push_back(argument);
+                }
+            }
+
+            if (positional.size() != 2) throw std::runtime_error("expected an input and an output path");
+            options.input = positional[0];
+            options.output = positional[1];
+            // normal maps are data, never gamma encoded
+            if (options.codec == Codec::BC5) options.linear = true;
+            return options;
+        }
+
+        const char* codecName(Codec codec)
+        {
+            switch (codec)
+            {
+                case Codec::BC1: return "BC1";
+                case Codec::BC5: return "BC5";
+                case Codec::BC7: return "BC7";
+            }
+            return "?";
+        }
+
+        VkFormat vkFormat(Codec codec, bool linear)
+        {
+            switch (codec)
+            {
+                case Codec::BC1: return linear ? VK_FORMAT_BC1_RGBA_UNORM_BLOCK : VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+                case Codec::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+                case Codec::BC7: return linear ? VK_FORMAT_BC7_UNORM_BLOCK : VK_FORMAT_BC7_SRGB_BLOCK;
+            }
+            return VK_FORMAT_UNDEFINED;
+        }
+
+        uint32_t blockSize(Codec codec)
+        {
+            return codec == Codec::BC1 ? bc::BC1_BLOCK_SIZE : bc::BC7_BLOCK_SIZE;
+        }
+
+        // channels the codec stores, the others are left out of the PSNR
+        uint32_t measuredChannels(Codec codec)
+        {
+            switch (codec)
+            {
+                case Codec::BC1: return 3;
+                case Codec::BC5: return 2;
+                case Codec::BC7: return 4;
+            }
+            return 4;
+        }
+
+        float srgbToLinear(float value)
+        {
+            return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+
+        float linearToSrgb(float value)
+        {
+            return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+        }
+
+        // 2x2 box filter, filtering colors in linear space unless the texels already are linear
+        Image downsample(const Image& source, bool linear)
+        {
+            static const auto toLinear = [] {
+                std::vector<float> table(256);
+                for (int i = 0; i < 256; i++) table[i] = srgbToLinear(i / 255.f);
+                return table;
+            }();
+
+            Image target{};
+            target.width = std::max(source.width / 2, 1u);
+            target.height = std::max(source.height / 2, 1u);
+            target.texels.resize(static_cast<size_t>(target.width) * target.height * CHANNELS);
+
+            for (uint32_t y = 0; y < target.height; y++)
+            {
+                for (uint32_t x = 0; x < target.width; x++)
+                {
+                    float sum[CHANNELS] = {};
+                    for (uint32_t dy = 0; dy < 2; dy++)
+                    {
+                        for (uint32_t dx = 0; dx < 2; dx++)
+                        {
+                            uint32_t sx = std::min(2 * x + dx, source.width - 1);
+                            uint32_t sy = std::min(2 * y + dy, source.height - 1);
+                            const uint8_t* texel = &source.texels[(static_cast<size_t>(sy) * source.width + sx) * CHANNELS];
+                            for (uint32_t c = 0; c < CHANNELS; c++)
+                            {
+                                bool gamma = !linear && c < 3;
+                                sum[c] += gamma ? toLinear[texel[c]] : texel[c] / 255.f;
+                            }
+                        }
+                    }
+
+                    uint8_t* texel = &target.texels[(static_cast<size_t>(y) * target.width + x) * CHANNELS];
+                    for (uint32_t c = 0; c < CHANNELS; c++)
+                    {
+                        float value = sum[c] / 4.f;
+                        if (!linear && c < 3) value = linearToSrgb(value);
+                        texel[c] = static_cast<uint8_t>(std::clamp(std::lround(value * 255.f), 0L, 255L));
+                    }
+                }
+            }
+            return target;
+        }
+
+        // Runs fn(row) for every block row, spread over the hardware threads
+        template <typename Fn>
+        void parallelRows(uint32_t rowCount, Fn fn)
+        {
+            uint32_t threadCount = std::max(1u, std::min(std::thread::hardware_concurrency(), rowCount));
+            std::vector<std::thread> threads;
+            threads.reserve(threadCount);
+            for (uint32_t t = 0; t < threadCount; t++)
+            {
+                threads.emplace_back([=] {
+                    for (uint32_t row = t; row < rowCount; row += threadCount) fn(row);
+                });
+            }
+            for (auto& thread : threads) thread.join();
+        }
+
+        // Encodes one level and decodes it again to accumulate the error against the source texels
+        std::vector<uint8_t> encodeLevel(const Image& image, Codec codec, LevelReport& report)
+        {
+            uint32_t blocksX = texture_container::blockCount(image.width);
+            uint32_t blocksY = texture_container::blockCount(image.height);
+            uint32_t size = blockSize(codec);
+            uint32_t channels = measuredChannels(codec);
+
+            std::vector<uint8_t> encoded(static_cast<size_t>(blocksX) * blocksY * size);
+            std::vector<double> rowErrors(blocksY, 0.0);
+
+            parallelRows(blocksY, [&](uint32_t by) {
+                for (uint32_t bx = 0; bx < blocksX; bx++)
+                {
+                    // edge blocks of odd sized levels repeat the last row and column
+                    uint8_t texels[64];
+                    for (uint32_t i = 0; i < 16; i++)
+                    {
+                        uint32_t x = std::min(bx * 4 + i % 4, image.width - 1);
+                        uint32_t y = std::min(by * 4 + i / 4, image.height - 1);
+                        std::memcpy(&texels[i * CHANNELS], &image.texels[(static_cast<size_t>(y) * image.width + x) * CHANNELS], CHANNELS);
+                    }
+
+                    uint8_t* block = &encoded[(static_cast<size_t>(by) * blocksX + bx) * size];
+                    uint8_t decoded[64];
+                    switch (codec)
+                    {
+                        case Codec::BC1:
+                            bc::encodeBC1(texels, block);
+                            bc::decodeBC1(block, decoded);
+                            break;
+                        case Codec::BC5:
+                            bc::encodeBC5(texels, block);
+                            bc::decodeBC5(block, decoded);
+                            break;
+                        case Codec::BC7:
+                            bc::encodeBC7(texels, block);
+                            bc::decodeBC7(block, decoded);
+                            break;
+                    }
+
+                    // only texels inside the level count towards its error
+                    for (uint32_t i = 0; i < 16; i++)
+                    {
+                        if (bx * 4 + i % 4 >= image.width || by * 4 + i / 4 >= image.height) continue;
+                        for (uint32_t c = 0; c < channels; c++)
+                        {
+                            double delta = static_cast<double>(texels[i * CHANNELS + c]) - decoded[i * CHANNELS + c];
+                            rowErrors[by] += delta * delta;
+                        }
+                    }
+                }
+            });
+
+            report.width = image.width;
+            report.height = image.height;
+            report.bytes = encoded.size();
+            report.uncompressedBytes = static_cast<uint64_t>(image.width) * image.height * CHANNELS;
+            report.squaredError = 0.0;
+            for (double error : rowErrors) report.squaredError += error;
+            report.samples = static_cast<uint64_t>(image.width) * image.height * channels;
+            return encoded;
+        }
+
+        double psnr(double squaredError, uint64_t samples)
+        {
+            double mse = squaredError / static_cast<double>(samples);
+            if (mse <= 0.0) return std::numeric_limits<double>::infinity();
+            return 10.0 * std::log10(255.0 * 255.0 / mse);
+        }
+
+        uint64_t alignUp(uint64_t value, uint64_t alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        uint64_t writeContainer(const Options& options, const Image& base, const std::vector<std::vector<uint8_t>>& levels, const std::vector<LevelReport>& reports)
+        {
+            texture_container::Header header{};
+            std::memcpy(header.identifier, texture_container::IDENTIFIER, sizeof(header.identifier));
+            header.vkFormat = static_cast<uint32_t>(vkFormat(options.codec, options.linear));
+            header.pixelWidth = base.width;
+            header.pixelHeight = base.height;
+            header.levelCount = static_cast<uint32_t>(levels.size());
+            header.supercompressionScheme = 0;
+
+            // smallest level first, like KTX2
+            std::vector<texture_container::Level> index(levels.size());
+            uint64_t offset = sizeof(header) + index.size() * sizeof(texture_container::Level);
+            for (size_t level = levels.size(); level-- > 0;)
+            {
+                offset = alignUp(offset, texture_container::LEVEL_ALIGNMENT);
+                index[level].byteOffset = offset;
+                index[level].byteLength = levels[level].size();
+                index[level].uncompressedByteLength = reports[level].uncompressedBytes;
+                offset += levels[level].size();
+            }
+
+            std::ofstream file{options.output, std::ios::binary | std::ios::trunc};
+            if (!file.is_open()) throw std::runtime_error("failed to open " + options.output);
+
+            std::vector<uint8_t> contents(offset, 0);
+            std::memcpy(contents.data(), &header, sizeof(header));
+            std::memcpy(contents.data() + sizeof(header), index.data(), index.size() * sizeof(texture_container::Level));
+            for (size_t level = 0; level < levels.size(); level++)
+            {
+                std::memcpy(contents.data() + index[level].byteOffset, levels[level].data(), levels[level].size());
+            }
+            file.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+            if (!file) throw std::runtime_error("failed to write " + options.output);
+            return contents.size();
+        }
+
+        void appendCsvReport(const Options& options, uint64_t sourceBytes, uint64_t fileBytes, uint64_t rgbaBytes, double basePsnr, double chainPsnr, double seconds)
+        {
+            bool writeHeader = !std::ifstream{options.reportPath}.good();
+            std::ofstream report{options.reportPath, std::ios::app};
+            if (!report.is_open()) throw std::runtime_error("failed to open " + options.reportPath);
+            if (writeHeader)
+            {
+                report << "input,output,format,source_bytes,rgba8_mip_bytes,cooked_bytes,ratio,psnr_mip0_db,psnr_all_db,encode_seconds\n";
+            }
+            report << options.input << ',' << options.output << ',' << codecName(options.codec) << ','
+                   << sourceBytes << ',' << rgbaBytes << ',' << fileBytes << ','
+                   << static_cast<double>(rgbaBytes) / static_cast<double>(fileBytes) << ','
+                   << basePsnr << ',' << chainPsnr << ',' << seconds << '\n';
+        }
+
+        int run(const Options& options)
+        {
+            int width, height, channels;
+            stbi_uc* pixels = stbi_load(options.input.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+            if (pixels == nullptr)
+            {
+                throw std::runtime_error("failed to load " + options.input + ": " + stbi_failure_reason());
+            }
+            Image base{};
+            base.width = static_cast<uint32_t>(width);
+            base.height = static_cast<uint32_t>(height);
+            base.texels.assign(pixels, pixels + static_cast<size_t>(width) * height * CHANNELS);
+            stbi_image_free(pixels);
+
+            std::ifstream source{options.input, std::ios::binary | std::ios::ate};
+            uint64_t sourceBytes = source.good() ? static_cast<uint64_t>(source.tellg()) : 0;
+
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::vector<uint8_t>> levels;
+            std::vector<LevelReport> reports;
+            Image image = base;
+            while (true)
+            {
+                LevelReport report{};
+                levels.push_back(encodeLevel(image, options.codec, report));
+                reports.push_back(report);
+                if (image.width == 1 && image.height == 1) break;
+                image = downsample(image, options.linear);
+            }
+            double seconds = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::steady_clock::now() - start).count();
+
+            uint64_t fileBytes = writeContainer(options, base, levels, reports);
+
+            std::cout << options.input << " -> " << options.output << "\n"
+                      << "  " << base.width << "x" << base.height << " " << codecName(options.codec)
+                      << (options.linear ? " UNORM" : " SRGB") << ", " << levels.size() << " levels, encoded in "
+                      << std::fixed << std::setprecision(2) << seconds << " s\n\n"
+                      << "  level        size      bytes   rgba8 bytes   psnr (dB)\n";
+
+            uint64_t rgbaBytes = 0;
+            double squaredError = 0.0;
+            uint64_t samples = 0;
+            for (size_t level = 0; level < reports.size(); level++)
+            {
+                const auto& report = reports[level];
+                std::string size = std::to_string(report.width) + "x" + std::to_string(report.height);
+                std::cout << "  " << std::setw(5) << level << std::setw(12) << size << std::setw(11) << report.bytes
+                          << std::setw(14) << report.uncompressedBytes << std::setw(12) << std::setprecision(2)
+                          << psnr(report.squaredError, report.samples) << "\n";
+                rgbaBytes += report.uncompressedBytes;
+                squaredError += report.squaredError;
+                samples += report.samples;
+            }
+
+            double basePsnr = psnr(reports[0].squaredError, reports[0].samples);
+            double chainPsnr = psnr(squaredError, samples);
+            double bitsPerTexel = 8.0 * blockSize(options.codec) / 16.0;
+            std::cout << "\n  source file   " << sourceBytes << " bytes\n"
+                      << "  rgba8 + mips  " << rgbaBytes << " bytes\n"
+                      << "  cooked        " << fileBytes << " bytes (" << std::setprecision(1) << bitsPerTexel
+                      << " bpp, " << std::setprecision(2) << static_cast<double>(rgbaBytes) / fileBytes
+                      << "x smaller than rgba8)\n"
+                      << "  psnr          " << basePsnr << " dB mip 0, " << chainPsnr << " dB all levels" << std::endl;
+
+            if (!options.reportPath.empty())
+            {
+                appendCsvReport(options, sourceBytes, fileBytes, rgbaBytes, basePsnr, chainPsnr, seconds);
+            }
+            return EXIT_SUCCESS;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        vhl::printUsage();
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        return vhl::run(vhl::parseOptions(argc, argv));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << '\n';
+        vhl::printUsage();
+        return EXIT_FAILURE;
+    }
+}